@@ -1,108 +1,130 @@
 #include "BoundingBoxTree.h"
 #include "Result.h"
+#include "CollisionHeap.h"
 #include "Math/Ray.h"
 #include "Math/Plane.h"
 #include <algorithm>
+#include <execution>
 #include <format>
 
 using namespace Imzadi;
 
 //--------------------------------- BoundingBoxTree ---------------------------------
 
-BoundingBoxTree::BoundingBoxTree(const AxisAlignedBoundingBox& collisionWorldExtents)
+BoundingBoxTree::BoundingBoxTree(const AxisAlignedBoundingBox& collisionWorldExtents) : BroadPhase(collisionWorldExtents)
 {
-	this->rootNode = nullptr;
-	this->collisionWorldExtents = collisionWorldExtents;
-	this->shapeMap = new std::unordered_map<ShapeID, Shape*>();
+	this->nodeArray = new std::vector<Node>();
+	this->shapeSlotArray = new std::vector<Shape*>();
+	this->numAbandonedShapeSlots = 0;
+	this->numEmptyNodes = 0;
 }
 
 /*virtual*/ BoundingBoxTree::~BoundingBoxTree()
 {
 	this->Clear();
 
-	delete this->shapeMap;
+	delete this->nodeArray;
+	delete this->shapeSlotArray;
 }
 
-bool BoundingBoxTree::Insert(Shape* shape, uint32_t flags)
+/*virtual*/ bool BoundingBoxTree::InsertDynamic(Shape* shape, uint32_t flags)
 {
 	if (!shape)
 		return false;
 
 	// Insertion begins either where the shape is already bound or, if not bound, at the root.
-	BoundingBoxNode* node = shape->node;
-	if (node)
-		node->UnbindFromShape(shape);
-	else
+	uint32_t nodeIndex = shape->nodeIndex;
+	if (nodeIndex != IMZADI_INVALID_NODE_INDEX)
 	{
-		if (!this->rootNode)
+		// The space of a node acts as a fat box for the shapes in it.  A shape that moved,
+		// but is still as deep as it can go in the same node, needs no tree work at all.
+		if ((flags & IMZADI_ADD_FLAG_ALLOW_SPLIT) == 0 && this->IsDeepestFitFor(nodeIndex, shape->GetBoundingBox()))
 		{
-			this->rootNode = new BoundingBoxNode(nullptr);
-			this->rootNode->box = this->collisionWorldExtents;
+			if (this->statistics)
+				this->statistics->RecordReinsertionAvoided();
+
+			return true;
 		}
 
-		node = this->rootNode;
+		if (this->statistics)
+			this->statistics->RecordReinsertion();
+
+		this->UnbindShape(shape);
+	}
+	else
+	{
+		this->MakeRootIfNotAlreadyMade();
+		nodeIndex = 0;
 	}
 
 	// Bring the shape up the tree only as far as is necessary.
-	while (node && !node->box.ContainsBox(shape->GetBoundingBox()))
-		node = node->parentNode;
-	
+	while (nodeIndex != IMZADI_INVALID_NODE_INDEX && !(*this->nodeArray)[nodeIndex].box.ContainsBox(shape->GetBoundingBox()))
+		nodeIndex = (*this->nodeArray)[nodeIndex].parentIndex;
+
 	// Now push the shape down the tree as far as possible.
-	while (node)
+	while (nodeIndex != IMZADI_INVALID_NODE_INDEX)
 	{
-		// Make children for the current node if it doesn't already have them.
-		node->SplitIfNotAlreadySplit();
-
-		// Can the shape fit into any of the children?
-		BoundingBoxNode* foundNode = nullptr;
-		for (BoundingBoxNode* childNode : *node->childNodeArray)
+		// Can the shape fit into either of the children?  They needn't have been made yet to tell.
+		AxisAlignedBoundingBox childBox[2];
+		this->GetChildSpaces(nodeIndex, childBox[0], childBox[1]);
+		uint32_t foundIndex = IMZADI_INVALID_NODE_INDEX;
+		for (uint32_t i = 0; i < 2; i++)
 		{
-			if (childNode->box.ContainsBox(shape->GetBoundingBox()))
+			if (childBox[i].ContainsBox(shape->GetBoundingBox()))
 			{
-				foundNode = childNode;
+				foundIndex = i;
 				break;
 			}
 		}
 
 		// Can we push the shape deeper into the tree?
-		if (foundNode)
+		if (foundIndex != IMZADI_INVALID_NODE_INDEX)
 		{
-			// Yes!
-			node = foundNode;
+			// Yes!  Make the children now if they don't already exist.
+			this->SplitIfNotAlreadySplit(nodeIndex);
+			nodeIndex = (*this->nodeArray)[nodeIndex].childIndex + foundIndex;
 			continue;
 		}
-		
+
 		// The shape is as deep as it can go.  If splitting is not allowed, we're done.
 		if ((flags & IMZADI_ADD_FLAG_ALLOW_SPLIT) == 0)
 			break;
 
 		// Okay, splitting is allowed, but is the node too small for us to want to attempt any further splitting?
-		double nodeVolume = node->box.GetVolume();
+		const Node& node = (*this->nodeArray)[nodeIndex];
+		double nodeVolume = node.box.GetVolume();
 		if (nodeVolume < IMZADI_MIN_NODE_VOLUME)
 			break;
 
-		// Attempt to split the shape.  If we can't, we're done.
+		// Attempt to split the shape.  If we can't, we're done.  The dividing plane
+		// of a node isn't stored, since it's only ever needed here, and is easy to remake.
+		AxisAlignedBoundingBox backBox, frontBox;
+		Plane dividingPlane;
+		node.box.Split(backBox, frontBox, &dividingPlane);
 		Shape* shapeBack = nullptr;
 		Shape* shapeFront = nullptr;
-		if (!shape->Split(node->dividingPlane, shapeBack, shapeFront))
+		if (!shape->Split(dividingPlane, shapeBack, shapeFront))
 			break;
 
-		// The shape was split!  Destroy the original shape and insert the sub-shapes.
+		// The shape was split!  Destroy the original shape and insert the sub-shapes, which
+		// answer to queries in its name.  Each is sure to fit in the child on its side.
+		IMZADI_ASSERT(backBox.ContainsBox(shapeBack->GetBoundingBox()));
+		IMZADI_ASSERT(frontBox.ContainsBox(shapeFront->GetBoundingBox()));
+
+		shapeBack->originalShapeID = shape->originalShapeID;
+		shapeFront->originalShapeID = shape->originalShapeID;
+		this->UntrackShape(shape);
+		this->collisionCache.Forget(shape->GetShapeID());
 		Shape::Free(shape);
 		shape = nullptr;
-		node->BindToShape(shapeBack);
-		node->BindToShape(shapeFront);
-			
-		IMZADI_ASSERT((*node->childNodeArray)[0]->box.ContainsBox(shapeBack->GetBoundingBox()));
-		IMZADI_ASSERT((*node->childNodeArray)[1]->box.ContainsBox(shapeFront->GetBoundingBox()));
 
-		if (!this->Insert(shapeBack, flags))
+		if (!this->InsertDynamic(shapeBack, flags))
 		{
 			Shape::Free(shapeBack);
 			return false;
 		}
 
-		if (!this->Insert(shapeFront, flags))
+		if (!this->InsertDynamic(shapeFront, flags))
 		{
 			Shape::Free(shapeFront);
 			return false;
@@ -113,249 +135,449 @@ bool BoundingBoxTree::Insert(Shape* shape, uint32_t flags)
 
 	if (shape)
 	{
-		if (node)
-			node->BindToShape(shape);
+		if (nodeIndex != IMZADI_INVALID_NODE_INDEX)
+			this->BindShape(nodeIndex, shape);
 
-		this->shapeMap->insert(std::pair<ShapeID, Shape*>(shape->GetShapeID(), shape));
+		this->TrackShape(shape);
 	}
 
 	return true;
 }
 
-bool BoundingBoxTree::Remove(ShapeID shapeID)
+/*virtual*/ void BoundingBoxTree::InsertManyDynamic(std::vector<Shape*>& shapeArray, uint32_t flags)
 {
-	Shape* shape = this->FindShape(shapeID);
-	if (!shape)
-		return false;
-
-	if (shape->node)
-		shape->node->UnbindFromShape(shape);
-	this->shapeMap->erase(shape->GetShapeID());
-	Shape::Free(shape);
-	return true;
+	// A shape being split turns into more shapes to insert as we go, and a shape already in the tree starts
+	// from wherever it is, so in either case the shape is inserted on its own.  All others are done together.
+	auto lastNewShape = shapeArray.begin();
+	if ((flags & IMZADI_ADD_FLAG_ALLOW_SPLIT) == 0)
+		lastNewShape = std::partition(shapeArray.begin(), shapeArray.end(), [](const Shape* shape) -> bool { return shape->nodeIndex == IMZADI_INVALID_NODE_INDEX; });
+
+	for (auto iter = lastNewShape; iter != shapeArray.end(); iter++)
+		if (!this->InsertDynamic(*iter, flags))
+			Shape::Free(*iter);
+
+	// A shape's box is calculated the first time it's asked for, which, for polygons, is a good part of the work
+	// of inserting them, so get that done for all the shapes at once, spread across all cores.
+	std::for_each(std::execution::par, shapeArray.begin(), lastNewShape, [](const Shape* shape) { shape->GetBoundingBox(); });
+
+	// As always, shapes outside the collision world are tracked, but not put in the tree.
+	this->MakeRootIfNotAlreadyMade();
+	const AxisAlignedBoundingBox& rootBox = (*this->nodeArray)[0].box;
+	auto lastInWorldShape = BroadPhase::Partition(shapeArray.begin(), lastNewShape, [&rootBox](const Shape* shape) -> bool { return rootBox.ContainsBox(shape->GetBoundingBox()); });
+	this->InsertShapesUnder(0, shapeArray.begin(), lastInWorldShape);
+
+	for (auto iter = shapeArray.begin(); iter != lastNewShape; iter++)
+		this->TrackShape(*iter);
 }
 
-Shape* BoundingBoxTree::FindShape(ShapeID shapeID)
+void BoundingBoxTree::InsertShapesUnder(uint32_t nodeIndex, std::vector<Shape*>::iterator firstShape, std::vector<Shape*>::iterator lastShape)
 {
-	std::unordered_map<ShapeID, Shape*>::iterator iter = this->shapeMap->find(shapeID);
-	if (iter == this->shapeMap->end())
-		return nullptr;
+	if (firstShape == lastShape)
+		return;
 
-	return iter->second;
-}
+	if ((*this->nodeArray)[nodeIndex].numSubtreeShapes == 0)
+		this->numEmptyNodes--;
 
-bool BoundingBoxTree::ForAllShapes(std::function<bool(const Shape*)> callback) const
-{
-	for (auto pair : *this->shapeMap)
+	(*this->nodeArray)[nodeIndex].numSubtreeShapes += uint32_t(lastShape - firstShape);
+
+	// Sort the shapes into those going down the first child, those going down the second, and those
+	// staying here, trying the children in the same order that the InsertDynamic method does.
+	AxisAlignedBoundingBox firstChildBox, secondChildBox;
+	this->GetChildSpaces(nodeIndex, firstChildBox, secondChildBox);
+	auto lastFirstChildShape = BroadPhase::Partition(firstShape, lastShape, [&firstChildBox](const Shape* shape) -> bool { return firstChildBox.ContainsBox(shape->GetBoundingBox()); });
+	auto lastSecondChildShape = BroadPhase::Partition(lastFirstChildShape, lastShape, [&secondChildBox](const Shape* shape) -> bool { return secondChildBox.ContainsBox(shape->GetBoundingBox()); });
+
+	uint32_t numStayingShapes = uint32_t(lastShape - lastSecondChildShape);
+	if (numStayingShapes > 0)
 	{
-		const Shape* shape = pair.second;
-		if (!callback(shape))
-			return false;
+		if ((*this->nodeArray)[nodeIndex].numShapes + numStayingShapes > (*this->nodeArray)[nodeIndex].shapeSlotCapacity)
+			this->GrowShapeSlotRange(nodeIndex, (*this->nodeArray)[nodeIndex].numShapes + numStayingShapes);
+
+		Node& node = (*this->nodeArray)[nodeIndex];
+		for (auto iter = lastSecondChildShape; iter != lastShape; iter++)
+		{
+			Shape* shape = *iter;
+			uint32_t slotIndex = node.firstShapeSlot + node.numShapes++;
+			(*this->shapeSlotArray)[slotIndex] = shape;
+			shape->nodeIndex = nodeIndex;
+			shape->nodeSlotIndex = slotIndex;
+		}
 	}
 
-	return true;
+	if (firstShape == lastSecondChildShape)
+		return;
+
+	this->SplitIfNotAlreadySplit(nodeIndex);
+	uint32_t childIndex = (*this->nodeArray)[nodeIndex].childIndex;
+	this->InsertShapesUnder(childIndex, firstShape, lastFirstChildShape);
+	this->InsertShapesUnder(childIndex + 1, lastFirstChildShape, lastSecondChildShape);
 }
 
-uint32_t BoundingBoxTree::GetNumShapes() const
+/*virtual*/ bool BoundingBoxTree::Remove(ShapeID shapeID)
 {
-	return this->shapeMap->size();
+	Shape* shape = this->FindShape(shapeID);
+	if (!shape)
+		return false;
+
+	if (shape->nodeIndex != IMZADI_INVALID_NODE_INDEX)
+		this->UnbindShape(shape);
+
+	return BroadPhase::Remove(shapeID);
 }
 
-void BoundingBoxTree::Clear()
+/*virtual*/ void BoundingBoxTree::Clear()
 {
-	this->collisionCache.Clear();
+	for (Shape* shape : *this->shapeSlotArray)
+		if (shape)
+			shape->nodeIndex = IMZADI_INVALID_NODE_INDEX;
 
-	delete this->rootNode;
-	this->rootNode = nullptr;
+	this->nodeArray->clear();
+	this->shapeSlotArray->clear();
+	this->numAbandonedShapeSlots = 0;
+	this->numEmptyNodes = 0;
 
-	while (this->shapeMap->size() > 0)
-	{
-		std::unordered_map<ShapeID, Shape*>::iterator iter = this->shapeMap->begin();
-		Shape* shape = iter->second;
-		Shape::Free(shape);
-		this->shapeMap->erase(iter);
-	}
+	BroadPhase::Clear();
 }
 
-void BoundingBoxTree::DebugRender(DebugRenderResult* renderResult) const
+/*virtual*/ void BoundingBoxTree::RebuildIfDegraded()
 {
-	if (this->rootNode)
-		this->rootNode->DebugRender(renderResult);
+	uint32_t numNodes = (uint32_t)this->nodeArray->size();
+	if (numNodes < IMZADI_TREE_MIN_NODES_TO_RECLAIM || double(this->numEmptyNodes) <= double(numNodes) * IMZADI_TREE_MAX_EMPTY_NODE_RATIO)
+		return;
+
+	this->ReclaimEmptyNodes();
+
+	if (this->statistics)
+		this->statistics->RecordTreeRebuild();
 }
 
-void BoundingBoxTree::RayCast(const Ray& ray, RayCastResult* rayCastResult) const
+/*virtual*/ void BoundingBoxTree::DebugRenderDynamic(DebugRenderResult* renderResult) const
 {
-	RayCastResult::HitData hitData;
-	hitData.shapeID = 0;
-	hitData.alpha = std::numeric_limits<double>::max();
+	for (const Node& node : *this->nodeArray)
+		renderResult->AddLinesForBox(node.box, Vector3(1.0, 1.0, 1.0));
+}
 
-	if (this->rootNode && ray.HitsOrOriginatesIn(this->rootNode->box))
-		this->rootNode->RayCast(ray, hitData);
+/*virtual*/ void BoundingBoxTree::RayCastDynamic(const Ray& ray, RayCastResult::HitData& hitData) const
+{
+	uint32_t numNodesVisited = 0;
+	if (this->nodeArray->size() > 0 && (*this->nodeArray)[0].numSubtreeShapes > 0 && ray.HitsOrOriginatesIn((*this->nodeArray)[0].box))
+		this->RayCastNode(0, ray, hitData, numNodesVisited);
 
-	rayCastResult->SetHitData(hitData);
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(numNodesVisited);
 }
 
-bool BoundingBoxTree::CalculateCollision(const Shape* shape, CollisionQueryResult* collisionResult) const
+/*virtual*/ void BoundingBoxTree::CalculateDynamicCollision(const Shape* shape, CollisionQueryResult* collisionResult) const
 {
-	const BoundingBoxNode* node = shape->node;
-	if (!node)
-		return false;
+	if (this->nodeArray->size() == 0 || (*this->nodeArray)[0].numSubtreeShapes == 0)
+		return;
 
 	// We have to start our traversal at the root, not the node of the shape,
 	// because there are some shapes that straddle boundaries at a higher level
 	// in the tree that can still intersect with shapes at a lower level.
-	std::list<const BoundingBoxNode*> nodeQueue;
-	nodeQueue.push_back(this->rootNode);
-	while (nodeQueue.size() > 0)
+	std::vector<uint32_t, CollisionHeapAllocator<uint32_t>> nodeQueue;
+	nodeQueue.push_back(0);
+	for (size_t i = 0; i < nodeQueue.size(); i++)
 	{
-		std::list<const BoundingBoxNode*>::iterator iter = nodeQueue.begin();
-		node = *iter;
-		nodeQueue.erase(iter);
+		const Node& node = (*this->nodeArray)[nodeQueue[i]];
 
-		for (const BoundingBoxNode* childNode : *node->childNodeArray)
+		if (node.childIndex != 0)
 		{
-			AxisAlignedBoundingBox intersection;
-			if (intersection.Intersect(childNode->box, shape->GetBoundingBox()))
-				nodeQueue.push_back(childNode);
-		}
-
-		for (auto pair : *node->shapeMap)
-		{
-			const Shape* otherShape = pair.second;
-			if (shape == otherShape)
-				continue;
-
-			AxisAlignedBoundingBox intersection;
-			if (intersection.Intersect(otherShape->GetBoundingBox(), shape->GetBoundingBox()))
+			for (uint32_t j = node.childIndex; j < node.childIndex + 2; j++)
 			{
-				ShapePairCollisionStatus* collisionStatus = this->collisionCache.DetermineCollisionStatusOfShapes(shape, otherShape);
-				IMZADI_ASSERT(collisionStatus != nullptr);
-				if (collisionStatus && collisionStatus->AreInCollision())
-				{
-					collisionResult->AddCollisionStatus(collisionStatus);
-				}
+				const Node& childNode = (*this->nodeArray)[j];
+				AxisAlignedBoundingBox intersection;
+				if (childNode.numSubtreeShapes > 0 && intersection.Intersect(childNode.box, shape->GetBoundingBox()))
+					nodeQueue.push_back(j);
 			}
 		}
+
+		for (uint32_t j = 0; j < node.numShapes; j++)
+			this->CollideShapes(shape, (*this->shapeSlotArray)[node.firstShapeSlot + j], collisionResult);
 	}
 
-	return true;
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(nodeQueue.size());
 }
 
-//--------------------------------- BoundingBoxNode ---------------------------------
+/*virtual*/ void BoundingBoxTree::GatherDynamicDiagnostics(TreeDiagnosticsResult::Diagnostics& diagnostics) const
+{
+	if (this->nodeArray->size() == 0)
+		return;
 
-BoundingBoxNode::BoundingBoxNode(BoundingBoxNode* parentNode)
+	// Every node comes after its parent, so the depth of each can be found in one pass.
+	std::vector<uint32_t> depthArray(this->nodeArray->size());
+	double rootArea = (*this->nodeArray)[0].box.GetSurfaceArea();
+	for (uint32_t i = 0; i < (uint32_t)this->nodeArray->size(); i++)
+	{
+		const Node& node = (*this->nodeArray)[i];
+		depthArray[i] = (i == 0) ? 0 : depthArray[node.parentIndex] + 1;
+		BroadPhase::AccountForNode(diagnostics, depthArray[i], node.numShapes, node.childIndex == 0, node.numSubtreeShapes == 0, node.box.GetSurfaceArea() / rootArea);
+	}
+}
+
+void BoundingBoxTree::MakeRootIfNotAlreadyMade()
 {
-	this->parentNode = parentNode;
-	this->childNodeArray = new std::vector<BoundingBoxNode*>();
-	this->shapeMap = new std::unordered_map<ShapeID, Shape*>();
+	if (this->nodeArray->size() > 0)
+		return;
+
+	Node rootNode;
+	rootNode.box = this->collisionWorldExtents;
+	rootNode.parentIndex = IMZADI_INVALID_NODE_INDEX;
+	rootNode.childIndex = 0;
+	rootNode.firstShapeSlot = 0;
+	rootNode.numShapes = 0;
+	rootNode.shapeSlotCapacity = 0;
+	rootNode.numSubtreeShapes = 0;
+	this->nodeArray->push_back(rootNode);
+	this->numEmptyNodes = 1;
 }
 
-/*virtual*/ BoundingBoxNode::~BoundingBoxNode()
+void BoundingBoxTree::SplitIfNotAlreadySplit(uint32_t nodeIndex)
 {
-	for (auto pair : *this->shapeMap)
+	if ((*this->nodeArray)[nodeIndex].childIndex != 0)
+		return;
+
+	Node nodeA, nodeB;
+	(*this->nodeArray)[nodeIndex].box.Split(nodeA.box, nodeB.box);
+
+	for (Node* childNode : { &nodeA, &nodeB })
 	{
-		Shape* shape = pair.second;
-		shape->node = nullptr;
+		childNode->parentIndex = nodeIndex;
+		childNode->childIndex = 0;
+		childNode->firstShapeSlot = 0;
+		childNode->numShapes = 0;
+		childNode->shapeSlotCapacity = 0;
+		childNode->numSubtreeShapes = 0;
 	}
 
-	delete this->shapeMap;
+	uint32_t childIndex = (uint32_t)this->nodeArray->size();
+	this->nodeArray->push_back(nodeA);
+	this->nodeArray->push_back(nodeB);
+	(*this->nodeArray)[nodeIndex].childIndex = childIndex;
+	this->numEmptyNodes += 2;
+}
 
-	for (BoundingBoxNode* childNode : *this->childNodeArray)
-		delete childNode;
+void BoundingBoxTree::GetChildSpaces(uint32_t nodeIndex, AxisAlignedBoundingBox& firstBox, AxisAlignedBoundingBox& secondBox) const
+{
+	const Node& node = (*this->nodeArray)[nodeIndex];
+	if (node.childIndex == 0)
+		node.box.Split(firstBox, secondBox);
+	else
+	{
+		firstBox = (*this->nodeArray)[node.childIndex].box;
+		secondBox = (*this->nodeArray)[node.childIndex + 1].box;
+	}
+}
+
+bool BoundingBoxTree::IsDeepestFitFor(uint32_t nodeIndex, const AxisAlignedBoundingBox& shapeBox) const
+{
+	if (!(*this->nodeArray)[nodeIndex].box.ContainsBox(shapeBox))
+		return false;
 
-	delete this->childNodeArray;
+	AxisAlignedBoundingBox firstBox, secondBox;
+	this->GetChildSpaces(nodeIndex, firstBox, secondBox);
+	return !firstBox.ContainsBox(shapeBox) && !secondBox.ContainsBox(shapeBox);
 }
 
-void BoundingBoxNode::SplitIfNotAlreadySplit()
+void BoundingBoxTree::BindShape(uint32_t nodeIndex, Shape* shape)
 {
-	if (this->childNodeArray->size() > 0)
+	if (shape->nodeIndex != IMZADI_INVALID_NODE_INDEX)
 		return;
 
-	auto nodeA = new BoundingBoxNode(this);
-	auto nodeB = new BoundingBoxNode(this);
+	if ((*this->nodeArray)[nodeIndex].numShapes == (*this->nodeArray)[nodeIndex].shapeSlotCapacity)
+		this->GrowShapeSlotRange(nodeIndex, (*this->nodeArray)[nodeIndex].numShapes + 1);
+
+	Node& node = (*this->nodeArray)[nodeIndex];
+	uint32_t slotIndex = node.firstShapeSlot + node.numShapes++;
+	(*this->shapeSlotArray)[slotIndex] = shape;
+	shape->nodeIndex = nodeIndex;
+	shape->nodeSlotIndex = slotIndex;
+
+	for (uint32_t i = nodeIndex; i != IMZADI_INVALID_NODE_INDEX; i = (*this->nodeArray)[i].parentIndex)
+		if ((*this->nodeArray)[i].numSubtreeShapes++ == 0)
+			this->numEmptyNodes--;
+}
+
+void BoundingBoxTree::UnbindShape(Shape* shape)
+{
+	// Keep the node's shapes packed at the start of its range by moving its last shape into the hole.
+	Node& node = (*this->nodeArray)[shape->nodeIndex];
+	uint32_t lastSlotIndex = node.firstShapeSlot + --node.numShapes;
+	if (shape->nodeSlotIndex != lastSlotIndex)
+	{
+		Shape* lastShape = (*this->shapeSlotArray)[lastSlotIndex];
+		(*this->shapeSlotArray)[shape->nodeSlotIndex] = lastShape;
+		lastShape->nodeSlotIndex = shape->nodeSlotIndex;
+	}
+
+	(*this->shapeSlotArray)[lastSlotIndex] = nullptr;
 
-	this->box.Split(nodeA->box, nodeB->box, &this->dividingPlane);
+	for (uint32_t i = shape->nodeIndex; i != IMZADI_INVALID_NODE_INDEX; i = (*this->nodeArray)[i].parentIndex)
+		if (--(*this->nodeArray)[i].numSubtreeShapes == 0)
+			this->numEmptyNodes++;
 
-	this->childNodeArray->push_back(nodeA);
-	this->childNodeArray->push_back(nodeB);
+	shape->nodeIndex = IMZADI_INVALID_NODE_INDEX;
+	shape->nodeSlotIndex = 0;
 }
 
-void BoundingBoxNode::BindToShape(Shape* shape)
+void BoundingBoxTree::GrowShapeSlotRange(uint32_t nodeIndex, uint32_t minCapacity)
 {
-	if (shape->node == nullptr)
+	// Gaps are left behind whenever a range moves, so once they outnumber the slots in use, close them up.
+	if (this->numAbandonedShapeSlots > this->shapeSlotArray->size() / 2)
+		this->CompactShapeSlotArray();
+
+	Node& node = (*this->nodeArray)[nodeIndex];
+	uint32_t newCapacity = IMZADI_MAX(IMZADI_MAX(node.shapeSlotCapacity * 2, 2), minCapacity);
+
+	if (node.shapeSlotCapacity > 0 && node.firstShapeSlot + node.shapeSlotCapacity == this->shapeSlotArray->size())
 	{
-		this->shapeMap->insert(std::pair<ShapeID, Shape*>(shape->GetShapeID(), shape));
-		shape->node = this;
+		this->shapeSlotArray->resize(node.firstShapeSlot + newCapacity, nullptr);
 	}
+	else
+	{
+		uint32_t newFirstShapeSlot = (uint32_t)this->shapeSlotArray->size();
+		this->shapeSlotArray->resize(newFirstShapeSlot + newCapacity, nullptr);
+
+		for (uint32_t i = 0; i < node.numShapes; i++)
+		{
+			Shape* shape = (*this->shapeSlotArray)[node.firstShapeSlot + i];
+			(*this->shapeSlotArray)[node.firstShapeSlot + i] = nullptr;
+			(*this->shapeSlotArray)[newFirstShapeSlot + i] = shape;
+			shape->nodeSlotIndex = newFirstShapeSlot + i;
+		}
+
+		this->numAbandonedShapeSlots += node.shapeSlotCapacity;
+		node.firstShapeSlot = newFirstShapeSlot;
+	}
+
+	node.shapeSlotCapacity = newCapacity;
 }
 
-void BoundingBoxNode::UnbindFromShape(Shape* shape)
+void BoundingBoxTree::CompactShapeSlotArray()
 {
-	if (shape->node == this)
+	std::vector<Shape*> compactedShapeSlotArray;
+	compactedShapeSlotArray.reserve(this->shapeSlotArray->size() - this->numAbandonedShapeSlots);
+
+	for (Node& node : *this->nodeArray)
 	{
-		this->shapeMap->erase(shape->GetShapeID());
-		shape->node = nullptr;
+		uint32_t newFirstShapeSlot = (uint32_t)compactedShapeSlotArray.size();
+
+		for (uint32_t i = 0; i < node.numShapes; i++)
+		{
+			Shape* shape = (*this->shapeSlotArray)[node.firstShapeSlot + i];
+			shape->nodeSlotIndex = newFirstShapeSlot + i;
+			compactedShapeSlotArray.push_back(shape);
+		}
+
+		compactedShapeSlotArray.resize(newFirstShapeSlot + node.shapeSlotCapacity, nullptr);
+		node.firstShapeSlot = newFirstShapeSlot;
 	}
+
+	this->shapeSlotArray->swap(compactedShapeSlotArray);
+	this->numAbandonedShapeSlots = 0;
 }
 
-void BoundingBoxNode::DebugRender(DebugRenderResult* renderResult) const
+void BoundingBoxTree::ReclaimEmptyNodes()
 {
-	renderResult->AddLinesForBox(this->box, Vector3(1.0, 1.0, 1.0));
+	// A node keeps its children only if there's a shape somewhere beneath it.  Children are
+	// placed as their parent is visited, so the kept nodes come out depth-first, each pair
+	// of children still adjacent, and still after their parent.
+	std::vector<Node> keptNodeArray;
+	keptNodeArray.reserve(this->nodeArray->size() - this->numEmptyNodes + 1);
+	keptNodeArray.push_back((*this->nodeArray)[0]);
+
+	struct NodeMapping
+	{
+		uint32_t oldIndex;
+		uint32_t newIndex;
+	};
+
+	std::vector<NodeMapping> nodeStack;
+	nodeStack.push_back(NodeMapping{ 0, 0 });
+	this->numEmptyNodes = 0;
+	while (nodeStack.size() > 0)
+	{
+		NodeMapping mapping = nodeStack.back();
+		nodeStack.pop_back();
+
+		const Node& oldNode = (*this->nodeArray)[mapping.oldIndex];
+		if (oldNode.numSubtreeShapes == 0)
+			this->numEmptyNodes++;
+
+		for (uint32_t i = 0; i < oldNode.numShapes; i++)
+			(*this->shapeSlotArray)[oldNode.firstShapeSlot + i]->nodeIndex = mapping.newIndex;
+
+		if (oldNode.childIndex == 0 || oldNode.numSubtreeShapes == oldNode.numShapes)
+		{
+			keptNodeArray[mapping.newIndex].childIndex = 0;
+			continue;
+		}
+
+		uint32_t childIndex = (uint32_t)keptNodeArray.size();
+		keptNodeArray[mapping.newIndex].childIndex = childIndex;
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			keptNodeArray.push_back((*this->nodeArray)[oldNode.childIndex + i]);
+			keptNodeArray.back().parentIndex = mapping.newIndex;
+		}
 
-	for (const BoundingBoxNode* childNode : *this->childNodeArray)
-		childNode->DebugRender(renderResult);
+		nodeStack.push_back(NodeMapping{ oldNode.childIndex + 1, childIndex + 1 });
+		nodeStack.push_back(NodeMapping{ oldNode.childIndex, childIndex });
+	}
+
+	// The ranges of the dropped nodes are left behind as gaps, which compaction closes up.
+	this->nodeArray->swap(keptNodeArray);
+	this->CompactShapeSlotArray();
 }
 
-bool BoundingBoxNode::RayCast(const Ray& ray, RayCastResult::HitData& hitData) const
+bool BoundingBoxTree::RayCastNode(uint32_t nodeIndex, const Ray& ray, RayCastResult::HitData& hitData, uint32_t& numNodesVisited) const
 {
+	numNodesVisited++;
+
+	const Node& node = (*this->nodeArray)[nodeIndex];
+
 	struct ChildHit
 	{
-		const BoundingBoxNode* childNode;
+		uint32_t childIndex;
 		double alpha;
 	};
 
-	std::vector<ChildHit> childHitArray;
-	for (const BoundingBoxNode* childNode : *this->childNodeArray)
+	ChildHit childHitArray[2];
+	uint32_t numChildHits = 0;
+	if (node.childIndex != 0)
 	{
-		if (childNode->box.ContainsPoint(ray.origin))
-			childHitArray.push_back(ChildHit{ childNode, 0.0 });
-		else
+		for (uint32_t i = node.childIndex; i < node.childIndex + 2; i++)
 		{
-			double boxHitAlpha = 0.0;
-			if (ray.CastAgainst(childNode->box, boxHitAlpha))
-				childHitArray.push_back(ChildHit{ childNode, boxHitAlpha });
+			if ((*this->nodeArray)[i].numSubtreeShapes == 0)
+				continue;
+
+			const AxisAlignedBoundingBox& childBox = (*this->nodeArray)[i].box;
+			if (childBox.ContainsPoint(ray.origin))
+				childHitArray[numChildHits++] = ChildHit{ i, 0.0 };
+			else
+			{
+				// Nothing in a box the ray enters beyond the nearest hit so far can be any nearer.
+				double boxHitAlpha = 0.0;
+				if (ray.CastAgainst(childBox, boxHitAlpha) && boxHitAlpha < hitData.alpha)
+					childHitArray[numChildHits++] = ChildHit{ i, boxHitAlpha };
+			}
 		}
 	}
 
-	std::sort(childHitArray.begin(), childHitArray.end(), [](const ChildHit& childHitA, const ChildHit& childHitB) -> bool {
-		return childHitA.alpha < childHitB.alpha;
-	});
+	if (numChildHits == 2 && childHitArray[1].alpha < childHitArray[0].alpha)
+		std::swap(childHitArray[0], childHitArray[1]);
 
 	// The main optimization here is the early-out, which allows us to disregard branches of the tree.
-	for (const ChildHit& childHit : childHitArray)
-	{
-		const BoundingBoxNode* childNode = childHit.childNode;
-		if (childNode->RayCast(ray, hitData))
+	for (uint32_t i = 0; i < numChildHits; i++)
+		if (this->RayCastNode(childHitArray[i].childIndex, ray, hitData, numNodesVisited))
 			break;
-	}
 
 	// What remains is to check the current hit, if any, against what's at this node.
 	bool hitOccurredAtThisNode = false;
-	for (auto pair : *this->shapeMap)
-	{
-		const Shape* shape = pair.second;
-
-		double shapeAlpha = 0.0;
-		Vector3 unitSurfaceNormal;
-		if (shape->RayCast(ray, shapeAlpha, unitSurfaceNormal) && 0.0 <= shapeAlpha && shapeAlpha < hitData.alpha)
-		{
+	for (uint32_t i = 0; i < node.numShapes; i++)
+		if (BroadPhase::RayCastShape(ray, (*this->shapeSlotArray)[node.firstShapeSlot + i], hitData))
 			hitOccurredAtThisNode = true;
-			hitData.shapeID = shape->GetShapeID();
-			hitData.surfaceNormal = unitSurfaceNormal;
-			hitData.surfacePoint = ray.CalculatePoint(shapeAlpha);
-			hitData.alpha = shapeAlpha;
-		}
-	}
 
 	return hitOccurredAtThisNode;
 }
\ No newline at end of file
@@ -1,31 +1,45 @@
 #pragma once
 
 #include "Defines.h"
+#include "BroadPhase.h"
 #include "Math/AxisAlignedBoundingBox.h"
-#include "Math/Plane.h"
-#include "Shape.h"
-#include "Result.h"
-#include "CollisionCache.h"
 #include <vector>
-#include <unordered_map>
-#include <functional>
 
 namespace Imzadi
 {
-	class BoundingBoxNode;
-
 	/**
-	 * This class facilitates the broad-phase of collision detection.
-	 * Note that it is not a user-facing class and so the collision system
-	 * user will never have to interface with it directly.  This class,
-	 * when appropriate, calls directly into the narrow-phase.
+	 * This class facilitates the broad-phase of collision detection by
+	 * recursively cutting the collision world in half and putting each
+	 * shape in the deepest space that fully contains it.
 	 */
-	class IMZADI_API BoundingBoxTree
+	class IMZADI_API BoundingBoxTree : public BroadPhase
 	{
 	public:
 		BoundingBoxTree(const AxisAlignedBoundingBox& collisionWorldExtents);
 		virtual ~BoundingBoxTree();
 
+		/**
+		 * Remove the shape having the given ID from this bounding-box tree.
+		 * 
+		 * @param[in] shapeID This is the shape to remove from the tree.  It must already be a member of this tree.
+		 */
+		virtual bool Remove(ShapeID shapeID) override;
+
+		/**
+		 * Remove all shapes from this tree and delete all nodes of the tree.
+		 */
+		virtual void Clear() override;
+
+		/**
+		 * Shapes that move leave behind nodes with nothing in or beneath them.  Searches skip
+		 * such nodes, but they still take up memory and spread the rest of the tree out, so once
+		 * they make up more than IMZADI_TREE_MAX_EMPTY_NODE_RATIO of a tree with at least
+		 * IMZADI_TREE_MIN_NODES_TO_RECLAIM nodes, the tree is rebuilt without them.
+		 */
+		virtual void RebuildIfDegraded() override;
+
+	protected:
+
 		/**
 		 * Insert the given shape into this bounding-box tree.  Note that
 		 * it is fine for the shape to already be in the tree; in which case,
@@ -52,7 +66,8 @@ namespace Imzadi
 		 * the tree as possible, with a reasonable limit on how small a leaf
 		 * node can get.  Also, only on successful insertion is the ownership
 		 * of the memory of the given shape taken on by the tree.  If it gets
-		 * split, then it will be deleted, and its ID will become invalid.
+		 * split, then it will be deleted, and its ID can no longer be used
+		 * to command it, but the pieces report that ID in query results.
 		 * If splitting is not allowed and insertion is successful, then you
 		 * can continue to refer to the shape on the main thread by its ID.
 		 * Thus, splitting is designed for static collision shapes.  It doesn't
@@ -62,120 +77,135 @@ namespace Imzadi
 		 * @param[in] flags This is an OR-ing of flags of the form IMZADI_ADD_FLAG_*.  In particular, we look at the IMZADI_ADD_FLAG_ALLOW_SPLIT flag to see if shape splitting is allowed.
 		 * @return True is returned on success; false, otherwise.
 		 */
-		bool Insert(Shape* shape, uint32_t flags);
+		virtual bool InsertDynamic(Shape* shape, uint32_t flags) override;
 
 		/**
-		 * Remove the shape having the given ID from this bounding-box tree.
-		 * 
-		 * @param[in] shapeID This is the shape to remove from the tree.  It must already be a member of this tree.
+		 * Insert all the given shapes into this bounding-box tree in one pass.  Rather than
+		 * pushing each shape down the tree on its own, the whole set is partitioned at each
+		 * node into those fitting the first child, those fitting the second, and those staying
+		 * put, so each node is visited once and each node's shape slots are grown once.  The
+		 * shapes land exactly where the InsertDynamic method would have put them.  Shapes that
+		 * are to be split, or that are already in the tree, are inserted one at a time.
 		 */
-		bool Remove(ShapeID shapeID);
+		virtual void InsertManyDynamic(std::vector<Shape*>& shapeArray, uint32_t flags) override;
 
 		/**
-		 * Find and return the shape having the given shape ID.
-		 *
-		 * @param[in] shapeID This is the ID of the shape to find within the collision world.
-		 * @return If found, a pointer to the shape is returned; null, otherwise.
+		 * Provide a visualization of the tree for debugging purposes.
 		 */
-		Shape* FindShape(ShapeID shapeID);
+		virtual void DebugRenderDynamic(DebugRenderResult* renderResult) const override;
 
 		/**
-		 * Provide a convenient way to iterate all shapes of the tree.
+		 * Perform a ray-cast against all collision shapes within the tree.
 		 * 
-		 * @param[in] callback This is a lambda that is given each shape of the tree and expected to return true if and only if iteration should continue.
-		 * @return True is returned if every invocation of the callback returned true.
+		 * @param[in] ray This is the ray with which to perform the cast.
+		 * @param[in,out] hitData This is the nearest hit found so far, if any.  It is replaced by any closer hit found in the tree.
 		 */
-		bool ForAllShapes(std::function<bool(const Shape*)> callback) const;
+		virtual void RayCastDynamic(const Ray& ray, RayCastResult::HitData& hitData) const override;
 
 		/**
-		 * Return the number of shapes being stored in the tree.
+		 * Determine the collision status of the given shape against the shapes of this tree.
+		 * 
+		 * @param[in] shape This is the shape in question.
+		 * @param[out] collisionResult The collision status is added to this instance of the CollisionQueryResult class.
 		 */
-		uint32_t GetNumShapes() const;
+		virtual void CalculateDynamicCollision(const Shape* shape, CollisionQueryResult* collisionResult) const override;
 
 		/**
-		 * Remove all shapes from this tree and delete all nodes of the tree.
+		 * Account for every node of the tree in the given diagnostics.  Shapes in interior
+		 * nodes are those that straddle the plane dividing their node.
 		 */
-		void Clear();
+		virtual void GatherDynamicDiagnostics(TreeDiagnosticsResult::Diagnostics& diagnostics) const override;
+
+	private:
 
 		/**
-		 * Provide a visualization of the tree for debugging purposes.
+		 * These are the nodes of the tree.  They are all kept in one array, and they refer
+		 * to one another by index, so a traversal of the tree walks through one block of memory.
+		 * The children of a node are always adjacent in the array, and always come after it.
+		 * Nodes are only ever removed when the whole tree is cleared, or when the empty ones
+		 * are reclaimed.
 		 */
-		void DebugRender(DebugRenderResult* renderResult) const;
+		struct Node
+		{
+			AxisAlignedBoundingBox box;				///< This is the space represented by this node.
+			uint32_t parentIndex;					///< This is the index of the node whose space contains this node's space, or IMZADI_INVALID_NODE_INDEX for the root.
+			uint32_t childIndex;					///< This is the index of the first of the two nodes partitioning this node's space.  It is zero if the node hasn't been split, the root never being a child.
+			uint32_t firstShapeSlot;				///< This is the start of this node's range of the shape slot array.
+			uint32_t numShapes;						///< This is how many shapes are in this node's space, but can't fit in a sub-space.  They occupy the start of the node's range.
+			uint32_t shapeSlotCapacity;				///< This is the length of this node's range of the shape slot array.
+			uint32_t numSubtreeShapes;				///< This is how many shapes are in this node or any node beneath it.  Searches skip nodes where this is zero.
+		};
 
 		/**
-		 * Perform a ray-cast against all collision shapes within the tree.
-		 * 
-		 * @param[in] ray This is the ray with which to perform the cast.
-		 * @param[out] rayCastResult The hit result, if any, is put into the given RayCastResult instance.  If no hit, then the result will indicate as much.
+		 * Create the root node if it doesn't already exist.
 		 */
-		void RayCast(const Ray& ray, RayCastResult* rayCastResult) const;
+		void MakeRootIfNotAlreadyMade();
 
 		/**
-		 * Determine the collision status of the given shape.
-		 * 
-		 * @param[in] shape This is the shape in question.
-		 * @param[out] collisionResult The collision status is returned in this instance of the CollisionQueryResult class.
-		 * @return True is returned on success; false, otherwise.
+		 * If the given node has no children, create two children partitioning the node's
+		 * space into two ideal-sized sub-spaces.  Note that this may move the node array.
+		 * This is only done once a shape is going into one of the children.
 		 */
-		bool CalculateCollision(const Shape* shape, CollisionQueryResult* collisionResult) const;
+		void SplitIfNotAlreadySplit(uint32_t nodeIndex);
 
-	private:
-		std::unordered_map<ShapeID, Shape*>* shapeMap;		///< We keep a map here of all shapes stored in the tree.
-		BoundingBoxNode* rootNode;							///< The root note represents the entire space managed by the collision system.
-		AxisAlignedBoundingBox collisionWorldExtents;		///< When the root note is created, it takes on this extent.
-		mutable CollisionCache collisionCache;				///< This is used to speed up the narrow-phase of collision detection.
-	};
+		/**
+		 * Get the spaces of the two children of the given node, whether or not they've been made yet.
+		 */
+		void GetChildSpaces(uint32_t nodeIndex, AxisAlignedBoundingBox& firstBox, AxisAlignedBoundingBox& secondBox) const;
 
-	/**
-	 * Instances of this class form the nodes of the BoundingBoxTree class.
-	 * This class is designed to have an arbitrary branching factor, but a
-	 * binary tree is best, because it minimizes the chance of a shape's box
-	 * having to straddle the boundary between sub-spaces which, admittedly,
-	 * is a problem I'm not yet sure how to easily solve.
-	 */
-	class IMZADI_API BoundingBoxNode
-	{
-		friend class BoundingBoxTree;
+		/**
+		 * Tell the caller if a shape with the given box belongs in the given node,
+		 * it fitting in the node, but in neither of the node's children.
+		 */
+		bool IsDeepestFitFor(uint32_t nodeIndex, const AxisAlignedBoundingBox& shapeBox) const;
 
-	private:
-		BoundingBoxNode(BoundingBoxNode* parentNode);
-		virtual ~BoundingBoxNode();
+		/**
+		 * Put all the given shapes, known to fit in the given node, as deep under the node as they'll go.
+		 * The given range of the shape array is reordered in the process.
+		 */
+		void InsertShapesUnder(uint32_t nodeIndex, std::vector<Shape*>::iterator firstShape, std::vector<Shape*>::iterator lastShape);
+
+		/**
+		 * Point the given shape to the given node, and put the shape in the node's range of shape slots.
+		 */
+		void BindShape(uint32_t nodeIndex, Shape* shape);
 
 		/**
-		 * Point the given shape to this node, and this node to the given shape.
+		 * Take the given shape out of its node's range of shape slots, and point it to no node.
 		 */
-		void BindToShape(Shape* shape);
+		void UnbindShape(Shape* shape);
 
 		/**
-		 * Unlink the pointers between this node and the given shape in both directions.
+		 * Double the size of the given node's range of shape slots, or more, if need be, to hold the given number of shapes.
+		 * The range is grown in place if it's at the end of the slot array; otherwise, it's moved there, leaving a gap.
 		 */
-		void UnbindFromShape(Shape* shape);
+		void GrowShapeSlotRange(uint32_t nodeIndex, uint32_t minCapacity);
 
 		/**
-		 * If this node has no children, create two children partitioning this node's
-		 * space into two ideal-sized sub-spaces.
+		 * Close up all gaps left in the shape slot array by ranges that have been moved.
 		 */
-		void SplitIfNotAlreadySplit();
+		void CompactShapeSlotArray();
 
 		/**
-		 * Render this node's space as a simple wire-frame box.
+		 * Rebuild the node array without the children of any node having nothing beneath it.
+		 * The nodes that remain are laid out depth-first, and the shape slot array is compacted.
 		 */
-		void DebugRender(DebugRenderResult* renderResult) const;
+		void ReclaimEmptyNodes();
 
 		/**
-		 * Descend the tree, performing a ray-cast as we go.
+		 * Descend the tree from the given node, performing a ray-cast as we go.
 		 * 
+		 * @param[in] nodeIndex This is the node at which to start.
 		 * @param[in] ray This is the ray with which to perform the ray-cast.
 		 * @param[out] hitData This will contain info about what shape was hit and how, if any.
-		 * @return True is returned if and only if a hit ocurred in this node of the tree.
+		 * @param[in,out] numNodesVisited This is incremented for the given node and every node visited beneath it.
+		 * @return True is returned if and only if a hit ocurred in the given node of the tree.
 		 */
-		bool RayCast(const Ray& ray, RayCastResult::HitData& hitData) const;
+		bool RayCastNode(uint32_t nodeIndex, const Ray& ray, RayCastResult::HitData& hitData, uint32_t& numNodesVisited) const;
 
-	private:
-		AxisAlignedBoundingBox box;							///< This is the space represented by this node.
-		std::vector<BoundingBoxNode*>* childNodeArray;		///< These are the sub-space partitions of this node.
-		BoundingBoxNode* parentNode;						///< This is a pointer to the parent space containing this node.
-		std::unordered_map<ShapeID, Shape*>* shapeMap;		///< These are shapes in this node's space that cannot fit in a sub-space.
-		Plane dividingPlane;								///< This is a plane dividing this node's space into two sub-spaces, but not dividing any of this node's sub-nodes.
+		std::vector<Node>* nodeArray;						///< This is empty until the root node is made, which is always at index zero.  The root represents the entire space managed by the collision system.
+		std::vector<Shape*>* shapeSlotArray;				///< Each node owns a contiguous range of this array in which to keep its shapes.
+		uint32_t numAbandonedShapeSlots;					///< This is the number of slots left behind in gaps when node ranges were moved.
+		uint32_t numEmptyNodes;								///< This is the number of nodes with no shapes in or beneath them.
 	};
 }
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "BroadPhase.h"
+#include "BoundingBoxTree.h"
+#include "DynamicBoundingBoxTree.h"
+#include "SpatialHashGrid.h"
+#include "Math/Ray.h"
+#include <chrono>
+
+using namespace Imzadi;
+
+BroadPhase::BroadPhase(const AxisAlignedBoundingBox& collisionWorldExtents)
+{
+	this->collisionWorldExtents = collisionWorldExtents;
+	this->shapeMap = new ShapeMap();
+	this->statistics = nullptr;
+	this->staticTree = new StaticBoundingBoxTree();
+	this->sweepAndPrune = new SweepAndPrune();
+	this->sweepAndPruneMutex = new std::mutex();
+	this->dirtyShapeArray = new std::vector<ShapeID>();
+	this->parallelQueries = false;
+}
+
+/*virtual*/ BroadPhase::~BroadPhase()
+{
+	delete this->sweepAndPrune;
+	delete this->sweepAndPruneMutex;
+	delete this->dirtyShapeArray;
+	delete this->staticTree;
+	delete this->shapeMap;
+}
+
+/*static*/ BroadPhase* BroadPhase::Create(Type type, const AxisAlignedBoundingBox& collisionWorldExtents, double gridCellSize)
+{
+	switch (type)
+	{
+		case Type::BOUNDING_BOX_TREE:
+			return new BoundingBoxTree(collisionWorldExtents);
+		case Type::DYNAMIC_BOUNDING_BOX_TREE:
+			return new DynamicBoundingBoxTree(collisionWorldExtents);
+		case Type::SPATIAL_HASH_GRID:
+			return new SpatialHashGrid(collisionWorldExtents, gridCellSize);
+	}
+
+	return nullptr;
+}
+
+bool BroadPhase::Insert(Shape* shape, uint32_t flags)
+{
+	if (!shape)
+		return false;
+
+	// A shape that moved may need no work from the derivative, but it still needs it from the sweep.
+	this->MarkShapeDirty(shape);
+
+	bool isStatic = (shape->staticShapeIndex != IMZADI_INVALID_SHAPE_INDEX);
+	if (!isStatic && (flags & IMZADI_ADD_FLAG_STATIC) == 0)
+		return this->InsertDynamic(shape, flags);
+
+	// As with any other shape, a static shape outside the collision world is tracked, but not searched.
+	// Should one be moved back into the world, it's treated as the moving shape it evidently is.
+	bool inWorld = this->collisionWorldExtents.ContainsBox(shape->GetBoundingBox());
+	if (isStatic)
+	{
+		if (inWorld)
+			this->staticTree->Invalidate();
+		else
+			this->staticTree->Remove(shape);
+	}
+	else if (inWorld)
+		this->staticTree->Add(shape);
+
+	this->TrackShape(shape);
+	return true;
+}
+
+void BroadPhase::InsertMany(std::vector<Shape*>& shapeArray, uint32_t flags)
+{
+	shapeArray.erase(std::remove(shapeArray.begin(), shapeArray.end(), nullptr), shapeArray.end());
+
+	// Static shapes already go in all at once, since the static tree is only built the next time it's searched.
+	if ((flags & IMZADI_ADD_FLAG_STATIC) != 0)
+	{
+		for (Shape* shape : shapeArray)
+			this->Insert(shape, flags);
+
+		return;
+	}
+
+	for (Shape* shape : shapeArray)
+		this->MarkShapeDirty(shape);
+
+	this->InsertManyDynamic(shapeArray, flags);
+}
+
+/*virtual*/ void BroadPhase::InsertManyDynamic(std::vector<Shape*>& shapeArray, uint32_t flags)
+{
+	for (Shape* shape : shapeArray)
+		if (!this->InsertDynamic(shape, flags))
+			Shape::Free(shape);
+}
+
+/*virtual*/ bool BroadPhase::Remove(ShapeID shapeID)
+{
+	ShapeMap::iterator iter = this->shapeMap->find(shapeID);
+	if (iter == this->shapeMap->end())
+		return false;
+
+	Shape* shape = iter->second;
+	if (shape->staticShapeIndex != IMZADI_INVALID_SHAPE_INDEX)
+		this->staticTree->Remove(shape);
+
+	this->collisionCache.Forget(shapeID);
+	this->UntrackShape(shape);
+	Shape::Free(shape);
+	return true;
+}
+
+/*virtual*/ void BroadPhase::Clear()
+{
+	this->staticTree->Clear();
+	this->sweepAndPrune->Clear();
+	this->dirtyShapeArray->clear();
+	this->collisionCache.Clear();
+
+	while (this->shapeMap->size() > 0)
+	{
+		ShapeMap::iterator iter = this->shapeMap->begin();
+		Shape* shape = iter->second;
+		Shape::Free(shape);
+		this->shapeMap->erase(iter);
+	}
+}
+
+void BroadPhase::DebugRender(DebugRenderResult* renderResult) const
+{
+	this->staticTree->DebugRender(renderResult);
+	this->DebugRenderDynamic(renderResult);
+}
+
+void BroadPhase::RayCast(const Ray& ray, RayCastResult* rayCastResult) const
+{
+	RayCastResult::HitData hitData;
+	hitData.shapeID = 0;
+	hitData.alpha = std::numeric_limits<double>::max();
+
+	// The static shapes go first, since a hit among them lets the derivative skip anything farther away.
+	uint32_t numNodesVisited = 0;
+	this->staticTree->RayCast(ray, hitData, this->parallelQueries, numNodesVisited);
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(numNodesVisited);
+
+	this->RayCastDynamic(ray, hitData);
+
+	rayCastResult->SetHitData(hitData);
+}
+
+bool BroadPhase::CalculateCollision(const Shape* shape, CollisionQueryResult* collisionResult) const
+{
+	if (!shape->IsBound())
+		return false;
+
+	uint32_t numNodesVisited = 0;
+	std::vector<const Shape*> staticShapeArray;
+	this->staticTree->GatherShapesOverlapping(shape->GetBoundingBox(), staticShapeArray, this->parallelQueries, numNodesVisited);
+
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(numNodesVisited);
+
+	if (!this->parallelQueries || staticShapeArray.size() < IMZADI_PARALLEL_QUERY_MIN_PAIRS)
+	{
+		for (const Shape* otherShape : staticShapeArray)
+			this->CollideShapes(shape, otherShape, collisionResult);
+	}
+	else
+	{
+		// The narrow-phase is run on all pairs at once, but the results are added in order,
+		// which matters when pieces of the same split shape are hit, so they come out the same.
+		std::vector<ShapePairCollisionStatus*> collisionStatusArray(staticShapeArray.size());
+		std::transform(std::execution::par, staticShapeArray.begin(), staticShapeArray.end(), collisionStatusArray.begin(), [this, shape](const Shape* otherShape) -> ShapePairCollisionStatus*
+		{
+			if (shape == otherShape)
+				return nullptr;
+
+			return this->collisionCache.DetermineCollisionStatusOfShapes(shape, otherShape);
+		});
+
+		for (ShapePairCollisionStatus* collisionStatus : collisionStatusArray)
+			if (collisionStatus && collisionStatus->AreInCollision())
+				collisionResult->AddCollisionStatus(collisionStatus);
+	}
+
+	this->CalculateDynamicCollision(shape, collisionResult);
+	return true;
+}
+
+void BroadPhase::CalculateAllCollisions(AllPairsResult* allPairsResult) const
+{
+	std::vector<std::pair<const Shape*, const Shape*>> candidatePairArray;
+
+	{
+		std::lock_guard<std::mutex> guard(*this->sweepAndPruneMutex);
+
+		// Only shapes inserted or moved since the last sweep are looked at.  Those that have since been
+		// removed were already dropped from the sweep.  Those that have left the collision world, or gone
+		// static, are dropped now.  Everything else is brought up to date where it now is.
+		for (ShapeID shapeID : *this->dirtyShapeArray)
+		{
+			ShapeMap::const_iterator iter = this->shapeMap->find(shapeID);
+			if (iter == this->shapeMap->end())
+				continue;
+
+			Shape* shape = iter->second;
+			shape->sweepDirty = false;
+			if (shape->staticShapeIndex == IMZADI_INVALID_SHAPE_INDEX && shape->IsBound())
+				this->sweepAndPrune->Update(shape);
+			else
+				this->sweepAndPrune->Forget(shape);
+		}
+
+		this->dirtyShapeArray->clear();
+
+		uint64_t numShifts = this->sweepAndPrune->Sort();
+		if (this->statistics)
+			this->statistics->RecordSweepShifts(numShifts);
+
+		this->sweepAndPrune->ForAllOverlappingPairs([&candidatePairArray](const Shape* shape, const Shape* otherShape)
+		{
+			candidatePairArray.push_back(std::pair<const Shape*, const Shape*>(shape, otherShape));
+		});
+	}
+
+	// The narrow-phase is done outside the lock, as it doesn't touch the sweep-and-prune.
+	for (const auto& candidatePair : candidatePairArray)
+	{
+		ShapePairCollisionStatus* collisionStatus = this->collisionCache.DetermineCollisionStatusOfShapes(candidatePair.first, candidatePair.second);
+		IMZADI_ASSERT(collisionStatus != nullptr);
+		if (collisionStatus && collisionStatus->AreInCollision())
+			allPairsResult->AddCollisionStatus(collisionStatus);
+	}
+
+	allPairsResult->SortCollisionStatusArray();
+}
+
+void BroadPhase::BuildStaticTreeIfNotAlreadyBuilt()
+{
+	if (this->staticTree->IsBuilt())
+		return;
+
+	auto startTime = std::chrono::steady_clock::now();
+	this->staticTree->BuildIfNotAlreadyBuilt();
+	auto buildTime = std::chrono::steady_clock::now() - startTime;
+
+	if (this->statistics)
+		this->statistics->RecordStaticTreeBuild(std::chrono::duration_cast<std::chrono::nanoseconds>(buildTime).count());
+}
+
+/*virtual*/ void BroadPhase::RebuildIfDegraded()
+{
+}
+
+void BroadPhase::GatherDiagnostics(TreeDiagnosticsResult* diagnosticsResult) const
+{
+	TreeDiagnosticsResult::Diagnostics& diagnostics = diagnosticsResult->GetDiagnostics();
+	this->GatherDynamicDiagnostics(diagnostics);
+
+	diagnostics.numStaticShapes = this->staticTree->GetNumShapes();
+	diagnostics.numShapesOutsideTree = this->GetNumShapes() - diagnostics.numStaticShapes - diagnostics.numShapesInLeafNodes - diagnostics.numShapesInInteriorNodes;
+}
+
+/*static*/ void BroadPhase::AccountForNode(TreeDiagnosticsResult::Diagnostics& diagnostics, uint32_t depth, uint32_t numShapes, bool isLeaf, bool isEmpty, double visitProbability)
+{
+	uint32_t depthIndex = IMZADI_MIN(depth, IMZADI_TREE_DIAGNOSTICS_MAX_DEPTH - 1);
+	diagnostics.numNodesAtDepth[depthIndex]++;
+	diagnostics.numShapesAtDepth[depthIndex] += numShapes;
+	diagnostics.numNodes++;
+	diagnostics.maxDepth = IMZADI_MAX(diagnostics.maxDepth, depth);
+	diagnostics.maxShapesPerNode = IMZADI_MAX(diagnostics.maxShapesPerNode, numShapes);
+
+	if (isLeaf)
+	{
+		diagnostics.numLeafNodes++;
+		diagnostics.numShapesInLeafNodes += numShapes;
+	}
+	else
+		diagnostics.numShapesInInteriorNodes += numShapes;
+
+	// Searches never go into empty nodes, so they cost nothing but memory.
+	if (isEmpty)
+		diagnostics.numEmptyNodes++;
+	else
+		diagnostics.estimatedTraversalCost += visitProbability * double(1 + numShapes);
+}
+
+Shape* BroadPhase::FindShape(ShapeID shapeID)
+{
+	ShapeMap::iterator iter = this->shapeMap->find(shapeID);
+	if (iter == this->shapeMap->end())
+		return nullptr;
+
+	return iter->second;
+}
+
+bool BroadPhase::ForAllShapes(std::function<bool(const Shape*)> callback) const
+{
+	for (auto pair : *this->shapeMap)
+	{
+		const Shape* shape = pair.second;
+		if (!callback(shape))
+			return false;
+	}
+
+	return true;
+}
+
+uint32_t BroadPhase::GetNumShapes() const
+{
+	return this->shapeMap->size();
+}
+
+void BroadPhase::SetStatistics(CollisionStatistics* statistics)
+{
+	this->statistics = statistics;
+	this->collisionCache.SetStatistics(statistics);
+}
+
+void BroadPhase::CollideShapes(const Shape* shape, const Shape* otherShape, CollisionQueryResult* collisionResult) const
+{
+	if (shape == otherShape)
+		return;
+
+	AxisAlignedBoundingBox intersection;
+	if (!intersection.Intersect(otherShape->GetBoundingBox(), shape->GetBoundingBox()))
+		return;
+
+	ShapePairCollisionStatus* collisionStatus = this->collisionCache.DetermineCollisionStatusOfShapes(shape, otherShape);
+	IMZADI_ASSERT(collisionStatus != nullptr);
+	if (collisionStatus && collisionStatus->AreInCollision())
+		collisionResult->AddCollisionStatus(collisionStatus);
+}
+
+void BroadPhase::TrackShape(Shape* shape)
+{
+	this->shapeMap->insert(std::pair<ShapeID, Shape*>(shape->GetShapeID(), shape));
+	this->MarkShapeDirty(shape);
+}
+
+void BroadPhase::UntrackShape(Shape* shape)
+{
+	this->shapeMap->erase(shape->GetShapeID());
+	this->sweepAndPrune->Forget(shape);
+
+	// A shape removed before the sweep got to it leaves its ID behind.  Those are weeded out
+	// now and then, so they don't pile up when no all-pairs query comes along to do it.
+	if (shape->sweepDirty && this->dirtyShapeArray->size() > 2 * this->shapeMap->size())
+	{
+		this->dirtyShapeArray->erase(std::remove_if(this->dirtyShapeArray->begin(), this->dirtyShapeArray->end(), [this](ShapeID shapeID) -> bool
+		{
+			return this->shapeMap->find(shapeID) == this->shapeMap->end();
+		}), this->dirtyShapeArray->end());
+	}
+}
+
+void BroadPhase::MarkShapeDirty(Shape* shape)
+{
+	if (shape->sweepDirty)
+		return;
+
+	shape->sweepDirty = true;
+	this->dirtyShapeArray->push_back(shape->GetShapeID());
+}
+
+/*static*/ bool BroadPhase::RayCastShape(const Ray& ray, const Shape* shape, RayCastResult::HitData& hitData)
+{
+	double shapeAlpha = 0.0;
+	Vector3 unitSurfaceNormal;
+	if (!shape->RayCast(ray, shapeAlpha, unitSurfaceNormal) || shapeAlpha < 0.0 || shapeAlpha >= hitData.alpha)
+		return false;
+
+	hitData.shapeID = shape->GetOriginalShapeID();
+	hitData.surfaceNormal = unitSurfaceNormal;
+	hitData.surfacePoint = ray.CalculatePoint(shapeAlpha);
+	hitData.alpha = shapeAlpha;
+	return true;
+}
\ No newline at end of file
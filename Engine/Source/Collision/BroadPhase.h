@@ -0,0 +1,321 @@
+#pragma once
+
+#include "Defines.h"
+#include "Math/AxisAlignedBoundingBox.h"
+#include "Shape.h"
+#include "Result.h"
+#include "CollisionCache.h"
+#include "CollisionHeap.h"
+#include "StaticBoundingBoxTree.h"
+#include "SweepAndPrune.h"
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <execution>
+
+namespace Imzadi
+{
+	class Ray;
+
+	/**
+	 * Shapes are moved in and out of these maps every time they move, so their nodes come from the collision heap.
+	 */
+	typedef std::unordered_map<ShapeID, Shape*, std::hash<ShapeID>, std::equal_to<ShapeID>, CollisionHeapAllocator<std::pair<const ShapeID, Shape*>>> ShapeMap;
+
+	/**
+	 * This is the base class for all the ways we have of spatially sorting the shapes
+	 * of the collision world so that the broad-phase of collision detection can quickly
+	 * rule out pairs of shapes that are nowhere near one another.  Derivatives call
+	 * directly into the narrow-phase, through the collision cache, for whatever pairs
+	 * of shapes remain.
+	 *
+	 * The broad-phase owns every shape it is given.  This base class keeps track of them
+	 * all by ID, and keeps the static ones, which never move, in a tree of its own.
+	 * Derivatives take care of where all the other shapes go spatially.  Queries search
+	 * both transparently.  Note that this is not a user-facing class and so the collision
+	 * system user will never have to interface with it directly, except to choose which
+	 * kind is used.
+	 */
+	class IMZADI_API BroadPhase
+	{
+	public:
+		/**
+		 * These are the kinds of broad-phase the collision system can be initialized with.
+		 */
+		enum Type
+		{
+			BOUNDING_BOX_TREE,				///< The collision world is recursively cut in half, down to a minimum volume.  See the BoundingBoxTree class.
+			DYNAMIC_BOUNDING_BOX_TREE,		///< The boxes of the shapes are themselves grouped into a balanced hierarchy.  See the DynamicBoundingBoxTree class.
+			SPATIAL_HASH_GRID				///< All of space is cut into cells of one size, with no bounds, and only occupied cells are stored.  See the SpatialHashGrid class.
+		};
+
+		BroadPhase(const AxisAlignedBoundingBox& collisionWorldExtents);
+		virtual ~BroadPhase();
+
+		/**
+		 * Allocate and return a new broad-phase of the given type.
+		 *
+		 * @param[in] type This is the kind of broad-phase wanted.
+		 * @param[in] collisionWorldExtents This is the AABB defining the scope of the collision world.
+		 * @param[in] gridCellSize This is the size of each cell of a SpatialHashGrid.  Other types ignore it.
+		 * @return Null is returned if the given type is not recognized.
+		 */
+		static BroadPhase* Create(Type type, const AxisAlignedBoundingBox& collisionWorldExtents, double gridCellSize);
+
+		/**
+		 * Insert the given shape, or, if it's already been inserted, update its
+		 * position in the broad-phase after its bounding box has changed.  It is
+		 * up to the caller to know when to do this.  Ownership of the shape's
+		 * memory is taken only on success.
+		 * 
+		 * Shapes inserted with the IMZADI_ADD_FLAG_STATIC flag go into the static tree,
+		 * which is rebuilt from scratch the next time it's searched.  They should be shapes
+		 * that never move, as moving one means rebuilding the whole static tree.  Static shapes
+		 * are never split, a tree of tight boxes having no use for it.  All other shapes are
+		 * handed off to the derivative.
+		 *
+		 * @param[in] shape This is the shape to insert (or re-insert).
+		 * @param[in] flags This is an OR-ing of flags of the form IMZADI_ADD_FLAG_*.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool Insert(Shape* shape, uint32_t flags);
+
+		/**
+		 * Insert all the given shapes in one go.  This does the same as calling the Insert method
+		 * on each shape, but is much faster, because the shapes can then be placed all at once rather
+		 * than one at a time.  Ownership of every shape's memory is taken, and any shape that can't be
+		 * inserted is deleted.
+		 *
+		 * @param[in,out] shapeArray These are the shapes to insert.  They may be reordered.
+		 * @param[in] flags This is an OR-ing of flags of the form IMZADI_ADD_FLAG_*, applied to every shape.
+		 */
+		void InsertMany(std::vector<Shape*>& shapeArray, uint32_t flags);
+
+		/**
+		 * Remove and delete the shape having the given ID.  Overrides should
+		 * let go of the shape and then call this base-class method.
+		 *
+		 * @param[in] shapeID This is the shape to remove.
+		 * @return True is returned if the shape was found; false, otherwise.
+		 */
+		virtual bool Remove(ShapeID shapeID);
+
+		/**
+		 * Remove and delete all shapes.  Overrides should let go of all
+		 * shapes and then call this base-class method.
+		 */
+		virtual void Clear();
+
+		/**
+		 * Provide a visualization of the broad-phase, static tree included, for debugging purposes.
+		 */
+		void DebugRender(DebugRenderResult* renderResult) const;
+
+		/**
+		 * Perform a ray-cast against all collision shapes in the broad-phase, static or not.
+		 *
+		 * @param[in] ray This is the ray with which to perform the cast.
+		 * @param[out] rayCastResult The hit result, if any, is put into the given RayCastResult instance.  If no hit, then the result will indicate as much.
+		 */
+		void RayCast(const Ray& ray, RayCastResult* rayCastResult) const;
+
+		/**
+		 * Determine the collision status of the given shape against all other shapes, static or not.
+		 *
+		 * @param[in] shape This is the shape in question.
+		 * @param[out] collisionResult The collision status is returned in this instance of the CollisionQueryResult class.
+		 * @return True is returned on success; false, otherwise, such as when the given shape is outside the collision world.
+		 */
+		bool CalculateCollision(const Shape* shape, CollisionQueryResult* collisionResult) const;
+
+		/**
+		 * Find every pair of shapes in collision with one another, neither being static, and both being in the
+		 * collision world.  The shapes are swept across, rather than searched for, so this works the same no
+		 * matter how the derivative sorts them.  Only shapes inserted or moved since the last such query are
+		 * brought up to date in the sweep.  This is thread-safe, as are the other queries of this class.
+		 *
+		 * @param[out] allPairsResult The collision statuses are put into this instance of the AllPairsResult class.
+		 */
+		void CalculateAllCollisions(AllPairsResult* allPairsResult) const;
+
+		/**
+		 * Rebuild the static tree if static shapes have come, gone or changed since it was last
+		 * built.  This must be called before any query is run against the broad-phase.  It is
+		 * done lazily like this so that a level's worth of static shapes costs only one build.
+		 */
+		void BuildStaticTreeIfNotAlreadyBuilt();
+
+		/**
+		 * Rebuild whatever structure the derivative keeps for the shapes that move if it has
+		 * gotten bad enough to be worth it.  Like the BuildStaticTreeIfNotAlreadyBuilt method,
+		 * this is called before queries are run, and so must be cheap when there's nothing to do.
+		 * By default, nothing is done.
+		 */
+		virtual void RebuildIfDegraded();
+
+		/**
+		 * Purge the collision cache of entries involving removed shapes, and evict entries from it if it
+		 * has outgrown its memory limit.  Like the RebuildIfDegraded method, this is called before queries
+		 * are run, and must not be called while they are.  See the CollisionCache::Trim method.
+		 */
+		void TrimCollisionCache() { this->collisionCache.Trim(); }
+
+		/**
+		 * Set the most memory the collision cache should take up, in bytes.  See the CollisionCache::SetMemoryLimit method.
+		 */
+		void SetCacheMemoryLimit(uint64_t memoryLimit) { this->collisionCache.SetMemoryLimit(memoryLimit); }
+
+		/**
+		 * Measure how well the shapes that move are sorted, for tuning and debugging purposes.
+		 *
+		 * @param[out] diagnosticsResult The measurements are put into this instance of the TreeDiagnosticsResult class.
+		 */
+		void GatherDiagnostics(TreeDiagnosticsResult* diagnosticsResult) const;
+
+		/**
+		 * Find and return the shape having the given shape ID.
+		 *
+		 * @param[in] shapeID This is the ID of the shape to find within the collision world.
+		 * @return If found, a pointer to the shape is returned; null, otherwise.
+		 */
+		Shape* FindShape(ShapeID shapeID);
+
+		/**
+		 * Provide a convenient way to iterate all shapes of the broad-phase.
+		 *
+		 * @param[in] callback This is a lambda that is given each shape and expected to return true if and only if iteration should continue.
+		 * @return True is returned if every invocation of the callback returned true.
+		 */
+		bool ForAllShapes(std::function<bool(const Shape*)> callback) const;
+
+		/**
+		 * Return the number of shapes being stored in the broad-phase.
+		 */
+		uint32_t GetNumShapes() const;
+
+		/**
+		 * Tell the broad-phase where to count the work it does.  It does not own the given object.
+		 */
+		void SetStatistics(CollisionStatistics* statistics);
+
+		/**
+		 * Say whether a single query may spread its own work across all cores.  This is worth it when the
+		 * query is being run on its own, and would otherwise leave the other cores idle.  Ray-casts and collision
+		 * queries big enough to be worth splitting up then search the static tree one subtree per core, and run
+		 * the narrow-phase on many pairs of shapes at once.  Results are the same either way.  This must not be
+		 * called while queries are running.
+		 */
+		void SetParallelQueries(bool parallelQueries) { this->parallelQueries = parallelQueries; }
+
+		/**
+		 * Cast the given ray against the given shape, and if it's hit closer than the
+		 * given hit, replace the given hit.
+		 *
+		 * @return True is returned if and only if the given hit was replaced.
+		 */
+		static bool RayCastShape(const Ray& ray, const Shape* shape, RayCastResult::HitData& hitData);
+
+		/**
+		 * Reorder the given range so that all elements satisfying the given predicate come first,
+		 * as std::stable_partition does, but spread the work across all cores when the range is large
+		 * enough to be worth it.  This is for building trees from many shapes at once.  The partition
+		 * is stable so that the order it leaves things in, and so the tree built, is the same no matter
+		 * how many cores there are, or how the work was divided among them.
+		 *
+		 * @return An iterator to the first element not satisfying the predicate is returned.
+		 */
+		template<typename Iterator, typename Predicate>
+		static Iterator Partition(Iterator first, Iterator last, Predicate predicate)
+		{
+			if (last - first >= IMZADI_PARALLEL_BUILD_MIN_SHAPES)
+				return std::stable_partition(std::execution::par, first, last, predicate);
+
+			return std::stable_partition(first, last, predicate);
+		}
+
+	protected:
+
+		/**
+		 * Insert or re-insert the given shape, which is not static.  See the Insert method.
+		 */
+		virtual bool InsertDynamic(Shape* shape, uint32_t flags) = 0;
+
+		/**
+		 * Insert all the given shapes, none of which are static, taking ownership of them all, and deleting
+		 * any that can't be inserted.  The default implementation inserts them one at a time.  Overrides
+		 * should do better, placing the shapes all at once.  See the InsertMany method.
+		 */
+		virtual void InsertManyDynamic(std::vector<Shape*>& shapeArray, uint32_t flags);
+
+		/**
+		 * Provide a visualization of how the shapes that aren't static are sorted.
+		 */
+		virtual void DebugRenderDynamic(DebugRenderResult* renderResult) const = 0;
+
+		/**
+		 * Cast the given ray against all shapes that aren't static, replacing the given hit with any closer one.
+		 *
+		 * @param[in] ray This is the ray with which to perform the cast.
+		 * @param[in,out] hitData This is the nearest hit found so far, if any.
+		 */
+		virtual void RayCastDynamic(const Ray& ray, RayCastResult::HitData& hitData) const = 0;
+
+		/**
+		 * Add to the given result the collision status of the given shape with every shape that isn't static.
+		 * The given shape may or may not be static itself, but it is known to be in the collision world.
+		 */
+		virtual void CalculateDynamicCollision(const Shape* shape, CollisionQueryResult* collisionResult) const = 0;
+
+		/**
+		 * Walk the structure kept for the shapes that aren't static, accounting for each of its nodes
+		 * in the given diagnostics by calling the AccountForNode method.  The given diagnostics start zeroed.
+		 */
+		virtual void GatherDynamicDiagnostics(TreeDiagnosticsResult::Diagnostics& diagnostics) const = 0;
+
+		/**
+		 * Add one node of a tree to the given diagnostics.
+		 *
+		 * @param[in] depth This is how far the node is from the root, which is at depth zero.
+		 * @param[in] numShapes This is the number of shapes in the node itself, not counting those beneath it.
+		 * @param[in] isLeaf This says whether the node has no children.
+		 * @param[in] isEmpty This says whether the node has no shapes in or beneath it.
+		 * @param[in] visitProbability This is the chance that a ray through the root visits the node, being the ratio of their surface areas.
+		 */
+		static void AccountForNode(TreeDiagnosticsResult::Diagnostics& diagnostics, uint32_t depth, uint32_t numShapes, bool isLeaf, bool isEmpty, double visitProbability);
+
+		/**
+		 * Run the narrow-phase on the given pair of shapes, if their bounding boxes overlap,
+		 * and add their collision status to the given result if they're in collision.
+		 */
+		void CollideShapes(const Shape* shape, const Shape* otherShape, CollisionQueryResult* collisionResult) const;
+
+		/**
+		 * Add the given shape to the map of all shapes, if it isn't already there, and mark it as needing to
+		 * be brought up to date in the sweep-and-prune.  Derivatives call this once they've placed a shape.
+		 */
+		void TrackShape(Shape* shape);
+
+		/**
+		 * Take the given shape out of the map of all shapes, and out of the sweep-and-prune.  This must be
+		 * called before a shape that has been tracked is freed.
+		 */
+		void UntrackShape(Shape* shape);
+
+		/**
+		 * Mark the given shape as needing to be brought up to date in the sweep-and-prune
+		 * the next time all pairs are found.  See the CalculateAllCollisions method.
+		 */
+		void MarkShapeDirty(Shape* shape);
+
+		ShapeMap* shapeMap;									///< We keep a map here of all shapes stored in the broad-phase.
+		AxisAlignedBoundingBox collisionWorldExtents;		///< This is the scope of the collision world.
+		mutable CollisionCache collisionCache;				///< This is used to speed up the narrow-phase of collision detection.
+		CollisionStatistics* statistics;					///< If given, this is where we count the nodes we visit.
+		StaticBoundingBoxTree* staticTree;					///< This is where shapes that never move are kept, apart from those that do.
+		SweepAndPrune* sweepAndPrune;						///< This is only used for all-pairs queries, and is brought up to date by each of them.
+		std::mutex* sweepAndPruneMutex;						///< Queries run in parallel, so this keeps more than one from updating the sweep-and-prune at once.
+		std::vector<ShapeID>* dirtyShapeArray;				///< These are the shapes inserted or moved since the sweep-and-prune was last brought up to date.
+		bool parallelQueries;								///< If true, a query may spread its own work across all cores.  See the SetParallelQueries method.
+	};
+}
\ No newline at end of file
@@ -1,11 +1,12 @@
 #include "CollisionCache.h"
+#include "CollisionHeap.h"
 #include "CollisionCalculator.h"
 #include "Shape.h"
 #include "Shapes/Sphere.h"
 #include "Shapes/Box.h"
 #include "Shapes/Capsule.h"
 #include "Shapes/Polygon.h"
-#include <format>
+#include <algorithm>
 
 using namespace Imzadi;
 
@@ -13,120 +14,261 @@ using namespace Imzadi;
 
 CollisionCache::CollisionCache()
 {
-	this->cacheMap = new ShapePairCollisionStatusMap();
-	this->calculatorMap = new CollisionCalculatorMap();
-
-	// Sphere:
-	this->AddCalculator<SphereShape, SphereShape>();
-	this->AddCalculator<SphereShape, CapsuleShape>();
-	this->AddCalculator<SphereShape, PolygonShape>();
-	this->AddCalculator<SphereShape, BoxShape>();
-
-	// Capsule:
-	this->AddCalculator<CapsuleShape, SphereShape>();
-	this->AddCalculator<CapsuleShape, CapsuleShape>();
-	this->AddCalculator<CapsuleShape, PolygonShape>();
-	this->AddCalculator<CapsuleShape, BoxShape>();
-	
-	// Polygon:
-	this->AddCalculator<PolygonShape, SphereShape>();
-	this->AddCalculator<PolygonShape, CapsuleShape>();
-	this->AddCalculator<PolygonShape, PolygonShape>();
-	this->AddCalculator<PolygonShape, BoxShape>();
-
-	// Box:
-	this->AddCalculator<BoxShape, SphereShape>();
-	this->AddCalculator<BoxShape, CapsuleShape>();
-	this->AddCalculator<BoxShape, PolygonShape>();
-	this->AddCalculator<BoxShape, BoxShape>();
+	this->cacheSlotArray = new std::vector<CacheSlot>(IMZADI_CACHE_INITIAL_NUM_SLOTS, CacheSlot{ { 0, 0 }, nullptr, 0 });
+	this->numCacheEntries = 0;
+	this->forgottenShapeArray = new std::vector<ShapeID>();
+	this->generation = 0;
+	this->memoryLimit = IMZADI_CACHE_DEFAULT_MEMORY_LIMIT;
+	this->retiredStatusArray = new std::vector<ShapePairCollisionStatus*>();
+	this->cacheMapMutex = new std::mutex();
+	this->statistics = nullptr;
 }
 
 /*virtual*/ CollisionCache::~CollisionCache()
 {
 	this->Clear();
-	this->ClearCalculatorMap();
 
-	delete this->cacheMap;
-	delete this->calculatorMap;
+	// Any results still holding statuses should have been freed by now.
+	for (ShapePairCollisionStatus* collisionStatus : *this->retiredStatusArray)
+		delete collisionStatus;
+
+	delete this->cacheSlotArray;
+	delete this->forgottenShapeArray;
+	delete this->retiredStatusArray;
+	delete this->cacheMapMutex;
 }
 
 ShapePairCollisionStatus* CollisionCache::DetermineCollisionStatusOfShapes(const Shape* shapeA, const Shape* shapeB)
 {
 	ShapePairCollisionStatus* collisionStatus = nullptr;
 
-	std::string cacheKey = this->MakeCacheKey(shapeA, shapeB);
+	CacheKey cacheKey = MakeCacheKey(shapeA, shapeB);
 
-	ShapePairCollisionStatusMap::iterator cacheIter = this->cacheMap->find(cacheKey);
-	if (cacheIter != this->cacheMap->end())
 	{
-		collisionStatus = cacheIter->second;
-		if (!collisionStatus->IsValid())
+		std::lock_guard<std::mutex> guard(*this->cacheMapMutex);
+		CacheSlot* cacheSlot = this->FindCacheSlot(cacheKey);
+		if (cacheSlot->collisionStatus && cacheSlot->collisionStatus->IsValid())
 		{
-			delete collisionStatus;
-			collisionStatus = nullptr;
-			this->cacheMap->erase(cacheIter);
+			cacheSlot->lastUsedGeneration = this->generation;
+
+			if (this->statistics)
+				this->statistics->RecordCacheHit();
+
+			return cacheSlot->collisionStatus;
 		}
 	}
-	
+
+	Shape::TypeID typeIDA = shapeA->GetShapeTypeID();
+	Shape::TypeID typeIDB = shapeB->GetShapeTypeID();
+
+	if (this->statistics)
+	{
+		this->statistics->RecordCacheMiss();
+		this->statistics->RecordCalculatorInvocation(typeIDA, typeIDB);
+	}
+
+	collisionStatus = CollisionCalculatorTable::Calculate(typeIDA, typeIDB, shapeA, shapeB);
 	if (!collisionStatus)
+		return nullptr;
+
+	// Another thread may have beaten us to calculating the same pair.  If so, go with theirs.
+	// A stale entry is replaced in place so that its slot gets reused.
+	std::lock_guard<std::mutex> guard(*this->cacheMapMutex);
+	CacheSlot* cacheSlot = this->FindCacheSlot(cacheKey);
+	cacheSlot->lastUsedGeneration = this->generation;
+	if (!cacheSlot->collisionStatus)
 	{
-		uint64_t calculatorKey = this->MakeCalculatorKey(shapeA, shapeB);
-		CollisionCalculatorMap::iterator calculatorIter = this->calculatorMap->find(calculatorKey);
-		if (calculatorIter != this->calculatorMap->end())
-		{
-			CollisionCalculatorInterface* calculator = calculatorIter->second;
-			collisionStatus = calculator->Calculate(shapeA, shapeB);
-			if (collisionStatus)
-				this->cacheMap->insert(std::pair<std::string, ShapePairCollisionStatus*>(cacheKey, collisionStatus));
-		}
+		cacheSlot->key = cacheKey;
+		cacheSlot->collisionStatus = collisionStatus;
+		if (++this->numCacheEntries > this->cacheSlotArray->size() / 2)
+			this->GrowCacheTable();
+	}
+	else if (cacheSlot->collisionStatus->IsValid())
+	{
+		delete collisionStatus;
+		collisionStatus = cacheSlot->collisionStatus;
+	}
+	else
+	{
+		this->RetireCollisionStatus(cacheSlot->collisionStatus);
+		cacheSlot->collisionStatus = collisionStatus;
 	}
 
 	return collisionStatus;
 }
 
-std::string CollisionCache::MakeCacheKey(const Shape* shapeA, const Shape* shapeB)
+/*static*/ CollisionCache::CacheKey CollisionCache::MakeCacheKey(const Shape* shapeA, const Shape* shapeB)
 {
-	ShapeID shapeIDs[2];
+	CacheKey cacheKey;
 
-	shapeIDs[0] = IMZADI_MIN(shapeA->GetShapeID(), shapeB->GetShapeID());
-	shapeIDs[1] = IMZADI_MAX(shapeA->GetShapeID(), shapeB->GetShapeID());
+	cacheKey.shapeIDA = IMZADI_MIN(shapeA->GetShapeID(), shapeB->GetShapeID());
+	cacheKey.shapeIDB = IMZADI_MAX(shapeA->GetShapeID(), shapeB->GetShapeID());
 
-	return std::format("{}-{}", shapeIDs[0], shapeIDs[1]);
+	return cacheKey;
 }
 
-uint64_t CollisionCache::MakeCalculatorKey(const Shape* shapeA, const Shape* shapeB)
+CollisionCache::CacheSlot* CollisionCache::FindCacheSlot(const CacheKey& key)
 {
-	uint32_t typeIDA = shapeA->GetShapeTypeID();
-	uint32_t typeIDB = shapeB->GetShapeTypeID();
+	// Shape IDs are handed out in sequence, so they're mixed well enough here to
+	// keep neighboring pairs from piling up in neighboring slots.
+	uint64_t hash = key.shapeIDA * 0x9E3779B97F4A7C15ULL;
+	hash ^= key.shapeIDB * 0xC2B2AE3D27D4EB4FULL;
+	hash ^= hash >> 29;
+
+	std::vector<CacheSlot>& cacheSlotArray = *this->cacheSlotArray;
+	size_t mask = cacheSlotArray.size() - 1;
+	size_t i = size_t(hash) & mask;
+	while (cacheSlotArray[i].collisionStatus && !(cacheSlotArray[i].key == key))
+		i = (i + 1) & mask;
+
+	return &cacheSlotArray[i];
+}
+
+void CollisionCache::GrowCacheTable()
+{
+	this->RehashCacheTable(this->cacheSlotArray->size() * 2);
+}
 
-	return this->MakeCalculatorKey(typeIDA, typeIDB);
+void CollisionCache::RehashCacheTable(size_t numSlots)
+{
+	std::vector<CacheSlot>* oldCacheSlotArray = this->cacheSlotArray;
+	this->cacheSlotArray = new std::vector<CacheSlot>(numSlots, CacheSlot{ { 0, 0 }, nullptr, 0 });
+
+	for (const CacheSlot& oldCacheSlot : *oldCacheSlotArray)
+		if (oldCacheSlot.collisionStatus)
+			*this->FindCacheSlot(oldCacheSlot.key) = oldCacheSlot;
+
+	delete oldCacheSlotArray;
 }
 
-uint64_t CollisionCache::MakeCalculatorKey(uint32_t typeIDA, uint32_t typeIDB)
+void CollisionCache::Forget(ShapeID shapeID)
 {
-	return (uint64_t(typeIDA) << 32) | uint64_t(typeIDB);
+	std::lock_guard<std::mutex> guard(*this->cacheMapMutex);
+	this->forgottenShapeArray->push_back(shapeID);
 }
 
-void CollisionCache::Clear()
+void CollisionCache::Trim()
 {
-	while (this->cacheMap->size() > 0)
+	std::lock_guard<std::mutex> guard(*this->cacheMapMutex);
+	std::vector<CacheSlot>& cacheSlotArray = *this->cacheSlotArray;
+
+	// No query is running, so no result can take hold of a retired status now.  Free those that have been let go.
+	auto lastHeldStatus = std::partition(this->retiredStatusArray->begin(), this->retiredStatusArray->end(), [](const ShapePairCollisionStatus* collisionStatus) { return collisionStatus->IsHeldByResult(); });
+	for (auto iter = lastHeldStatus; iter != this->retiredStatusArray->end(); iter++)
+		delete *iter;
+
+	this->retiredStatusArray->erase(lastHeldStatus, this->retiredStatusArray->end());
+
+	// Entries can't be taken out of the table one at a time without breaking up the probe sequences of
+	// others, so they're only emptied here, and the table is rehashed once they've all been dealt with.
+	uint64_t numPurged = 0;
+	if (this->forgottenShapeArray->size() > 0)
 	{
-		ShapePairCollisionStatusMap::iterator iter = this->cacheMap->begin();
-		ShapePairCollisionStatus* collisionStatus = iter->second;
-		delete collisionStatus;
-		this->cacheMap->erase(iter);
+		std::sort(this->forgottenShapeArray->begin(), this->forgottenShapeArray->end());
+		for (CacheSlot& cacheSlot : cacheSlotArray)
+		{
+			if (cacheSlot.collisionStatus &&
+				(std::binary_search(this->forgottenShapeArray->begin(), this->forgottenShapeArray->end(), cacheSlot.key.shapeIDA) ||
+				std::binary_search(this->forgottenShapeArray->begin(), this->forgottenShapeArray->end(), cacheSlot.key.shapeIDB)))
+			{
+				this->RetireCollisionStatus(cacheSlot.collisionStatus);
+				cacheSlot.collisionStatus = nullptr;
+				numPurged++;
+			}
+		}
+
+		this->numCacheEntries -= uint32_t(numPurged);
+		this->forgottenShapeArray->clear();
+	}
+
+	// After an eviction, the table is sized to be between a quarter and half full, so no entry
+	// accounts for more than four slots.  Evict enough that the target is met even then.
+	uint64_t numEvicted = 0;
+	if (CalculateMemoryUsage(this->numCacheEntries, cacheSlotArray.size()) > this->memoryLimit)
+	{
+		uint64_t targetNumEntries = uint64_t(double(this->memoryLimit) * IMZADI_CACHE_EVICTION_TARGET) / CalculateMemoryUsage(1, 4);
+		uint64_t numToEvict = (this->numCacheEntries > targetNumEntries) ? (this->numCacheEntries - targetNumEntries) : 0;
+
+		std::vector<uint64_t> generationArray;
+		for (const CacheSlot& cacheSlot : cacheSlotArray)
+			if (cacheSlot.collisionStatus && cacheSlot.lastUsedGeneration < this->generation)
+				generationArray.push_back(cacheSlot.lastUsedGeneration);
+
+		numToEvict = IMZADI_MIN(numToEvict, generationArray.size());
+		if (numToEvict > 0)
+		{
+			// Everything last used before the cut-off generation goes, along with just enough of those last used in it.
+			std::nth_element(generationArray.begin(), generationArray.begin() + (numToEvict - 1), generationArray.end());
+			uint64_t cutOffGeneration = generationArray[numToEvict - 1];
+			uint64_t numAtCutOff = numToEvict - std::count_if(generationArray.begin(), generationArray.end(), [cutOffGeneration](uint64_t generation) { return generation < cutOffGeneration; });
+
+			for (CacheSlot& cacheSlot : cacheSlotArray)
+			{
+				if (!cacheSlot.collisionStatus || cacheSlot.lastUsedGeneration > cutOffGeneration)
+					continue;
+
+				if (cacheSlot.lastUsedGeneration == cutOffGeneration)
+				{
+					if (numAtCutOff == 0)
+						continue;
+
+					numAtCutOff--;
+				}
+
+				this->RetireCollisionStatus(cacheSlot.collisionStatus);
+				cacheSlot.collisionStatus = nullptr;
+				numEvicted++;
+			}
+
+			this->numCacheEntries -= uint32_t(numEvicted);
+		}
 	}
+
+	if (numPurged > 0 || numEvicted > 0)
+	{
+		size_t numSlots = cacheSlotArray.size();
+		if (numEvicted > 0 || uint64_t(this->numCacheEntries) * 8 < numSlots)
+		{
+			numSlots = IMZADI_CACHE_INITIAL_NUM_SLOTS;
+			while (numSlots < size_t(this->numCacheEntries) * 2)
+				numSlots *= 2;
+		}
+
+		this->RehashCacheTable(numSlots);
+	}
+
+	if (this->statistics)
+		this->statistics->RecordCacheTrim(numPurged, numEvicted, this->numCacheEntries, CalculateMemoryUsage(this->numCacheEntries, this->cacheSlotArray->size()));
+
+	this->generation++;
 }
 
-void CollisionCache::ClearCalculatorMap()
+void CollisionCache::RetireCollisionStatus(ShapePairCollisionStatus* collisionStatus)
 {
-	while (this->calculatorMap->size() > 0)
+	if (collisionStatus->IsHeldByResult())
+		this->retiredStatusArray->push_back(collisionStatus);
+	else
+		delete collisionStatus;
+}
+
+/*static*/ uint64_t CollisionCache::CalculateMemoryUsage(uint64_t numEntries, uint64_t numSlots)
+{
+	return numEntries * sizeof(ShapePairCollisionStatus) + numSlots * sizeof(CacheSlot);
+}
+
+void CollisionCache::Clear()
+{
+	std::lock_guard<std::mutex> guard(*this->cacheMapMutex);
+	for (CacheSlot& cacheSlot : *this->cacheSlotArray)
 	{
-		CollisionCalculatorMap::iterator iter = this->calculatorMap->begin();
-		CollisionCalculatorInterface* calculator = iter->second;
-		delete calculator;
-		this->calculatorMap->erase(iter);
+		if (cacheSlot.collisionStatus)
+			this->RetireCollisionStatus(cacheSlot.collisionStatus);
+
+		cacheSlot.collisionStatus = nullptr;
 	}
+
+	this->numCacheEntries = 0;
+	this->forgottenShapeArray->clear();
 }
 
 //----------------------------- ShapePairCollisionStatus -----------------------------
@@ -136,8 +278,11 @@ ShapePairCollisionStatus::ShapePairCollisionStatus(const Shape* shapeA, const Sh
 	this->inCollision = false;
 	this->shapeA = shapeA;
 	this->shapeB = shapeB;
+	this->shapeIDA = shapeA->GetOriginalShapeID();
+	this->shapeIDB = shapeB->GetOriginalShapeID();
 	this->revisionNumberA = shapeA->GetRevisionNumber();
 	this->revisionNumberB = shapeB->GetRevisionNumber();
+	this->numResultReferences = 0;
 }
 
 /*virtual*/ ShapePairCollisionStatus::~ShapePairCollisionStatus()
@@ -158,25 +303,25 @@ bool ShapePairCollisionStatus::IsValid() const
 ShapeID ShapePairCollisionStatus::GetShapeID(int i) const
 {
 	if (i % 2 == 0)
-		return this->shapeA->GetShapeID();
+		return this->shapeIDA;
 	else
-		return this->shapeB->GetShapeID();
+		return this->shapeIDB;
 }
 
 ShapeID ShapePairCollisionStatus::GetOtherShape(ShapeID shapeID) const
 {
-	if (shapeID == this->shapeA->GetShapeID())
-		return this->shapeB->GetShapeID();
-	else if (shapeID == this->shapeB->GetShapeID())
-		return this->shapeA->GetShapeID();
+	if (shapeID == this->shapeIDA)
+		return this->shapeIDB;
+	else if (shapeID == this->shapeIDB)
+		return this->shapeIDA;
 	return 0;
 }
 
 Vector3 ShapePairCollisionStatus::GetSeparationDelta(ShapeID shapeID) const
 {
-	if (shapeID == this->shapeA->GetShapeID())
+	if (shapeID == this->shapeIDA)
 		return this->separationDelta;
-	else if (shapeID == this->shapeB->GetShapeID())
+	else if (shapeID == this->shapeIDB)
 		return -this->separationDelta;
 
 	return Vector3(0.0, 0.0, 0.0);
@@ -190,6 +335,16 @@ double ShapePairCollisionStatus::GetSeparationDeltaLength() const
 	return this->separationDelta.Length();
 }
 
+/*static*/ void* ShapePairCollisionStatus::operator new(size_t size)
+{
+	return CollisionHeap::Get()->Allocate(size);
+}
+
+/*static*/ void ShapePairCollisionStatus::operator delete(void* memory, size_t size)
+{
+	CollisionHeap::Get()->Deallocate(memory, size);
+}
+
 void ShapePairCollisionStatus::FlipContext()
 {
 	this->separationDelta *= -1.0;
@@ -197,4 +352,12 @@ void ShapePairCollisionStatus::FlipContext()
 	const Shape* shape = this->shapeA;
 	this->shapeA = this->shapeB;
 	this->shapeB = shape;
+
+	ShapeID shapeID = this->shapeIDA;
+	this->shapeIDA = this->shapeIDB;
+	this->shapeIDB = shapeID;
+
+	uint64_t revisionNumber = this->revisionNumberA;
+	this->revisionNumberA = this->revisionNumberB;
+	this->revisionNumberB = revisionNumber;
 }
\ No newline at end of file
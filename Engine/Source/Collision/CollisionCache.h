@@ -4,8 +4,11 @@
 #include "Math/Vector3.h"
 #include "CollisionCalculator.h"
 #include "Shape.h"
+#include "CollisionStatistics.h"
 #include <unordered_map>
-#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 namespace Imzadi
 {
@@ -18,6 +21,20 @@ namespace Imzadi
 	 * another, then you will, of course, get the same result.  The purposes of this cache
 	 * is to prevent the work of calculating a collision between two shapes from being
 	 * needlessly redone, such as in the cases thus described.
+	 * 
+	 * Cache entries are kept in a flat, open-addressed table keyed by the pair of shape IDs,
+	 * so that a lookup is a hash of two integers and a short linear probe, with nothing to
+	 * allocate or format along the way.
+	 * 
+	 * The cache is bounded.  Entries involving a removed shape are purged, and once the cache
+	 * takes up more than its memory limit, the entries that have gone unused the longest are
+	 * evicted.  Both are done by the Trim method, between batches of queries.  A status still
+	 * held by a result is not freed along with its entry, but is kept aside until the result
+	 * lets go of it, as is the status of any entry replaced because it went stale.
+	 * 
+	 * The cache may be accessed by multiple collision worker threads at once,
+	 * so access to it is guarded by a mutex, but the narrow-phase calculations
+	 * themselves are done outside of that lock.
 	 */
 	class IMZADI_API CollisionCache
 	{
@@ -42,36 +59,112 @@ namespace Imzadi
 		 */
 		void Clear();
 
+		/**
+		 * Tell the cache where to count its hits, misses and calculations.  The cache does not own the given object.
+		 */
+		void SetStatistics(CollisionStatistics* statistics) { this->statistics = statistics; }
+
+		/**
+		 * Note that the shape having the given ID is going away, so that entries involving it
+		 * get purged.  They aren't purged right away, but by the next call to the Trim method.
+		 * The shape is never looked at again, so it may be freed as soon as this returns.
+		 */
+		void Forget(ShapeID shapeID);
+
+		/**
+		 * Purge entries involving forgotten shapes and, if the cache is over its memory limit, evict
+		 * entries that have gone unused the longest until it's down to IMZADI_CACHE_EVICTION_TARGET
+		 * of its limit.  Entries used since the last call are never evicted, so the limit may be
+		 * exceeded for a time if that many are in use.  This must not be called while queries are
+		 * being executed, and marks the start of a new period of use.
+		 */
+		void Trim();
+
+		/**
+		 * Set the most memory the cache should take up, counting its entries and its table.
+		 * This takes effect the next time the Trim method is called.
+		 */
+		void SetMemoryLimit(uint64_t memoryLimit) { this->memoryLimit = memoryLimit; }
+
+		/**
+		 * Get the most memory the cache should take up.  See the SetMemoryLimit method.
+		 */
+		uint64_t GetMemoryLimit() const { return this->memoryLimit; }
+
 	private:
 
-		template<typename ShapeTypeA, typename ShapeTypeB>
-		void AddCalculator()
+		/**
+		 * This identifies an unordered pair of shapes, the lesser ID always going first.
+		 */
+		struct CacheKey
 		{
-			CollisionCalculatorInterface* calculator = new CollisionCalculator<ShapeTypeA, ShapeTypeB>();
-			uint32_t typeIDA = ShapeTypeA::StaticTypeID();
-			uint32_t typeIDB = ShapeTypeB::StaticTypeID();
-			uint64_t calculatorKey = this->MakeCalculatorKey(typeIDA, typeIDB);
-			this->calculatorMap->insert(std::pair<uint64_t, CollisionCalculatorInterface*>(calculatorKey, calculator));
-		}
+			ShapeID shapeIDA;
+			ShapeID shapeIDB;
 
-		void ClearCalculatorMap();
+			bool operator==(const CacheKey& key) const
+			{
+				return this->shapeIDA == key.shapeIDA && this->shapeIDB == key.shapeIDB;
+			}
+		};
 
-		std::string MakeCacheKey(const Shape* shapeA, const Shape* shapeB);
-		uint64_t MakeCalculatorKey(const Shape* shapeA, const Shape* shapeB);
-		uint64_t MakeCalculatorKey(uint32_t typeIDA, uint32_t typeIDB);
+		/**
+		 * This is one slot of the cache table.  A slot is empty if it has no collision status.
+		 */
+		struct CacheSlot
+		{
+			CacheKey key;
+			ShapePairCollisionStatus* collisionStatus;
+			uint64_t lastUsedGeneration;		///< This is the generation in which the entry was last looked up.  See the Trim method.
+		};
 
-		typedef std::unordered_map<std::string, ShapePairCollisionStatus*> ShapePairCollisionStatusMap;
-		ShapePairCollisionStatusMap* cacheMap;
+		static CacheKey MakeCacheKey(const Shape* shapeA, const Shape* shapeB);
+
+		/**
+		 * Find the slot holding the given key, or, failing that, the empty slot at which its probe ends.
+		 * The table must have at least one empty slot.  The cache map mutex must be held.
+		 */
+		CacheSlot* FindCacheSlot(const CacheKey& key);
+
+		/**
+		 * Double the number of slots in the table and put every entry back in.  The cache map mutex must be held.
+		 */
+		void GrowCacheTable();
 
-		typedef std::unordered_map<uint64_t, CollisionCalculatorInterface*> CollisionCalculatorMap;
-		CollisionCalculatorMap* calculatorMap;
+		/**
+		 * Put every entry back into a table having the given number of slots, which must be
+		 * a power of two.  The cache map mutex must be held.
+		 */
+		void RehashCacheTable(size_t numSlots);
+
+		/**
+		 * Calculate how much memory the cache takes up for the given number of entries and slots.
+		 */
+		static uint64_t CalculateMemoryUsage(uint64_t numEntries, uint64_t numSlots);
+
+		/**
+		 * Free the given status, which is no longer in the table, or, if a result still holds it,
+		 * keep it aside until a later trim finds it let go.  The cache map mutex must be held.
+		 */
+		void RetireCollisionStatus(ShapePairCollisionStatus* collisionStatus);
+
+		std::vector<CacheSlot>* cacheSlotArray;		///< The number of these is always a power of two, and they are never more than half full.
+		uint32_t numCacheEntries;					///< This is the number of slots holding a collision status.
+		std::vector<ShapeID>* forgottenShapeArray;	///< These are the IDs of shapes removed since the last trim, whose entries are yet to be purged.
+		uint64_t generation;						///< This is the number of times the cache has been trimmed.
+		uint64_t memoryLimit;						///< This is the most memory the cache should take up, in bytes.
+		std::vector<ShapePairCollisionStatus*>* retiredStatusArray;	///< These are statuses no longer in the table, but still held by results.
+
+		std::mutex* cacheMapMutex;
+		CollisionStatistics* statistics;
 	};
 
 	/**
 	 * These are the elements of the collision cache, and what are returned in a collision query result.
 	 * Note that raw shape pointers are included in this class/structure, but should not be accessed
 	 * by the collision system user.  They are made private, but don't be tempted to hack the structure,
-	 * because read/write or even just read-only access to them is not thread-safe.
+	 * because read/write or even just read-only access to them is not thread-safe.  A result may be
+	 * looked at while the collision thread removes its shapes, so the shape IDs are copied in when the
+	 * status is made, and only the cache, on the collision thread, ever goes through the pointers.
 	 */
 	class IMZADI_API ShapePairCollisionStatus
 	{
@@ -89,6 +182,8 @@ namespace Imzadi
 
 		/**
 		 * Get the ID of one of the two shapes involved in this collision status pair.
+		 * Here, as with all IDs reported by this class, a piece of a split shape goes
+		 * by the ID of the shape it was split from.  See Shape::GetOriginalShapeID.
 		 * 
 		 * @param[in] i If this is even, shape A's ID is returned; B, otherwise.
 		 */
@@ -127,12 +222,38 @@ namespace Imzadi
 		 */
 		ShapeID GetOtherShape(ShapeID shapeID) const;
 
+		/**
+		 * Cache entries are allocated from the collision heap rather than the system heap.
+		 * See the CollisionHeap class.
+		 */
+		static void* operator new(size_t size);
+
+		/**
+		 * Give the memory of a cache entry back to the collision heap.
+		 */
+		static void operator delete(void* memory, size_t size);
+
 	public:
 		/**
 		 * This is used internally so that we can re-use code comparing A against B in the case of B against A.
 		 */
 		void FlipContext();
 
+		/**
+		 * A result counts itself here for as long as it holds this status, so that the cache knows not to free it.
+		 */
+		void AddResultReference() { this->numResultReferences.fetch_add(1, std::memory_order_relaxed); }
+
+		/**
+		 * A result calls this once it no longer holds this status.
+		 */
+		void RemoveResultReference() { this->numResultReferences.fetch_sub(1, std::memory_order_release); }
+
+		/**
+		 * Tell the caller if any result still holds this status.
+		 */
+		bool IsHeldByResult() const { return this->numResultReferences.load(std::memory_order_acquire) > 0; }
+
 		bool inCollision;				///< Are the shapes in this pair thought to be in collision/overlapping?
 		Vector3 collisionCenter;		///< This is an approximate center of the overlap region between the two shapes, if they are thought to be in collision; undefined, otherwise.
 		Vector3 separationDelta;		///< This is a minimal translation delta that, if added to shape A or subtracted from shape B, will get them into a state of at most touching.  It is undefined if the shapes are not thought to be in collision.
@@ -142,5 +263,8 @@ namespace Imzadi
 		uint64_t revisionNumberB;		///< This cache entry was calculated when shape B was at this revision number.
 		const Shape* shapeA;			///< This is the first shape in the collision pair.  Order doesn't matter.
 		const Shape* shapeB;			///< This is the second shape in the collision pair.  Again, order doesn't matter.
+		ShapeID shapeIDA;				///< This is the original ID of shape A.  See Shape::GetOriginalShapeID.
+		ShapeID shapeIDB;				///< This is the original ID of shape B.
+		std::atomic<uint32_t> numResultReferences;	///< This is the number of results holding this status.
 	};
 }
\ No newline at end of file
@@ -7,21 +7,13 @@
 #include "Shapes/Polygon.h"
 #include "Math/LineSegment.h"
 #include "Math/Plane.h"
-#include "Math/Ray.h"
-#include "Math/Interval.h"
 
 using namespace Imzadi;
 
 //------------------------------ CollisionCalculator<SphereShape, SphereShape> ------------------------------
 
-ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calculate(const SphereShape* sphereA, const SphereShape* sphereB)
 {
-	auto sphereA = dynamic_cast<const SphereShape*>(shapeA);
-	auto sphereB = dynamic_cast<const SphereShape*>(shapeB);
-
-	if (!sphereA || !sphereB)
-		return nullptr;
-
 	auto collisionStatus = new ShapePairCollisionStatus(sphereA, sphereB);
 
 	Vector3 centerA = sphereA->GetObjectToWorldTransform().TransformPoint(sphereA->GetCenter());
@@ -43,15 +35,9 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<SphereShape, CapsuleShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<SphereShape, CapsuleShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<SphereShape, CapsuleShape>::Calculate(const SphereShape* sphere, const CapsuleShape* capsule)
 {
-	auto sphere = dynamic_cast<const SphereShape*>(shapeA);
-	auto capsule = dynamic_cast<const CapsuleShape*>(shapeB);
-	
-	if (!sphere || !capsule)
-		return nullptr;
-
-	auto collisionStatus = new ShapePairCollisionStatus(shapeA, shapeB);
+	auto collisionStatus = new ShapePairCollisionStatus(sphere, capsule);
 
 	LineSegment capsuleSpine(capsule->GetVertex(0), capsule->GetVertex(1));
 	capsuleSpine = capsule->GetObjectToWorldTransform().TransformLineSegment(capsuleSpine);
@@ -74,9 +60,9 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<CapsuleShape, SphereShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<CapsuleShape, SphereShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<CapsuleShape, SphereShape>::Calculate(const CapsuleShape* capsule, const SphereShape* sphere)
 {
-	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<SphereShape, CapsuleShape>().Calculate(shapeB, shapeA);
+	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<SphereShape, CapsuleShape>::Calculate(sphere, capsule);
 	if (collisionStatus)
 		collisionStatus->FlipContext();
 	return collisionStatus;
@@ -84,15 +70,9 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<CapsuleShape, CapsuleShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<CapsuleShape, CapsuleShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<CapsuleShape, CapsuleShape>::Calculate(const CapsuleShape* capsuleA, const CapsuleShape* capsuleB)
 {
-	auto collisionStatus = new ShapePairCollisionStatus(shapeA, shapeB);
-
-	auto capsuleA = dynamic_cast<const CapsuleShape*>(shapeA);
-	auto capsuleB = dynamic_cast<const CapsuleShape*>(shapeB);
-
-	if (!capsuleA || !capsuleB)
-		return nullptr;
+	auto collisionStatus = new ShapePairCollisionStatus(capsuleA, capsuleB);
 
 	LineSegment spineA = capsuleA->GetObjectToWorldTransform().TransformLineSegment(capsuleA->GetSpine());
 	LineSegment spineB = capsuleB->GetObjectToWorldTransform().TransformLineSegment(capsuleB->GetSpine());
@@ -116,15 +96,9 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<SphereShape, BoxShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<SphereShape, BoxShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<SphereShape, BoxShape>::Calculate(const SphereShape* sphere, const BoxShape* box)
 {
-	auto sphere = dynamic_cast<const SphereShape*>(shapeA);
-	auto box = dynamic_cast<const BoxShape*>(shapeB);
-
-	if (!sphere || !box)
-		return nullptr;
-
-	auto collisionStatus = new ShapePairCollisionStatus(shapeA, shapeB);
+	auto collisionStatus = new ShapePairCollisionStatus(sphere, box);
 
 	Transform worldToBox = box->GetWorldToObjectTransform();
 	Transform sphereToWorld = sphere->GetObjectToWorldTransform();
@@ -164,9 +138,9 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<BoxShape, SphereShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<BoxShape, SphereShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<BoxShape, SphereShape>::Calculate(const BoxShape* box, const SphereShape* sphere)
 {
-	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<SphereShape, BoxShape>().Calculate(shapeB, shapeA);
+	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<SphereShape, BoxShape>::Calculate(sphere, box);
 	if (collisionStatus)
 		collisionStatus->FlipContext();
 	return collisionStatus;
@@ -174,15 +148,9 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<SphereShape, PolygonShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<SphereShape, PolygonShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<SphereShape, PolygonShape>::Calculate(const SphereShape* sphere, const PolygonShape* polygon)
 {
-	auto sphere = dynamic_cast<const SphereShape*>(shapeA);
-	auto polygon = dynamic_cast<const PolygonShape*>(shapeB);
-
-	if (!sphere || !polygon)
-		return nullptr;
-
-	auto collisionStatus = new ShapePairCollisionStatus(shapeA, shapeB);
+	auto collisionStatus = new ShapePairCollisionStatus(sphere, polygon);
 
 	Vector3 sphereCenter = sphere->GetObjectToWorldTransform().TransformPoint(sphere->GetCenter());
 	Vector3 polygonPoint = polygon->ClosestPointTo(sphereCenter);
@@ -203,9 +171,9 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<PolygonShape, SphereShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<PolygonShape, SphereShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<PolygonShape, SphereShape>::Calculate(const PolygonShape* polygon, const SphereShape* sphere)
 {
-	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<SphereShape, PolygonShape>().Calculate(shapeB, shapeA);
+	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<SphereShape, PolygonShape>::Calculate(sphere, polygon);
 	if (collisionStatus)
 		collisionStatus->FlipContext();
 	return collisionStatus;
@@ -213,203 +181,240 @@ ShapePairCollisionStatus* CollisionCalculator<SphereShape, SphereShape>::Calcula
 
 //------------------------------ CollisionCalculator<BoxShape, BoxShape> ------------------------------
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<BoxShape, BoxShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<BoxShape, BoxShape>::Calculate(const BoxShape* boxA, const BoxShape* boxB)
 {
-	auto boxA = dynamic_cast<const BoxShape*>(shapeA);
-	auto boxB = dynamic_cast<const BoxShape*>(shapeB);
+	auto collisionStatus = new ShapePairCollisionStatus(boxA, boxB);
 
-	if (!boxA || !boxB)
-		return nullptr;
+	WorldBox worldBoxA, worldBoxB;
+	MakeWorldBox(boxA, worldBoxA);
+	MakeWorldBox(boxB, worldBoxB);
 
-	auto collisionStatus = new ShapePairCollisionStatus(shapeA, shapeB);
+	Vector3 centerDelta = worldBoxB.center - worldBoxA.center;
 
-	BoxShape tempBoxA(*boxA);
-	Vector3 totalSeparationDelta(0.0, 0.0, 0.0);
+	// The cross product of nearly parallel edges is too short to be trusted for a direction.
+	// Such an axis is skipped, which is safe, because were the edges exactly parallel, any
+	// separating axis among their cross products would also be found among the face normals.
+	constexpr double parallelTolerance = 1e-6;
 
-	while (true)
+	double smallestOverlap = std::numeric_limits<double>::max();
+	Vector3 unitNormal;
+	int axisA = -1;
+	int axisB = -1;
+
+	// The face normals of A come first, then those of B, then the edge cross products, so that ties go to faces.
+	for (int i = 0; i < 15; i++)
 	{
-		VertexPenetrationArray vertexPenetrationArrayA;
-		EdgeImpalementArray edgeImpalementArrayA;
-		FacePunctureArray facePunctureArrayA;
-		bool intersectionsFoundA = this->GatherInfo(&tempBoxA, boxB, vertexPenetrationArrayA, edgeImpalementArrayA, facePunctureArrayA);
-
-		VertexPenetrationArray vertexPenetrationArrayB;
-		EdgeImpalementArray edgeImpalementArrayB;
-		FacePunctureArray facePunctureArrayB;
-		bool intersectionsFoundB = this->GatherInfo(boxB, &tempBoxA, vertexPenetrationArrayB, edgeImpalementArrayB, facePunctureArrayB);
-
-		if (!intersectionsFoundA && !intersectionsFoundB)
-			break;
-		
-		Vector3 separationDelta(0.0, 0.0, 0.0);
-
-		if (edgeImpalementArrayA.size() == 1 && edgeImpalementArrayB.size() == 1 &&
-			vertexPenetrationArrayA.size() == 0 && vertexPenetrationArrayB.size() == 0)
-		{
-			LineSegment lineA(edgeImpalementArrayA[0].surfacePointA, edgeImpalementArrayA[0].surfacePointB);
-			LineSegment lineB(edgeImpalementArrayB[0].surfacePointA, edgeImpalementArrayB[0].surfacePointB);
-			LineSegment connector;
-			connector.SetAsShortestConnector(lineA, lineB);
-			separationDelta = -connector.GetDelta();
-		}
-		else if (edgeImpalementArrayA.size() == 0 && edgeImpalementArrayB.size() == 0 &&
-			vertexPenetrationArrayA.size() == 1 && vertexPenetrationArrayB.size() == 0)
+		Vector3 unitAxis;
+		int candidateAxisA = -1;
+		int candidateAxisB = -1;
+
+		if (i < 3)
 		{
-			const VertexPenetration& vertexPenetration = vertexPenetrationArrayA[0];
-			LineSegment lineSeg(vertexPenetration.penetrationPoint, vertexPenetration.surfacePoint);
-			separationDelta = -lineSeg.GetDelta();
+			candidateAxisA = i;
+			unitAxis = worldBoxA.unitFaceNormal[candidateAxisA];
 		}
-		else if (edgeImpalementArrayA.size() == 0 && edgeImpalementArrayB.size() == 0 &&
-			vertexPenetrationArrayA.size() == 0 && vertexPenetrationArrayB.size() == 1)
+		else if (i < 6)
 		{
-			const VertexPenetration& vertexPenetration = vertexPenetrationArrayB[0];
-			LineSegment lineSeg(vertexPenetration.penetrationPoint, vertexPenetration.surfacePoint);
-			separationDelta = lineSeg.GetDelta();
-		}
-		else if(facePunctureArrayA.size() > 0 || facePunctureArrayB.size() > 0)
-		{
-			std::vector<const FacePuncture*> combinedPunctureArray;
-			for (const FacePuncture& facePuncture : facePunctureArrayA)
-				combinedPunctureArray.push_back(&facePuncture);
-			for (const FacePuncture& facePuncture : facePunctureArrayB)
-				combinedPunctureArray.push_back(&facePuncture);
-			double smallestPunctureDistance = std::numeric_limits<double>::max();
-			int j = -1;
-			for (int i = 0; i < (signed)combinedPunctureArray.size(); i++)
-			{
-				const FacePuncture* facePuncture = combinedPunctureArray[i];
-				double punctureDistance = (facePuncture->surfacePoint - facePuncture->internalPoint).Length();
-				if (punctureDistance < smallestPunctureDistance)
-				{
-					smallestPunctureDistance = punctureDistance;
-					j = i;
-				}
-			}
-			const FacePuncture* chosenPuncture = combinedPunctureArray[j];
-			separationDelta = chosenPuncture->internalPoint - chosenPuncture->surfacePoint;
-			if (j >= facePunctureArrayA.size())
-				separationDelta = -separationDelta;
+			candidateAxisB = i - 3;
+			unitAxis = worldBoxB.unitFaceNormal[candidateAxisB];
 		}
 		else
 		{
-			// This means there's a case we need to consider that we have not yet considered.
-			IMZADI_ASSERT(false);
-			break;
+			candidateAxisA = (i - 6) / 3;
+			candidateAxisB = (i - 6) % 3;
+			const Vector3& halfEdgeA = worldBoxA.halfEdge[candidateAxisA];
+			const Vector3& halfEdgeB = worldBoxB.halfEdge[candidateAxisB];
+			unitAxis.Cross(halfEdgeA, halfEdgeB);
+			double length = unitAxis.Length();
+			if (length <= parallelTolerance * halfEdgeA.Length() * halfEdgeB.Length())
+				continue;
+			unitAxis /= length;
 		}
 
-		Transform separationTransform;
-		separationTransform.SetIdentity();
-		separationTransform.translation = separationDelta;
-		tempBoxA.SetObjectToWorldTransform(separationTransform * tempBoxA.GetObjectToWorldTransform());
-		totalSeparationDelta += separationDelta;
-	}
+		if (!unitAxis.IsNonZero())
+			continue;
 
-	if (totalSeparationDelta.IsNonZero())
-	{
-		collisionStatus->inCollision = true;
-		collisionStatus->separationDelta = totalSeparationDelta;
+		double distance = centerDelta.Dot(unitAxis);
+		double overlap = ProjectedRadius(worldBoxA, unitAxis) + ProjectedRadius(worldBoxB, unitAxis) - ::fabs(distance);
+		if (overlap <= 0.0)
+			return collisionStatus;
+
+		if (overlap < smallestOverlap)
+		{
+			smallestOverlap = overlap;
+			unitNormal = (distance >= 0.0) ? unitAxis : -unitAxis;
+			axisA = candidateAxisA;
+			axisB = candidateAxisB;
+		}
 	}
 
+	if (axisA < 0 && axisB < 0)
+		return collisionStatus;
+
+	collisionStatus->inCollision = true;
+	collisionStatus->separationDelta = -unitNormal * smallestOverlap;
+
+	if (axisB < 0)
+		collisionStatus->collisionCenter = CalculateFaceContactCenter(worldBoxA, axisA, worldBoxB, unitNormal);
+	else if (axisA < 0)
+		collisionStatus->collisionCenter = CalculateFaceContactCenter(worldBoxB, axisB, worldBoxA, -unitNormal);
+	else
+		collisionStatus->collisionCenter = CalculateEdgeContactCenter(worldBoxA, axisA, worldBoxB, axisB, unitNormal);
+
 	return collisionStatus;
 }
 
-bool CollisionCalculator<BoxShape, BoxShape>::GatherInfo(const BoxShape* homeBox, const BoxShape* awayBox,
-															VertexPenetrationArray& vertexPenetrationArray,
-															EdgeImpalementArray& edgeImpalementArray,
-															FacePunctureArray& facePunctureArray)
+/*static*/ void CollisionCalculator<BoxShape, BoxShape>::MakeWorldBox(const BoxShape* box, WorldBox& worldBox)
 {
-	constexpr double threshold = 1e-5;
-
-	vertexPenetrationArray.clear();
-	edgeImpalementArray.clear();
-	facePunctureArray.clear();
-
-	AxisAlignedBoundingBox homeBoxAligned;
-	homeBox->GetAxisAlignedBox(homeBoxAligned);
+	const Transform& objectToWorld = box->GetObjectToWorldTransform();
+	const Vector3& extents = box->GetExtents();
 
-	std::vector<Vector3> awayCornerPointArray;
-	awayBox->GetCornerPointArray(awayCornerPointArray, false);
+	worldBox.center = objectToWorld.translation;
+	worldBox.halfEdge[0] = objectToWorld.matrix.GetColumnVector(0) * extents.x;
+	worldBox.halfEdge[1] = objectToWorld.matrix.GetColumnVector(1) * extents.y;
+	worldBox.halfEdge[2] = objectToWorld.matrix.GetColumnVector(2) * extents.z;
 
-	const Transform& homeToWorld = homeBox->GetObjectToWorldTransform();
-	Transform worldToHome = homeToWorld.Inverted();
+	// A face is spanned by the two half-edges not pointing to it.  A box with no volume is given zero normals.
+	for (int i = 0; i < 3; i++)
+	{
+		Vector3& unitFaceNormal = worldBox.unitFaceNormal[i];
+		unitFaceNormal.Cross(worldBox.halfEdge[(i + 1) % 3], worldBox.halfEdge[(i + 2) % 3]);
+		if (!unitFaceNormal.Normalize())
+			unitFaceNormal = Vector3(0.0, 0.0, 0.0);
+		else if (unitFaceNormal.Dot(worldBox.halfEdge[i]) < 0.0)
+			unitFaceNormal = -unitFaceNormal;
+	}
+}
 
-	const Transform& awayToWorld = awayBox->GetObjectToWorldTransform();
-	Transform awayToHome = worldToHome * awayToWorld;
+/*static*/ double CollisionCalculator<BoxShape, BoxShape>::ProjectedRadius(const WorldBox& worldBox, const Vector3& unitAxis)
+{
+	return
+		::fabs(worldBox.halfEdge[0].Dot(unitAxis)) +
+		::fabs(worldBox.halfEdge[1].Dot(unitAxis)) +
+		::fabs(worldBox.halfEdge[2].Dot(unitAxis));
+}
 
-	for (Vector3& awayCorner : awayCornerPointArray)
-		awayCorner = awayToHome.TransformPoint(awayCorner);
+/*static*/ Vector3 CollisionCalculator<BoxShape, BoxShape>::CalculateFaceContactCenter(const WorldBox& referenceBox, int referenceAxis, const WorldBox& incidentBox, const Vector3& unitNormal)
+{
+	double referenceSide = (referenceBox.unitFaceNormal[referenceAxis].Dot(unitNormal) >= 0.0) ? 1.0 : -1.0;
+	Vector3 referenceFaceCenter = referenceBox.center + referenceBox.halfEdge[referenceAxis] * referenceSide;
 
-	for (const Vector3& awayCorner : awayCornerPointArray)
+	// The incident face is the one facing most against the reference face.
+	int incidentAxis = 0;
+	double largestDot = -1.0;
+	for (int i = 0; i < 3; i++)
 	{
-		if (homeBoxAligned.ContainsPoint(awayCorner))
+		double dot = ::fabs(incidentBox.unitFaceNormal[i].Dot(unitNormal));
+		if (dot > largestDot)
 		{
-			VertexPenetration vertexPenetration;
-			vertexPenetration.penetrationPoint = homeToWorld.TransformPoint(awayCorner);
-			vertexPenetration.surfacePoint = homeToWorld.TransformPoint(homeBoxAligned.ClosestPointTo(awayCorner));
-			if ((vertexPenetration.surfacePoint - vertexPenetration.penetrationPoint).Length() > threshold)
-				vertexPenetrationArray.push_back(vertexPenetration);
+			largestDot = dot;
+			incidentAxis = i;
 		}
 	}
 
-	std::vector<LineSegment> edgeSegmentArray;
-	awayBox->GetEdgeSegmentArray(edgeSegmentArray, false);
-
-	for (LineSegment& edge : edgeSegmentArray)
-		edge = awayToHome.TransformLineSegment(edge);
-
-	for (const LineSegment& edge : edgeSegmentArray)
+	double incidentSide = (incidentBox.unitFaceNormal[incidentAxis].Dot(unitNormal) > 0.0) ? -1.0 : 1.0;
+	Vector3 incidentFaceCenter = incidentBox.center + incidentBox.halfEdge[incidentAxis] * incidentSide;
+	const Vector3& incidentHalfEdgeU = incidentBox.halfEdge[(incidentAxis + 1) % 3];
+	const Vector3& incidentHalfEdgeV = incidentBox.halfEdge[(incidentAxis + 2) % 3];
+
+	// Clipping a quadrilateral against four planes adds at most one point per plane.
+	Vector3 pointArray[2][8];
+	int numPoints = 4;
+	pointArray[0][0] = incidentFaceCenter + incidentHalfEdgeU + incidentHalfEdgeV;
+	pointArray[0][1] = incidentFaceCenter - incidentHalfEdgeU + incidentHalfEdgeV;
+	pointArray[0][2] = incidentFaceCenter - incidentHalfEdgeU - incidentHalfEdgeV;
+	pointArray[0][3] = incidentFaceCenter + incidentHalfEdgeU - incidentHalfEdgeV;
+
+	int k = 0;
+	for (int i = 1; i <= 2; i++)
 	{
-		std::vector<double> alphaArray;
-		Interval interval(0.0, edge.Length());
-		Ray ray;
-		ray.FromLineSegment(edge);
-		ray.CastAgainst(homeBoxAligned, alphaArray);
-		if (alphaArray.size() == 2)
+		int sideAxis = (referenceAxis + i) % 3;
+		const Vector3& sideNormal = referenceBox.unitFaceNormal[sideAxis];
+		double sideCenter = sideNormal.Dot(referenceBox.center);
+		double sideRadius = sideNormal.Dot(referenceBox.halfEdge[sideAxis]);
+
+		for (int j = 0; j < 2; j++)
 		{
-			constexpr double epsilon = 1e-6;
-			if (interval.ContainsValue(alphaArray[0], epsilon) && interval.ContainsValue(alphaArray[1], epsilon))
-			{
-				EdgeImpalement edgeImpalement;
-				edgeImpalement.surfacePointA = homeToWorld.TransformPoint(ray.CalculatePoint(alphaArray[0]));
-				edgeImpalement.surfacePointB = homeToWorld.TransformPoint(ray.CalculatePoint(alphaArray[1]));
-				if ((edgeImpalement.surfacePointA - edgeImpalement.surfacePointB).Length() > threshold)
-					edgeImpalementArray.push_back(edgeImpalement);
-			}
-			else if (interval.ContainsValue(alphaArray[0]))
+			// Keep what is on the inside of the plane of the side face.
+			double sign = (j == 0) ? 1.0 : -1.0;
+			const Vector3* point = pointArray[k];
+			Vector3* clippedPoint = pointArray[1 - k];
+			int numClippedPoints = 0;
+
+			for (int m = 0; m < numPoints; m++)
 			{
-				FacePuncture facePuncture;
-				facePuncture.surfacePoint = homeToWorld.TransformPoint(ray.CalculatePoint(alphaArray[0]));
-				facePuncture.externalPoint = homeToWorld.TransformPoint(edge.point[0]);
-				facePuncture.internalPoint = homeToWorld.TransformPoint(edge.point[1]);
-				if ((facePuncture.surfacePoint - facePuncture.internalPoint).Length() > threshold)
-					facePunctureArray.push_back(facePuncture);
+				const Vector3& pointA = point[m];
+				const Vector3& pointB = point[(m + 1) % numPoints];
+				double distanceA = sign * (sideNormal.Dot(pointA) - sideCenter) - sideRadius;
+				double distanceB = sign * (sideNormal.Dot(pointB) - sideCenter) - sideRadius;
+
+				if (distanceA <= 0.0)
+					clippedPoint[numClippedPoints++] = pointA;
+
+				if ((distanceA < 0.0 && distanceB > 0.0) || (distanceA > 0.0 && distanceB < 0.0))
+					clippedPoint[numClippedPoints++] = pointA + (pointB - pointA) * (distanceA / (distanceA - distanceB));
 			}
+
+			numPoints = numClippedPoints;
+			k = 1 - k;
 		}
-		else if (alphaArray.size() == 1)
+	}
+
+	// Each point of the clipped incident face behind the reference face is taken halfway back to it.
+	Vector3 centerSum(0.0, 0.0, 0.0);
+	int numContactPoints = 0;
+	double referencePlaneCenter = unitNormal.Dot(referenceFaceCenter);
+	for (int i = 0; i < numPoints; i++)
+	{
+		const Vector3& point = pointArray[k][i];
+		double depth = referencePlaneCenter - unitNormal.Dot(point);
+		if (depth >= 0.0)
 		{
-			if (interval.ContainsValue(alphaArray[0]))
-			{
-				FacePuncture facePuncture;
-				facePuncture.surfacePoint = homeToWorld.TransformPoint(ray.CalculatePoint(alphaArray[0]));
-				facePuncture.externalPoint = homeToWorld.TransformPoint(edge.point[1]);
-				facePuncture.internalPoint = homeToWorld.TransformPoint(edge.point[0]);
-				if ((facePuncture.surfacePoint - facePuncture.internalPoint).Length() > threshold)
-					facePunctureArray.push_back(facePuncture);
-			}
+			centerSum += point + unitNormal * (depth / 2.0);
+			numContactPoints++;
 		}
 	}
 
-	return facePunctureArray.size() > 0 || edgeImpalementArray.size() > 0 || vertexPenetrationArray.size() > 0;
+	if (numContactPoints == 0)
+		return referenceFaceCenter;
+
+	return centerSum / double(numContactPoints);
 }
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<CapsuleShape, PolygonShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ Vector3 CollisionCalculator<BoxShape, BoxShape>::CalculateEdgeContactCenter(const WorldBox& worldBoxA, int edgeAxisA, const WorldBox& worldBoxB, int edgeAxisB, const Vector3& unitNormal)
 {
-	auto capsule = dynamic_cast<const CapsuleShape*>(shapeA);
-	auto polygon = dynamic_cast<const PolygonShape*>(shapeB);
+	// The edge of A farthest along the normal meets the edge of B farthest against it.
+	Vector3 edgeCenterA = worldBoxA.center;
+	Vector3 edgeCenterB = worldBoxB.center;
+	for (int i = 1; i <= 2; i++)
+	{
+		const Vector3& halfEdgeA = worldBoxA.halfEdge[(edgeAxisA + i) % 3];
+		const Vector3& halfEdgeB = worldBoxB.halfEdge[(edgeAxisB + i) % 3];
+		edgeCenterA += (halfEdgeA.Dot(unitNormal) >= 0.0) ? halfEdgeA : -halfEdgeA;
+		edgeCenterB += (halfEdgeB.Dot(unitNormal) >= 0.0) ? -halfEdgeB : halfEdgeB;
+	}
 
-	if (!capsule || !polygon)
-		return nullptr;
+	// Minimize the distance between the points at the given fractions of the half-edges from the edge centers.
+	const Vector3& edgeA = worldBoxA.halfEdge[edgeAxisA];
+	const Vector3& edgeB = worldBoxB.halfEdge[edgeAxisB];
+	Vector3 delta = edgeCenterA - edgeCenterB;
+	double a = edgeA.Dot(edgeA);
+	double b = edgeA.Dot(edgeB);
+	double c = edgeA.Dot(delta);
+	double e = edgeB.Dot(edgeB);
+	double f = edgeB.Dot(delta);
+	double denominator = a * e - b * b;
+
+	double alphaA = (denominator > 0.0) ? (b * f - c * e) / denominator : 0.0;
+	alphaA = IMZADI_CLAMP(alphaA, -1.0, 1.0);
+	double alphaB = (alphaA * b + f) / e;
+	alphaB = IMZADI_CLAMP(alphaB, -1.0, 1.0);
+
+	return ((edgeCenterA + edgeA * alphaA) + (edgeCenterB + edgeB * alphaB)) / 2.0;
+}
 
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<CapsuleShape, PolygonShape>::Calculate(const CapsuleShape* capsule, const PolygonShape* polygon)
+{
 	LineSegment capsuleSpine = capsule->GetObjectToWorldTransform().TransformLineSegment(capsule->GetSpine());
 	
 	Vector3 intersectionPoint;
@@ -450,7 +455,7 @@ bool CollisionCalculator<BoxShape, BoxShape>::GatherInfo(const BoxShape* homeBox
 
 	IMZADI_ASSERT(shortestConnector != nullptr);
 	
-	auto collisionStatus = new ShapePairCollisionStatus(shapeA, shapeB);
+	auto collisionStatus = new ShapePairCollisionStatus(capsule, polygon);
 
 	if (intersectsSpine || shortestDistance < capsule->GetRadius())
 	{
@@ -476,10 +481,31 @@ bool CollisionCalculator<BoxShape, BoxShape>::GatherInfo(const BoxShape* homeBox
 	return collisionStatus;
 }
 
-/*virtual*/ ShapePairCollisionStatus* CollisionCalculator<PolygonShape, CapsuleShape>::Calculate(const Shape* shapeA, const Shape* shapeB)
+/*static*/ ShapePairCollisionStatus* CollisionCalculator<PolygonShape, CapsuleShape>::Calculate(const PolygonShape* polygon, const CapsuleShape* capsule)
 {
-	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<CapsuleShape, PolygonShape>().Calculate(shapeB, shapeA);
+	ShapePairCollisionStatus* collisionStatus = CollisionCalculator<CapsuleShape, PolygonShape>::Calculate(capsule, polygon);
 	if (collisionStatus)
 		collisionStatus->FlipContext();
 	return collisionStatus;
+}
+
+//--------------------------------- CollisionCalculatorTable ---------------------------------
+
+// The rows and columns here must go in the same order as the Shape::TypeID enum.
+/*static*/ const CollisionCalculatorTable::CalculateFunction CollisionCalculatorTable::calculateFunctionTable[Shape::TypeID::NUM_TYPE_IDS][Shape::TypeID::NUM_TYPE_IDS] =
+{
+	{ &CalculateWithTypes<SphereShape, SphereShape>, &CalculateWithTypes<SphereShape, BoxShape>, &CalculateWithTypes<SphereShape, CapsuleShape>, &CalculateWithTypes<SphereShape, PolygonShape> },
+	{ &CalculateWithTypes<BoxShape, SphereShape>, &CalculateWithTypes<BoxShape, BoxShape>, &CalculateWithTypes<BoxShape, CapsuleShape>, &CalculateWithTypes<BoxShape, PolygonShape> },
+	{ &CalculateWithTypes<CapsuleShape, SphereShape>, &CalculateWithTypes<CapsuleShape, BoxShape>, &CalculateWithTypes<CapsuleShape, CapsuleShape>, &CalculateWithTypes<CapsuleShape, PolygonShape> },
+	{ &CalculateWithTypes<PolygonShape, SphereShape>, &CalculateWithTypes<PolygonShape, BoxShape>, &CalculateWithTypes<PolygonShape, CapsuleShape>, &CalculateWithTypes<PolygonShape, PolygonShape> }
+};
+
+/*static*/ ShapePairCollisionStatus* CollisionCalculatorTable::Calculate(Shape::TypeID typeIDA, Shape::TypeID typeIDB, const Shape* shapeA, const Shape* shapeB)
+{
+	IMZADI_ASSERT(typeIDA == shapeA->GetShapeTypeID() && typeIDB == shapeB->GetShapeTypeID());
+
+	if (uint32_t(typeIDA) >= Shape::TypeID::NUM_TYPE_IDS || uint32_t(typeIDB) >= Shape::TypeID::NUM_TYPE_IDS)
+		return nullptr;
+
+	return calculateFunctionTable[typeIDA][typeIDB](shapeA, shapeB);
 }
\ No newline at end of file
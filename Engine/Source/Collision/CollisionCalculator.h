@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Defines.h"
+#include "ConvexCollision.h"
 #include "Shapes/Sphere.h"
 #include "Shapes/Capsule.h"
 #include "Shapes/Box.h"
@@ -13,40 +14,29 @@ namespace Imzadi
 	class Shape;
 
 	/**
-	 * This is the base class for all derivatives that know how to calculate the
-	 * collision status between a given pair of specific shape types.
-	 */
-	class IMZADI_API CollisionCalculatorInterface
-	{
-	public:
-		/**
-		 * Overrides should calculate and return a new collision status for the given
-		 * shapes, which may or may not be in collision; that is determined by this
-		 * function.
-		 * 
-		 * Note that the order of the arguments does matter in at least two ways.  First,
-		 * the override will expect certain types to be castable for each argument.
-		 * Second, the separation delta is always based on moving the first shape away
-		 * from the second.
-		 * 
-		 * @param[in] shapeA The first shape to consider in a possible collision with the second.
-		 * @param[in] shapeB The second shape to consider in a possible collision with the first.
-		 * @return A new and valid ShapePairCollisionStatus class instance should be calculated and returned.
-		 */
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) = 0;
-	};
-
-	/**
-	 * This class is just a dummy and is meant to be specialized.
+	 * Each specialization of this class knows how to calculate the collision status
+	 * between a given pair of specific shape types.  The calculators are never
+	 * instantiated, nor called through a base class; rather, the CollisionCalculatorTable
+	 * class picks the one to call by the type IDs of the shapes.
+	 * 
+	 * The Calculate method of each specialization should calculate and return a new
+	 * collision status for the given shapes, which may or may not be in collision;
+	 * that is determined by the method.
+	 * 
+	 * Note that the order of the arguments does matter, because the separation delta
+	 * is always based on moving the first shape away from the second.
+	 * 
+	 * This unspecialized version serves every pair of shape types having no calculator
+	 * of its own, knowing only that both shapes are convex.  See the ConvexCollision class.
+	 * A pair is worth specializing only where it can be done faster than that.
 	 */
 	template<typename ShapeTypeA, typename ShapeTypeB>
-	class IMZADI_API CollisionCalculator : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override
+		static ShapePairCollisionStatus* Calculate(const ShapeTypeA* shapeA, const ShapeTypeB* shapeB)
 		{
-			IMZADI_ASSERT(false);
-			return nullptr;
+			return ConvexCollision::Calculate(shapeA, shapeB);
 		}
 	};
 
@@ -54,145 +44,197 @@ namespace Imzadi
 	 * Calculate the collision status between two given sphere shapes.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<SphereShape, SphereShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<SphereShape, SphereShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const SphereShape* sphereA, const SphereShape* sphereB);
 	};
 
 	/**
 	 * Calculate the collision status between a sphere and a capsule.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<SphereShape, CapsuleShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<SphereShape, CapsuleShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const SphereShape* sphere, const CapsuleShape* capsule);
 	};
 
 	/**
 	 * Calculate the collision status between a capsule and a sphere.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<CapsuleShape, SphereShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<CapsuleShape, SphereShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const CapsuleShape* capsule, const SphereShape* sphere);
 	};
 
 	/**
 	 * Calculate the collision status between two capsules.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<CapsuleShape, CapsuleShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<CapsuleShape, CapsuleShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const CapsuleShape* capsuleA, const CapsuleShape* capsuleB);
 	};
 
 	/**
 	 * Calculate the collision status between a sphere and a box.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<SphereShape, BoxShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<SphereShape, BoxShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const SphereShape* sphere, const BoxShape* box);
 	};
 
 	/**
 	 * Calculate the collision status between a box and a sphere.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<BoxShape, SphereShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<BoxShape, SphereShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const BoxShape* box, const SphereShape* sphere);
 	};
 
 	/**
 	 * Calculate the collision status between a sphere and a polygon.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<SphereShape, PolygonShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<SphereShape, PolygonShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const SphereShape* sphere, const PolygonShape* polygon);
 	};
 
 	/**
 	 * Calculate the collision status between a polygon and a sphere.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<PolygonShape, SphereShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<PolygonShape, SphereShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const PolygonShape* polygon, const SphereShape* sphere);
 	};
 
 	/**
 	 * Calculate the collision status between a pair of boxes.
+	 *
+	 * This is the separating axis test.  Two boxes are apart if and only if their projections are apart
+	 * along one of 15 axes: the 3 face normals of each box, and the 9 cross products of an edge direction of
+	 * one box with an edge direction of the other.  A box projects onto an axis as an interval whose radius
+	 * is found straight from the box's edge vectors, so every axis takes the same small amount of work, no
+	 * matter how deep the boxes are in one another.  If no axis separates the boxes, the axis along which
+	 * they overlap least gives the minimal translation vector, and the features of the boxes that touch along
+	 * it (a face and whatever of the other box pokes through it, or a pair of edges) give the collision center.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<BoxShape, BoxShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<BoxShape, BoxShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const BoxShape* boxA, const BoxShape* boxB);
 
 	private:
 
-		struct VertexPenetration
+		/**
+		 * This is a box taken into world space.  The object-to-world transform of a box need not be rigid,
+		 * so the box is thought of here as a parallelepiped, whose faces need not be square with its edges.
+		 */
+		struct WorldBox
 		{
-			Vector3 surfacePoint;
-			Vector3 penetrationPoint;
+			Vector3 center;				///< This is the world-space center of the box.
+			Vector3 halfEdge[3];		///< This goes from the center of the box to the center of the face on the positive side of the object-space axis of the same index.
+			Vector3 unitFaceNormal[3];	///< This is the outward normal of the face that the half-edge of the same index points to.
 		};
 
-		struct EdgeImpalement
-		{
-			Vector3 surfacePointA;
-			Vector3 surfacePointB;
-		};
+		/**
+		 * Take the given box into world space.
+		 */
+		static void MakeWorldBox(const BoxShape* box, WorldBox& worldBox);
 
-		struct FacePuncture
-		{
-			Vector3 surfacePoint;
-			Vector3 externalPoint;
-			Vector3 internalPoint;
-		};
+		/**
+		 * Return half the length of the interval the given box projects onto along the given axis.
+		 */
+		static double ProjectedRadius(const WorldBox& worldBox, const Vector3& unitAxis);
 
-		typedef std::vector<VertexPenetration> VertexPenetrationArray;
-		typedef std::vector<EdgeImpalement> EdgeImpalementArray;
-		typedef std::vector<FacePuncture> FacePunctureArray;
+		/**
+		 * Find the center of the contact between a face of one box and the face of the other box
+		 * facing most against it, by clipping the latter to the sides of the former.
+		 *
+		 * @param[in] referenceBox This is the box whose face is pushed into.
+		 * @param[in] referenceAxis This is the index of the half-edge pointing to the face of the reference box that is pushed into, or the opposite face.
+		 * @param[in] incidentBox This is the box that pushes into the face of the reference box.
+		 * @param[in] unitNormal This points out of the reference box, through the face pushed into.
+		 * @return The average of the points midway between the reference face and the points of the clipped incident face behind it is returned.
+		 */
+		static Vector3 CalculateFaceContactCenter(const WorldBox& referenceBox, int referenceAxis, const WorldBox& incidentBox, const Vector3& unitNormal);
 
 		/**
-		 * Gather information about how the "away" box intersects the "home" box, if at all.
-		 * 
-		 * @param[in] homeBox All calculations will be done in this box's space.
-		 * @param[in] awayBox This box will be transformed into the space of the home box before calculations are made.
-		 * @param[out] vertexPenetrationArray Away-box vertices inside the home-box are returned here in world space.
-		 * @param[out] edgeImpalementArray Away-box edges originating outside the home-box and then passing in and out of it are returned here in world space.
-		 * @param[out] facePunctureArray Away-box edges originating inside or outside the home-box and then entering or exiting the away-box are returned here in world space.
+		 * Find the center of the contact between an edge of each of the given boxes.
+		 *
+		 * @param[in] edgeAxisA This is the index of the half-edge of the first box parallel to its edge in contact.
+		 * @param[in] edgeAxisB This is the index of the half-edge of the second box parallel to its edge in contact.
+		 * @param[in] unitNormal This points from the first box toward the second.
+		 * @return The point midway between the nearest points of the two edges is returned.
 		 */
-		bool GatherInfo(const BoxShape* homeBox, const BoxShape* awayBox, VertexPenetrationArray& vertexPenetrationArray, EdgeImpalementArray& edgeImpalementArray, FacePunctureArray& facePunctureArray);
+		static Vector3 CalculateEdgeContactCenter(const WorldBox& worldBoxA, int edgeAxisA, const WorldBox& worldBoxB, int edgeAxisB, const Vector3& unitNormal);
 	};
 
 	/**
 	 * Calculate the collision status between a capsule and a polygon.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<CapsuleShape, PolygonShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<CapsuleShape, PolygonShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const CapsuleShape* capsule, const PolygonShape* polygon);
 	};
 
 	/**
 	 * Calculate the collision status between a polygon and a capsule.
 	 */
 	template<>
-	class IMZADI_API CollisionCalculator<PolygonShape, CapsuleShape> : public CollisionCalculatorInterface
+	class IMZADI_API CollisionCalculator<PolygonShape, CapsuleShape>
 	{
 	public:
-		virtual ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB) override;
+		static ShapePairCollisionStatus* Calculate(const PolygonShape* polygon, const CapsuleShape* capsule);
+	};
+
+	/**
+	 * This picks the calculator for a pair of shapes by their type IDs, looking it up in a table
+	 * of functions indexed by both IDs.  Once the types are known, the shapes are cast down to
+	 * them without any checking, so the IDs given must be those of the shapes given.
+	 */
+	class IMZADI_API CollisionCalculatorTable
+	{
+	public:
+		/**
+		 * Calculate and return a new collision status for the given shapes.
+		 * 
+		 * @param[in] typeIDA This must be the type ID of the first shape.
+		 * @param[in] typeIDB This must be the type ID of the second shape.
+		 * @param[in] shapeA The first shape to consider in a possible collision with the second.
+		 * @param[in] shapeB The second shape to consider in a possible collision with the first.
+		 * @return Null is returned only if either type ID is out of range.
+		 */
+		static ShapePairCollisionStatus* Calculate(Shape::TypeID typeIDA, Shape::TypeID typeIDB, const Shape* shapeA, const Shape* shapeB);
+
+	private:
+
+		typedef ShapePairCollisionStatus* (*CalculateFunction)(const Shape* shapeA, const Shape* shapeB);
+
+		/**
+		 * Cast the given shapes down to the given types and hand them to the calculator for those types.
+		 */
+		template<typename ShapeTypeA, typename ShapeTypeB>
+		static ShapePairCollisionStatus* CalculateWithTypes(const Shape* shapeA, const Shape* shapeB)
+		{
+			return CollisionCalculator<ShapeTypeA, ShapeTypeB>::Calculate(static_cast<const ShapeTypeA*>(shapeA), static_cast<const ShapeTypeB*>(shapeB));
+		}
+
+		static const CalculateFunction calculateFunctionTable[Shape::TypeID::NUM_TYPE_IDS][Shape::TypeID::NUM_TYPE_IDS];	///< This is indexed first by the type ID of the first shape, then by that of the second.
 	};
 }
\ No newline at end of file
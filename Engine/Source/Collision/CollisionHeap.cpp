@@ -0,0 +1,153 @@
+#include "CollisionHeap.h"
+
+using namespace Imzadi;
+
+#define IMZADI_HEAP_NUM_SMALL_SIZE_CLASSES		(IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE / IMZADI_HEAP_BLOCK_GRANULARITY)
+
+CollisionHeap::CollisionHeap()
+{
+	static_assert(IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE % IMZADI_HEAP_BLOCK_GRANULARITY == 0, "Max small block size must be a multiple of the block granularity.");
+	static_assert(IMZADI_IS_POW_TWO(IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE) && IMZADI_IS_POW_TWO(IMZADI_HEAP_MAX_BLOCK_SIZE), "Large blocks come in powers of two.");
+	static_assert(IMZADI_HEAP_BLOCK_GRANULARITY >= sizeof(FreeBlock), "Blocks must be able to hold a free-list link.");
+
+	// Small blocks come in multiples of the granularity, which suits the objects we allocate.
+	// Beyond that, blocks come in powers of two, which suits the buffers of growing STL containers.
+	this->numSizeClasses = IMZADI_HEAP_NUM_SMALL_SIZE_CLASSES;
+	for (size_t blockSize = IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE * 2; blockSize <= IMZADI_HEAP_MAX_BLOCK_SIZE; blockSize *= 2)
+		this->numSizeClasses++;
+
+	this->sizeClassArray = new SizeClass[this->numSizeClasses];
+	for (uint32_t i = 0; i < this->numSizeClasses; i++)
+	{
+		SizeClass* sizeClass = &this->sizeClassArray[i];
+		sizeClass->freeBlockList = nullptr;
+		if (i < IMZADI_HEAP_NUM_SMALL_SIZE_CLASSES)
+			sizeClass->blockSize = (i + 1) * IMZADI_HEAP_BLOCK_GRANULARITY;
+		else
+			sizeClass->blockSize = size_t(IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE) << (i - IMZADI_HEAP_NUM_SMALL_SIZE_CLASSES + 1);
+		sizeClass->slabSize = IMZADI_MAX(IMZADI_HEAP_SLAB_SIZE, 4 * sizeClass->blockSize) + IMZADI_HEAP_BLOCK_GRANULARITY;
+	}
+
+	this->slabList = nullptr;
+	this->slabListMutex = new std::mutex();
+	this->numSystemAllocations = 0;
+	this->numSystemFrees = 0;
+	this->numBlockAllocations = 0;
+	this->numBlockFrees = 0;
+	this->numSlabBytes = 0;
+}
+
+/*virtual*/ CollisionHeap::~CollisionHeap()
+{
+	while (this->slabList)
+	{
+		Slab* slab = this->slabList;
+		this->slabList = slab->nextSlab;
+		::operator delete(slab);
+	}
+
+	delete[] this->sizeClassArray;
+	delete this->slabListMutex;
+}
+
+/*static*/ CollisionHeap* CollisionHeap::Get()
+{
+	static CollisionHeap heap;
+	return &heap;
+}
+
+uint32_t CollisionHeap::SizeClassIndex(size_t size) const
+{
+	if (size == 0)
+		size = 1;
+
+	if (size <= IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE)
+		return uint32_t((size - 1) / IMZADI_HEAP_BLOCK_GRANULARITY);
+
+	uint32_t i = IMZADI_HEAP_NUM_SMALL_SIZE_CLASSES;
+	size_t blockSize = IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE * 2;
+	while (blockSize < size)
+	{
+		blockSize *= 2;
+		i++;
+	}
+
+	return i;
+}
+
+void* CollisionHeap::Allocate(size_t size)
+{
+	if (size > IMZADI_HEAP_MAX_BLOCK_SIZE)
+	{
+		this->numSystemAllocations.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(size);
+	}
+
+	SizeClass* sizeClass = &this->sizeClassArray[this->SizeClassIndex(size)];
+
+	std::lock_guard<std::mutex> guard(sizeClass->mutex);
+
+	if (!sizeClass->freeBlockList)
+		this->GrowSizeClass(sizeClass);
+
+	FreeBlock* block = sizeClass->freeBlockList;
+	sizeClass->freeBlockList = block->nextBlock;
+	this->numBlockAllocations.fetch_add(1, std::memory_order_relaxed);
+	return block;
+}
+
+void CollisionHeap::Deallocate(void* memory, size_t size)
+{
+	if (!memory)
+		return;
+
+	if (size > IMZADI_HEAP_MAX_BLOCK_SIZE)
+	{
+		this->numSystemFrees.fetch_add(1, std::memory_order_relaxed);
+		::operator delete(memory);
+		return;
+	}
+
+	SizeClass* sizeClass = &this->sizeClassArray[this->SizeClassIndex(size)];
+
+	std::lock_guard<std::mutex> guard(sizeClass->mutex);
+
+	FreeBlock* block = static_cast<FreeBlock*>(memory);
+	block->nextBlock = sizeClass->freeBlockList;
+	sizeClass->freeBlockList = block;
+	this->numBlockFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CollisionHeap::GrowSizeClass(SizeClass* sizeClass)
+{
+	// The first granule of the slab is reserved for threading it onto the slab list,
+	// which keeps the blocks after it aligned to the block granularity.
+	uint8_t* slabMemory = static_cast<uint8_t*>(::operator new(sizeClass->slabSize));
+	this->numSystemAllocations.fetch_add(1, std::memory_order_relaxed);
+	this->numSlabBytes.fetch_add(sizeClass->slabSize, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> guard(*this->slabListMutex);
+		Slab* slab = reinterpret_cast<Slab*>(slabMemory);
+		slab->nextSlab = this->slabList;
+		this->slabList = slab;
+	}
+
+	size_t numBlocks = (sizeClass->slabSize - IMZADI_HEAP_BLOCK_GRANULARITY) / sizeClass->blockSize;
+	uint8_t* blockMemory = slabMemory + IMZADI_HEAP_BLOCK_GRANULARITY;
+	for (size_t i = 0; i < numBlocks; i++)
+	{
+		FreeBlock* block = reinterpret_cast<FreeBlock*>(blockMemory + i * sizeClass->blockSize);
+		block->nextBlock = sizeClass->freeBlockList;
+		sizeClass->freeBlockList = block;
+	}
+}
+
+void CollisionHeap::GetStats(Stats& stats) const
+{
+	stats.numSystemAllocations = this->numSystemAllocations.load(std::memory_order_relaxed);
+	stats.numSystemFrees = this->numSystemFrees.load(std::memory_order_relaxed);
+	stats.numBlockAllocations = this->numBlockAllocations.load(std::memory_order_relaxed);
+	stats.numBlockFrees = this->numBlockFrees.load(std::memory_order_relaxed);
+	stats.numSlabBytes = this->numSlabBytes.load(std::memory_order_relaxed);
+}
\ No newline at end of file
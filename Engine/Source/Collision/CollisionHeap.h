@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Defines.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace Imzadi
+{
+	/**
+	 * This is a small-block heap for the objects that churn through the collision system
+	 * every frame, such as commands, queries, results and collision cache entries.  These
+	 * are typically allocated on one thread and freed on another.  Blocks are carved out of
+	 * slabs, there being one free-list per size class, and a freed block goes back onto its
+	 * free-list instead of back to the system heap.  Once the free-lists have grown to meet
+	 * the demands of a typical frame, the collision system makes no more system heap allocations.
+	 *
+	 * Requests too big for any size class are passed through to the system heap.
+	 */
+	class IMZADI_API CollisionHeap
+	{
+	public:
+		/**
+		 * These are counters that can be used to see how the heap is behaving.
+		 * Comparing two snapshots of these taken a frame apart tells you whether
+		 * anything in that frame had to go to the system heap.
+		 */
+		struct Stats
+		{
+			uint64_t numSystemAllocations;		///< This is the number of times memory was taken from the system heap, be it for a new slab or for an oversized block.
+			uint64_t numSystemFrees;			///< This is the number of times memory was given back to the system heap.  Slabs are never given back.
+			uint64_t numBlockAllocations;		///< This is the number of blocks handed out from the free-lists.
+			uint64_t numBlockFrees;				///< This is the number of blocks returned to the free-lists.
+			uint64_t numSlabBytes;				///< This is the total size of all slabs allocated so far.
+		};
+
+		/**
+		 * Get the one and only instance of the collision heap.
+		 */
+		static CollisionHeap* Get();
+
+		/**
+		 * Allocate a block of memory of at least the given size.
+		 * This is thread-safe.
+		 *
+		 * @param size This is the number of bytes needed.
+		 * @return A pointer to the memory is returned.  It is aligned suitably for any type not requiring extended alignment.
+		 */
+		void* Allocate(size_t size);
+
+		/**
+		 * Give back a block of memory previously returned by the Allocate method.
+		 * This is thread-safe, and need not be called on the thread that made the allocation.
+		 *
+		 * @param memory This is the block to free.  Null is ignored.
+		 * @param size This must be the same size that was given to the Allocate method for this block.
+		 */
+		void Deallocate(void* memory, size_t size);
+
+		/**
+		 * Take a snapshot of this heap's counters.
+		 */
+		void GetStats(Stats& stats) const;
+
+		/**
+		 * Allocate and default-construct an object of the given type from this heap.
+		 * Use the Delete method to free it.
+		 */
+		template<typename T>
+		T* New()
+		{
+			return new (this->Allocate(sizeof(T))) T();
+		}
+
+		/**
+		 * Destruct and free an object allocated by the New method.
+		 */
+		template<typename T>
+		void Delete(T* object)
+		{
+			if (object)
+			{
+				object->~T();
+				this->Deallocate(object, sizeof(T));
+			}
+		}
+
+	private:
+		CollisionHeap();
+		virtual ~CollisionHeap();
+
+		/**
+		 * A block is threaded onto its free-list by over-writing its first few bytes.
+		 */
+		struct FreeBlock
+		{
+			FreeBlock* nextBlock;
+		};
+
+		/**
+		 * All blocks of the same size come from the same size class.
+		 */
+		struct SizeClass
+		{
+			std::mutex mutex;
+			FreeBlock* freeBlockList;
+			size_t blockSize;
+			size_t slabSize;
+		};
+
+		/**
+		 * Carve a new slab into blocks for the given size class.  The size class must be locked.
+		 */
+		void GrowSizeClass(SizeClass* sizeClass);
+
+		uint32_t SizeClassIndex(size_t size) const;
+
+		struct Slab
+		{
+			Slab* nextSlab;
+		};
+
+		SizeClass* sizeClassArray;
+		uint32_t numSizeClasses;
+		Slab* slabList;
+		std::mutex* slabListMutex;
+
+		std::atomic<uint64_t> numSystemAllocations;
+		std::atomic<uint64_t> numSystemFrees;
+		std::atomic<uint64_t> numBlockAllocations;
+		std::atomic<uint64_t> numBlockFrees;
+		std::atomic<uint64_t> numSlabBytes;
+	};
+
+	/**
+	 * This lets STL containers used in the collision path draw their memory from the collision heap.
+	 */
+	template<typename T>
+	class CollisionHeapAllocator
+	{
+	public:
+		typedef T value_type;
+
+		CollisionHeapAllocator() noexcept {}
+
+		template<typename U>
+		CollisionHeapAllocator(const CollisionHeapAllocator<U>&) noexcept {}
+
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(CollisionHeap::Get()->Allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T* memory, size_t n)
+		{
+			CollisionHeap::Get()->Deallocate(memory, n * sizeof(T));
+		}
+
+		template<typename U>
+		bool operator==(const CollisionHeapAllocator<U>&) const noexcept { return true; }
+
+		template<typename U>
+		bool operator!=(const CollisionHeapAllocator<U>&) const noexcept { return false; }
+	};
+}
\ No newline at end of file
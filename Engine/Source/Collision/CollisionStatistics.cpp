@@ -0,0 +1,174 @@
+#include "CollisionStatistics.h"
+#include "Task.h"
+#include <bit>
+
+using namespace Imzadi;
+
+CollisionStatistics::CollisionStatistics()
+{
+	this->taskTypeCountersArray = new TaskTypeCounters[IMZADI_STATS_MAX_TASK_TYPES];
+	for (uint32_t i = 0; i < IMZADI_STATS_MAX_TASK_TYPES; i++)
+		this->taskTypeCountersArray[i].typeInfo = nullptr;
+
+	this->calculatorInvocationArray = new std::atomic<uint64_t>[IMZADI_STATS_MAX_SHAPE_TYPES * IMZADI_STATS_MAX_SHAPE_TYPES];
+	this->numCacheEntries = 0;
+	this->cacheMemoryUsage = 0;
+
+	this->Reset();
+}
+
+/*virtual*/ CollisionStatistics::~CollisionStatistics()
+{
+	delete[] this->taskTypeCountersArray;
+	delete[] this->calculatorInvocationArray;
+}
+
+CollisionStatistics::TaskTypeCounters* CollisionStatistics::FindTaskTypeCounters(const std::type_info& typeInfo)
+{
+	// Types are compared by address first, because that's cheap and almost always good enough.
+	for (uint32_t i = 0; i < IMZADI_STATS_MAX_TASK_TYPES; i++)
+	{
+		const std::type_info* existingTypeInfo = this->taskTypeCountersArray[i].typeInfo.load(std::memory_order_acquire);
+		if (!existingTypeInfo)
+			break;
+
+		if (existingTypeInfo == &typeInfo)
+			return &this->taskTypeCountersArray[i];
+	}
+
+	// Failing that, compare types properly, and claim new counters for the type if it's really new.
+	// Two threads racing to claim counters for the same type will both end up with the same ones.
+	for (uint32_t i = 0; i < IMZADI_STATS_MAX_TASK_TYPES; i++)
+	{
+		TaskTypeCounters* counters = &this->taskTypeCountersArray[i];
+		const std::type_info* existingTypeInfo = counters->typeInfo.load(std::memory_order_acquire);
+		if (!existingTypeInfo && counters->typeInfo.compare_exchange_strong(existingTypeInfo, &typeInfo, std::memory_order_acq_rel, std::memory_order_acquire))
+			return counters;
+
+		if (*existingTypeInfo == typeInfo)
+			return counters;
+	}
+
+	return nullptr;
+}
+
+void CollisionStatistics::RecordTaskExecution(const Task* task, uint64_t nanoseconds)
+{
+	TaskTypeCounters* counters = this->FindTaskTypeCounters(typeid(*task));
+	if (!counters)
+		return;
+
+	uint32_t bucket = IMZADI_MIN((uint32_t)std::bit_width(nanoseconds / 1000), uint32_t(IMZADI_STATS_NUM_HISTOGRAM_BUCKETS - 1));
+
+	counters->numExecuted.fetch_add(1, std::memory_order_relaxed);
+	counters->totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+	counters->histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CollisionStatistics::RecordCalculatorInvocation(uint32_t typeIDA, uint32_t typeIDB)
+{
+	if (typeIDA < IMZADI_STATS_MAX_SHAPE_TYPES && typeIDB < IMZADI_STATS_MAX_SHAPE_TYPES)
+		this->calculatorInvocationArray[typeIDA * IMZADI_STATS_MAX_SHAPE_TYPES + typeIDB].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CollisionStatistics::RecordFlush(uint64_t nanoseconds)
+{
+	this->numFlushes.fetch_add(1, std::memory_order_relaxed);
+	this->flushNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void CollisionStatistics::RecordTaskWait(uint64_t nanoseconds)
+{
+	this->numTaskWaits.fetch_add(1, std::memory_order_relaxed);
+	this->taskWaitNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void CollisionStatistics::RecordStaticTreeBuild(uint64_t nanoseconds)
+{
+	this->numStaticTreeBuilds.fetch_add(1, std::memory_order_relaxed);
+	this->staticTreeBuildNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void CollisionStatistics::RecordCacheTrim(uint64_t numPurged, uint64_t numEvicted, uint64_t numEntries, uint64_t memoryUsage)
+{
+	this->numCachePurges.fetch_add(numPurged, std::memory_order_relaxed);
+	this->numCacheEvictions.fetch_add(numEvicted, std::memory_order_relaxed);
+	this->numCacheEntries.store(numEntries, std::memory_order_relaxed);
+	this->cacheMemoryUsage.store(memoryUsage, std::memory_order_relaxed);
+}
+
+void CollisionStatistics::TakeSnapshot(Snapshot& snapshot) const
+{
+	snapshot.queueDepth = 0;
+	snapshot.numTaskTypes = 0;
+	for (uint32_t i = 0; i < IMZADI_STATS_MAX_TASK_TYPES; i++)
+	{
+		const TaskTypeCounters* counters = &this->taskTypeCountersArray[i];
+		const std::type_info* typeInfo = counters->typeInfo.load(std::memory_order_acquire);
+		if (!typeInfo)
+			break;
+
+		TaskTypeSnapshot* taskTypeSnapshot = &snapshot.taskTypeArray[snapshot.numTaskTypes++];
+		taskTypeSnapshot->typeName = typeInfo->name();
+		taskTypeSnapshot->numExecuted = counters->numExecuted.load(std::memory_order_relaxed);
+		taskTypeSnapshot->totalNanoseconds = counters->totalNanoseconds.load(std::memory_order_relaxed);
+		for (uint32_t j = 0; j < IMZADI_STATS_NUM_HISTOGRAM_BUCKETS; j++)
+			taskTypeSnapshot->histogram[j] = counters->histogram[j].load(std::memory_order_relaxed);
+	}
+
+	snapshot.numNodesVisited = this->numNodesVisited.load(std::memory_order_relaxed);
+
+	for (uint32_t i = 0; i < IMZADI_STATS_MAX_SHAPE_TYPES; i++)
+		for (uint32_t j = 0; j < IMZADI_STATS_MAX_SHAPE_TYPES; j++)
+			snapshot.numCalculatorInvocations[i][j] = this->calculatorInvocationArray[i * IMZADI_STATS_MAX_SHAPE_TYPES + j].load(std::memory_order_relaxed);
+
+	snapshot.numCacheHits = this->numCacheHits.load(std::memory_order_relaxed);
+	snapshot.numCacheMisses = this->numCacheMisses.load(std::memory_order_relaxed);
+	snapshot.numReinsertions = this->numReinsertions.load(std::memory_order_relaxed);
+	snapshot.numReinsertionsAvoided = this->numReinsertionsAvoided.load(std::memory_order_relaxed);
+	snapshot.numFlushes = this->numFlushes.load(std::memory_order_relaxed);
+	snapshot.flushNanoseconds = this->flushNanoseconds.load(std::memory_order_relaxed);
+	snapshot.numTaskWaits = this->numTaskWaits.load(std::memory_order_relaxed);
+	snapshot.taskWaitNanoseconds = this->taskWaitNanoseconds.load(std::memory_order_relaxed);
+	snapshot.numBulkInsertedShapes = this->numBulkInsertedShapes.load(std::memory_order_relaxed);
+	snapshot.numStaticTreeBuilds = this->numStaticTreeBuilds.load(std::memory_order_relaxed);
+	snapshot.staticTreeBuildNanoseconds = this->staticTreeBuildNanoseconds.load(std::memory_order_relaxed);
+	snapshot.numTreeRebuilds = this->numTreeRebuilds.load(std::memory_order_relaxed);
+	snapshot.numSweepShifts = this->numSweepShifts.load(std::memory_order_relaxed);
+	snapshot.numCachePurges = this->numCachePurges.load(std::memory_order_relaxed);
+	snapshot.numCacheEvictions = this->numCacheEvictions.load(std::memory_order_relaxed);
+	snapshot.numCacheEntries = this->numCacheEntries.load(std::memory_order_relaxed);
+	snapshot.cacheMemoryUsage = this->cacheMemoryUsage.load(std::memory_order_relaxed);
+}
+
+void CollisionStatistics::Reset()
+{
+	for (uint32_t i = 0; i < IMZADI_STATS_MAX_TASK_TYPES; i++)
+	{
+		TaskTypeCounters* counters = &this->taskTypeCountersArray[i];
+		counters->numExecuted = 0;
+		counters->totalNanoseconds = 0;
+		for (uint32_t j = 0; j < IMZADI_STATS_NUM_HISTOGRAM_BUCKETS; j++)
+			counters->histogram[j] = 0;
+	}
+
+	for (uint32_t i = 0; i < IMZADI_STATS_MAX_SHAPE_TYPES * IMZADI_STATS_MAX_SHAPE_TYPES; i++)
+		this->calculatorInvocationArray[i] = 0;
+
+	this->numNodesVisited = 0;
+	this->numCacheHits = 0;
+	this->numCacheMisses = 0;
+	this->numReinsertions = 0;
+	this->numReinsertionsAvoided = 0;
+	this->numFlushes = 0;
+	this->flushNanoseconds = 0;
+	this->numTaskWaits = 0;
+	this->taskWaitNanoseconds = 0;
+	this->numBulkInsertedShapes = 0;
+	this->numStaticTreeBuilds = 0;
+	this->staticTreeBuildNanoseconds = 0;
+	this->numTreeRebuilds = 0;
+	this->numSweepShifts = 0;
+	this->numCachePurges = 0;
+	this->numCacheEvictions = 0;
+}
\ No newline at end of file
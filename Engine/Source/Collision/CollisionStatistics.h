@@ -0,0 +1,205 @@
+#pragma once
+
+#include "Defines.h"
+#include <stdint.h>
+#include <atomic>
+#include <typeinfo>
+
+namespace Imzadi
+{
+	class Task;
+
+	/**
+	 * These are the counters the collision system keeps about what it's doing, so that
+	 * its behavior can be watched as it runs.  They are kept all the time, release builds
+	 * included, so updating them has to be cheap.  Every counter is a relaxed atomic,
+	 * and the hot loops of the collision system tally locally before adding to them once.
+	 * 
+	 * The collision thread owns an instance of this class.  Users get at the counters
+	 * using the StatisticsQuery class, which returns a Snapshot of them.
+	 */
+	class IMZADI_API CollisionStatistics
+	{
+	public:
+		CollisionStatistics();
+		virtual ~CollisionStatistics();
+
+		/**
+		 * These are the counters kept for one type of task.
+		 */
+		struct TaskTypeSnapshot
+		{
+			const char* typeName;									///< This is the compiler's name for the class of the task.
+			uint64_t numExecuted;									///< This is the number of tasks of this type that were executed.
+			uint64_t totalNanoseconds;								///< This is the total time spent executing tasks of this type.
+			uint64_t histogram[IMZADI_STATS_NUM_HISTOGRAM_BUCKETS];	///< Bucket zero counts executions under a microsecond.  Bucket i > 0 counts those taking [2^(i-1), 2^i) microseconds, the last bucket taking everything longer.
+		};
+
+		/**
+		 * This is a copy of all the counters taken at one moment.
+		 */
+		struct Snapshot
+		{
+			uint32_t queueDepth;															///< This is the number of tasks that were sent, but not yet executed, when the snapshot was taken.
+			uint32_t numTaskTypes;															///< This is the number of valid entries in the task type array.
+			TaskTypeSnapshot taskTypeArray[IMZADI_STATS_MAX_TASK_TYPES];					///< These are the execution counters of each type of task seen so far.
+			uint64_t numNodesVisited;														///< This is the number of bounding-box tree nodes visited by collision queries and ray-casts.
+			uint64_t numCalculatorInvocations[IMZADI_STATS_MAX_SHAPE_TYPES][IMZADI_STATS_MAX_SHAPE_TYPES];	///< These are the number of narrow-phase calculations done for each pair of shape types, indexed by Shape::TypeID.
+			uint64_t numCacheHits;															///< This is the number of times the collision cache had a valid entry for a shape pair.
+			uint64_t numCacheMisses;														///< This is the number of times the collision cache had no valid entry for a shape pair.
+			uint64_t numReinsertions;														///< This is the number of times a moved shape had to be re-inserted into the broad-phase.
+			uint64_t numReinsertionsAvoided;												///< This is the number of times a moved shape was still where it belonged in the broad-phase.
+			uint64_t numFlushes;															///< This is the number of calls made to flush all tasks.
+			uint64_t flushNanoseconds;														///< This is the total time callers spent blocked in a flush of all tasks.
+			uint64_t numTaskWaits;															///< This is the number of tasks waited on individually.
+			uint64_t taskWaitNanoseconds;													///< This is the total time callers spent blocked waiting on individual tasks.
+			uint64_t numBulkInsertedShapes;													///< This is the number of shapes added to the broad-phase in bulk rather than one at a time.
+			uint64_t numStaticTreeBuilds;													///< This is the number of times the tree of static shapes was built.
+			uint64_t staticTreeBuildNanoseconds;											///< This is the total time spent building the tree of static shapes.
+			uint64_t numTreeRebuilds;														///< This is the number of times the broad-phase rebuilt its tree of moving shapes because it had degraded.
+			uint64_t numSweepShifts;														///< This is the number of places shapes were shifted to keep the sweep-and-prune of all-pairs queries in order.
+			uint64_t numCachePurges;														///< This is the number of collision cache entries dropped because one of their shapes was removed.
+			uint64_t numCacheEvictions;														///< This is the number of collision cache entries dropped to keep the cache within its memory limit.
+			uint64_t numCacheEntries;														///< This is the number of entries in the collision cache as of its last trim.  It is not a counter, so it isn't reset.
+			uint64_t cacheMemoryUsage;														///< This is the memory taken up by the collision cache as of its last trim, in bytes.  Nor is this reset.
+
+			/**
+			 * Return the fraction of collision cache lookups that found a valid entry, or zero if there were none.
+			 */
+			double CalculateCacheHitRate() const
+			{
+				uint64_t numLookups = this->numCacheHits + this->numCacheMisses;
+				return (numLookups > 0) ? double(this->numCacheHits) / double(numLookups) : 0.0;
+			}
+		};
+
+		/**
+		 * Account for the execution of the given task.
+		 * 
+		 * @param[in] task This is the task that was executed.  Only its type is looked at.
+		 * @param[in] nanoseconds This is how long the task took to execute.
+		 */
+		void RecordTaskExecution(const Task* task, uint64_t nanoseconds);
+
+		/**
+		 * Account for the given number of bounding-box tree nodes having been visited.
+		 */
+		void RecordNodesVisited(uint64_t numNodes) { this->numNodesVisited.fetch_add(numNodes, std::memory_order_relaxed); }
+
+		/**
+		 * Account for a hit in the collision cache.
+		 */
+		void RecordCacheHit() { this->numCacheHits.fetch_add(1, std::memory_order_relaxed); }
+
+		/**
+		 * Account for a miss in the collision cache.
+		 */
+		void RecordCacheMiss() { this->numCacheMisses.fetch_add(1, std::memory_order_relaxed); }
+
+		/**
+		 * Count a moved shape that had to be re-inserted into the broad-phase.
+		 */
+		void RecordReinsertion() { this->numReinsertions.fetch_add(1, std::memory_order_relaxed); }
+
+		/**
+		 * Count a moved shape that did not have to be re-inserted into the broad-phase.
+		 */
+		void RecordReinsertionAvoided() { this->numReinsertionsAvoided.fetch_add(1, std::memory_order_relaxed); }
+
+		/**
+		 * Account for a narrow-phase calculation between shapes of the given types.
+		 */
+		void RecordCalculatorInvocation(uint32_t typeIDA, uint32_t typeIDB);
+
+		/**
+		 * Account for a caller having been blocked for the given time in a flush of all tasks.
+		 */
+		void RecordFlush(uint64_t nanoseconds);
+
+		/**
+		 * Account for a caller having been blocked for the given time waiting on a task.
+		 */
+		void RecordTaskWait(uint64_t nanoseconds);
+
+		/**
+		 * Account for the given number of shapes having been added to the broad-phase in bulk.
+		 */
+		void RecordBulkInsertion(uint64_t numShapes) { this->numBulkInsertedShapes.fetch_add(numShapes, std::memory_order_relaxed); }
+
+		/**
+		 * Account for the tree of static shapes having taken the given time to build.
+		 */
+		void RecordStaticTreeBuild(uint64_t nanoseconds);
+
+		/**
+		 * Count a rebuild of the broad-phase's tree of moving shapes.
+		 */
+		void RecordTreeRebuild() { this->numTreeRebuilds.fetch_add(1, std::memory_order_relaxed); }
+
+		/**
+		 * Account for the given number of places shapes were shifted to keep the sweep-and-prune in order.
+		 */
+		void RecordSweepShifts(uint64_t numShifts) { this->numSweepShifts.fetch_add(numShifts, std::memory_order_relaxed); }
+
+		/**
+		 * Account for a trim of the collision cache.
+		 * 
+		 * @param[in] numPurged This is the number of entries dropped because one of their shapes was removed.
+		 * @param[in] numEvicted This is the number of entries dropped to keep the cache within its memory limit.
+		 * @param[in] numEntries This is the number of entries left in the cache.
+		 * @param[in] memoryUsage This is the memory the cache now takes up, in bytes.
+		 */
+		void RecordCacheTrim(uint64_t numPurged, uint64_t numEvicted, uint64_t numEntries, uint64_t memoryUsage);
+
+		/**
+		 * Copy all counters into the given snapshot.  Note that the counters are not all read
+		 * at the same instant, so a snapshot taken while tasks are executing may be a little
+		 * inconsistent with itself.  The queue depth is left for the caller to fill in.
+		 */
+		void TakeSnapshot(Snapshot& snapshot) const;
+
+		/**
+		 * Set all counters back to zero.  The types of tasks seen so far are remembered,
+		 * as are the number of collision cache entries and the memory they take up.
+		 */
+		void Reset();
+
+	private:
+
+		struct TaskTypeCounters
+		{
+			std::atomic<const std::type_info*> typeInfo;
+			std::atomic<uint64_t> numExecuted;
+			std::atomic<uint64_t> totalNanoseconds;
+			std::atomic<uint64_t> histogram[IMZADI_STATS_NUM_HISTOGRAM_BUCKETS];
+		};
+
+		/**
+		 * Find the counters for the given type of task, claiming a new set of counters for it if need be.
+		 * 
+		 * @return Null is returned if all sets of counters have been claimed by other types.
+		 */
+		TaskTypeCounters* FindTaskTypeCounters(const std::type_info& typeInfo);
+
+		TaskTypeCounters* taskTypeCountersArray;			///< These are claimed in order, so the first with a null type marks the end of those in use.
+		std::atomic<uint64_t> numNodesVisited;
+		std::atomic<uint64_t>* calculatorInvocationArray;
+		std::atomic<uint64_t> numCacheHits;
+		std::atomic<uint64_t> numCacheMisses;
+		std::atomic<uint64_t> numReinsertions;
+		std::atomic<uint64_t> numReinsertionsAvoided;
+		std::atomic<uint64_t> numFlushes;
+		std::atomic<uint64_t> flushNanoseconds;
+		std::atomic<uint64_t> numTaskWaits;
+		std::atomic<uint64_t> taskWaitNanoseconds;
+		std::atomic<uint64_t> numBulkInsertedShapes;
+		std::atomic<uint64_t> numStaticTreeBuilds;
+		std::atomic<uint64_t> staticTreeBuildNanoseconds;
+		std::atomic<uint64_t> numTreeRebuilds;
+		std::atomic<uint64_t> numSweepShifts;
+		std::atomic<uint64_t> numCachePurges;
+		std::atomic<uint64_t> numCacheEvictions;
+		std::atomic<uint64_t> numCacheEntries;
+		std::atomic<uint64_t> cacheMemoryUsage;
+	};
+}
\ No newline at end of file
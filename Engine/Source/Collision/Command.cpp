@@ -1,6 +1,6 @@
 #include "Command.h"
 #include "Thread.h"
-#include "BoundingBoxTree.h"
+#include "BroadPhase.h"
 #include <format>
 #include <filesystem>
 #include <fstream>
@@ -17,6 +17,31 @@ Command::Command()
 {
 }
 
+/*virtual*/ bool Command::AffectsShape(ShapeID shapeID) const
+{
+	return true;
+}
+
+//------------------------------- CommandBatch -------------------------------
+
+CommandBatch::CommandBatch()
+{
+}
+
+/*virtual*/ CommandBatch::~CommandBatch()
+{
+}
+
+void CommandBatch::Add(Command* command)
+{
+	this->AddTask(command);
+}
+
+/*static*/ CommandBatch* CommandBatch::Create()
+{
+	return new CommandBatch();
+}
+
 //------------------------------- ExitThreadCommand -------------------------------
 
 ExitThreadCommand::ExitThreadCommand()
@@ -49,6 +74,11 @@ ShapeCommand::ShapeCommand()
 {
 }
 
+/*virtual*/ bool ShapeCommand::AffectsShape(ShapeID shapeID) const
+{
+	return shapeID == this->shapeID;
+}
+
 //------------------------------- AddShapeCommand -------------------------------
 
 AddShapeCommand::AddShapeCommand()
@@ -74,6 +104,29 @@ AddShapeCommand::AddShapeCommand()
 	return new AddShapeCommand();
 }
 
+//------------------------------- AddShapesCommand -------------------------------
+
+AddShapesCommand::AddShapesCommand()
+{
+	this->shapeArray = new std::vector<Shape*>();
+	this->flags = 0;
+}
+
+/*virtual*/ AddShapesCommand::~AddShapesCommand()
+{
+	delete this->shapeArray;
+}
+
+/*virtual*/ void AddShapesCommand::Execute(Thread* thread)
+{
+	thread->AddShapes(*this->shapeArray, this->flags);
+}
+
+/*static*/ AddShapesCommand* AddShapesCommand::Create()
+{
+	return new AddShapesCommand();
+}
+
 //------------------------------- RemoveShapeCommand -------------------------------
 
 RemoveShapeCommand::RemoveShapeCommand()
@@ -115,6 +168,27 @@ RemoveAllShapesCommand::RemoveAllShapesCommand()
 	return new RemoveAllShapesCommand();
 }
 
+//------------------------------- SetCacheMemoryLimitCommand -------------------------------
+
+SetCacheMemoryLimitCommand::SetCacheMemoryLimitCommand()
+{
+	this->memoryLimit = IMZADI_CACHE_DEFAULT_MEMORY_LIMIT;
+}
+
+/*virtual*/ SetCacheMemoryLimitCommand::~SetCacheMemoryLimitCommand()
+{
+}
+
+/*virtual*/ void SetCacheMemoryLimitCommand::Execute(Thread* thread)
+{
+	thread->SetCacheMemoryLimit(this->memoryLimit);
+}
+
+/*static*/ SetCacheMemoryLimitCommand* SetCacheMemoryLimitCommand::Create()
+{
+	return new SetCacheMemoryLimitCommand();
+}
+
 //------------------------------- RemoveAllShapesCommand -------------------------------
 
 SetDebugRenderColorCommand::SetDebugRenderColorCommand()
@@ -142,10 +216,13 @@ SetDebugRenderColorCommand::SetDebugRenderColorCommand()
 ObjectToWorldCommand::ObjectToWorldCommand()
 {
 	this->objectToWorld.SetIdentity();
+	this->absorbedObjectToWorld.SetIdentity();
+	this->absorbedTaskIDArray = nullptr;
 }
 
 /*virtual*/ ObjectToWorldCommand::~ObjectToWorldCommand()
 {
+	CollisionHeap::Get()->Delete(this->absorbedTaskIDArray);
 }
 
 /*virtual*/ void ObjectToWorldCommand::Execute(Thread* thread)
@@ -154,10 +231,28 @@ ObjectToWorldCommand::ObjectToWorldCommand()
 	if (!shape)
 		return;
 
+	// Passing through the second-to-last transform is cheap, and it leaves
+	// the shape's previous transform what it would have been without us.
+	if (this->absorbedTaskIDArray)
+		shape->SetObjectToWorldTransform(this->absorbedObjectToWorld);
+
 	shape->SetObjectToWorldTransform(this->objectToWorld);
 
-	BoundingBoxTree& boxTree = thread->GetBoundingBoxTree();
-	boxTree.Insert(shape, 0);
+	BroadPhase& broadPhase = thread->GetBroadPhase();
+	broadPhase.Insert(shape, 0);
+}
+
+void ObjectToWorldCommand::Absorb(const ObjectToWorldCommand* command)
+{
+	IMZADI_ASSERT(command->shapeID == this->shapeID);
+
+	this->absorbedObjectToWorld = this->objectToWorld;
+	this->objectToWorld = command->objectToWorld;
+
+	if (!this->absorbedTaskIDArray)
+		this->absorbedTaskIDArray = CollisionHeap::Get()->New<TaskIDArray>();
+
+	this->absorbedTaskIDArray->push_back(command->GetTaskID());
 }
 
 /*static*/ ObjectToWorldCommand* ObjectToWorldCommand::Create()
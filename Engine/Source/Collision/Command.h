@@ -2,6 +2,7 @@
 
 #include "Task.h"
 #include "Shape.h"
+#include <vector>
 
 namespace Imzadi
 {
@@ -17,6 +18,36 @@ namespace Imzadi
 	public:
 		Command();
 		virtual ~Command();
+
+		/**
+		 * Tell the caller if this command could change the given shape, or anything about
+		 * the collision world as it pertains to that shape.  This is used to keep queries
+		 * about the shape from being moved ahead of this command.  By default, a command
+		 * is assumed to affect every shape.
+		 * 
+		 * @param[in] shapeID This is the ID of the shape in question.
+		 */
+		virtual bool AffectsShape(ShapeID shapeID) const;
+	};
+
+	/**
+	 * This is a batch of commands that is issued all at once.  See the TaskBatch class.
+	 */
+	class IMZADI_API CommandBatch : public TaskBatch
+	{
+	public:
+		CommandBatch();
+		virtual ~CommandBatch();
+
+		/**
+		 * Add the given command to the end of this batch.  The batch takes ownership of the memory.
+		 */
+		void Add(Command* command);
+
+		/**
+		 * Allocate and return a new instance of the CommandBatch class.
+		 */
+		static CommandBatch* Create();
 	};
 
 	/**
@@ -62,6 +93,11 @@ namespace Imzadi
 		 */
 		ShapeID GetShapeID() const { return this->shapeID; }
 
+		/**
+		 * A shape command affects only its own shape.
+		 */
+		virtual bool AffectsShape(ShapeID shapeID) const override;
+
 	protected:
 		ShapeID shapeID;
 	};
@@ -113,6 +149,49 @@ namespace Imzadi
 		uint32_t flags;
 	};
 
+	/**
+	 * This command is used to add many shapes to the system at once, such as all
+	 * the shapes of a level.  This is much faster than adding them one at a time,
+	 * because the broad-phase can then place them all in one pass.
+	 */
+	class IMZADI_API AddShapesCommand : public Command
+	{
+	public:
+		AddShapesCommand();
+		virtual ~AddShapesCommand();
+
+		/**
+		 * Get the array of shapes that are to be added to the collision system.
+		 * Fill it with shapes made using the Create method of the desired shape class.
+		 */
+		std::vector<Shape*>& GetShapeArray() { return *this->shapeArray; }
+
+		/**
+		 * Perform the addition of all the given shapes to the collision system.
+		 */
+		virtual void Execute(Thread* thread) override;
+
+		/**
+		 * Set the insertion flags to be used for every shape in the add operation.
+		 * These are flags of the form IMZADI_ADD_FLAG_*.
+		 */
+		void SetFlags(uint32_t flags) { this->flags = flags; }
+
+		/**
+		 * Get the insertion flags to be used for every shape in the add operation.
+		 */
+		uint32_t GetFlags() const { return this->flags; }
+
+		/**
+		 * Allocate an instance of the AddShapesCommand.
+		 */
+		static AddShapesCommand* Create();
+
+	private:
+		std::vector<Shape*>* shapeArray;
+		uint32_t flags;
+	};
+
 	/**
 	 * This command is used to remove a shape from the system.
 	 */
@@ -153,6 +232,41 @@ namespace Imzadi
 		static RemoveAllShapesCommand* Create();
 	};
 
+	/**
+	 * Use this command to bound the memory taken up by the collision cache.  Once the cache
+	 * grows past the given limit, the entries that have gone unused the longest are evicted.
+	 * See the CollisionCache class.  The default is IMZADI_CACHE_DEFAULT_MEMORY_LIMIT.
+	 */
+	class IMZADI_API SetCacheMemoryLimitCommand : public Command
+	{
+	public:
+		SetCacheMemoryLimitCommand();
+		virtual ~SetCacheMemoryLimitCommand();
+
+		/**
+		 * Apply the limit to the collision cache.
+		 */
+		virtual void Execute(Thread* thread) override;
+
+		/**
+		 * Set the most memory, in bytes, that the collision cache should take up.
+		 */
+		void SetMemoryLimit(uint64_t memoryLimit) { this->memoryLimit = memoryLimit; }
+
+		/**
+		 * Get the most memory, in bytes, that the collision cache should take up.
+		 */
+		uint64_t GetMemoryLimit() const { return this->memoryLimit; }
+
+		/**
+		 * Create a new instance of the SetCacheMemoryLimitCommand class.
+		 */
+		static SetCacheMemoryLimitCommand* Create();
+
+	private:
+		uint64_t memoryLimit;
+	};
+
 	/**
 	 * This command can be used to change the debug render color of a collision shape.
 	 * It is not meant to be used in production; just debug.
@@ -189,6 +303,10 @@ namespace Imzadi
 
 	/**
 	 * Use this command to change the object-to-world transform of a collision shape.
+	 * 
+	 * If a shape is moved several times before the collision thread gets around to it,
+	 * and no query is made in between, then only the last move is applied.  The collision
+	 * thread does this by folding later commands into the first.  See the Absorb method.
 	 */
 	class IMZADI_API ObjectToWorldCommand : public ShapeCommand
 	{
@@ -201,6 +319,25 @@ namespace Imzadi
 		 */
 		virtual void Execute(Thread* thread) override;
 
+		/**
+		 * Take on the transform of the given command, which moves the same shape later on, so that
+		 * the given command need not be executed.  The shape is still left just as if both commands
+		 * were executed, including its previous object-to-world transform.  The given command's task
+		 * ID is remembered so that it can be marked finished once this command has executed.
+		 * 
+		 * @param[in] command This is a later command for the same shape.  It is not freed here.
+		 */
+		void Absorb(const ObjectToWorldCommand* command);
+
+		typedef std::vector<TaskID, CollisionHeapAllocator<TaskID>> TaskIDArray;
+
+		/**
+		 * Get the task IDs of the commands absorbed by this one, if any.
+		 * 
+		 * @return Null is returned if no command has been absorbed.
+		 */
+		const TaskIDArray* GetAbsorbedTaskIDArray() const { return this->absorbedTaskIDArray; }
+
 		/**
 		 * Allocate and return a new instance of the ObjectToWorldCommand class.
 		 */
@@ -208,6 +345,19 @@ namespace Imzadi
 
 	public:
 		Transform objectToWorld;		///< This transform is what's assigned to the target shape's object-to-world transform.
+
+	private:
+		Transform absorbedObjectToWorld;	///< If any commands were absorbed, this is the transform that the last of them replaced.
+		TaskIDArray* absorbedTaskIDArray;	///< These are the IDs of the later commands absorbed by this one.  It's only allocated once one is.
+	};
+
+	/**
+	 * These are counters kept by the collision thread about the commands it has been sent.
+	 */
+	struct IMZADI_API CommandStats
+	{
+		uint64_t numObjectToWorldCommands;			///< This is the number of ObjectToWorldCommand instances received.
+		uint64_t numObjectToWorldCommandsElided;	///< This is how many of those were absorbed by an earlier one, and so never executed.
 	};
 
 	/**
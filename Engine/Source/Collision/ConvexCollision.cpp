@@ -0,0 +1,524 @@
+#include "ConvexCollision.h"
+#include "CollisionCache.h"
+#include "Shape.h"
+#include "Math/AxisAlignedBoundingBox.h"
+#include <limits>
+
+using namespace Imzadi;
+
+//--------------------------------- ConvexCollision ---------------------------------
+
+/*static*/ ShapePairCollisionStatus* ConvexCollision::Calculate(const Shape* shapeA, const Shape* shapeB)
+{
+	auto collisionStatus = new ShapePairCollisionStatus(shapeA, shapeB);
+
+	double radiusA = shapeA->GetSupportRadius();
+	double radiusB = shapeB->GetSupportRadius();
+	double margin = radiusA + radiusB;
+
+	Simplex simplex;
+	Vector3 pointA, pointB, unitNormal;
+	double distance = 0.0;
+	double depth = 0.0;
+
+	if (!CalculateCoreDistance(shapeA, shapeB, margin, simplex, distance, pointA, pointB))
+	{
+		if (distance >= margin)
+			return collisionStatus;
+
+		// Only the rounded parts of the shapes overlap, so the nearest points of the cores tell us all we need to know.
+		unitNormal = (pointB - pointA) / distance;
+		depth = -distance;
+	}
+	else
+	{
+		depth = CalculateCorePenetration(shapeA, shapeB, simplex, unitNormal, pointA, pointB);
+	}
+
+	double penetration = depth + margin;
+	if (penetration > 0.0)
+	{
+		collisionStatus->inCollision = true;
+		collisionStatus->separationDelta = -unitNormal * penetration;
+		collisionStatus->collisionCenter = ((pointA + unitNormal * radiusA) + (pointB - unitNormal * radiusB)) / 2.0;
+	}
+
+	return collisionStatus;
+}
+
+/*static*/ void ConvexCollision::CalculateSupportVertex(const Shape* shapeA, const Shape* shapeB, const Vector3& direction, SupportVertex& supportVertex)
+{
+	supportVertex.pointA = shapeA->GetSupportPoint(direction);
+	supportVertex.pointB = shapeB->GetSupportPoint(-direction);
+	supportVertex.point = supportVertex.pointA - supportVertex.pointB;
+}
+
+/*static*/ bool ConvexCollision::CalculateCoreDistance(const Shape* shapeA, const Shape* shapeB, double margin, Simplex& simplex, double& distance, Vector3& pointA, Vector3& pointB)
+{
+	// Start from the side of the Minkowski difference facing the origin, going by the centers of the shapes' boxes.
+	const AxisAlignedBoundingBox& boxA = shapeA->GetBoundingBox();
+	const AxisAlignedBoundingBox& boxB = shapeB->GetBoundingBox();
+	Vector3 direction = (boxB.minCorner + boxB.maxCorner - boxA.minCorner - boxA.maxCorner) / 2.0;
+	if (direction.IsZero())
+		direction.SetComponents(1.0, 0.0, 0.0);
+
+	simplex.numVertices = 1;
+	simplex.weight[0] = 1.0;
+	CalculateSupportVertex(shapeA, shapeB, direction, simplex.vertex[0]);
+	Vector3 closestPoint = simplex.vertex[0].point;
+
+	for (int i = 0; i < IMZADI_GJK_MAX_ITERATIONS; i++)
+	{
+		double squareDistance = closestPoint.Dot(closestPoint);
+		if (squareDistance <= IMZADI_GJK_TOLERANCE * IMZADI_GJK_TOLERANCE)
+		{
+			distance = 0.0;
+			return true;
+		}
+
+		SupportVertex supportVertex;
+		CalculateSupportVertex(shapeA, shapeB, -closestPoint, supportVertex);
+
+		// No point of the Minkowski difference is nearer the origin than the support point is along the search direction.
+		// Knowing that much is often enough to tell that the shapes are apart.
+		double projection = closestPoint.Dot(supportVertex.point);
+		if (projection > 0.0 && projection * projection >= margin * margin * squareDistance)
+		{
+			distance = projection / ::sqrt(squareDistance);
+			return false;
+		}
+
+		// If the support point is no nearer the origin than our closest point so far, then there's none nearer.
+		if (squareDistance - projection <= IMZADI_GJK_TOLERANCE * squareDistance)
+			break;
+
+		Simplex previousSimplex = simplex;
+		simplex.vertex[simplex.numVertices++] = supportVertex;
+		Vector3 newClosestPoint = ReduceSimplex(simplex);
+		if (simplex.numVertices == 4)
+		{
+			distance = 0.0;
+			return true;
+		}
+
+		// Rounding error can keep us from getting any closer.  If so, what we have is as good as it gets.
+		if (newClosestPoint.Dot(newClosestPoint) >= squareDistance)
+		{
+			simplex = previousSimplex;
+			break;
+		}
+
+		closestPoint = newClosestPoint;
+	}
+
+	distance = closestPoint.Length();
+	pointA.SetComponents(0.0, 0.0, 0.0);
+	pointB.SetComponents(0.0, 0.0, 0.0);
+	for (int i = 0; i < simplex.numVertices; i++)
+	{
+		pointA += simplex.vertex[i].pointA * simplex.weight[i];
+		pointB += simplex.vertex[i].pointB * simplex.weight[i];
+	}
+
+	return false;
+}
+
+/*static*/ double ConvexCollision::CalculateCorePenetration(const Shape* shapeA, const Shape* shapeB, Simplex& simplex, Vector3& unitNormal, Vector3& pointA, Vector3& pointB)
+{
+	if (!InflateSimplex(shapeA, shapeB, simplex, unitNormal))
+	{
+		// The Minkowski difference is flat, so the cores can only touch, and they do so where the simplex meets the origin.
+		pointA.SetComponents(0.0, 0.0, 0.0);
+		pointB.SetComponents(0.0, 0.0, 0.0);
+		for (int i = 0; i < simplex.numVertices; i++)
+		{
+			pointA += simplex.vertex[i].pointA * simplex.weight[i];
+			pointB += simplex.vertex[i].pointB * simplex.weight[i];
+		}
+
+		return 0.0;
+	}
+
+	std::vector<SupportVertex> vertexArray(simplex.vertex, simplex.vertex + 4);
+	std::vector<Face> faceArray;
+	std::vector<Edge> edgeArray;
+
+	// Wind each face of the tetrahedron so that its normal points away from the vertex opposite it.
+	static const int tetrahedronFaces[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+	for (int i = 0; i < 4; i++)
+	{
+		Face face;
+		face.vertex[0] = tetrahedronFaces[i][0];
+		face.vertex[1] = tetrahedronFaces[i][1];
+		face.vertex[2] = tetrahedronFaces[i][2];
+		CalculateFace(face, vertexArray);
+		const Vector3& oppositePoint = vertexArray[6 - face.vertex[0] - face.vertex[1] - face.vertex[2]].point;
+		if (face.unitNormal.Dot(oppositePoint - vertexArray[face.vertex[0]].point) > 0.0)
+		{
+			std::swap(face.vertex[1], face.vertex[2]);
+			face.unitNormal = -face.unitNormal;
+			face.distance = -face.distance;
+		}
+
+		faceArray.push_back(face);
+	}
+
+	Face closestFace = faceArray[0];
+	for (int i = 0; i < IMZADI_EPA_MAX_ITERATIONS; i++)
+	{
+		int j = 0;
+		for (int k = 1; k < (signed)faceArray.size(); k++)
+			if (faceArray[k].distance < faceArray[j].distance)
+				j = k;
+
+		// The nearest face should only ever get farther away.  If rounding error has left the polytope
+		// in a state where that's not so, the nearest face we had before is as good as we're going to get.
+		if (i > 0 && faceArray[j].distance < closestFace.distance - IMZADI_GJK_TOLERANCE)
+			break;
+
+		closestFace = faceArray[j];
+
+		// Once the face nearest the origin can't be pushed out any farther, it's on the boundary of the Minkowski difference.
+		SupportVertex supportVertex;
+		CalculateSupportVertex(shapeA, shapeB, closestFace.unitNormal, supportVertex);
+		if (supportVertex.point.Dot(closestFace.unitNormal) - closestFace.distance <= IMZADI_GJK_TOLERANCE)
+			break;
+
+		// Take out every face the new vertex can see, and patch the hole with faces fanning out from it to the horizon.
+		// Faces the new vertex is nearly in the plane of are left in, lest rounding error tear a hole in the horizon.
+		int newVertex = (int)vertexArray.size();
+		vertexArray.push_back(supportVertex);
+		edgeArray.clear();
+		for (int k = (signed)faceArray.size() - 1; k >= 0; k--)
+		{
+			const Face& face = faceArray[k];
+			if (face.unitNormal.Dot(supportVertex.point - vertexArray[face.vertex[0]].point) <= IMZADI_GJK_TOLERANCE)
+				continue;
+
+			ToggleHorizonEdge(edgeArray, face.vertex[0], face.vertex[1]);
+			ToggleHorizonEdge(edgeArray, face.vertex[1], face.vertex[2]);
+			ToggleHorizonEdge(edgeArray, face.vertex[2], face.vertex[0]);
+			faceArray[k] = faceArray.back();
+			faceArray.pop_back();
+		}
+
+		for (const Edge& edge : edgeArray)
+		{
+			Face face;
+			face.vertex[0] = edge.vertex[0];
+			face.vertex[1] = edge.vertex[1];
+			face.vertex[2] = newVertex;
+			CalculateFace(face, vertexArray);
+			faceArray.push_back(face);
+		}
+	}
+
+	unitNormal = closestFace.unitNormal;
+	double depth = IMZADI_MAX(closestFace.distance, 0.0);
+
+	// Find where on the face the origin projects, and so where on each core the deepest points are.
+	const SupportVertex& vertexA = vertexArray[closestFace.vertex[0]];
+	const SupportVertex& vertexB = vertexArray[closestFace.vertex[1]];
+	const SupportVertex& vertexC = vertexArray[closestFace.vertex[2]];
+	Vector3 edgeB = vertexB.point - vertexA.point;
+	Vector3 edgeC = vertexC.point - vertexA.point;
+	Vector3 delta = unitNormal * closestFace.distance - vertexA.point;
+	double dotBB = edgeB.Dot(edgeB);
+	double dotBC = edgeB.Dot(edgeC);
+	double dotCC = edgeC.Dot(edgeC);
+	double dotDB = delta.Dot(edgeB);
+	double dotDC = delta.Dot(edgeC);
+	double denominator = dotBB * dotCC - dotBC * dotBC;
+	double weightB = (denominator > 0.0) ? (dotCC * dotDB - dotBC * dotDC) / denominator : 0.0;
+	double weightC = (denominator > 0.0) ? (dotBB * dotDC - dotBC * dotDB) / denominator : 0.0;
+	double weightA = 1.0 - weightB - weightC;
+
+	pointA = vertexA.pointA * weightA + vertexB.pointA * weightB + vertexC.pointA * weightC;
+	pointB = vertexA.pointB * weightA + vertexB.pointB * weightB + vertexC.pointB * weightC;
+
+	return depth;
+}
+
+/*static*/ bool ConvexCollision::InflateSimplex(const Shape* shapeA, const Shape* shapeB, Simplex& simplex, Vector3& unitNormal)
+{
+	static const double axisArray[6][3] = { { 1.0, 0.0, 0.0 }, { -1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, -1.0, 0.0 }, { 0.0, 0.0, 1.0 }, { 0.0, 0.0, -1.0 } };
+
+	// Each vertex added here is given no weight, so that the weights still give the point of the simplex at the origin.
+	while (simplex.numVertices < 4)
+	{
+		SupportVertex& newVertex = simplex.vertex[simplex.numVertices];
+		simplex.weight[simplex.numVertices] = 0.0;
+		const Vector3& pointA = simplex.vertex[0].point;
+		bool added = false;
+
+		if (simplex.numVertices == 1)
+		{
+			for (int i = 0; i < 6 && !added; i++)
+			{
+				unitNormal.SetComponents(axisArray[i][0], axisArray[i][1], axisArray[i][2]);
+				CalculateSupportVertex(shapeA, shapeB, unitNormal, newVertex);
+				added = (newVertex.point - pointA).Length() > IMZADI_GJK_TOLERANCE;
+			}
+		}
+		else if (simplex.numVertices == 2)
+		{
+			Vector3 unitAxis = simplex.vertex[1].point - pointA;
+			unitAxis.Normalize();
+			Vector3 unitPerpendicular;
+			unitPerpendicular.SetAsOrthogonalTo(unitAxis);
+			unitPerpendicular.Normalize();
+			for (int i = 0; i < 6 && !added; i++)
+			{
+				unitNormal = unitPerpendicular.Rotated(unitAxis, double(i) * M_PI / 3.0);
+				CalculateSupportVertex(shapeA, shapeB, unitNormal, newVertex);
+				added = (newVertex.point - pointA).RejectedFrom(unitAxis).Length() > IMZADI_GJK_TOLERANCE;
+			}
+		}
+		else
+		{
+			unitNormal = (simplex.vertex[1].point - pointA).Cross(simplex.vertex[2].point - pointA);
+			unitNormal.Normalize();
+			for (int i = 0; i < 2 && !added; i++)
+			{
+				CalculateSupportVertex(shapeA, shapeB, (i == 0) ? unitNormal : -unitNormal, newVertex);
+				added = ::fabs(unitNormal.Dot(newVertex.point - pointA)) > IMZADI_GJK_TOLERANCE;
+			}
+		}
+
+		if (!added)
+			return false;
+
+		simplex.numVertices++;
+	}
+
+	return true;
+}
+
+/*static*/ Vector3 ConvexCollision::ReduceSimplex(Simplex& simplex)
+{
+	switch (simplex.numVertices)
+	{
+	case 1:
+		simplex.weight[0] = 1.0;
+		return simplex.vertex[0].point;
+	case 2:
+		return ReduceSegment(simplex);
+	case 3:
+		return ReduceTriangle(simplex);
+	case 4:
+		return ReduceTetrahedron(simplex);
+	}
+
+	IMZADI_ASSERT(false);
+	return Vector3(0.0, 0.0, 0.0);
+}
+
+/*static*/ Vector3 ConvexCollision::ReduceSegment(Simplex& simplex)
+{
+	Vector3 pointA = simplex.vertex[0].point;
+	Vector3 pointB = simplex.vertex[1].point;
+	Vector3 edge = pointB - pointA;
+	double squareLength = edge.Dot(edge);
+	double alpha = (squareLength > 0.0) ? -pointA.Dot(edge) / squareLength : 0.0;
+
+	if (alpha <= 0.0)
+	{
+		static const int vertexIndices[] = { 0 };
+		static const double weights[] = { 1.0 };
+		KeepSimplexVertices(simplex, 1, vertexIndices, weights);
+		return pointA;
+	}
+
+	if (alpha >= 1.0)
+	{
+		static const int vertexIndices[] = { 1 };
+		static const double weights[] = { 1.0 };
+		KeepSimplexVertices(simplex, 1, vertexIndices, weights);
+		return pointB;
+	}
+
+	simplex.weight[0] = 1.0 - alpha;
+	simplex.weight[1] = alpha;
+	return pointA + edge * alpha;
+}
+
+/*static*/ Vector3 ConvexCollision::ReduceTriangle(Simplex& simplex)
+{
+	// This goes region by region, as in "Real-Time Collision Detection" by Christer Ericson, section 5.1.5.
+	Vector3 pointA = simplex.vertex[0].point;
+	Vector3 pointB = simplex.vertex[1].point;
+	Vector3 pointC = simplex.vertex[2].point;
+	Vector3 edgeAB = pointB - pointA;
+	Vector3 edgeAC = pointC - pointA;
+
+	double dotA1 = -edgeAB.Dot(pointA);
+	double dotA2 = -edgeAC.Dot(pointA);
+	if (dotA1 <= 0.0 && dotA2 <= 0.0)
+	{
+		static const int vertexIndices[] = { 0 };
+		static const double weights[] = { 1.0 };
+		KeepSimplexVertices(simplex, 1, vertexIndices, weights);
+		return pointA;
+	}
+
+	double dotB1 = -edgeAB.Dot(pointB);
+	double dotB2 = -edgeAC.Dot(pointB);
+	if (dotB1 >= 0.0 && dotB2 <= dotB1)
+	{
+		static const int vertexIndices[] = { 1 };
+		static const double weights[] = { 1.0 };
+		KeepSimplexVertices(simplex, 1, vertexIndices, weights);
+		return pointB;
+	}
+
+	double areaC = dotA1 * dotB2 - dotB1 * dotA2;
+	if (areaC <= 0.0 && dotA1 >= 0.0 && dotB1 <= 0.0)
+	{
+		double alpha = (dotA1 - dotB1 > 0.0) ? dotA1 / (dotA1 - dotB1) : 0.0;
+		static const int vertexIndices[] = { 0, 1 };
+		double weights[] = { 1.0 - alpha, alpha };
+		KeepSimplexVertices(simplex, 2, vertexIndices, weights);
+		return pointA + edgeAB * alpha;
+	}
+
+	double dotC1 = -edgeAB.Dot(pointC);
+	double dotC2 = -edgeAC.Dot(pointC);
+	if (dotC2 >= 0.0 && dotC1 <= dotC2)
+	{
+		static const int vertexIndices[] = { 2 };
+		static const double weights[] = { 1.0 };
+		KeepSimplexVertices(simplex, 1, vertexIndices, weights);
+		return pointC;
+	}
+
+	double areaB = dotC1 * dotA2 - dotA1 * dotC2;
+	if (areaB <= 0.0 && dotA2 >= 0.0 && dotC2 <= 0.0)
+	{
+		double alpha = (dotA2 - dotC2 > 0.0) ? dotA2 / (dotA2 - dotC2) : 0.0;
+		static const int vertexIndices[] = { 0, 2 };
+		double weights[] = { 1.0 - alpha, alpha };
+		KeepSimplexVertices(simplex, 2, vertexIndices, weights);
+		return pointA + edgeAC * alpha;
+	}
+
+	double areaA = dotB1 * dotC2 - dotC1 * dotB2;
+	if (areaA <= 0.0 && dotB2 - dotB1 >= 0.0 && dotC1 - dotC2 >= 0.0)
+	{
+		double denominator = (dotB2 - dotB1) + (dotC1 - dotC2);
+		double alpha = (denominator > 0.0) ? (dotB2 - dotB1) / denominator : 0.0;
+		static const int vertexIndices[] = { 1, 2 };
+		double weights[] = { 1.0 - alpha, alpha };
+		KeepSimplexVertices(simplex, 2, vertexIndices, weights);
+		return pointB + (pointC - pointB) * alpha;
+	}
+
+	double denominator = areaA + areaB + areaC;
+	if (denominator <= 0.0)
+	{
+		// The triangle has no area, and the origin is nearest no edge nor vertex of it.  It must be on it, then.
+		simplex.weight[0] = 1.0;
+		simplex.weight[1] = 0.0;
+		simplex.weight[2] = 0.0;
+		return Vector3(0.0, 0.0, 0.0);
+	}
+
+	double weightB = areaB / denominator;
+	double weightC = areaC / denominator;
+	simplex.weight[0] = 1.0 - weightB - weightC;
+	simplex.weight[1] = weightB;
+	simplex.weight[2] = weightC;
+	return pointA + edgeAB * weightB + edgeAC * weightC;
+}
+
+/*static*/ Vector3 ConvexCollision::ReduceTetrahedron(Simplex& simplex)
+{
+	// The last three vertices of each row are the face opposite the first.
+	static const int faceVertices[4][4] = { { 3, 0, 1, 2 }, { 2, 0, 3, 1 }, { 1, 0, 2, 3 }, { 0, 1, 3, 2 } };
+
+	Simplex closestSimplex;
+	Vector3 closestPoint;
+	double smallestSquareDistance = std::numeric_limits<double>::max();
+
+	for (int i = 0; i < 4; i++)
+	{
+		const Vector3& oppositePoint = simplex.vertex[faceVertices[i][0]].point;
+		const Vector3& pointA = simplex.vertex[faceVertices[i][1]].point;
+		const Vector3& pointB = simplex.vertex[faceVertices[i][2]].point;
+		const Vector3& pointC = simplex.vertex[faceVertices[i][3]].point;
+
+		// The origin is only nearer this face than the inside of the tetrahedron if it's on the side of the face away from the opposite vertex.
+		Vector3 normal = (pointB - pointA).Cross(pointC - pointA);
+		double originSide = -normal.Dot(pointA);
+		double oppositeSide = normal.Dot(oppositePoint - pointA);
+		if (oppositeSide != 0.0 && originSide * oppositeSide >= 0.0)
+			continue;
+
+		Simplex faceSimplex;
+		faceSimplex.numVertices = 3;
+		for (int j = 0; j < 3; j++)
+			faceSimplex.vertex[j] = simplex.vertex[faceVertices[i][j + 1]];
+
+		Vector3 point = ReduceTriangle(faceSimplex);
+		double squareDistance = point.Dot(point);
+		if (squareDistance < smallestSquareDistance)
+		{
+			smallestSquareDistance = squareDistance;
+			closestSimplex = faceSimplex;
+			closestPoint = point;
+		}
+	}
+
+	if (smallestSquareDistance == std::numeric_limits<double>::max())
+		return Vector3(0.0, 0.0, 0.0);
+
+	simplex = closestSimplex;
+	return closestPoint;
+}
+
+/*static*/ void ConvexCollision::KeepSimplexVertices(Simplex& simplex, int numVertices, const int* vertexIndices, const double* weights)
+{
+	SupportVertex vertexArray[4];
+	for (int i = 0; i < numVertices; i++)
+		vertexArray[i] = simplex.vertex[vertexIndices[i]];
+
+	for (int i = 0; i < numVertices; i++)
+	{
+		simplex.vertex[i] = vertexArray[i];
+		simplex.weight[i] = weights[i];
+	}
+
+	simplex.numVertices = numVertices;
+}
+
+/*static*/ bool ConvexCollision::CalculateFace(Face& face, const std::vector<SupportVertex>& vertexArray)
+{
+	const Vector3& pointA = vertexArray[face.vertex[0]].point;
+	const Vector3& pointB = vertexArray[face.vertex[1]].point;
+	const Vector3& pointC = vertexArray[face.vertex[2]].point;
+
+	face.unitNormal = (pointB - pointA).Cross(pointC - pointA);
+	if (!face.unitNormal.Normalize())
+	{
+		face.unitNormal.SetComponents(0.0, 0.0, 0.0);
+		face.distance = std::numeric_limits<double>::max();
+		return false;
+	}
+
+	face.distance = face.unitNormal.Dot(pointA);
+	return true;
+}
+
+/*static*/ void ConvexCollision::ToggleHorizonEdge(std::vector<Edge>& edgeArray, int i, int j)
+{
+	for (int k = 0; k < (signed)edgeArray.size(); k++)
+	{
+		if (edgeArray[k].vertex[0] == j && edgeArray[k].vertex[1] == i)
+		{
+			edgeArray[k] = edgeArray.back();
+			edgeArray.pop_back();
+			return;
+		}
+	}
+
+	edgeArray.push_back(Edge{ { i, j } });
+}
\ No newline at end of file
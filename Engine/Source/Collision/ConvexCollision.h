@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Defines.h"
+#include "Math/Vector3.h"
+#include <vector>
+
+namespace Imzadi
+{
+	class Shape;
+	class ShapePairCollisionStatus;
+
+	/**
+	 * This calculates the collision status between any two convex shapes, knowing nothing of either
+	 * but its support function.  See Shape::GetSupportPoint.  It serves every pair of shape types for
+	 * which no calculator has been specialized.  See the CollisionCalculator class.
+	 *
+	 * Each shape is thought of as a core, from which its support points are taken, rounded out by a
+	 * radius.  The GJK algorithm finds how far apart the cores are.  If that's less than the sum of the
+	 * radii, the shapes overlap in their rounded parts only, and the closest points of the cores give
+	 * the answer exactly.  If the cores themselves overlap, the EPA algorithm grows the simplex GJK
+	 * left behind into a polytope, until the face of it nearest the origin lies on the boundary of
+	 * the Minkowski difference of the cores.  That face gives the depth and direction of penetration.
+	 *
+	 * Every core we have is a polytope, so both algorithms end in a finite number of steps, but they
+	 * give up after IMZADI_GJK_MAX_ITERATIONS and IMZADI_EPA_MAX_ITERATIONS steps anyway.
+	 */
+	class IMZADI_API ConvexCollision
+	{
+	public:
+		/**
+		 * Calculate and return a new collision status for the given shapes, just as a calculator would.
+		 * The separation delta is based on moving the first shape away from the second.
+		 *
+		 * @param[in] shapeA The first shape to consider in a possible collision with the second.
+		 * @param[in] shapeB The second shape to consider in a possible collision with the first.
+		 * @return A new collision status is always returned.
+		 */
+		static ShapePairCollisionStatus* Calculate(const Shape* shapeA, const Shape* shapeB);
+
+	private:
+
+		/**
+		 * This is a point of the Minkowski difference of the cores of two shapes, along with the point of each core it came from.
+		 */
+		struct SupportVertex
+		{
+			Vector3 point;			///< This is the first shape's point minus the second shape's point.
+			Vector3 pointA;			///< This is the support point of the first shape.
+			Vector3 pointB;			///< This is the support point of the second shape.
+		};
+
+		/**
+		 * This is the simplex kept by the GJK algorithm, along with the barycentric weights of the point on it nearest the origin.
+		 */
+		struct Simplex
+		{
+			SupportVertex vertex[4];
+			double weight[4];
+			int numVertices;
+		};
+
+		/**
+		 * This is a triangular face of the polytope grown by the EPA algorithm.
+		 */
+		struct Face
+		{
+			int vertex[3];			///< These index the polytope's vertices, wound counter-clockwise as seen from outside.
+			Vector3 unitNormal;		///< This points out of the polytope.
+			double distance;		///< This is the signed distance from the origin to the plane of the face.
+		};
+
+		/**
+		 * This is a directed edge of the polytope, used to find the horizon of the faces a new vertex can see.
+		 */
+		struct Edge
+		{
+			int vertex[2];
+		};
+
+		/**
+		 * Find the point of the Minkowski difference of the cores of the given shapes that is farthest along the given direction.
+		 */
+		static void CalculateSupportVertex(const Shape* shapeA, const Shape* shapeB, const Vector3& direction, SupportVertex& supportVertex);
+
+		/**
+		 * Use the GJK algorithm to find how far apart the cores of the given shapes are.
+		 *
+		 * @param[in] margin The cores are known to be apart enough as soon as they're found to be at least this far apart.
+		 * @param[out] simplex This is left holding the simplex in which the search ended.  It contains the origin if the cores overlap.
+		 * @param[out] distance This is given the distance between the cores, unless they overlap, or are found to be at least the given margin apart, in which case it's given how far apart they're known to be so far.
+		 * @param[out] pointA This is given the point of the first core nearest the second, unless the cores overlap, or are found to be at least the given margin apart.
+		 * @param[out] pointB This is given the point of the second core nearest the first, under the same conditions.
+		 * @return True is returned if the cores overlap; false, otherwise.
+		 */
+		static bool CalculateCoreDistance(const Shape* shapeA, const Shape* shapeB, double margin, Simplex& simplex, double& distance, Vector3& pointA, Vector3& pointB);
+
+		/**
+		 * Use the EPA algorithm to find how deep, and in what direction, the overlapping cores of the given shapes penetrate one another.
+		 *
+		 * @param[in] simplex This is the simplex left by the GJK algorithm, which must contain the origin.
+		 * @param[out] unitNormal This is the direction the first core must be pushed against to stop overlapping the second.
+		 * @param[out] pointA This is given the point of the first core deepest inside the second.
+		 * @param[out] pointB This is given the point of the second core deepest inside the first.
+		 * @return The depth of penetration is returned.  It may be zero if the cores only touch.
+		 */
+		static double CalculateCorePenetration(const Shape* shapeA, const Shape* shapeB, Simplex& simplex, Vector3& unitNormal, Vector3& pointA, Vector3& pointB);
+
+		/**
+		 * Add vertices to the given simplex, which must contain the origin, until it's a tetrahedron, if that's possible.
+		 * It isn't if the Minkowski difference is flat, in which case the cores can only touch.
+		 *
+		 * @param[out] unitNormal If we return false, this is given a direction out of the flat Minkowski difference.
+		 * @return True is returned if the simplex is made a tetrahedron; false, otherwise.
+		 */
+		static bool InflateSimplex(const Shape* shapeA, const Shape* shapeB, Simplex& simplex, Vector3& unitNormal);
+
+		/**
+		 * Find the point of the given simplex nearest the origin, setting the weights of the simplex to
+		 * its barycentric coordinates, and drop the vertices of the simplex not needed to express it.
+		 *
+		 * @return The nearest point is returned.  If the simplex is a tetrahedron containing the origin, it is left as is, and zero is returned.
+		 */
+		static Vector3 ReduceSimplex(Simplex& simplex);
+
+		/**
+		 * This is the part of the ReduceSimplex method that handles a line segment.
+		 */
+		static Vector3 ReduceSegment(Simplex& simplex);
+
+		/**
+		 * This is the part of the ReduceSimplex method that handles a triangle.
+		 */
+		static Vector3 ReduceTriangle(Simplex& simplex);
+
+		/**
+		 * This is the part of the ReduceSimplex method that handles a tetrahedron.
+		 */
+		static Vector3 ReduceTetrahedron(Simplex& simplex);
+
+		/**
+		 * Keep just the vertices of the given simplex having the given indices, in the given order, along with the given weights.
+		 */
+		static void KeepSimplexVertices(Simplex& simplex, int numVertices, const int* vertexIndices, const double* weights);
+
+		/**
+		 * Fill in the normal and distance of the given face from the given vertices.
+		 *
+		 * @return False is returned if the face has no area, in which case it's given no normal, and a distance so great it's never thought nearest the origin.
+		 */
+		static bool CalculateFace(Face& face, const std::vector<SupportVertex>& vertexArray);
+
+		/**
+		 * Add the given edge to the given horizon, unless its reverse is already there, in which case it's removed instead.
+		 */
+		static void ToggleHorizonEdge(std::vector<Edge>& edgeArray, int i, int j);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,566 @@
+#include "DynamicBoundingBoxTree.h"
+#include "Result.h"
+#include "CollisionHeap.h"
+#include "Math/Ray.h"
+#include <algorithm>
+#include <execution>
+#include <bit>
+
+using namespace Imzadi;
+
+//--------------------------------- DynamicBoundingBoxTree ---------------------------------
+
+DynamicBoundingBoxTree::DynamicBoundingBoxTree(const AxisAlignedBoundingBox& collisionWorldExtents) : BroadPhase(collisionWorldExtents)
+{
+	this->rootNode = nullptr;
+}
+
+/*virtual*/ DynamicBoundingBoxTree::~DynamicBoundingBoxTree()
+{
+	this->Clear();
+}
+
+/*virtual*/ bool DynamicBoundingBoxTree::InsertDynamic(Shape* shape, uint32_t flags)
+{
+	if (!shape)
+		return false;
+
+	const AxisAlignedBoundingBox& shapeBox = shape->GetBoundingBox();
+	bool inWorld = this->collisionWorldExtents.ContainsBox(shapeBox);
+
+	DynamicBoundingBoxNode* leafNode = shape->leafNode;
+	if (leafNode)
+	{
+		// A shape that moved, but is still inside its fat box, needs no tree work at all.
+		// We just have to make sure that the fat box hasn't gone stale, which happens
+		// when a shape that was moving quickly slows down or changes direction.
+		AxisAlignedBoundingBox fatBox;
+		CalculateFatBox(shape, fatBox);
+		if (inWorld && leafNode->box.ContainsBox(shapeBox) && leafNode->box.GetSurfaceArea() <= IMZADI_FAT_BOX_MAX_AREA_RATIO * fatBox.GetSurfaceArea())
+		{
+			if (this->statistics)
+				this->statistics->RecordReinsertionAvoided();
+
+			return true;
+		}
+
+		if (this->statistics)
+			this->statistics->RecordReinsertion();
+
+		this->RemoveLeaf(leafNode);
+		leafNode->box = fatBox;
+	}
+
+	if (!inWorld)
+	{
+		// The shape has left the collision world, so it no longer gets a place in the tree.
+		CollisionHeap::Get()->Delete(leafNode);
+	}
+	else
+	{
+		// Shapes are only given fat boxes once they start moving.  Those that never move,
+		// such as the static geometry of a level, are better served by tight boxes.
+		if (!leafNode)
+		{
+			leafNode = CollisionHeap::Get()->New<DynamicBoundingBoxNode>();
+			leafNode->shape = shape;
+			leafNode->box = shapeBox;
+			shape->leafNode = leafNode;
+		}
+
+		this->InsertLeaf(leafNode);
+	}
+
+	this->TrackShape(shape);
+	return true;
+}
+
+/*virtual*/ void DynamicBoundingBoxTree::InsertManyDynamic(std::vector<Shape*>& shapeArray, uint32_t flags)
+{
+	auto lastNewShape = std::partition(shapeArray.begin(), shapeArray.end(), [](const Shape* shape) -> bool { return shape->leafNode == nullptr; });
+	for (auto iter = lastNewShape; iter != shapeArray.end(); iter++)
+		if (!this->InsertDynamic(*iter, flags))
+			Shape::Free(*iter);
+
+	// A shape's box is calculated the first time it's asked for, which, for polygons, is a good part of the work
+	// of inserting them, so get that done for all the shapes at once, spread across all cores.
+	std::for_each(std::execution::par, shapeArray.begin(), lastNewShape, [](const Shape* shape) { shape->GetBoundingBox(); });
+
+	// As always, shapes outside the collision world are tracked, but not put in the tree.
+	auto lastInWorldShape = BroadPhase::Partition(shapeArray.begin(), lastNewShape, [this](const Shape* shape) -> bool { return this->collisionWorldExtents.ContainsBox(shape->GetBoundingBox()); });
+
+	std::vector<BuildEntry> buildEntryArray(lastInWorldShape - shapeArray.begin());
+	std::transform(std::execution::par, shapeArray.begin(), lastInWorldShape, buildEntryArray.begin(), [this](Shape* shape) -> BuildEntry
+	{
+		const AxisAlignedBoundingBox& box = shape->GetBoundingBox();
+		return BuildEntry{ this->CalculateMortonCode((box.minCorner + box.maxCorner) / 2.0), shape };
+	});
+
+	std::sort(std::execution::par, buildEntryArray.begin(), buildEntryArray.end(), [](const BuildEntry& entryA, const BuildEntry& entryB) -> bool
+	{
+		return entryA.mortonCode < entryB.mortonCode;
+	});
+
+	if (buildEntryArray.size() > 0)
+		this->InsertLeaf(this->BuildSubtree(buildEntryArray, 0, (uint32_t)buildEntryArray.size()));
+
+	for (auto iter = shapeArray.begin(); iter != lastNewShape; iter++)
+		this->TrackShape(*iter);
+}
+
+uint64_t DynamicBoundingBoxTree::CalculateMortonCode(const Vector3& point) const
+{
+	// Spread the low 21 bits of the given value out so that there are two zero bits between each.
+	auto spreadBits = [](uint64_t value) -> uint64_t
+	{
+		value &= 0x1FFFFF;
+		value = (value | (value << 32)) & 0x1F00000000FFFF;
+		value = (value | (value << 16)) & 0x1F0000FF0000FF;
+		value = (value | (value << 8)) & 0x100F00F00F00F00F;
+		value = (value | (value << 4)) & 0x10C30C30C30C30C3;
+		value = (value | (value << 2)) & 0x1249249249249249;
+		return value;
+	};
+
+	double width = 0.0, height = 0.0, depth = 0.0;
+	this->collisionWorldExtents.GetDimensions(width, height, depth);
+	Vector3 offset = point - this->collisionWorldExtents.minCorner;
+	double scale = double(0x1FFFFF);
+	uint64_t x = (uint64_t)IMZADI_CLAMP(offset.x / width * scale, 0.0, scale);
+	uint64_t y = (uint64_t)IMZADI_CLAMP(offset.y / height * scale, 0.0, scale);
+	uint64_t z = (uint64_t)IMZADI_CLAMP(offset.z / depth * scale, 0.0, scale);
+
+	return (spreadBits(x) << 2) | (spreadBits(y) << 1) | spreadBits(z);
+}
+
+DynamicBoundingBoxNode* DynamicBoundingBoxTree::BuildSubtree(const std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries)
+{
+	if (numEntries == 1)
+	{
+		Shape* shape = buildEntryArray[firstEntry].shape;
+		DynamicBoundingBoxNode* leafNode = CollisionHeap::Get()->New<DynamicBoundingBoxNode>();
+		leafNode->shape = shape;
+		leafNode->box = shape->GetBoundingBox();
+		shape->leafNode = leafNode;
+		return leafNode;
+	}
+
+	// Cut the run where the highest bit in which its first and last codes differ turns on.  This is the
+	// biggest cell of the curve that the run spans.  If all the codes are the same, just cut the run in half.
+	uint32_t numFirstEntries = numEntries / 2;
+	uint64_t firstCode = buildEntryArray[firstEntry].mortonCode;
+	uint64_t lastCode = buildEntryArray[firstEntry + numEntries - 1].mortonCode;
+	if (firstCode != lastCode)
+	{
+		uint64_t highestBit = uint64_t(1) << (std::bit_width(firstCode ^ lastCode) - 1);
+		auto cutIter = std::partition_point(buildEntryArray.begin() + firstEntry, buildEntryArray.begin() + firstEntry + numEntries,
+			[highestBit](const BuildEntry& buildEntry) -> bool
+			{
+				return (buildEntry.mortonCode & highestBit) == 0;
+			});
+
+		numFirstEntries = uint32_t(cutIter - (buildEntryArray.begin() + firstEntry));
+	}
+
+	DynamicBoundingBoxNode* node = CollisionHeap::Get()->New<DynamicBoundingBoxNode>();
+	node->childNode[0] = this->BuildSubtree(buildEntryArray, firstEntry, numFirstEntries);
+	node->childNode[1] = this->BuildSubtree(buildEntryArray, firstEntry + numFirstEntries, numEntries - numFirstEntries);
+	node->childNode[0]->parentNode = node;
+	node->childNode[1]->parentNode = node;
+	node->Refit();
+
+	// The curve only knows where the centers of the shapes are, not how big they are, so tidy up as we go.
+	this->Rotate(node);
+	return node;
+}
+
+/*static*/ void DynamicBoundingBoxTree::CalculateFatBox(const Shape* shape, AxisAlignedBoundingBox& fatBox)
+{
+	fatBox = shape->GetBoundingBox();
+	fatBox.minCorner -= Vector3(IMZADI_FAT_BOX_MARGIN, IMZADI_FAT_BOX_MARGIN, IMZADI_FAT_BOX_MARGIN);
+	fatBox.maxCorner += Vector3(IMZADI_FAT_BOX_MARGIN, IMZADI_FAT_BOX_MARGIN, IMZADI_FAT_BOX_MARGIN);
+
+	// Assume the shape will keep moving the way it just did, and stretch the box to where it's headed.
+	// A shape that jumped farther than its own size was probably teleported rather than moved, so we
+	// never stretch the box by more than the size of the shape.  A huge box would be worse than none.
+	Vector3 motion = shape->GetObjectToWorldTransform().translation - shape->GetPreviousObjectToWorldTransform().translation;
+	motion *= IMZADI_FAT_BOX_MOTION_FACTOR;
+
+	double width = 0.0, height = 0.0, depth = 0.0;
+	shape->GetBoundingBox().GetDimensions(width, height, depth);
+	motion.x = IMZADI_CLAMP(motion.x, -width, width);
+	motion.y = IMZADI_CLAMP(motion.y, -height, height);
+	motion.z = IMZADI_CLAMP(motion.z, -depth, depth);
+
+	if (motion.x > 0.0)
+		fatBox.maxCorner.x += motion.x;
+	else
+		fatBox.minCorner.x += motion.x;
+
+	if (motion.y > 0.0)
+		fatBox.maxCorner.y += motion.y;
+	else
+		fatBox.minCorner.y += motion.y;
+
+	if (motion.z > 0.0)
+		fatBox.maxCorner.z += motion.z;
+	else
+		fatBox.minCorner.z += motion.z;
+}
+
+/*virtual*/ bool DynamicBoundingBoxTree::Remove(ShapeID shapeID)
+{
+	Shape* shape = this->FindShape(shapeID);
+	if (!shape)
+		return false;
+
+	DynamicBoundingBoxNode* leafNode = shape->leafNode;
+	if (leafNode)
+	{
+		this->RemoveLeaf(leafNode);
+		CollisionHeap::Get()->Delete(leafNode);
+	}
+
+	return BroadPhase::Remove(shapeID);
+}
+
+/*virtual*/ void DynamicBoundingBoxTree::Clear()
+{
+	CollisionHeap::Get()->Delete(this->rootNode);
+	this->rootNode = nullptr;
+
+	BroadPhase::Clear();
+}
+
+/*virtual*/ void DynamicBoundingBoxTree::DebugRenderDynamic(DebugRenderResult* renderResult) const
+{
+	if (this->rootNode)
+		this->rootNode->DebugRender(renderResult);
+}
+
+/*virtual*/ void DynamicBoundingBoxTree::RayCastDynamic(const Ray& ray, RayCastResult::HitData& hitData) const
+{
+	struct NodeHit
+	{
+		const DynamicBoundingBoxNode* node;
+		double alpha;
+	};
+
+	// Find out where, if anywhere, the ray enters the box of the given node.
+	auto castAgainstNode = [&ray](const DynamicBoundingBoxNode* node, NodeHit& nodeHit) -> bool
+	{
+		nodeHit.node = node;
+		nodeHit.alpha = 0.0;
+		if (node->box.ContainsPoint(ray.origin))
+			return true;
+
+		return ray.CastAgainst(node->box, nodeHit.alpha);
+	};
+
+	uint32_t numNodesVisited = 0;
+	std::vector<NodeHit, CollisionHeapAllocator<NodeHit>> nodeStack;
+	NodeHit rootHit;
+	if (this->rootNode && castAgainstNode(this->rootNode, rootHit) && rootHit.alpha < hitData.alpha)
+		nodeStack.push_back(rootHit);
+
+	while (nodeStack.size() > 0)
+	{
+		NodeHit nodeHit = nodeStack.back();
+		nodeStack.pop_back();
+
+		// A nearer hit may have been found since this node was pushed.
+		if (nodeHit.alpha >= hitData.alpha)
+			continue;
+
+		const DynamicBoundingBoxNode* node = nodeHit.node;
+		numNodesVisited++;
+
+		if (node->IsLeaf())
+		{
+			BroadPhase::RayCastShape(ray, node->shape, hitData);
+			continue;
+		}
+
+		NodeHit childHit[2];
+		bool childHitValid[2];
+		for (int i = 0; i < 2; i++)
+			childHitValid[i] = castAgainstNode(node->childNode[i], childHit[i]) && childHit[i].alpha < hitData.alpha;
+
+		// Push the farther child first so that the nearer child is visited first.
+		int nearIndex = (childHitValid[0] && childHitValid[1] && childHit[1].alpha < childHit[0].alpha) ? 1 : 0;
+		int farIndex = 1 - nearIndex;
+		if (childHitValid[farIndex])
+			nodeStack.push_back(childHit[farIndex]);
+		if (childHitValid[nearIndex])
+			nodeStack.push_back(childHit[nearIndex]);
+	}
+
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(numNodesVisited);
+}
+
+/*virtual*/ void DynamicBoundingBoxTree::CalculateDynamicCollision(const Shape* shape, CollisionQueryResult* collisionResult) const
+{
+	if (!this->rootNode)
+		return;
+
+	const AxisAlignedBoundingBox& shapeBox = shape->GetBoundingBox();
+
+	uint32_t numNodesVisited = 0;
+	std::vector<const DynamicBoundingBoxNode*, CollisionHeapAllocator<const DynamicBoundingBoxNode*>> nodeStack;
+	nodeStack.push_back(this->rootNode);
+	while (nodeStack.size() > 0)
+	{
+		const DynamicBoundingBoxNode* node = nodeStack.back();
+		nodeStack.pop_back();
+		numNodesVisited++;
+
+		if (node->IsLeaf())
+		{
+			this->CollideShapes(shape, node->shape, collisionResult);
+			continue;
+		}
+
+		for (const DynamicBoundingBoxNode* childNode : node->childNode)
+		{
+			AxisAlignedBoundingBox intersection;
+			if (intersection.Intersect(childNode->box, shapeBox))
+				nodeStack.push_back(childNode);
+		}
+	}
+
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(numNodesVisited);
+}
+
+/*virtual*/ void DynamicBoundingBoxTree::GatherDynamicDiagnostics(TreeDiagnosticsResult::Diagnostics& diagnostics) const
+{
+	if (!this->rootNode)
+		return;
+
+	struct NodeDepth
+	{
+		const DynamicBoundingBoxNode* node;
+		uint32_t depth;
+	};
+
+	double rootArea = this->rootNode->box.GetSurfaceArea();
+	std::vector<NodeDepth> nodeStack;
+	nodeStack.push_back(NodeDepth{ this->rootNode, 0 });
+	while (nodeStack.size() > 0)
+	{
+		NodeDepth nodeDepth = nodeStack.back();
+		nodeStack.pop_back();
+
+		const DynamicBoundingBoxNode* node = nodeDepth.node;
+		BroadPhase::AccountForNode(diagnostics, nodeDepth.depth, node->IsLeaf() ? 1 : 0, node->IsLeaf(), false, node->box.GetSurfaceArea() / rootArea);
+
+		if (!node->IsLeaf())
+			for (const DynamicBoundingBoxNode* childNode : node->childNode)
+				nodeStack.push_back(NodeDepth{ childNode, nodeDepth.depth + 1 });
+	}
+}
+
+void DynamicBoundingBoxTree::InsertLeaf(DynamicBoundingBoxNode* leafNode)
+{
+	if (!this->rootNode)
+	{
+		this->rootNode = leafNode;
+		leafNode->parentNode = nullptr;
+		return;
+	}
+
+	DynamicBoundingBoxNode* siblingNode = this->FindBestSibling(leafNode->box);
+	DynamicBoundingBoxNode* oldParentNode = siblingNode->parentNode;
+
+	DynamicBoundingBoxNode* newParentNode = CollisionHeap::Get()->New<DynamicBoundingBoxNode>();
+	newParentNode->parentNode = oldParentNode;
+	newParentNode->childNode[0] = siblingNode;
+	newParentNode->childNode[1] = leafNode;
+	newParentNode->Refit();
+	siblingNode->parentNode = newParentNode;
+	leafNode->parentNode = newParentNode;
+
+	if (!oldParentNode)
+		this->rootNode = newParentNode;
+	else
+	{
+		int i = (oldParentNode->childNode[0] == siblingNode) ? 0 : 1;
+		oldParentNode->childNode[i] = newParentNode;
+		this->RefitAncestors(oldParentNode);
+	}
+}
+
+void DynamicBoundingBoxTree::RemoveLeaf(DynamicBoundingBoxNode* leafNode)
+{
+	DynamicBoundingBoxNode* parentNode = leafNode->parentNode;
+	leafNode->parentNode = nullptr;
+
+	if (!parentNode)
+	{
+		IMZADI_ASSERT(this->rootNode == leafNode);
+		this->rootNode = nullptr;
+		return;
+	}
+
+	DynamicBoundingBoxNode* siblingNode = (parentNode->childNode[0] == leafNode) ? parentNode->childNode[1] : parentNode->childNode[0];
+	DynamicBoundingBoxNode* grandParentNode = parentNode->parentNode;
+	siblingNode->parentNode = grandParentNode;
+
+	if (!grandParentNode)
+		this->rootNode = siblingNode;
+	else
+	{
+		int i = (grandParentNode->childNode[0] == parentNode) ? 0 : 1;
+		grandParentNode->childNode[i] = siblingNode;
+	}
+
+	// Don't let the parent take its children with it.
+	parentNode->childNode[0] = nullptr;
+	parentNode->childNode[1] = nullptr;
+	CollisionHeap::Get()->Delete(parentNode);
+
+	if (grandParentNode)
+		this->RefitAncestors(grandParentNode);
+}
+
+DynamicBoundingBoxNode* DynamicBoundingBoxTree::FindBestSibling(const AxisAlignedBoundingBox& box) const
+{
+	// The cost of making a node the sibling is the surface area of the new parent, plus
+	// the area that must be added to each of the node's ancestors to contain the new leaf.
+	// We call the latter the inherited cost.  It only grows as we go deeper, so once even
+	// the smallest possible new parent can't beat the best cost so far, we can stop.
+	struct Candidate
+	{
+		DynamicBoundingBoxNode* node;
+		double inheritedCost;
+	};
+
+	double boxArea = box.GetSurfaceArea();
+
+	DynamicBoundingBoxNode* bestNode = this->rootNode;
+	AxisAlignedBoundingBox mergedBox;
+	mergedBox.Merge(this->rootNode->box, box);
+	double bestCost = mergedBox.GetSurfaceArea();
+
+	std::vector<Candidate, CollisionHeapAllocator<Candidate>> candidateStack;
+	candidateStack.push_back(Candidate{ this->rootNode, 0.0 });
+	while (candidateStack.size() > 0)
+	{
+		Candidate candidate = candidateStack.back();
+		candidateStack.pop_back();
+
+		DynamicBoundingBoxNode* node = candidate.node;
+		mergedBox.Merge(node->box, box);
+		double mergedArea = mergedBox.GetSurfaceArea();
+		double cost = mergedArea + candidate.inheritedCost;
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestNode = node;
+		}
+
+		if (node->IsLeaf())
+			continue;
+
+		double childInheritedCost = candidate.inheritedCost + mergedArea - node->box.GetSurfaceArea();
+		if (boxArea + childInheritedCost < bestCost)
+		{
+			candidateStack.push_back(Candidate{ node->childNode[0], childInheritedCost });
+			candidateStack.push_back(Candidate{ node->childNode[1], childInheritedCost });
+		}
+	}
+
+	return bestNode;
+}
+
+void DynamicBoundingBoxTree::RefitAncestors(DynamicBoundingBoxNode* node)
+{
+	while (node)
+	{
+		node->Refit();
+		this->Rotate(node);
+		node = node->parentNode;
+	}
+}
+
+void DynamicBoundingBoxTree::Rotate(DynamicBoundingBoxNode* node)
+{
+	if (node->IsLeaf())
+		return;
+
+	// Consider swapping child i of the given node with grand-child j of the given node
+	// through its other child.  The given node's box stays the same either way, but the
+	// other child's box gets smaller if the child we give it fits better with what's left.
+	int bestI = -1, bestJ = -1;
+	double bestAreaChange = 0.0;
+	for (int i = 0; i < 2; i++)
+	{
+		DynamicBoundingBoxNode* childNode = node->childNode[i];
+		DynamicBoundingBoxNode* otherChildNode = node->childNode[1 - i];
+		if (otherChildNode->IsLeaf())
+			continue;
+
+		double otherChildArea = otherChildNode->box.GetSurfaceArea();
+		for (int j = 0; j < 2; j++)
+		{
+			AxisAlignedBoundingBox rotatedBox;
+			rotatedBox.Merge(childNode->box, otherChildNode->childNode[1 - j]->box);
+			double areaChange = rotatedBox.GetSurfaceArea() - otherChildArea;
+			if (areaChange < bestAreaChange)
+			{
+				bestAreaChange = areaChange;
+				bestI = i;
+				bestJ = j;
+			}
+		}
+	}
+
+	if (bestI < 0)
+		return;
+
+	DynamicBoundingBoxNode* childNode = node->childNode[bestI];
+	DynamicBoundingBoxNode* otherChildNode = node->childNode[1 - bestI];
+	DynamicBoundingBoxNode* grandChildNode = otherChildNode->childNode[bestJ];
+
+	node->childNode[bestI] = grandChildNode;
+	grandChildNode->parentNode = node;
+	otherChildNode->childNode[bestJ] = childNode;
+	childNode->parentNode = otherChildNode;
+	otherChildNode->Refit();
+}
+
+//--------------------------------- DynamicBoundingBoxNode ---------------------------------
+
+DynamicBoundingBoxNode::DynamicBoundingBoxNode()
+{
+	this->parentNode = nullptr;
+	this->childNode[0] = nullptr;
+	this->childNode[1] = nullptr;
+	this->shape = nullptr;
+}
+
+/*virtual*/ DynamicBoundingBoxNode::~DynamicBoundingBoxNode()
+{
+	if (this->shape)
+		this->shape->leafNode = nullptr;
+
+	CollisionHeap::Get()->Delete(this->childNode[0]);
+	CollisionHeap::Get()->Delete(this->childNode[1]);
+}
+
+void DynamicBoundingBoxNode::Refit()
+{
+	this->box.Merge(this->childNode[0]->box, this->childNode[1]->box);
+}
+
+void DynamicBoundingBoxNode::DebugRender(DebugRenderResult* renderResult) const
+{
+	renderResult->AddLinesForBox(this->box, Vector3(1.0, 1.0, 1.0));
+
+	if (!this->IsLeaf())
+	{
+		this->childNode[0]->DebugRender(renderResult);
+		this->childNode[1]->DebugRender(renderResult);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Defines.h"
+#include "BroadPhase.h"
+#include "Math/AxisAlignedBoundingBox.h"
+#include <vector>
+
+namespace Imzadi
+{
+	class DynamicBoundingBoxNode;
+
+	/**
+	 * This class facilitates the broad-phase of collision detection by grouping the
+	 * bounding boxes of the shapes themselves into a binary hierarchy.  Unlike the
+	 * BoundingBoxTree class, no space is ever divided, so no shape ever straddles
+	 * a boundary, and every shape sits in a leaf.  A node's box is simply the
+	 * smallest box containing the boxes of its two children.
+	 *
+	 * Each shape is inserted next to whatever node of the tree it would add the
+	 * least surface area to, this being a good measure of how likely a random
+	 * query is to have to visit the new parent node.  On the way back up to the
+	 * root, nodes are rotated wherever doing so shrinks the tree, which keeps the
+	 * tree in good shape as shapes come and go in whatever order.
+	 *
+	 * Once a shape starts moving, its leaf is given a box a bit bigger than the shape,
+	 * stretched in the direction the shape is moving.  So long as the shape stays inside
+	 * this fat box, moving it takes no work at all.  Otherwise, only its leaf is taken
+	 * out of the tree and put back in; the rest of the tree is left alone.  Shapes outside
+	 * the collision world are tracked, but not put into the tree, just as they are with
+	 * the BoundingBoxTree class.
+	 */
+	class IMZADI_API DynamicBoundingBoxTree : public BroadPhase
+	{
+	public:
+		DynamicBoundingBoxTree(const AxisAlignedBoundingBox& collisionWorldExtents);
+		virtual ~DynamicBoundingBoxTree();
+
+		/**
+		 * Remove the shape having the given ID from this tree.
+		 */
+		virtual bool Remove(ShapeID shapeID) override;
+
+		/**
+		 * Remove all shapes from this tree and delete all nodes of the tree.
+		 */
+		virtual void Clear() override;
+
+	protected:
+
+		/**
+		 * Insert the given shape into this tree, or, if it's already in the tree and has
+		 * moved out of the fat box of its leaf, move its leaf to wherever its new fat box
+		 * best fits.  Shapes are never split in this kind of tree, so the
+		 * IMZADI_ADD_FLAG_ALLOW_SPLIT flag is ignored.
+		 *
+		 * @param[in] shape This is the shape to insert (or re-insert) into this tree.
+		 * @param[in] flags This is an OR-ing of flags of the form IMZADI_ADD_FLAG_*.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		virtual bool InsertDynamic(Shape* shape, uint32_t flags) override;
+
+		/**
+		 * Build a sub-tree from all the given shapes at once, and then graft it into this tree.
+		 * The shapes are sorted along a Z-order curve through the collision world, which puts
+		 * shapes near one another in space near one another in the sort, and the sorted run
+		 * is then cut recursively wherever the curve crosses the biggest cell boundary.  This
+		 * is far quicker than finding the best sibling of each shape one at a time.  Shapes
+		 * already in the tree are moving, and so are re-inserted one at a time.
+		 */
+		virtual void InsertManyDynamic(std::vector<Shape*>& shapeArray, uint32_t flags) override;
+
+		/**
+		 * Draw the box of every node in the tree.
+		 */
+		virtual void DebugRenderDynamic(DebugRenderResult* renderResult) const override;
+
+		/**
+		 * Perform a ray-cast against all collision shapes within the tree.  Nodes are visited
+		 * nearest-first, and any node farther away than the nearest hit so far is skipped.
+		 */
+		virtual void RayCastDynamic(const Ray& ray, RayCastResult::HitData& hitData) const override;
+
+		/**
+		 * Determine the collision status of the given shape by visiting only those
+		 * nodes of the tree whose boxes overlap that of the shape.
+		 */
+		virtual void CalculateDynamicCollision(const Shape* shape, CollisionQueryResult* collisionResult) const override;
+
+		/**
+		 * Account for every node of the tree in the given diagnostics.  Every shape is in a leaf,
+		 * and no node is ever empty.  Rotations keep this tree in shape as it changes, so it has
+		 * no need to override the RebuildIfDegraded method.
+		 */
+		virtual void GatherDynamicDiagnostics(TreeDiagnosticsResult::Diagnostics& diagnostics) const override;
+
+	private:
+
+		/**
+		 * This is what we need to know about each shape while building a sub-tree from many shapes at once.
+		 */
+		struct BuildEntry
+		{
+			uint64_t mortonCode;					///< This is where the center of the shape's box falls along a Z-order curve through the collision world.
+			Shape* shape;
+		};
+
+		/**
+		 * Calculate the given point's place along a Z-order curve through the collision world, this
+		 * being the interleaving of the bits of the point's coordinates, 21 bits per coordinate.
+		 */
+		uint64_t CalculateMortonCode(const Vector3& point) const;
+
+		/**
+		 * Make a sub-tree of the shapes of the given run of build entries, which are sorted by Morton code.
+		 *
+		 * @return The root of the new sub-tree is returned.  Its parent is left null.
+		 */
+		DynamicBoundingBoxNode* BuildSubtree(const std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries);
+
+		/**
+		 * Calculate the box to give the leaf of the given shape now that it has moved.
+		 * This is the shape's box, padded by IMZADI_FAT_BOX_MARGIN, and stretched along
+		 * the shape's most recent change of position by IMZADI_FAT_BOX_MOTION_FACTOR.
+		 */
+		static void CalculateFatBox(const Shape* shape, AxisAlignedBoundingBox& fatBox);
+
+		/**
+		 * Put the given leaf into the tree as the sibling of the node it adds the least surface area to.
+		 * The given node may also be the root of a whole sub-tree, which is grafted in the same way.
+		 */
+		void InsertLeaf(DynamicBoundingBoxNode* leafNode);
+
+		/**
+		 * Take the given leaf out of the tree.  Its parent node is deleted and its sibling takes the parent's place.
+		 */
+		void RemoveLeaf(DynamicBoundingBoxNode* leafNode);
+
+		/**
+		 * Find the node that, if made a sibling of a leaf with the given box, would
+		 * grow the total surface area of the tree the least.  This is a branch-and-bound
+		 * search, so whole sub-trees are ruled out once they can't possibly do better.
+		 */
+		DynamicBoundingBoxNode* FindBestSibling(const AxisAlignedBoundingBox& box) const;
+
+		/**
+		 * Starting at the given node, walk up to the root, refitting and rotating each node along the way.
+		 */
+		void RefitAncestors(DynamicBoundingBoxNode* node);
+
+		/**
+		 * Swap a child of the given node with a grand-child of the given node if that shrinks
+		 * the child that would gain the grand-child more than any other such swap would.
+		 */
+		void Rotate(DynamicBoundingBoxNode* node);
+
+		DynamicBoundingBoxNode* rootNode;		///< This is null when the tree is empty, and is a leaf when the tree has one shape.
+	};
+
+	/**
+	 * Instances of this class form the nodes of the DynamicBoundingBoxTree class.
+	 * A node either has two children or a shape, never both.
+	 */
+	class IMZADI_API DynamicBoundingBoxNode
+	{
+		friend class DynamicBoundingBoxTree;
+		friend class CollisionHeap;
+
+	private:
+		DynamicBoundingBoxNode();
+		virtual ~DynamicBoundingBoxNode();
+
+		/**
+		 * Tell the caller if this node holds a shape rather than children.
+		 */
+		bool IsLeaf() const { return this->shape != nullptr; }
+
+		/**
+		 * Make this node's box the smallest one containing the boxes of its children.
+		 */
+		void Refit();
+
+		/**
+		 * Render this node's box, and those of all its descendants, as simple wire-frame boxes.
+		 */
+		void DebugRender(DebugRenderResult* renderResult) const;
+
+	private:
+		AxisAlignedBoundingBox box;						///< For a leaf, this contains the box of its shape, and may be fat; otherwise, it contains the boxes of both children.
+		DynamicBoundingBoxNode* parentNode;				///< This is null for the root node.
+		DynamicBoundingBoxNode* childNode[2];			///< These are null for a leaf.
+		Shape* shape;									///< This is null for any node that isn't a leaf.
+	};
+}
\ No newline at end of file
@@ -1,7 +1,8 @@
 #include "Query.h"
 #include "Result.h"
+#include "Command.h"
 #include "Thread.h"
-#include "BoundingBoxTree.h"
+#include "BroadPhase.h"
 #include "Log.h"
 #include <format>
 
@@ -11,6 +12,8 @@ using namespace Imzadi;
 
 Query::Query()
 {
+	this->priority = Priority::NORMAL;
+	this->deadline = std::chrono::steady_clock::time_point::max();
 }
 
 /*virtual*/ Query::~Query()
@@ -24,6 +27,44 @@ Query::Query()
 		thread->StoreResult(result, this->GetTaskID());
 }
 
+/*virtual*/ bool Query::IsReadOnly() const
+{
+	return true;
+}
+
+/*virtual*/ bool Query::DependsOn(const Command* command, Thread* thread) const
+{
+	return true;
+}
+
+bool Query::IsOverdue() const
+{
+	if (this->priority != Priority::LOW || this->deadline == std::chrono::steady_clock::time_point::max())
+		return false;
+
+	return std::chrono::steady_clock::now() > this->deadline;
+}
+
+//--------------------------------- QueryBatch ---------------------------------
+
+QueryBatch::QueryBatch()
+{
+}
+
+/*virtual*/ QueryBatch::~QueryBatch()
+{
+}
+
+void QueryBatch::Add(Query* query)
+{
+	this->AddTask(query);
+}
+
+/*static*/ QueryBatch* QueryBatch::Create()
+{
+	return new QueryBatch();
+}
+
 //--------------------------------- ShapeQuery ---------------------------------
 
 ShapeQuery::ShapeQuery()
@@ -35,6 +76,11 @@ ShapeQuery::ShapeQuery()
 {
 }
 
+/*virtual*/ bool ShapeQuery::DependsOn(const Command* command, Thread* thread) const
+{
+	return command->AffectsShape(this->shapeID);
+}
+
 //--------------------------------- DebugRenderQuery ---------------------------------
 
 DebugRenderQuery::DebugRenderQuery()
@@ -70,9 +116,9 @@ RayCastQuery::RayCastQuery()
 
 /*virtual*/ Result* RayCastQuery::ExecuteQuery(Thread* thread)
 {
-	const BoundingBoxTree& boxTree = thread->GetBoundingBoxTree();
+	const BroadPhase& broadPhase = thread->GetBroadPhase();
 	RayCastResult* result = RayCastResult::Create();
-	boxTree.RayCast(this->GetRay(), result);
+	broadPhase.RayCast(this->GetRay(), result);
 	return result;
 }
 
@@ -133,8 +179,8 @@ CollisionQuery::CollisionQuery()
 	collisionResult->SetShapeID(shape->GetShapeID());
 	collisionResult->SetObjectToWorldTransform(shape->GetObjectToWorldTransform());
 
-	BoundingBoxTree& tree = thread->GetBoundingBoxTree();
-	if (!tree.CalculateCollision(shape, collisionResult))
+	BroadPhase& broadPhase = thread->GetBroadPhase();
+	if (!broadPhase.CalculateCollision(shape, collisionResult))
 	{
 		CollisionQueryResult::Free(collisionResult);
 
@@ -145,11 +191,73 @@ CollisionQuery::CollisionQuery()
 	return collisionResult;
 }
 
+/*virtual*/ bool CollisionQuery::DependsOn(const Command* command, Thread* thread) const
+{
+	if (ShapeQuery::DependsOn(command, thread))
+		return true;
+
+	// Being a command that only affects one other shape, it can only change our result if
+	// that shape is anywhere near ours, either before or after the command.
+	auto shapeCommand = dynamic_cast<const ShapeCommand*>(command);
+	if (!shapeCommand)
+		return true;
+
+	// If we can't see one of the shapes, we can't rule anything out.
+	const Shape* shape = thread->FindShape(this->shapeID);
+	const Shape* otherShape = thread->FindShape(shapeCommand->GetShapeID());
+	if (!shape || !otherShape)
+		return true;
+
+	AxisAlignedBoundingBox intersection;
+	if (intersection.Intersect(shape->GetBoundingBox(), otherShape->GetBoundingBox()))
+		return true;
+
+	auto objectToWorldCommand = dynamic_cast<const ObjectToWorldCommand*>(command);
+	if (!objectToWorldCommand)
+		return false;
+
+	// The command could be moving the other shape into our vicinity.  Rather than fit a box to
+	// the shape where it's going, we carry its present box along with it and fit a box to that.
+	// The box may be a bit loose under rotation, but that only ever errs on the side of waiting.
+	Transform relativeTransform = objectToWorldCommand->objectToWorld * otherShape->GetObjectToWorldTransform().Inverted();
+	std::vector<Vector3> vertexArray;
+	otherShape->GetBoundingBox().GetVertices(vertexArray);
+	for (Vector3& vertex : vertexArray)
+		vertex = relativeTransform.TransformPoint(vertex);
+
+	AxisAlignedBoundingBox movedBoundingBox;
+	movedBoundingBox.SetToBoundPointCloud(vertexArray);
+	return intersection.Intersect(shape->GetBoundingBox(), movedBoundingBox);
+}
+
 /*static*/ CollisionQuery* CollisionQuery::Create()
 {
 	return new CollisionQuery();
 }
 
+//--------------------------------- AllPairsQuery ---------------------------------
+
+AllPairsQuery::AllPairsQuery()
+{
+}
+
+/*virtual*/ AllPairsQuery::~AllPairsQuery()
+{
+}
+
+/*virtual*/ Result* AllPairsQuery::ExecuteQuery(Thread* thread)
+{
+	const BroadPhase& broadPhase = thread->GetBroadPhase();
+	auto allPairsResult = AllPairsResult::Create();
+	broadPhase.CalculateAllCollisions(allPairsResult);
+	return allPairsResult;
+}
+
+/*static*/ AllPairsQuery* AllPairsQuery::Create()
+{
+	return new AllPairsQuery();
+}
+
 //--------------------------------- ShapeInBoundsQuery ---------------------------------
 
 ShapeInBoundsQuery::ShapeInBoundsQuery()
@@ -165,8 +273,8 @@ ShapeInBoundsQuery::ShapeInBoundsQuery()
 	BoolResult* result = BoolResult::Create();
 	result->SetAnswer(false);
 
-	BoundingBoxTree& tree = thread->GetBoundingBoxTree();
-	Shape* shape = tree.FindShape(this->GetShapeID());
+	BroadPhase& broadPhase = thread->GetBroadPhase();
+	Shape* shape = broadPhase.FindShape(this->GetShapeID());
 	if (shape && shape->IsBound())
 		result->SetAnswer(true);
 
@@ -176,4 +284,50 @@ ShapeInBoundsQuery::ShapeInBoundsQuery()
 /*static*/ ShapeInBoundsQuery* ShapeInBoundsQuery::Create()
 {
 	return new ShapeInBoundsQuery();
+}
+
+//--------------------------------- StatisticsQuery ---------------------------------
+
+StatisticsQuery::StatisticsQuery()
+{
+	this->resetCounters = false;
+}
+
+/*virtual*/ StatisticsQuery::~StatisticsQuery()
+{
+}
+
+/*virtual*/ Result* StatisticsQuery::ExecuteQuery(Thread* thread)
+{
+	auto statisticsResult = StatisticsResult::Create();
+	thread->TakeStatisticsSnapshot(statisticsResult->GetSnapshot(), this->resetCounters);
+	return statisticsResult;
+}
+
+/*static*/ StatisticsQuery* StatisticsQuery::Create()
+{
+	return new StatisticsQuery();
+}
+
+//--------------------------------- TreeDiagnosticsQuery ---------------------------------
+
+TreeDiagnosticsQuery::TreeDiagnosticsQuery()
+{
+}
+
+/*virtual*/ TreeDiagnosticsQuery::~TreeDiagnosticsQuery()
+{
+}
+
+/*virtual*/ Result* TreeDiagnosticsQuery::ExecuteQuery(Thread* thread)
+{
+	const BroadPhase& broadPhase = thread->GetBroadPhase();
+	auto diagnosticsResult = TreeDiagnosticsResult::Create();
+	broadPhase.GatherDiagnostics(diagnosticsResult);
+	return diagnosticsResult;
+}
+
+/*static*/ TreeDiagnosticsQuery* TreeDiagnosticsQuery::Create()
+{
+	return new TreeDiagnosticsQuery();
 }
\ No newline at end of file
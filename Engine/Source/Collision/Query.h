@@ -4,10 +4,12 @@
 #include "Math/Ray.h"
 #include "Shape.h"
 #include <stdint.h>
+#include <chrono>
 
 namespace Imzadi
 {
 	class Result;
+	class Command;
 
 	/**
 	 * This class and its derivatives are the means by which the collision system
@@ -17,6 +19,9 @@ namespace Imzadi
 	 * checking, for every shape, if it is (or is not) in collision with every other
 	 * shape of the system.  It is up to the user to tell _us_ what shapes it cares
 	 * about by querying for collision results involving those desired shapes.
+	 * 
+	 * Queries are normally executed in the order they were made with respect to
+	 * commands and other queries, but see the SetPriority and SetDeadline methods.
 	 */
 	class IMZADI_API Query : public Task
 	{
@@ -26,7 +31,90 @@ namespace Imzadi
 
 		virtual void Execute(Thread* thread) override;
 
+		/**
+		 * Queries never change the collision world, so they can be executed in parallel.
+		 * Note that this means overrides of ExecuteQuery must be thread-safe.
+		 */
+		virtual bool IsReadOnly() const override;
+
 		virtual Result* ExecuteQuery(Thread* thread) = 0;
+
+		/**
+		 * Tell the caller if the result of this query could be changed by the given command.
+		 * A high-priority query is never moved ahead of a command it depends on.  By default,
+		 * a query depends on every command, since it may look at the entire collision world.
+		 * This is called on the collision thread.
+		 * 
+		 * @param[in] command This is a command that was issued before this query.
+		 * @param[in] thread This is the collision thread, which can be used to look at the collision world as it is now.
+		 */
+		virtual bool DependsOn(const Command* command, Thread* thread) const;
+
+		enum Priority
+		{
+			HIGH,		///< The query is moved ahead of any other work it does not depend on, but not ahead of other high-priority queries.
+			NORMAL,		///< The query is executed in order.  This is the default.
+			LOW			///< The query is executed in order, but may be deferred if it has a deadline.  See the SetDeadline method.
+		};
+
+		/**
+		 * Set the priority class of this query.  A latency-critical query, such as one made
+		 * for the player's character, should be given high priority so that it doesn't get
+		 * stuck behind bulk work.  Note that, while such a query is never moved ahead of a command
+		 * it depends on (see the DependsOn method), it may see shapes that are not in its vicinity
+		 * as they were a few commands ago.
+		 */
+		void SetPriority(Priority priority) { this->priority = priority; }
+
+		/**
+		 * Get the priority class of this query.
+		 */
+		Priority GetPriority() const { return this->priority; }
+
+		/**
+		 * Set the time by which the collision thread should get to this query.  If a low-priority
+		 * query misses its deadline, then rather than hold up the work behind it, the query is set
+		 * aside until the collision thread has nothing else to do.  Such a query is no longer waited
+		 * on by a flush, but can still be waited on directly.  Deadlines are ignored for queries
+		 * that are not low-priority.
+		 */
+		void SetDeadline(std::chrono::steady_clock::time_point deadline) { this->deadline = deadline; }
+
+		/**
+		 * Remove this query's deadline, if any.
+		 */
+		void ClearDeadline() { this->deadline = std::chrono::steady_clock::time_point::max(); }
+
+		/**
+		 * Tell the caller if this query is low-priority and has missed its deadline.
+		 */
+		bool IsOverdue() const;
+
+	private:
+		Priority priority;
+		std::chrono::steady_clock::time_point deadline;
+	};
+
+	/**
+	 * This is a batch of queries that is made all at once.  See the TaskBatch class.
+	 * The results of the batched queries can be collected together using the range
+	 * of task IDs handed out when the batch is made.
+	 */
+	class IMZADI_API QueryBatch : public TaskBatch
+	{
+	public:
+		QueryBatch();
+		virtual ~QueryBatch();
+
+		/**
+		 * Add the given query to the end of this batch.  The batch takes ownership of the memory.
+		 */
+		void Add(Query* query);
+
+		/**
+		 * Allocate and return a new instance of the QueryBatch class.
+		 */
+		static QueryBatch* Create();
 	};
 
 	/**
@@ -48,6 +136,11 @@ namespace Imzadi
 		 */
 		ShapeID GetShapeID() const { return this->shapeID; }
 
+		/**
+		 * A shape query only depends on commands that affect its shape.
+		 */
+		virtual bool DependsOn(const Command* command, Thread* thread) const override;
+
 	protected:
 		ShapeID shapeID;
 	};
@@ -181,12 +274,45 @@ namespace Imzadi
 		 */
 		virtual Result* ExecuteQuery(Thread* thread) override;
 
+		/**
+		 * A collision query also depends on commands that affect shapes presently overlapping its shape,
+		 * and on commands that move other shapes to where they would overlap it.
+		 */
+		virtual bool DependsOn(const Command* command, Thread* thread) const override;
+
 		/**
 		 * Create an instance of the CollisionQuery class.
 		 */
 		static CollisionQuery* Create();
 	};
 
+	/**
+	 * Use this query to find every pair of moving shapes in collision with one another, all at
+	 * once.  This is much faster than making a CollisionQuery for every shape, because rather than
+	 * search the broad-phase once per shape, the boxes of all moving shapes are swept across
+	 * together, and the order they were swept in last time is reused.  See the SweepAndPrune class.
+	 * Only shapes inside the collision world are considered, and static shapes are left out, as
+	 * they never collide with one another.  A CollisionQuery is still the way to find out what
+	 * static shapes a moving shape is in collision with.  An AllPairsResult class instance is
+	 * returned by this query.
+	 */
+	class IMZADI_API AllPairsQuery : public Query
+	{
+	public:
+		AllPairsQuery();
+		virtual ~AllPairsQuery();
+
+		/**
+		 * Find and collect all collision pairs among the moving shapes.
+		 */
+		virtual Result* ExecuteQuery(Thread* thread) override;
+
+		/**
+		 * Create an instance of the AllPairsQuery class.
+		 */
+		static AllPairsQuery* Create();
+	};
+
 	/**
 	 * Use this query to find out if a given shape is still within
 	 * the bounds of the collision world.  If it's not, then it will
@@ -209,4 +335,63 @@ namespace Imzadi
 		 */
 		static ShapeInBoundsQuery* Create();
 	};
+
+	/**
+	 * Use this query to see what the collision system has been up to.  A StatisticsResult
+	 * class instance is returned by this query.  The statistics are kept all the time, so
+	 * this query can be made as often as desired, even in production.  If the counters are
+	 * reset with each query, then each result tells what happened since the last one,
+	 * such as over the course of the last frame.
+	 */
+	class IMZADI_API StatisticsQuery : public Query
+	{
+	public:
+		StatisticsQuery();
+		virtual ~StatisticsQuery();
+
+		/**
+		 * Take a snapshot of the statistics.
+		 */
+		virtual Result* ExecuteQuery(Thread* thread) override;
+
+		/**
+		 * Say whether the statistics should be set back to zero once they're taken.  By default, they aren't.
+		 */
+		void SetResetCounters(bool resetCounters) { this->resetCounters = resetCounters; }
+
+		/**
+		 * Tell the caller if the statistics are set back to zero once they're taken.
+		 */
+		bool GetResetCounters() const { return this->resetCounters; }
+
+		/**
+		 * Create an instance of the StatisticsQuery class.
+		 */
+		static StatisticsQuery* Create();
+
+	private:
+		bool resetCounters;
+	};
+
+	/**
+	 * Use this query to see how well the broad-phase is sorting the shapes of the collision
+	 * world.  A TreeDiagnosticsResult class instance is returned by this query.  It walks the
+	 * whole tree, so it's meant for tuning and debugging, not to be made every frame.
+	 */
+	class IMZADI_API TreeDiagnosticsQuery : public Query
+	{
+	public:
+		TreeDiagnosticsQuery();
+		virtual ~TreeDiagnosticsQuery();
+
+		/**
+		 * Measure the broad-phase's tree.
+		 */
+		virtual Result* ExecuteQuery(Thread* thread) override;
+
+		/**
+		 * Create an instance of the TreeDiagnosticsQuery class.
+		 */
+		static TreeDiagnosticsQuery* Create();
+	};
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "Result.h"
+#include "CollisionHeap.h"
 #include "CollisionCache.h"
 #include "Math/AxisAlignedBoundingBox.h"
+#include <algorithm>
 
 using namespace Imzadi;
 
@@ -19,6 +21,16 @@ Result::Result()
 	delete result;
 }
 
+/*static*/ void* Result::operator new(size_t size)
+{
+	return CollisionHeap::Get()->Allocate(size);
+}
+
+/*static*/ void Result::operator delete(void* memory, size_t size)
+{
+	CollisionHeap::Get()->Deallocate(memory, size);
+}
+
 //-------------------------------- BoolResult --------------------------------
 
 BoolResult::BoolResult()
@@ -153,13 +165,16 @@ void ObjectToWorldResult::SetTransforms(const Transform& objectToWorld, const Tr
 
 CollisionQueryResult::CollisionQueryResult()
 {
-	this->collisionStatusArray = new std::vector<ShapePairCollisionStatus*>();
+	this->collisionStatusArray = CollisionHeap::Get()->New<CollisionStatusArray>();
 	this->shapeID = 0;
 }
 
 /*virtual*/ CollisionQueryResult::~CollisionQueryResult()
 {
-	delete this->collisionStatusArray;
+	for (ShapePairCollisionStatus* collisionStatus : *this->collisionStatusArray)
+		collisionStatus->RemoveResultReference();
+
+	CollisionHeap::Get()->Delete(this->collisionStatusArray);
 }
 
 /*static*/ CollisionQueryResult* CollisionQueryResult::Create()
@@ -169,6 +184,23 @@ CollisionQueryResult::CollisionQueryResult()
 
 void CollisionQueryResult::AddCollisionStatus(ShapePairCollisionStatus* collisionStatus)
 {
+	for (ShapePairCollisionStatus*& existingStatus : *this->collisionStatusArray)
+	{
+		if (IMZADI_MIN(existingStatus->GetShapeID(0), existingStatus->GetShapeID(1)) == IMZADI_MIN(collisionStatus->GetShapeID(0), collisionStatus->GetShapeID(1)) &&
+			IMZADI_MAX(existingStatus->GetShapeID(0), existingStatus->GetShapeID(1)) == IMZADI_MAX(collisionStatus->GetShapeID(0), collisionStatus->GetShapeID(1)))
+		{
+			if (collisionStatus->GetSeparationDeltaLength() > existingStatus->GetSeparationDeltaLength())
+			{
+				collisionStatus->AddResultReference();
+				existingStatus->RemoveResultReference();
+				existingStatus = collisionStatus;
+			}
+
+			return;
+		}
+	}
+
+	collisionStatus->AddResultReference();
 	this->collisionStatusArray->push_back(collisionStatus);
 }
 
@@ -208,4 +240,94 @@ Vector3 CollisionQueryResult::GetAverageSeparationDelta(ShapeID shapeID) const
 	}
 
 	return averageSeparationDelta / IMZADI_MAX(count, 1.0);
+}
+
+//-------------------------------- AllPairsResult --------------------------------
+
+AllPairsResult::AllPairsResult()
+{
+	this->collisionStatusArray = CollisionHeap::Get()->New<CollisionQueryResult::CollisionStatusArray>();
+}
+
+/*virtual*/ AllPairsResult::~AllPairsResult()
+{
+	for (ShapePairCollisionStatus* collisionStatus : *this->collisionStatusArray)
+		collisionStatus->RemoveResultReference();
+
+	CollisionHeap::Get()->Delete(this->collisionStatusArray);
+}
+
+/*static*/ AllPairsResult* AllPairsResult::Create()
+{
+	return new AllPairsResult();
+}
+
+void AllPairsResult::AddCollisionStatus(ShapePairCollisionStatus* collisionStatus)
+{
+	collisionStatus->AddResultReference();
+	this->collisionStatusArray->push_back(collisionStatus);
+}
+
+void AllPairsResult::SortCollisionStatusArray()
+{
+	auto isBefore = [](const ShapePairCollisionStatus* statusA, const ShapePairCollisionStatus* statusB) -> bool
+	{
+		ShapeID minShapeIDA = IMZADI_MIN(statusA->GetShapeID(0), statusA->GetShapeID(1));
+		ShapeID minShapeIDB = IMZADI_MIN(statusB->GetShapeID(0), statusB->GetShapeID(1));
+		if (minShapeIDA != minShapeIDB)
+			return minShapeIDA < minShapeIDB;
+
+		return IMZADI_MAX(statusA->GetShapeID(0), statusA->GetShapeID(1)) < IMZADI_MAX(statusB->GetShapeID(0), statusB->GetShapeID(1));
+	};
+
+	std::sort(this->collisionStatusArray->begin(), this->collisionStatusArray->end(), isBefore);
+
+	// Statuses between the same two shapes are now next to one another.
+	uint32_t numKept = 0;
+	for (ShapePairCollisionStatus* collisionStatus : *this->collisionStatusArray)
+	{
+		if (numKept > 0 && !isBefore((*this->collisionStatusArray)[numKept - 1], collisionStatus))
+		{
+			ShapePairCollisionStatus*& existingStatus = (*this->collisionStatusArray)[numKept - 1];
+			if (collisionStatus->GetSeparationDeltaLength() > existingStatus->GetSeparationDeltaLength())
+				std::swap(existingStatus, collisionStatus);
+
+			collisionStatus->RemoveResultReference();
+		}
+		else
+			(*this->collisionStatusArray)[numKept++] = collisionStatus;
+	}
+
+	this->collisionStatusArray->resize(numKept);
+}
+
+//-------------------------------- StatisticsResult --------------------------------
+
+StatisticsResult::StatisticsResult()
+{
+}
+
+/*virtual*/ StatisticsResult::~StatisticsResult()
+{
+}
+
+/*static*/ StatisticsResult* StatisticsResult::Create()
+{
+	return new StatisticsResult();
+}
+
+//-------------------------------- TreeDiagnosticsResult --------------------------------
+
+TreeDiagnosticsResult::TreeDiagnosticsResult()
+{
+	this->diagnostics = {};
+}
+
+/*virtual*/ TreeDiagnosticsResult::~TreeDiagnosticsResult()
+{
+}
+
+/*static*/ TreeDiagnosticsResult* TreeDiagnosticsResult::Create()
+{
+	return new TreeDiagnosticsResult();
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Defines.h"
+#include "CollisionHeap.h"
 #include "Shape.h"
+#include "CollisionStatistics.h"
 #include "Math/LineSegment.h"
 #include "Math/Transform.h"
 #include <vector>
@@ -35,6 +37,17 @@ namespace Imzadi
 		 * @param result This is the result who's memory is to be reclaimed.
 		 */
 		static void Free(Result* result);
+
+		/**
+		 * Results are allocated from the collision heap rather than the system heap.
+		 * See the CollisionHeap class.
+		 */
+		static void* operator new(size_t size);
+
+		/**
+		 * Give the memory of a result back to the collision heap.
+		 */
+		static void operator delete(void* memory, size_t size);
 	};
 
 	/**
@@ -183,11 +196,14 @@ namespace Imzadi
 	/**
 	 * Instances of this class are results of collision queries, and simply consist
 	 * of a set of collision pairs.  See the ShapePairCollisionStatus class for
-	 * more information.
+	 * more information.  The pairs belong to the collision cache, but the cache
+	 * won't free any of them for as long as the result holds them.
 	 */
 	class IMZADI_API CollisionQueryResult : public Result
 	{
 	public:
+		typedef std::vector<ShapePairCollisionStatus*, CollisionHeapAllocator<ShapePairCollisionStatus*>> CollisionStatusArray;
+
 		CollisionQueryResult();
 		virtual ~CollisionQueryResult();
 
@@ -197,7 +213,10 @@ namespace Imzadi
 		static CollisionQueryResult* Create();
 
 		/**
-		 * This is used internally to populate the query result.
+		 * This is used internally to populate the query result.  The pieces of a split shape
+		 * all go by the ID of the shape they came from, so if the queried shape collides with
+		 * more than one of them, only the most egregious collision is kept.  This way the
+		 * result is the same as it would have been had the shape not been split.
 		 */
 		void AddCollisionStatus(ShapePairCollisionStatus* collisionStatus);
 
@@ -206,7 +225,7 @@ namespace Imzadi
 		 * Each pair will be a valid collision pair between two shapes, one of
 		 * which is the shape specified in the original collision query.
 		 */
-		const std::vector<ShapePairCollisionStatus*>& GetCollisionStatusArray() const { return *this->collisionStatusArray; }
+		const CollisionStatusArray& GetCollisionStatusArray() const { return *this->collisionStatusArray; }
 
 		/**
 		 * This is used internally to set the ID of the shape in question.
@@ -244,8 +263,123 @@ namespace Imzadi
 		Vector3 GetAverageSeparationDelta(ShapeID shapeID) const;
 
 	private:
-		std::vector<ShapePairCollisionStatus*>* collisionStatusArray;	///< This is the set of collisions involving the collision query's shape.
+		CollisionStatusArray* collisionStatusArray;	///< This is the set of collisions involving the collision query's shape.
 		ShapeID shapeID;			///< For convenience, this holds the ID of the shape in question that was the subject of the collision query.
 		Transform objectToWorld;	///< For convenience, this is the object-to-world transform of the shape in question at the time of query.
 	};
+
+	/**
+	 * Instances of this class are results of the AllPairsQuery class, and consist of every
+	 * pair of moving shapes found to be in collision with one another, each pair given once.
+	 */
+	class IMZADI_API AllPairsResult : public Result
+	{
+	public:
+		AllPairsResult();
+		virtual ~AllPairsResult();
+
+		/**
+		 * Allocate and return a new instance of the AllPairsResult class.
+		 */
+		static AllPairsResult* Create();
+
+		/**
+		 * This is used internally to populate the query result.
+		 */
+		void AddCollisionStatus(ShapePairCollisionStatus* collisionStatus);
+
+		/**
+		 * This is used internally once all collision statuses have been added.  The statuses are
+		 * sorted by the IDs of their shapes, and where the pieces of split shapes made for more than
+		 * one status between the same two shapes, only the most egregious collision is kept.
+		 * See the CollisionQueryResult::AddCollisionStatus method.
+		 */
+		void SortCollisionStatusArray();
+
+		/**
+		 * Get this result's set of ShapePairCollisionStatus class instances.  They are in
+		 * order of the lesser shape ID of each pair, and then of the greater shape ID.
+		 */
+		const CollisionQueryResult::CollisionStatusArray& GetCollisionStatusArray() const { return *this->collisionStatusArray; }
+
+	private:
+		CollisionQueryResult::CollisionStatusArray* collisionStatusArray;	///< This is the set of all collisions between moving shapes.
+	};
+
+	/**
+	 * Instances of this class are results of the StatisticsQuery class, and simply
+	 * hold a snapshot of the collision system's statistics.
+	 */
+	class IMZADI_API StatisticsResult : public Result
+	{
+	public:
+		StatisticsResult();
+		virtual ~StatisticsResult();
+
+		/**
+		 * Allocate and return a new instance of the StatisticsResult class.
+		 */
+		static StatisticsResult* Create();
+
+		/**
+		 * Get the statistics as they were at the time of the query.
+		 */
+		const CollisionStatistics::Snapshot& GetSnapshot() const { return this->snapshot; }
+
+		/**
+		 * This is used internally to populate the query result.
+		 */
+		CollisionStatistics::Snapshot& GetSnapshot() { return this->snapshot; }
+
+	private:
+		CollisionStatistics::Snapshot snapshot;
+	};
+
+	/**
+	 * Instances of this class are results of the TreeDiagnosticsQuery class, and describe
+	 * how well the broad-phase's tree of moving shapes fits the shapes in it at the moment.
+	 */
+	class IMZADI_API TreeDiagnosticsResult : public Result
+	{
+	public:
+		TreeDiagnosticsResult();
+		virtual ~TreeDiagnosticsResult();
+
+		/**
+		 * This is everything measured about the tree.  Depth zero is the root.
+		 */
+		struct Diagnostics
+		{
+			uint32_t numNodes;														///< This is the number of nodes in the tree.
+			uint32_t numLeafNodes;													///< This is the number of nodes without children.
+			uint32_t numEmptyNodes;													///< This is the number of nodes with no shapes in or beneath them, which searches skip, but which take up memory.
+			uint32_t maxDepth;														///< This is the depth of the deepest node.
+			uint32_t numNodesAtDepth[IMZADI_TREE_DIAGNOSTICS_MAX_DEPTH];			///< This is how many nodes there are at each depth, the last entry counting everything deeper too.
+			uint32_t numShapesAtDepth[IMZADI_TREE_DIAGNOSTICS_MAX_DEPTH];			///< This is how many shapes sit in nodes at each depth, the last entry counting everything deeper too.
+			uint32_t numShapesInLeafNodes;											///< This is the number of shapes sitting in nodes without children.
+			uint32_t numShapesInInteriorNodes;										///< This is the number of shapes sitting in nodes with children, because they straddle where the node is divided.
+			uint32_t maxShapesPerNode;												///< This is the most shapes sitting in any one node.
+			uint32_t numShapesOutsideTree;											///< This is the number of shapes outside the collision world, and so not in the tree.
+			uint32_t numStaticShapes;												///< This is the number of shapes kept apart in the static tree, and so not counted above.
+			double estimatedTraversalCost;											///< This is the expected number of nodes visited plus shapes tested by a ray through the collision world.
+		};
+
+		/**
+		 * Allocate and return a new instance of the TreeDiagnosticsResult class.
+		 */
+		static TreeDiagnosticsResult* Create();
+
+		/**
+		 * Get the diagnostics as they were at the time of the query.
+		 */
+		const Diagnostics& GetDiagnostics() const { return this->diagnostics; }
+
+		/**
+		 * This is used internally to populate the query result.
+		 */
+		Diagnostics& GetDiagnostics() { return this->diagnostics; }
+
+	private:
+		Diagnostics diagnostics;
+	};
 }
\ No newline at end of file
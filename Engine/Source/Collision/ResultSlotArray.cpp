@@ -0,0 +1,140 @@
+#include "ResultSlotArray.h"
+#include "Result.h"
+#include <thread>
+
+using namespace Imzadi;
+
+ResultSlotArray::ResultSlotArray(uint32_t capacity)
+{
+	this->capacity = 2;
+	while (this->capacity < capacity)
+		this->capacity <<= 1;
+
+	this->mask = this->capacity - 1;
+	this->slotArray = new Slot[this->capacity];
+	for (uint32_t i = 0; i < this->capacity; i++)
+	{
+		// Start each slot out as if a task from the previous lap around the ring had finished with it.
+		this->slotArray[i].word.store(MakeWord(i - this->capacity, State::DONE), std::memory_order_relaxed);
+		this->slotArray[i].result.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+/*virtual*/ ResultSlotArray::~ResultSlotArray()
+{
+	this->Clear();
+
+	delete[] this->slotArray;
+}
+
+void ResultSlotArray::Claim(TaskID taskID)
+{
+	Slot* slot = this->GetSlot(taskID);
+	uint64_t newWord = MakeWord(taskID, State::PENDING);
+	uint64_t oldWord = slot->word.load(std::memory_order_acquire);
+
+	while (true)
+	{
+		// The previous claimant has yet to finish, or a result is being put into the slot by it.
+		// Taking the slot from it now would have it thought finished by anyone polling it.
+		if (!IsVacantWord(oldWord))
+		{
+			std::this_thread::yield();
+			oldWord = slot->word.load(std::memory_order_acquire);
+			continue;
+		}
+
+		if (slot->word.compare_exchange_weak(oldWord, newWord, std::memory_order_seq_cst, std::memory_order_acquire))
+			break;
+	}
+
+	// Nobody can touch the previous claimant's result now, so it's ours to reclaim.
+	if (GetWordState(oldWord) == State::READY)
+		Result::Free(slot->result.exchange(nullptr, std::memory_order_relaxed));
+}
+
+void ResultSlotArray::Store(TaskID taskID, Result* result)
+{
+	Slot* slot = this->GetSlot(taskID);
+	uint64_t oldWord = MakeWord(taskID, State::PENDING);
+
+	while (!slot->word.compare_exchange_weak(oldWord, MakeWord(taskID, State::WRITING), std::memory_order_acq_rel, std::memory_order_acquire))
+	{
+		if (GetWordTaskID(oldWord) != taskID || (GetWordState(oldWord) != State::PENDING && GetWordState(oldWord) != State::READY))
+		{
+			// The slot has moved on without us.  Nobody is going to collect this result.
+			Result::Free(result);
+			return;
+		}
+	}
+
+	Result* oldResult = slot->result.exchange(result, std::memory_order_relaxed);
+	if (GetWordState(oldWord) == State::READY)
+		Result::Free(oldResult);
+
+	slot->word.store(MakeWord(taskID, State::READY), std::memory_order_seq_cst);
+}
+
+void ResultSlotArray::Finish(TaskID taskID)
+{
+	Slot* slot = this->GetSlot(taskID);
+	uint64_t oldWord = MakeWord(taskID, State::PENDING);
+	slot->word.compare_exchange_strong(oldWord, MakeWord(taskID, State::DONE), std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+Result* ResultSlotArray::Collect(TaskID taskID)
+{
+	Slot* slot = this->GetSlot(taskID);
+	uint64_t oldWord = MakeWord(taskID, State::READY);
+	if (slot->word.load(std::memory_order_acquire) != oldWord)
+		return nullptr;
+
+	// Read the result before the CAS.  Once the slot leaves the READY state, it may be reclaimed.
+	Result* result = slot->result.load(std::memory_order_relaxed);
+	if (!slot->word.compare_exchange_strong(oldWord, MakeWord(taskID, State::DONE), std::memory_order_acq_rel, std::memory_order_relaxed))
+		return nullptr;
+
+	return result;
+}
+
+bool ResultSlotArray::IsVacant(TaskID taskID) const
+{
+	// This is sequentially consistent for the same reason the IsFinished method is.
+	return IsVacantWord(this->GetSlot(taskID)->word.load(std::memory_order_seq_cst));
+}
+
+bool ResultSlotArray::IsFinished(TaskID taskID) const
+{
+	// This is sequentially consistent so that threads announcing they're about to assist until
+	// a task finishes, and then checking it, don't miss the collision thread looking for them.
+	return IsFinishedWord(this->GetSlot(taskID)->word.load(std::memory_order_seq_cst), taskID);
+}
+
+/*static*/ bool ResultSlotArray::IsFinishedWord(uint64_t word, TaskID taskID)
+{
+	if (GetWordTaskID(word) != taskID)
+		return true;
+
+	State state = GetWordState(word);
+	return state == State::READY || state == State::DONE;
+}
+
+/*static*/ bool ResultSlotArray::IsVacantWord(uint64_t word)
+{
+	State state = GetWordState(word);
+	return state == State::READY || state == State::DONE;
+}
+
+void ResultSlotArray::Clear()
+{
+	for (uint32_t i = 0; i < this->capacity; i++)
+	{
+		Slot* slot = &this->slotArray[i];
+		uint64_t oldWord = slot->word.load(std::memory_order_acquire);
+		if (GetWordState(oldWord) == State::READY)
+		{
+			TaskID taskID = GetWordTaskID(oldWord);
+			Result::Free(this->Collect(taskID));
+		}
+	}
+}
\ No newline at end of file
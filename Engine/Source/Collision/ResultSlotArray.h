@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Defines.h"
+#include "Task.h"
+#include <stdint.h>
+#include <atomic>
+
+namespace Imzadi
+{
+	class Result;
+
+	/**
+	 * This is where the results of tasks are handed from the threads that execute them
+	 * to the threads that collect them.  It is a fixed-size ring of slots indexed by task ID,
+	 * so finding the slot of a task is O(1), and there is no lock shared between slots.
+	 *
+	 * A slot is claimed for a task when the task is sent.  The thread that executes the task
+	 * then fills the slot, and the caller polls it using the task ID.
+	 * Each slot keeps the ID of the task it belongs to along with that task's state in a
+	 * single atomic word, and every hand-off is a CAS on that word.
+	 *
+	 * Since the ring wraps around, a slot is claimed again by the task whose ID is the
+	 * capacity of the ring more than that of the previous claimant.  Any result the previous
+	 * claimant left uncollected is freed at that time, so results nobody asks for are not leaked.
+	 * This means that a task ID can only be used to collect a result until that many more
+	 * tasks have been sent.  A slot is never taken from a task that has yet to finish, though,
+	 * so no more tasks than the capacity of the ring can be unfinished at once.
+	 */
+	class IMZADI_API ResultSlotArray
+	{
+	public:
+		/**
+		 * @param[in] capacity This is the number of slots in the ring.  It gets rounded up to a power of two.
+		 */
+		ResultSlotArray(uint32_t capacity);
+		virtual ~ResultSlotArray();
+
+		/**
+		 * Claim the slot of the given task, freeing any result left in it by a previous claimant.
+		 * This must be called before the task is made visible to the threads that execute it.
+		 * If the previous claimant has yet to finish, this spins until it does, so the caller
+		 * should first wait for the slot to be vacant, doing something useful.  See IsVacant.
+		 *
+		 * @param[in] taskID This is the ID of the task being sent.
+		 */
+		void Claim(TaskID taskID);
+
+		/**
+		 * Tell the caller if the slot of the given task can be claimed without waiting for a previous claimant to finish.
+		 */
+		bool IsVacant(TaskID taskID) const;
+
+		/**
+		 * Put the result of the given task into the task's slot.  If the slot already
+		 * holds a result for the task, that result is freed and replaced.  If the slot
+		 * has since been claimed by another task, the given result is simply freed.
+		 *
+		 * @param[in] taskID This is the ID of the task that produced the result.
+		 * @param[in] result This is the result.  Ownership of the memory is taken.
+		 */
+		void Store(TaskID taskID, Result* result);
+
+		/**
+		 * Mark the given task as having been executed.  This is a no-op if the task
+		 * already stored a result.
+		 *
+		 * @param[in] taskID This is the ID of the task that finished.
+		 */
+		void Finish(TaskID taskID);
+
+		/**
+		 * Take the result of the given task out of its slot, if it's there.
+		 *
+		 * @param[in] taskID This is the ID of the task who's result is wanted.
+		 * @return The result is returned if the task has finished and produced one that was not already collected; null, otherwise.  The caller takes ownership of the memory.
+		 */
+		Result* Collect(TaskID taskID);
+
+		/**
+		 * Tell the caller if the given task has finished, or has been forgotten about.
+		 */
+		bool IsFinished(TaskID taskID) const;
+
+		/**
+		 * Free every result that is sitting in a slot uncollected.
+		 */
+		void Clear();
+
+		/**
+		 * Return the number of slots in the ring.
+		 */
+		uint32_t GetCapacity() const { return this->capacity; }
+
+	private:
+
+		enum State : uint32_t
+		{
+			PENDING,		///< The task has been sent, but has not finished.
+			WRITING,		///< The task's result is being put into the slot.
+			READY,			///< The task has finished and its result waits in the slot.
+			DONE			///< The task has finished, and there is no result in the slot.
+		};
+
+		struct Slot
+		{
+			std::atomic<uint64_t> word;			///< The upper 32 bits are the ID of the claiming task and the lower 32 bits are its state.
+			std::atomic<Result*> result;		///< This is only meaningful in the READY state.
+		};
+
+		static uint64_t MakeWord(TaskID taskID, State state) { return (uint64_t(taskID) << 32) | uint64_t(state); }
+		static TaskID GetWordTaskID(uint64_t word) { return TaskID(word >> 32); }
+		static State GetWordState(uint64_t word) { return State(word & 0xFFFFFFFF); }
+
+		Slot* GetSlot(TaskID taskID) { return &this->slotArray[taskID & this->mask]; }
+		const Slot* GetSlot(TaskID taskID) const { return &this->slotArray[taskID & this->mask]; }
+
+		static bool IsFinishedWord(uint64_t word, TaskID taskID);
+		static bool IsVacantWord(uint64_t word);
+
+		Slot* slotArray;
+		uint32_t capacity;
+		uint32_t mask;
+	};
+}
\ No newline at end of file
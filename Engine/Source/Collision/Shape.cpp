@@ -12,9 +12,16 @@ std::atomic<ShapeID> Shape::nextShapeID(1);
 
 Shape::Shape(bool temporary)
 {
-	this->node = nullptr;
+	this->nodeIndex = IMZADI_INVALID_NODE_INDEX;
+	this->nodeSlotIndex = 0;
+	this->leafNode = nullptr;
+	this->gridEntryIndex = IMZADI_INVALID_SHAPE_INDEX;
+	this->sweepEntryIndex = IMZADI_INVALID_SHAPE_INDEX;
+	this->staticShapeIndex = IMZADI_INVALID_SHAPE_INDEX;
+	this->sweepDirty = false;
 	this->debugColor.SetComponents(1.0, 0.0, 0.0);
 	this->shapeID = temporary ? 0 : nextShapeID++;
+	this->originalShapeID = this->shapeID;
 	this->cache = nullptr;
 	this->objectToWorld.SetIdentity();
 	this->revisionNumber = 0;
@@ -58,6 +65,8 @@ ShapeID Shape::GetShapeID() const
 		return new PolygonShape(false);
 	case TypeID::SPHERE:
 		return new SphereShape(false);
+	default:
+		break;
 	}
 
 	return nullptr;
@@ -117,6 +126,11 @@ const AxisAlignedBoundingBox& Shape::GetBoundingBox() const
 	return this->GetCache()->boundingBox;
 }
 
+/*virtual*/ double Shape::GetSupportRadius() const
+{
+	return 0.0;
+}
+
 /*virtual*/ bool Shape::Dump(std::ostream& stream) const
 {
 	this->objectToWorld.Dump(stream);
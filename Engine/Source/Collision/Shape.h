@@ -11,7 +11,7 @@
 namespace Imzadi
 {
 	class DebugRenderResult;
-	class BoundingBoxNode;
+	class DynamicBoundingBoxNode;
 	class ShapeCache;
 
 	typedef uint64_t ShapeID;
@@ -35,8 +35,13 @@ namespace Imzadi
 	 */
 	class IMZADI_API Shape
 	{
+		friend class BroadPhase;
 		friend class BoundingBoxTree;
-		friend class BoundingBoxNode;
+		friend class DynamicBoundingBoxTree;
+		friend class DynamicBoundingBoxNode;
+		friend class StaticBoundingBoxTree;
+		friend class SpatialHashGrid;
+		friend class SweepAndPrune;
 		friend class ShapeCache;
 
 	public:
@@ -54,14 +59,17 @@ namespace Imzadi
 		virtual ~Shape();
 
 		/**
-		 * Any new derivatives of the Shape class should add its own type ID here.
+		 * Any new derivatives of the Shape class should add its own type ID here,
+		 * before NUM_TYPE_IDS, and a row and column for it to the table in the
+		 * CollisionCalculatorTable class, which goes in this same order.
 		 */
 		enum TypeID
 		{
 			SPHERE,
 			BOX,
 			CAPSULE,
-			POLYGON
+			POLYGON,
+			NUM_TYPE_IDS		///< This isn't a type, but the number of them.
 		};
 
 		/**
@@ -84,6 +92,14 @@ namespace Imzadi
 		 */
 		ShapeID GetShapeID() const;
 
+		/**
+		 * Get the ID of the shape, as added to the collision system by the user, that this shape is all or
+		 * part of.  This is the shape's own ID unless it's a piece of a shape that was split on insertion
+		 * into the broad-phase, in which case it's the ID of the shape that was split.  Query results always
+		 * report this ID, so that the user never sees the pieces, only the shape they added.
+		 */
+		ShapeID GetOriginalShapeID() const { return this->originalShapeID; }
+
 		/**
 		 * Tell the caller if this collision shape has valid data.  Overrides should
 		 * call this base-class method.  This function is provided mainly for debugging
@@ -104,7 +120,7 @@ namespace Imzadi
 		template<typename T>
 		T* Cast()
 		{
-			return (T::StaticTypeID() == this->GetShapeID()) ? (T*)this : nullptr;
+			return (T::StaticTypeID() == this->GetShapeTypeID()) ? (T*)this : nullptr;
 		}
 
 		/**
@@ -113,7 +129,7 @@ namespace Imzadi
 		template<typename T>
 		const T* Cast() const
 		{
-			return (T::StaticTypeID() == this->GetShapeID()) ? (const T*)this : nullptr;
+			return (T::StaticTypeID() == this->GetShapeTypeID()) ? (const T*)this : nullptr;
 		}
 
 		/**
@@ -133,7 +149,10 @@ namespace Imzadi
 		 * During insertion into the AABB tree, if splitting is allowed, and splitting is
 		 * supported by this shape, then this method can be used to split this shape across
 		 * box boundaries so that it can be inserted deeper into the tree.  The original
-		 * shape is deleted and the split parts of the shape live on.
+		 * shape is deleted and the split parts of the shape live on.  The parts must lie
+		 * entirely on their sides of the plane, not even a rounding error past it, so that
+		 * they fit in the boxes either side of it, and must together cover exactly what the
+		 * original shape did, so that nothing can slip between them.
 		 * 
 		 * @param[in] plane This is the plane across which this shape is split.
 		 * @param[out] shapeBack This will be assigned the part of the shape on the back side of the given plane.
@@ -170,6 +189,24 @@ namespace Imzadi
 		 */
 		virtual bool RayCast(const Ray& ray, double& alpha, Vector3& unitSurfaceNormal) const = 0;
 
+		/**
+		 * Overrides of this method should return the world-space point of this shape's core that
+		 * is farthest along the given direction.  A shape is thought of as every point within its
+		 * support radius of its core, so the core of a sphere is its center, and that of a capsule
+		 * is its spine.  This, being a support function, is all the ConvexCollision class needs to
+		 * know of a shape to collide it with any other.  Every shape must therefore be convex.
+		 * 
+		 * @param[in] direction This is a world-space direction.  It need not be of unit length, but must not be zero.
+		 * @return The farthest core point is returned.  Where there is a tie, any of the tied points may be returned.
+		 */
+		virtual Vector3 GetSupportPoint(const Vector3& direction) const = 0;
+
+		/**
+		 * Return how far this shape extends past the core that its support points are taken from.
+		 * See the GetSupportPoint method.  This is zero by default.
+		 */
+		virtual double GetSupportRadius() const;
+
 		/**
 		 * Overrides should serialize this shape to the given stream.  Note that they
 		 * should call this base-class method before providing their own implimentation.
@@ -262,18 +299,25 @@ namespace Imzadi
 		void BumpRevisionNumber() { this->revisionNumber++; }
 
 		/**
-		 * Tell the caller if this shape is bound to a node in the bounding box tree.
+		 * Tell the caller if this shape is bound to a node in the broad-phase.
 		 * This also means that the shape is, as of last insertion, still considered
 		 * to be within the bounds of the collision world.  Of course, the bounding
 		 * box of this shape may not actually be within the collision world.
 		 */
-		bool IsBound() const { return this->node != nullptr; }
+		bool IsBound() const { return this->nodeIndex != IMZADI_INVALID_NODE_INDEX || this->leafNode != nullptr || this->gridEntryIndex != IMZADI_INVALID_SHAPE_INDEX || this->staticShapeIndex != IMZADI_INVALID_SHAPE_INDEX; }
 
 	private:
 
 		ShapeID shapeID;							///< This is a unique identifier that can be used to safely refer to this node on any thread.
+		ShapeID originalShapeID;					///< This is the shape ID of the shape this one was split from, if any, or of this shape, if not.
 		static std::atomic<ShapeID> nextShapeID;	///< This is the ID of the next shape to be allocated by the system.
-		BoundingBoxNode* node;						///< This is the node of the bounding-box tree that contains this shape.
+		uint32_t nodeIndex;							///< This is the index of the node of the bounding-box tree that contains this shape, or IMZADI_INVALID_NODE_INDEX if none.
+		uint32_t nodeSlotIndex;						///< This is where this shape sits in the bounding-box tree's shape slot array, if it's in a node.
+		DynamicBoundingBoxNode* leafNode;			///< This is the leaf of the dynamic bounding-box tree that holds this shape.
+		uint32_t gridEntryIndex;					///< This is where this shape sits in the spatial hash grid's entry array, or IMZADI_INVALID_SHAPE_INDEX if it isn't in the grid.
+		uint32_t sweepEntryIndex;					///< This is where this shape sits in the sweep-and-prune's entry array, or IMZADI_INVALID_SHAPE_INDEX if it isn't in it.
+		uint32_t staticShapeIndex;					///< This is where this shape sits in the static bounding-box tree, or IMZADI_INVALID_SHAPE_INDEX if it isn't static.
+		bool sweepDirty;							///< This is true if the shape has been inserted or moved since the sweep-and-prune was last brought up to date.
 		mutable ShapeCache* cache;					///< This pointer should never be accessed directly by methods of this class or any of its derivatives.  Rather, the GetCache method should always be used.
 
 	protected:
@@ -288,6 +288,17 @@ void BoxShape::GetAxisAlignedBox(AxisAlignedBoundingBox& box) const
 	return false;
 }
 
+/*virtual*/ Vector3 BoxShape::GetSupportPoint(const Vector3& direction) const
+{
+	// Take the direction into object space by the transpose of the object-to-world matrix,
+	// not its inverse, so that this is right even if the box is scaled or sheared.
+	Vector3 cornerPoint;
+	cornerPoint.x = (this->objectToWorld.matrix.GetColumnVector(0).Dot(direction) >= 0.0) ? this->extents.x : -this->extents.x;
+	cornerPoint.y = (this->objectToWorld.matrix.GetColumnVector(1).Dot(direction) >= 0.0) ? this->extents.y : -this->extents.y;
+	cornerPoint.z = (this->objectToWorld.matrix.GetColumnVector(2).Dot(direction) >= 0.0) ? this->extents.z : -this->extents.z;
+	return this->objectToWorld.TransformPoint(cornerPoint);
+}
+
 /*virtual*/ bool BoxShape::Dump(std::ostream& stream) const
 {
 	if (!Shape::Dump(stream))
@@ -75,6 +75,11 @@ namespace Imzadi
 		 */
 		virtual bool RayCast(const Ray& ray, double& alpha, Vector3& unitSurfaceNormal) const override;
 
+		/**
+		 * Return the world-space corner of this box farthest along the given direction.  See Shape::GetSupportPoint.
+		 */
+		virtual Vector3 GetSupportPoint(const Vector3& direction) const override;
+
 		/**
 		 * Write this box to given stream in binary form.
 		 */
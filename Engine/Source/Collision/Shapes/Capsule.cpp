@@ -279,6 +279,17 @@ CapsuleShape::CapsuleShape(bool temporary) : Shape(temporary)
 	return false;
 }
 
+/*virtual*/ Vector3 CapsuleShape::GetSupportPoint(const Vector3& direction) const
+{
+	const LineSegment& worldSpine = ((CapsuleShapeCache*)this->GetCache())->worldSpine;
+	return (worldSpine.point[0].Dot(direction) >= worldSpine.point[1].Dot(direction)) ? worldSpine.point[0] : worldSpine.point[1];
+}
+
+/*virtual*/ double CapsuleShape::GetSupportRadius() const
+{
+	return this->radius;
+}
+
 void CapsuleShape::SetVertex(int i, const Vector3& point)
 {
 	if (i % 2 == 0)
@@ -331,6 +342,9 @@ CapsuleShapeCache::CapsuleShapeCache()
 	Vector3 pointA = capsule->objectToWorld.TransformPoint(capsule->lineSegment.point[0]);
 	Vector3 pointB = capsule->objectToWorld.TransformPoint(capsule->lineSegment.point[1]);
 
+	this->worldSpine.point[0] = pointA;
+	this->worldSpine.point[1] = pointB;
+
 	this->boundingBox.minCorner = pointA;
 	this->boundingBox.maxCorner = pointA;
 
@@ -70,6 +70,16 @@ namespace Imzadi
 		 */
 		virtual bool RayCast(const Ray& ray, double& alpha, Vector3& unitSurfaceNormal) const override;
 
+		/**
+		 * The core of a capsule is its world-space spine.  See Shape::GetSupportPoint.
+		 */
+		virtual Vector3 GetSupportPoint(const Vector3& direction) const override;
+
+		/**
+		 * See Shape::GetSupportRadius.
+		 */
+		virtual double GetSupportRadius() const override;
+
 		/**
 		 * Write this capsule to given stream in binary form.
 		 */
@@ -138,8 +148,11 @@ namespace Imzadi
 		virtual ~CapsuleShapeCache();
 
 		/**
-		 * Update the given capsule's bounding-box.
+		 * Update the given capsule's bounding-box and world-space spine.
 		 */
 		virtual void Update(const Shape* shape) override;
+
+	public:
+		LineSegment worldSpine;		///< This is the capsule's spine in world-space.
 	};
 }
\ No newline at end of file
@@ -138,43 +138,90 @@ PolygonShape::PolygonShape(bool temporary) : Shape(temporary)
 {
 	constexpr double planeThickness = 1e-6;
 
+	// The split is done in world space, because that's where the boxes the halves must fit into are.
+	const std::vector<Vector3>& worldVertexArray = this->GetWorldVertices();
+	int numVertices = (signed)worldVertexArray.size();
+
+	std::vector<double> distanceArray(numVertices);
+	std::vector<Plane::Side> sideArray(numVertices);
+	bool anyBack = false, anyFront = false;
+	for (int i = 0; i < numVertices; i++)
+	{
+		distanceArray[i] = plane.SignedDistanceTo(worldVertexArray[i]);
+		if (::fabs(distanceArray[i]) <= planeThickness)
+			sideArray[i] = Plane::Side::NEITHER;
+		else if (distanceArray[i] < 0.0)
+		{
+			sideArray[i] = Plane::Side::BACK;
+			anyBack = true;
+		}
+		else
+		{
+			sideArray[i] = Plane::Side::FRONT;
+			anyFront = true;
+		}
+	}
+
+	// A polygon that only touches the plane isn't split.  Neither half would be a proper polygon.
+	if (!anyBack || !anyFront)
+		return false;
+
+	// Put the given point exactly on the plane.  Projecting it onto the plane isn't quite enough, since
+	// that can leave it a rounding error off.  If the plane is axis-aligned, as those of the bounding-box
+	// tree are, we can do better by just setting the one coordinate the plane cares about.
+	auto putOnPlane = [&plane](const Vector3& point) -> Vector3
+	{
+		Vector3 planePoint = plane.ClosestPointTo(point);
+		if (plane.unitNormal.y == 0.0 && plane.unitNormal.z == 0.0)
+			planePoint.x = plane.center.x;
+		else if (plane.unitNormal.x == 0.0 && plane.unitNormal.z == 0.0)
+			planePoint.y = plane.center.y;
+		else if (plane.unitNormal.x == 0.0 && plane.unitNormal.y == 0.0)
+			planePoint.z = plane.center.z;
+		return planePoint;
+	};
+
 	auto polygonBack = new PolygonShape(false);
 	auto polygonFront = new PolygonShape(false);
 
-	for (int i = 0; i < (signed)this->vertexArray->size(); i++)
+	for (int i = 0; i < numVertices; i++)
 	{
-		int j = (i + 1) % this->vertexArray->size();
-
-		const Vector3& vertexA = (*this->vertexArray)[i];
-		const Vector3& vertexB = (*this->vertexArray)[j];
+		int j = (i + 1) % numVertices;
 
-		Plane::Side side = plane.GetSide(vertexA, planeThickness);
+		const Vector3& vertexA = worldVertexArray[i];
+		const Vector3& vertexB = worldVertexArray[j];
 
-		if (side == Plane::Side::BACK || side == Plane::Side::NEITHER)
+		if (sideArray[i] == Plane::Side::BACK)
 			polygonBack->vertexArray->push_back(vertexA);
-		if (side == Plane::Side::FRONT || side == Plane::Side::NEITHER)
+		else if (sideArray[i] == Plane::Side::FRONT)
 			polygonFront->vertexArray->push_back(vertexA);
+		else
+		{
+			Vector3 planePoint = putOnPlane(vertexA);
+			polygonBack->vertexArray->push_back(planePoint);
+			polygonFront->vertexArray->push_back(planePoint);
+		}
 
-		double edgeLength = 0.0;
-		Ray ray(vertexA, vertexB - vertexA);
-		ray.unitDirection.Normalize(&edgeLength);
-		double alpha = 0.0;
-		Interval interval(0.0, edgeLength);
-
-		if (ray.CastAgainst(plane, alpha) && interval.ContainsInteriorValue(alpha))
+		// Only an edge going from one side clear through to the other crosses the plane.  The same point is
+		// given to both halves so that there's no crack between them.  Rounding can put the point a hair outside
+		// the edge, and therefore outside the polygon's box, so it's clamped to the edge's box.
+		if ((sideArray[i] == Plane::Side::BACK && sideArray[j] == Plane::Side::FRONT) || (sideArray[i] == Plane::Side::FRONT && sideArray[j] == Plane::Side::BACK))
 		{
-			Vector3 intersectionPoint = ray.CalculatePoint(alpha);
-			polygonBack->vertexArray->push_back(intersectionPoint);
-			polygonFront->vertexArray->push_back(intersectionPoint);
+			double lerp = distanceArray[i] / (distanceArray[i] - distanceArray[j]);
+			Vector3 crossingPoint = vertexA + (vertexB - vertexA) * lerp;
+			crossingPoint.x = IMZADI_CLAMP(crossingPoint.x, IMZADI_MIN(vertexA.x, vertexB.x), IMZADI_MAX(vertexA.x, vertexB.x));
+			crossingPoint.y = IMZADI_CLAMP(crossingPoint.y, IMZADI_MIN(vertexA.y, vertexB.y), IMZADI_MAX(vertexA.y, vertexB.y));
+			crossingPoint.z = IMZADI_CLAMP(crossingPoint.z, IMZADI_MIN(vertexA.z, vertexB.z), IMZADI_MAX(vertexA.z, vertexB.z));
+			Vector3 planePoint = putOnPlane(crossingPoint);
+			polygonBack->vertexArray->push_back(planePoint);
+			polygonFront->vertexArray->push_back(planePoint);
 		}
 	}
 
-	if (polygonBack->vertexArray->size() < 3 || polygonFront->vertexArray->size() < 3)
-	{
-		delete polygonBack;
-		delete polygonFront;
-		return false;
-	}
+	IMZADI_ASSERT(polygonBack->vertexArray->size() >= 3 && polygonFront->vertexArray->size() >= 3);
+
+	polygonBack->debugColor = this->debugColor;
+	polygonFront->debugColor = this->debugColor;
 
 	shapeBack = polygonBack;
 	shapeFront = polygonFront;
@@ -257,6 +304,26 @@ const std::vector<Vector3>& PolygonShape::GetWorldVertices() const
 	return true;
 }
 
+/*virtual*/ Vector3 PolygonShape::GetSupportPoint(const Vector3& direction) const
+{
+	const std::vector<Vector3>& worldVertexArray = this->GetWorldVertices();
+	IMZADI_ASSERT(worldVertexArray.size() > 0);
+
+	int j = 0;
+	double largestDot = worldVertexArray[0].Dot(direction);
+	for (int i = 1; i < (signed)worldVertexArray.size(); i++)
+	{
+		double dot = worldVertexArray[i].Dot(direction);
+		if (dot > largestDot)
+		{
+			largestDot = dot;
+			j = i;
+		}
+	}
+
+	return worldVertexArray[j];
+}
+
 void PolygonShape::Clear()
 {
 	this->vertexArray->clear();
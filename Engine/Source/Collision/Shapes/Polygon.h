@@ -71,7 +71,10 @@ namespace Imzadi
 		 * Split this polygon across the given plane into two separate polygons.
 		 * This method is used during insertion into the AABB tree if splitting is allowed.
 		 * Unlike many shapes, what's nice about convex polygons is that when
-		 * split across a plane, the two halfs are also convex polygons.
+		 * split across a plane, the two halfs are also convex polygons.  The halves
+		 * are made from the world-space vertices of this polygon, and so are given
+		 * the identity transform.  Vertices on the plane, and the points where edges
+		 * cross it, are put exactly on the plane and shared by both halves.
 		 */
 		virtual bool Split(const Plane& plane, Shape*& shapeBack, Shape*& shapeFront) const override;
 
@@ -94,6 +97,11 @@ namespace Imzadi
 		 */
 		virtual bool RayCast(const Ray& ray, double& alpha, Vector3& unitSurfaceNormal) const override;
 
+		/**
+		 * Return the world-space vertex of this polygon farthest along the given direction.  See Shape::GetSupportPoint.
+		 */
+		virtual Vector3 GetSupportPoint(const Vector3& direction) const override;
+
 		/**
 		 * Write this polygon to given stream in binary form.
 		 */
@@ -185,6 +185,16 @@ SphereShape::SphereShape(bool temporary) : Shape(temporary)
 	return true;
 }
 
+/*virtual*/ Vector3 SphereShape::GetSupportPoint(const Vector3& direction) const
+{
+	return this->objectToWorld.TransformPoint(this->center);
+}
+
+/*virtual*/ double SphereShape::GetSupportRadius() const
+{
+	return this->radius;
+}
+
 /*virtual*/ bool SphereShape::Dump(std::ostream& stream) const
 {
 	if (!Shape::Dump(stream))
@@ -98,6 +98,16 @@ namespace Imzadi
 		 */
 		virtual bool RayCast(const Ray& ray, double& alpha, Vector3& unitSurfaceNormal) const override;
 
+		/**
+		 * The core of a sphere is its world-space center.  See Shape::GetSupportPoint.
+		 */
+		virtual Vector3 GetSupportPoint(const Vector3& direction) const override;
+
+		/**
+		 * See Shape::GetSupportRadius.
+		 */
+		virtual double GetSupportRadius() const override;
+
 		/**
 		 * Write this sphere to given stream in binary form.
 		 */
@@ -0,0 +1,365 @@
+#include "SpatialHashGrid.h"
+#include "Result.h"
+#include "Math/Ray.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace Imzadi;
+
+//--------------------------------- SpatialHashGrid ---------------------------------
+
+SpatialHashGrid::SpatialHashGrid(const AxisAlignedBoundingBox& collisionWorldExtents, double cellSize) : BroadPhase(collisionWorldExtents)
+{
+	// The grid has no bounds, so as far as the base class is concerned, the collision world is all of space.
+	this->collisionWorldExtents.minCorner.SetComponents(-std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max());
+	this->collisionWorldExtents.maxCorner.SetComponents(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+
+	this->cellSize = cellSize;
+	this->cellMap = new CellMap();
+	this->entryArray = new std::vector<Entry>();
+	this->oversizedShapeArray = new std::vector<Shape*>();
+	this->occupiedCellRange = CellRange{};
+}
+
+/*virtual*/ SpatialHashGrid::~SpatialHashGrid()
+{
+	this->Clear();
+
+	delete this->cellMap;
+	delete this->entryArray;
+	delete this->oversizedShapeArray;
+}
+
+/*virtual*/ bool SpatialHashGrid::InsertDynamic(Shape* shape, uint32_t flags)
+{
+	if (!shape)
+		return false;
+
+	CellRange cellRange;
+	bool oversized = this->CalculateCellRange(shape->GetBoundingBox(), cellRange) > IMZADI_GRID_MAX_CELLS_PER_SHAPE;
+
+	if (shape->gridEntryIndex != IMZADI_INVALID_SHAPE_INDEX)
+	{
+		// A shape that moved, but still overlaps the same cells, needs no grid work at all.
+		Entry& entry = (*this->entryArray)[shape->gridEntryIndex];
+		if (entry.oversized == oversized && (oversized || entry.cellRange == cellRange))
+		{
+			if (this->statistics)
+				this->statistics->RecordReinsertionAvoided();
+
+			return true;
+		}
+
+		if (this->statistics)
+			this->statistics->RecordReinsertion();
+
+		this->RemoveFromCells(entry);
+		entry.cellRange = cellRange;
+		entry.oversized = oversized;
+		this->AddToCells(entry);
+	}
+	else
+	{
+		shape->gridEntryIndex = (uint32_t)this->entryArray->size();
+		this->entryArray->push_back(Entry{ shape, cellRange, oversized });
+		this->AddToCells(this->entryArray->back());
+	}
+
+	this->TrackShape(shape);
+	return true;
+}
+
+/*virtual*/ bool SpatialHashGrid::Remove(ShapeID shapeID)
+{
+	Shape* shape = this->FindShape(shapeID);
+	if (!shape)
+		return false;
+
+	if (shape->gridEntryIndex != IMZADI_INVALID_SHAPE_INDEX)
+		this->Unbind(shape);
+
+	return BroadPhase::Remove(shapeID);
+}
+
+/*virtual*/ void SpatialHashGrid::Clear()
+{
+	for (Entry& entry : *this->entryArray)
+		entry.shape->gridEntryIndex = IMZADI_INVALID_SHAPE_INDEX;
+
+	this->cellMap->clear();
+	this->entryArray->clear();
+	this->oversizedShapeArray->clear();
+
+	BroadPhase::Clear();
+}
+
+/*virtual*/ void SpatialHashGrid::DebugRenderDynamic(DebugRenderResult* renderResult) const
+{
+	for (const auto& pair : *this->cellMap)
+	{
+		const CellKey& cellKey = pair.first;
+		AxisAlignedBoundingBox cellBox;
+		cellBox.minCorner.SetComponents(cellKey.coords[0] * this->cellSize, cellKey.coords[1] * this->cellSize, cellKey.coords[2] * this->cellSize);
+		cellBox.maxCorner = cellBox.minCorner + Vector3(this->cellSize, this->cellSize, this->cellSize);
+		renderResult->AddLinesForBox(cellBox, Vector3(1.0, 1.0, 1.0));
+	}
+}
+
+/*virtual*/ void SpatialHashGrid::RayCastDynamic(const Ray& ray, RayCastResult::HitData& hitData) const
+{
+	for (const Shape* shape : *this->oversizedShapeArray)
+		BroadPhase::RayCastShape(ray, shape, hitData);
+
+	if (this->cellMap->size() == 0)
+		return;
+
+	double origin[3], direction[3];
+	ray.origin.GetComponents(origin[0], origin[1], origin[2]);
+	ray.unitDirection.GetComponents(direction[0], direction[1], direction[2]);
+
+	// Nothing is ever outside the occupied cells, so that's as far as the ray need go.
+	double entryAlpha = 0.0;
+	double exitAlpha = hitData.alpha;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		double minCoord = double(this->occupiedCellRange.minCell.coords[i]) * this->cellSize;
+		double maxCoord = double(this->occupiedCellRange.maxCell.coords[i] + 1) * this->cellSize;
+		if (direction[i] == 0.0)
+		{
+			if (origin[i] < minCoord || origin[i] > maxCoord)
+				return;
+
+			continue;
+		}
+
+		double alphaA = (minCoord - origin[i]) / direction[i];
+		double alphaB = (maxCoord - origin[i]) / direction[i];
+		entryAlpha = IMZADI_MAX(entryAlpha, IMZADI_MIN(alphaA, alphaB));
+		exitAlpha = IMZADI_MIN(exitAlpha, IMZADI_MAX(alphaA, alphaB));
+	}
+
+	if (entryAlpha > exitAlpha)
+		return;
+
+	// Walk the cells from where the ray enters, always stepping across whichever cell wall is hit next.
+	CellKey cellKey;
+	this->CalculateCell(ray.CalculatePoint(entryAlpha), cellKey);
+	int32_t cellStep[3];
+	double nextWallAlpha[3], wallAlphaDelta[3];
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		cellKey.coords[i] = IMZADI_CLAMP(cellKey.coords[i], this->occupiedCellRange.minCell.coords[i], this->occupiedCellRange.maxCell.coords[i]);
+
+		if (direction[i] > 0.0)
+		{
+			cellStep[i] = 1;
+			nextWallAlpha[i] = (double(cellKey.coords[i] + 1) * this->cellSize - origin[i]) / direction[i];
+			wallAlphaDelta[i] = this->cellSize / direction[i];
+		}
+		else if (direction[i] < 0.0)
+		{
+			cellStep[i] = -1;
+			nextWallAlpha[i] = (double(cellKey.coords[i]) * this->cellSize - origin[i]) / direction[i];
+			wallAlphaDelta[i] = -this->cellSize / direction[i];
+		}
+		else
+		{
+			cellStep[i] = 0;
+			nextWallAlpha[i] = std::numeric_limits<double>::max();
+			wallAlphaDelta[i] = 0.0;
+		}
+	}
+
+	// A hit found in one cell may be out past the cell, so we keep going until the next cell starts beyond the nearest hit.
+	uint32_t numCellsVisited = 0;
+	double cellEntryAlpha = entryAlpha;
+	while (cellEntryAlpha <= exitAlpha && cellEntryAlpha < hitData.alpha)
+	{
+		numCellsVisited++;
+
+		CellMap::const_iterator iter = this->cellMap->find(cellKey);
+		if (iter != this->cellMap->end())
+			for (const Shape* shape : iter->second)
+				BroadPhase::RayCastShape(ray, shape, hitData);
+
+		uint32_t axis = 0;
+		if (nextWallAlpha[1] < nextWallAlpha[axis])
+			axis = 1;
+		if (nextWallAlpha[2] < nextWallAlpha[axis])
+			axis = 2;
+
+		cellEntryAlpha = nextWallAlpha[axis];
+		nextWallAlpha[axis] += wallAlphaDelta[axis];
+		cellKey.coords[axis] += cellStep[axis];
+	}
+
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(numCellsVisited);
+}
+
+/*virtual*/ void SpatialHashGrid::CalculateDynamicCollision(const Shape* shape, CollisionQueryResult* collisionResult) const
+{
+	for (const Shape* otherShape : *this->oversizedShapeArray)
+		this->CollideShapes(shape, otherShape, collisionResult);
+
+	CellRange cellRange;
+	if (this->CalculateCellRange(shape->GetBoundingBox(), cellRange) > IMZADI_GRID_MAX_CELLS_PER_SHAPE)
+	{
+		// A shape this big would have us visit more cells than it's worth, so just look at every shape.
+		for (const Entry& entry : *this->entryArray)
+			if (!entry.oversized)
+				this->CollideShapes(shape, entry.shape, collisionResult);
+
+		return;
+	}
+
+	uint32_t numCellsVisited = 0;
+	CellKey cellKey;
+	for (cellKey.coords[0] = cellRange.minCell.coords[0]; cellKey.coords[0] <= cellRange.maxCell.coords[0]; cellKey.coords[0]++)
+	{
+		for (cellKey.coords[1] = cellRange.minCell.coords[1]; cellKey.coords[1] <= cellRange.maxCell.coords[1]; cellKey.coords[1]++)
+		{
+			for (cellKey.coords[2] = cellRange.minCell.coords[2]; cellKey.coords[2] <= cellRange.maxCell.coords[2]; cellKey.coords[2]++)
+			{
+				numCellsVisited++;
+
+				CellMap::const_iterator iter = this->cellMap->find(cellKey);
+				if (iter == this->cellMap->end())
+					continue;
+
+				for (const Shape* otherShape : iter->second)
+				{
+					if (otherShape == shape)
+						continue;
+
+					// Only consider the pair in the lowest cell they share.
+					const CellRange& otherCellRange = (*this->entryArray)[otherShape->gridEntryIndex].cellRange;
+					bool isFirstSharedCell = true;
+					for (uint32_t i = 0; i < 3 && isFirstSharedCell; i++)
+						isFirstSharedCell = (IMZADI_MAX(cellRange.minCell.coords[i], otherCellRange.minCell.coords[i]) == cellKey.coords[i]);
+
+					if (isFirstSharedCell)
+						this->CollideShapes(shape, otherShape, collisionResult);
+				}
+			}
+		}
+	}
+
+	if (this->statistics)
+		this->statistics->RecordNodesVisited(numCellsVisited);
+}
+
+/*virtual*/ void SpatialHashGrid::GatherDynamicDiagnostics(TreeDiagnosticsResult::Diagnostics& diagnostics) const
+{
+	BroadPhase::AccountForNode(diagnostics, 0, (uint32_t)this->oversizedShapeArray->size(), this->cellMap->size() == 0, this->entryArray->size() == 0, 1.0);
+	if (this->cellMap->size() == 0)
+		return;
+
+	double occupiedArea = 0.0;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		double sizeA = double(this->occupiedCellRange.maxCell.coords[(i + 1) % 3] - this->occupiedCellRange.minCell.coords[(i + 1) % 3] + 1);
+		double sizeB = double(this->occupiedCellRange.maxCell.coords[(i + 2) % 3] - this->occupiedCellRange.minCell.coords[(i + 2) % 3] + 1);
+		occupiedArea += 2.0 * sizeA * sizeB;
+	}
+
+	for (const auto& pair : *this->cellMap)
+		BroadPhase::AccountForNode(diagnostics, 1, (uint32_t)pair.second.size(), true, false, 6.0 / occupiedArea);
+
+	// A shape is in every cell it overlaps, but should only be counted once.
+	diagnostics.numShapesInLeafNodes = uint32_t(this->entryArray->size() - this->oversizedShapeArray->size());
+}
+
+void SpatialHashGrid::CalculateCell(const Vector3& point, CellKey& cellKey) const
+{
+	// Cells are kept well within range of a 32-bit integer, so a neighboring cell can always be found.
+	const double maxCoord = double(1 << 30);
+
+	double coords[3];
+	point.GetComponents(coords[0], coords[1], coords[2]);
+	for (uint32_t i = 0; i < 3; i++)
+		cellKey.coords[i] = int32_t(IMZADI_CLAMP(std::floor(coords[i] / this->cellSize), -maxCoord, maxCoord));
+}
+
+uint64_t SpatialHashGrid::CalculateCellRange(const AxisAlignedBoundingBox& box, CellRange& cellRange) const
+{
+	this->CalculateCell(box.minCorner, cellRange.minCell);
+	this->CalculateCell(box.maxCorner, cellRange.maxCell);
+
+	uint64_t numCells = 1;
+	for (uint32_t i = 0; i < 3 && numCells <= IMZADI_GRID_MAX_CELLS_PER_SHAPE; i++)
+		numCells *= uint64_t(cellRange.maxCell.coords[i] - cellRange.minCell.coords[i] + 1);
+
+	return numCells;
+}
+
+void SpatialHashGrid::AddToCells(const Entry& entry)
+{
+	if (entry.oversized)
+	{
+		this->oversizedShapeArray->push_back(entry.shape);
+		return;
+	}
+
+	if (this->cellMap->size() == 0)
+		this->occupiedCellRange = entry.cellRange;
+	else
+	{
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			this->occupiedCellRange.minCell.coords[i] = IMZADI_MIN(this->occupiedCellRange.minCell.coords[i], entry.cellRange.minCell.coords[i]);
+			this->occupiedCellRange.maxCell.coords[i] = IMZADI_MAX(this->occupiedCellRange.maxCell.coords[i], entry.cellRange.maxCell.coords[i]);
+		}
+	}
+
+	CellKey cellKey;
+	for (cellKey.coords[0] = entry.cellRange.minCell.coords[0]; cellKey.coords[0] <= entry.cellRange.maxCell.coords[0]; cellKey.coords[0]++)
+		for (cellKey.coords[1] = entry.cellRange.minCell.coords[1]; cellKey.coords[1] <= entry.cellRange.maxCell.coords[1]; cellKey.coords[1]++)
+			for (cellKey.coords[2] = entry.cellRange.minCell.coords[2]; cellKey.coords[2] <= entry.cellRange.maxCell.coords[2]; cellKey.coords[2]++)
+				(*this->cellMap)[cellKey].push_back(entry.shape);
+}
+
+void SpatialHashGrid::RemoveFromCells(const Entry& entry)
+{
+	if (entry.oversized)
+	{
+		auto iter = std::find(this->oversizedShapeArray->begin(), this->oversizedShapeArray->end(), entry.shape);
+		*iter = this->oversizedShapeArray->back();
+		this->oversizedShapeArray->pop_back();
+		return;
+	}
+
+	// Cells are forgotten as soon as they're empty, so the map only ever holds occupied cells.
+	CellKey cellKey;
+	for (cellKey.coords[0] = entry.cellRange.minCell.coords[0]; cellKey.coords[0] <= entry.cellRange.maxCell.coords[0]; cellKey.coords[0]++)
+	{
+		for (cellKey.coords[1] = entry.cellRange.minCell.coords[1]; cellKey.coords[1] <= entry.cellRange.maxCell.coords[1]; cellKey.coords[1]++)
+		{
+			for (cellKey.coords[2] = entry.cellRange.minCell.coords[2]; cellKey.coords[2] <= entry.cellRange.maxCell.coords[2]; cellKey.coords[2]++)
+			{
+				CellMap::iterator iter = this->cellMap->find(cellKey);
+				CellShapeArray& cellShapeArray = iter->second;
+				auto shapeIter = std::find(cellShapeArray.begin(), cellShapeArray.end(), entry.shape);
+				*shapeIter = cellShapeArray.back();
+				cellShapeArray.pop_back();
+				if (cellShapeArray.size() == 0)
+					this->cellMap->erase(iter);
+			}
+		}
+	}
+}
+
+void SpatialHashGrid::Unbind(Shape* shape)
+{
+	uint32_t entryIndex = shape->gridEntryIndex;
+	this->RemoveFromCells((*this->entryArray)[entryIndex]);
+
+	// Keep the entries packed by moving the last one into the hole.
+	Entry& lastEntry = this->entryArray->back();
+	lastEntry.shape->gridEntryIndex = entryIndex;
+	(*this->entryArray)[entryIndex] = lastEntry;
+	this->entryArray->pop_back();
+
+	shape->gridEntryIndex = IMZADI_INVALID_SHAPE_INDEX;
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Defines.h"
+#include "BroadPhase.h"
+#include "CollisionHeap.h"
+#include "Math/AxisAlignedBoundingBox.h"
+#include <vector>
+#include <unordered_map>
+
+namespace Imzadi
+{
+	/**
+	 * This class facilitates the broad-phase of collision detection by dividing all of space
+	 * into cubic cells of one size and putting each shape in every cell its box overlaps.
+	 * Only the cells that have shapes in them are stored, in a hash map, so the grid has no
+	 * bounds, and the collision world box given to the system is ignored.  This makes it a good
+	 * fit for wide, open levels full of small things moving around, where a tree would have to
+	 * be deep and would be churned by every move.  A shape that moves, but stays in the same
+	 * cells, takes no work at all.
+	 *
+	 * The cell size should be about the size of the typical moving shape.  A shape
+	 * overlapping more than IMZADI_GRID_MAX_CELLS_PER_SHAPE cells isn't put in any,
+	 * but is kept in a list of oversized shapes that every search looks at.
+	 */
+	class IMZADI_API SpatialHashGrid : public BroadPhase
+	{
+	public:
+		/**
+		 * @param[in] collisionWorldExtents This is ignored, the grid having no bounds.
+		 * @param[in] cellSize This is the length of each side of each cell.
+		 */
+		SpatialHashGrid(const AxisAlignedBoundingBox& collisionWorldExtents, double cellSize);
+		virtual ~SpatialHashGrid();
+
+		/**
+		 * Remove the shape having the given ID from this grid.
+		 */
+		virtual bool Remove(ShapeID shapeID) override;
+
+		/**
+		 * Remove all shapes from this grid.
+		 */
+		virtual void Clear() override;
+
+	protected:
+
+		/**
+		 * Put the given shape in every cell its box overlaps, or, if it's already in the grid,
+		 * move it to the cells its box now overlaps, if they've changed.  Shapes are never
+		 * split in a grid, so the IMZADI_ADD_FLAG_ALLOW_SPLIT flag is ignored.
+		 */
+		virtual bool InsertDynamic(Shape* shape, uint32_t flags) override;
+
+		/**
+		 * Draw the box of every cell having shapes in it.
+		 */
+		virtual void DebugRenderDynamic(DebugRenderResult* renderResult) const override;
+
+		/**
+		 * Walk the cells the given ray passes through, nearest first, casting against the shapes of each,
+		 * and stop once the next cell is farther away than the nearest hit so far.
+		 */
+		virtual void RayCastDynamic(const Ray& ray, RayCastResult::HitData& hitData) const override;
+
+		/**
+		 * Determine the collision status of the given shape against the shapes sharing a cell with it.
+		 * A pair of shapes sharing several cells is only considered in the first of them, this being the
+		 * one at the lowest corner of the range of cells they share, so no pair is ever reported twice.
+		 */
+		virtual void CalculateDynamicCollision(const Shape* shape, CollisionQueryResult* collisionResult) const override;
+
+		/**
+		 * Account for the grid in the given diagnostics as though it were a tree of depth one,
+		 * the root holding the oversized shapes, and each cell with shapes in it being a leaf.
+		 */
+		virtual void GatherDynamicDiagnostics(TreeDiagnosticsResult::Diagnostics& diagnostics) const override;
+
+	private:
+
+		/**
+		 * This is the position of a cell along each axis, in units of cells from the origin.
+		 */
+		struct CellKey
+		{
+			int32_t coords[3];
+
+			bool operator==(const CellKey& key) const
+			{
+				return this->coords[0] == key.coords[0] && this->coords[1] == key.coords[1] && this->coords[2] == key.coords[2];
+			}
+		};
+
+		/**
+		 * This mixes the coordinates of a cell into a hash for the cell map.
+		 */
+		struct CellKeyHash
+		{
+			size_t operator()(const CellKey& key) const
+			{
+				uint64_t hash = uint64_t(uint32_t(key.coords[0])) * 0x9E3779B97F4A7C15ULL;
+				hash ^= uint64_t(uint32_t(key.coords[1])) * 0xC2B2AE3D27D4EB4FULL;
+				hash ^= uint64_t(uint32_t(key.coords[2])) * 0x165667B19E3779F9ULL;
+				return size_t(hash ^ (hash >> 32));
+			}
+		};
+
+		/**
+		 * This is a box of cells, inclusive of both corners.
+		 */
+		struct CellRange
+		{
+			CellKey minCell;
+			CellKey maxCell;
+
+			bool operator==(const CellRange& range) const { return this->minCell == range.minCell && this->maxCell == range.maxCell; }
+			bool operator!=(const CellRange& range) const { return !(*this == range); }
+		};
+
+		/**
+		 * This is what the grid remembers about each of its shapes.
+		 */
+		struct Entry
+		{
+			Shape* shape;
+			CellRange cellRange;			///< These are the cells the shape was put in, going by its box at the time.
+			bool oversized;					///< If true, the shape is in the oversized shape array rather than in any cells.
+		};
+
+		typedef std::vector<Shape*, CollisionHeapAllocator<Shape*>> CellShapeArray;
+		typedef std::unordered_map<CellKey, CellShapeArray, CellKeyHash, std::equal_to<CellKey>, CollisionHeapAllocator<std::pair<const CellKey, CellShapeArray>>> CellMap;
+
+		/**
+		 * Find the cell containing the given point.  Coordinates too far out to count in cells are clamped.
+		 */
+		void CalculateCell(const Vector3& point, CellKey& cellKey) const;
+
+		/**
+		 * Find the range of cells overlapped by the given box.
+		 *
+		 * @return The number of cells in the range is returned, or more than IMZADI_GRID_MAX_CELLS_PER_SHAPE if it's bigger than that.
+		 */
+		uint64_t CalculateCellRange(const AxisAlignedBoundingBox& box, CellRange& cellRange) const;
+
+		/**
+		 * Put the shape of the given entry into every cell of its range, or into the oversized shape array.
+		 */
+		void AddToCells(const Entry& entry);
+
+		/**
+		 * Take the shape of the given entry out of every cell of its range, or out of the oversized shape array.
+		 */
+		void RemoveFromCells(const Entry& entry);
+
+		/**
+		 * Take the given shape out of the grid altogether, forgetting its entry.
+		 */
+		void Unbind(Shape* shape);
+
+		double cellSize;									///< This is the length of each side of each cell.
+		CellMap* cellMap;									///< Only cells with shapes in them have an entry here.
+		std::vector<Entry>* entryArray;						///< There is one entry here for every shape in the grid, in no particular order.
+		std::vector<Shape*>* oversizedShapeArray;			///< These are shapes overlapping too many cells to be put in them.
+		CellRange occupiedCellRange;						///< This contains every cell that has had a shape in it since the grid was last empty.  Rays go no farther.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,572 @@
+#include "StaticBoundingBoxTree.h"
+#include "BroadPhase.h"
+#include "CollisionHeap.h"
+#include "Math/Ray.h"
+#include <algorithm>
+#include <execution>
+#include <numeric>
+
+using namespace Imzadi;
+
+//--------------------------------- StaticBoundingBoxTree ---------------------------------
+
+StaticBoundingBoxTree::StaticBoundingBoxTree()
+{
+	this->nodeArray = new std::vector<Node>();
+	this->shapeArray = new std::vector<Shape*>();
+	this->built = true;
+}
+
+/*virtual*/ StaticBoundingBoxTree::~StaticBoundingBoxTree()
+{
+	this->Clear();
+
+	delete this->nodeArray;
+	delete this->shapeArray;
+}
+
+void StaticBoundingBoxTree::Add(Shape* shape)
+{
+	IMZADI_ASSERT(shape->staticShapeIndex == IMZADI_INVALID_SHAPE_INDEX);
+
+	shape->staticShapeIndex = (uint32_t)this->shapeArray->size();
+	this->shapeArray->push_back(shape);
+	this->built = false;
+}
+
+void StaticBoundingBoxTree::Remove(Shape* shape)
+{
+	IMZADI_ASSERT((*this->shapeArray)[shape->staticShapeIndex] == shape);
+
+	Shape* lastShape = this->shapeArray->back();
+	(*this->shapeArray)[shape->staticShapeIndex] = lastShape;
+	lastShape->staticShapeIndex = shape->staticShapeIndex;
+	this->shapeArray->pop_back();
+
+	shape->staticShapeIndex = IMZADI_INVALID_SHAPE_INDEX;
+	this->built = false;
+}
+
+void StaticBoundingBoxTree::Invalidate()
+{
+	this->built = false;
+}
+
+void StaticBoundingBoxTree::Clear()
+{
+	for (Shape* shape : *this->shapeArray)
+		shape->staticShapeIndex = IMZADI_INVALID_SHAPE_INDEX;
+
+	this->shapeArray->clear();
+	this->nodeArray->clear();
+	this->built = true;
+}
+
+void StaticBoundingBoxTree::BuildIfNotAlreadyBuilt()
+{
+	if (this->built)
+		return;
+
+	// Getting a shape's box may mean calculating it for the first time, which, for a level's worth of
+	// polygons, is a good chunk of the work of the build, so the shapes are spread across all cores.
+	std::vector<BuildEntry> buildEntryArray(this->shapeArray->size());
+	std::transform(std::execution::par, this->shapeArray->begin(), this->shapeArray->end(), buildEntryArray.begin(), [](Shape* shape) -> BuildEntry
+	{
+		BuildEntry buildEntry;
+		buildEntry.shape = shape;
+		buildEntry.box = shape->GetBoundingBox();
+		Vector3 center = (buildEntry.box.minCorner + buildEntry.box.maxCorner) / 2.0;
+		center.GetComponents(buildEntry.center[0], buildEntry.center[1], buildEntry.center[2]);
+		return buildEntry;
+	});
+
+	this->nodeArray->clear();
+	this->nodeArray->reserve(2 * buildEntryArray.size());
+	if (buildEntryArray.size() > 0)
+	{
+		AxisAlignedBoundingBox rootBox;
+		CalculateBox(buildEntryArray, 0, (uint32_t)buildEntryArray.size(), rootBox);
+		BuildNode(*this->nodeArray, buildEntryArray, 0, (uint32_t)buildEntryArray.size(), rootBox);
+	}
+
+	// The shapes are kept in the order the build left them in so that each leaf refers to a run of them.
+	for (uint32_t i = 0; i < (uint32_t)buildEntryArray.size(); i++)
+	{
+		Shape* shape = buildEntryArray[i].shape;
+		(*this->shapeArray)[i] = shape;
+		shape->staticShapeIndex = i;
+	}
+
+	this->built = true;
+}
+
+/*static*/ uint32_t StaticBoundingBoxTree::BuildNode(std::vector<Node>& nodeArray, std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries, const AxisAlignedBoundingBox& box)
+{
+	Node node;
+	node.box = box;
+	node.secondChildIndex = 0;
+	node.firstShape = firstEntry;
+	node.numShapes = numEntries;
+
+	uint32_t nodeIndex = (uint32_t)nodeArray.size();
+	nodeArray.push_back(node);
+
+	if (numEntries <= IMZADI_STATIC_TREE_MAX_LEAF_SHAPES)
+		return nodeIndex;
+
+	AxisAlignedBoundingBox childBox[2];
+	uint32_t numFirstEntries = PartitionEntries(buildEntryArray, firstEntry, numEntries, childBox[0], childBox[1]);
+	uint32_t childFirstEntry[2] = { firstEntry, firstEntry + numFirstEntries };
+	uint32_t childNumEntries[2] = { numFirstEntries, numEntries - numFirstEntries };
+
+	uint32_t secondChildIndex = 0;
+	if (numEntries < IMZADI_PARALLEL_BUILD_MIN_SHAPES)
+	{
+		BuildNode(nodeArray, buildEntryArray, childFirstEntry[0], childNumEntries[0], childBox[0]);
+		secondChildIndex = BuildNode(nodeArray, buildEntryArray, childFirstEntry[1], childNumEntries[1], childBox[1]);
+	}
+	else
+	{
+		// The children have no entries in common, so they can be built at the same time, each into an array of its own.
+		// Splicing those in after this node, first child first, makes the same array as building the children in turn.
+		std::vector<Node> childNodeArray[2];
+		uint32_t childArray[2] = { 0, 1 };
+		std::for_each(std::execution::par, std::begin(childArray), std::end(childArray), [&](uint32_t i)
+		{
+			BuildNode(childNodeArray[i], buildEntryArray, childFirstEntry[i], childNumEntries[i], childBox[i]);
+		});
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			uint32_t offset = (uint32_t)nodeArray.size();
+			if (i == 1)
+				secondChildIndex = offset;
+
+			for (Node& childNode : childNodeArray[i])
+			{
+				if (childNode.secondChildIndex != 0)
+					childNode.secondChildIndex += offset;
+
+				nodeArray.push_back(childNode);
+			}
+		}
+	}
+
+	nodeArray[nodeIndex].secondChildIndex = secondChildIndex;
+	return nodeIndex;
+}
+
+/*static*/ void StaticBoundingBoxTree::CalculateBox(const std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries, AxisAlignedBoundingBox& box)
+{
+	box = buildEntryArray[firstEntry].box;
+	for (uint32_t i = firstEntry + 1; i < firstEntry + numEntries; i++)
+		box.Expand(buildEntryArray[i].box);
+}
+
+/*static*/ uint32_t StaticBoundingBoxTree::PartitionEntries(std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries, AxisAlignedBoundingBox& firstBox, AxisAlignedBoundingBox& secondBox)
+{
+	struct Bin
+	{
+		AxisAlignedBoundingBox box;
+		uint32_t numEntries;
+	};
+
+	double minCenter[3], maxCenter[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		minCenter[axis] = buildEntryArray[firstEntry].center[axis];
+		maxCenter[axis] = minCenter[axis];
+	}
+
+	for (uint32_t i = firstEntry + 1; i < firstEntry + numEntries; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minCenter[axis] = IMZADI_MIN(minCenter[axis], buildEntryArray[i].center[axis]);
+			maxCenter[axis] = IMZADI_MAX(maxCenter[axis], buildEntryArray[i].center[axis]);
+		}
+	}
+
+	auto calcBinIndex = [&minCenter, &maxCenter](const BuildEntry& buildEntry, int axis) -> uint32_t
+	{
+		double t = (buildEntry.center[axis] - minCenter[axis]) / (maxCenter[axis] - minCenter[axis]);
+		uint32_t binIndex = (uint32_t)(t * double(IMZADI_STATIC_TREE_NUM_BINS));
+		return IMZADI_MIN(binIndex, uint32_t(IMZADI_STATIC_TREE_NUM_BINS - 1));
+	};
+
+	// Sort the shapes into bins by their centers along each axis, all three axes in one pass over the entries.
+	Bin binArray[3][IMZADI_STATIC_TREE_NUM_BINS];
+	for (int axis = 0; axis < 3; axis++)
+		for (Bin& bin : binArray[axis])
+			bin.numEntries = 0;
+
+	for (uint32_t i = firstEntry; i < firstEntry + numEntries; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (maxCenter[axis] <= minCenter[axis])
+				continue;
+
+			Bin& bin = binArray[axis][calcBinIndex(buildEntryArray[i], axis)];
+			if (bin.numEntries++ == 0)
+				bin.box = buildEntryArray[i].box;
+			else
+				bin.box.Expand(buildEntryArray[i].box);
+		}
+	}
+
+	// For each axis, cost out putting the plane between each pair of neighboring bins.  The cost of a child is the
+	// number of its shapes times its surface area, which is proportional to the odds of a random query hitting it.
+	// The boxes of the children fall out of this too, so they needn't be recalculated from the entries.
+	double bestCost = std::numeric_limits<double>::max();
+	int bestAxis = -1;
+	uint32_t bestBinIndex = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (maxCenter[axis] <= minCenter[axis])
+			continue;
+
+		double firstCostArray[IMZADI_STATIC_TREE_NUM_BINS];
+		AxisAlignedBoundingBox firstBoxArray[IMZADI_STATIC_TREE_NUM_BINS];
+		AxisAlignedBoundingBox box;
+		uint32_t numBoxEntries = 0;
+		for (uint32_t i = 0; i < uint32_t(IMZADI_STATIC_TREE_NUM_BINS - 1); i++)
+		{
+			const Bin& bin = binArray[axis][i];
+			if (bin.numEntries > 0)
+			{
+				if (numBoxEntries == 0)
+					box = bin.box;
+				else
+					box.Expand(bin.box);
+				numBoxEntries += bin.numEntries;
+			}
+
+			firstCostArray[i] = (numBoxEntries > 0) ? double(numBoxEntries) * box.GetSurfaceArea() : -1.0;
+			firstBoxArray[i] = box;
+		}
+
+		numBoxEntries = 0;
+		for (uint32_t i = uint32_t(IMZADI_STATIC_TREE_NUM_BINS - 1); i > 0; i--)
+		{
+			const Bin& bin = binArray[axis][i];
+			if (bin.numEntries > 0)
+			{
+				if (numBoxEntries == 0)
+					box = bin.box;
+				else
+					box.Expand(bin.box);
+				numBoxEntries += bin.numEntries;
+			}
+
+			// The plane goes between bin i-1 and bin i.  Planes leaving either side empty are no good.
+			if (numBoxEntries == 0 || numBoxEntries == numEntries || firstCostArray[i - 1] < 0.0)
+				continue;
+
+			double cost = firstCostArray[i - 1] + double(numBoxEntries) * box.GetSurfaceArea();
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBinIndex = i;
+				firstBox = firstBoxArray[i - 1];
+				secondBox = box;
+			}
+		}
+	}
+
+	// If all the centers coincide, then there is no plane to choose, and we just cut the run in half.
+	if (bestAxis < 0)
+	{
+		uint32_t numFirstEntries = numEntries / 2;
+		CalculateBox(buildEntryArray, firstEntry, numFirstEntries, firstBox);
+		CalculateBox(buildEntryArray, firstEntry + numFirstEntries, numEntries - numFirstEntries, secondBox);
+		return numFirstEntries;
+	}
+
+	auto partitionIter = BroadPhase::Partition(buildEntryArray.begin() + firstEntry, buildEntryArray.begin() + firstEntry + numEntries,
+		[&calcBinIndex, bestAxis, bestBinIndex](const BuildEntry& buildEntry) -> bool
+		{
+			return calcBinIndex(buildEntry, bestAxis) < bestBinIndex;
+		});
+
+	uint32_t numFirstEntries = uint32_t(partitionIter - (buildEntryArray.begin() + firstEntry));
+	IMZADI_ASSERT(0 < numFirstEntries && numFirstEntries < numEntries);
+	return numFirstEntries;
+}
+
+void StaticBoundingBoxTree::GatherShapesOverlapping(const AxisAlignedBoundingBox& box, std::vector<const Shape*>& overlappingShapeArray, bool parallel, uint32_t& numNodesVisited) const
+{
+	IMZADI_ASSERT(this->built);
+
+	AxisAlignedBoundingBox intersection;
+	if (this->nodeArray->size() == 0 || !intersection.Intersect((*this->nodeArray)[0].box, box))
+		return;
+
+	if (!parallel)
+	{
+		this->GatherShapesInSubtree(0, box, overlappingShapeArray, numNodesVisited);
+		return;
+	}
+
+	// Searching the subtrees one after the other is the same as searching the whole tree.
+	std::vector<uint32_t> subtreeArray;
+	this->FindSubtreesOverlapping(box, subtreeArray, numNodesVisited);
+	if (subtreeArray.size() < 2 || this->CountShapesInSubtrees(subtreeArray) < IMZADI_PARALLEL_QUERY_MIN_SHAPES)
+	{
+		for (uint32_t subtreeIndex : subtreeArray)
+			this->GatherShapesInSubtree(subtreeIndex, box, overlappingShapeArray, numNodesVisited);
+
+		return;
+	}
+
+	// Each subtree gathers its shapes into a list of its own.  Appending the lists in
+	// the order the subtrees were found gives the shapes in the same order as a serial search.
+	std::vector<std::vector<const Shape*>> subtreeShapeArray(subtreeArray.size());
+	std::vector<uint32_t> subtreeNodesVisitedArray(subtreeArray.size(), 0);
+	std::vector<uint32_t> indexArray(subtreeArray.size());
+	std::iota(indexArray.begin(), indexArray.end(), 0);
+	std::for_each(std::execution::par, indexArray.begin(), indexArray.end(), [&](uint32_t i)
+	{
+		this->GatherShapesInSubtree(subtreeArray[i], box, subtreeShapeArray[i], subtreeNodesVisitedArray[i]);
+	});
+
+	for (uint32_t i = 0; i < (uint32_t)subtreeArray.size(); i++)
+	{
+		overlappingShapeArray.insert(overlappingShapeArray.end(), subtreeShapeArray[i].begin(), subtreeShapeArray[i].end());
+		numNodesVisited += subtreeNodesVisitedArray[i];
+	}
+}
+
+void StaticBoundingBoxTree::GatherShapesInSubtree(uint32_t subtreeIndex, const AxisAlignedBoundingBox& box, std::vector<const Shape*>& overlappingShapeArray, uint32_t& numNodesVisited) const
+{
+	AxisAlignedBoundingBox intersection;
+	std::vector<uint32_t, CollisionHeapAllocator<uint32_t>> nodeStack;
+	nodeStack.push_back(subtreeIndex);
+	while (nodeStack.size() > 0)
+	{
+		uint32_t nodeIndex = nodeStack.back();
+		const Node& node = (*this->nodeArray)[nodeIndex];
+		nodeStack.pop_back();
+		numNodesVisited++;
+
+		if (node.secondChildIndex == 0)
+		{
+			for (uint32_t i = node.firstShape; i < node.firstShape + node.numShapes; i++)
+			{
+				const Shape* shape = (*this->shapeArray)[i];
+				if (intersection.Intersect(shape->GetBoundingBox(), box))
+					overlappingShapeArray.push_back(shape);
+			}
+
+			continue;
+		}
+
+		if (intersection.Intersect((*this->nodeArray)[node.secondChildIndex].box, box))
+			nodeStack.push_back(node.secondChildIndex);
+
+		if (intersection.Intersect((*this->nodeArray)[nodeIndex + 1].box, box))
+			nodeStack.push_back(nodeIndex + 1);
+	}
+}
+
+void StaticBoundingBoxTree::FindSubtreesOverlapping(const AxisAlignedBoundingBox& box, std::vector<uint32_t>& subtreeArray, uint32_t& numNodesVisited) const
+{
+	struct NodeDepth
+	{
+		uint32_t nodeIndex;
+		uint32_t depth;
+	};
+
+	// This goes in the same order as the GatherShapesInSubtree method, but stops at a fixed depth.
+	AxisAlignedBoundingBox intersection;
+	std::vector<NodeDepth> nodeStack;
+	nodeStack.push_back(NodeDepth{ 0, 0 });
+	while (nodeStack.size() > 0)
+	{
+		NodeDepth nodeDepth = nodeStack.back();
+		nodeStack.pop_back();
+
+		const Node& node = (*this->nodeArray)[nodeDepth.nodeIndex];
+		if (node.secondChildIndex == 0 || nodeDepth.depth == IMZADI_PARALLEL_QUERY_SPLIT_DEPTH)
+		{
+			subtreeArray.push_back(nodeDepth.nodeIndex);
+			continue;
+		}
+
+		numNodesVisited++;
+
+		if (intersection.Intersect((*this->nodeArray)[node.secondChildIndex].box, box))
+			nodeStack.push_back(NodeDepth{ node.secondChildIndex, nodeDepth.depth + 1 });
+
+		if (intersection.Intersect((*this->nodeArray)[nodeDepth.nodeIndex + 1].box, box))
+			nodeStack.push_back(NodeDepth{ nodeDepth.nodeIndex + 1, nodeDepth.depth + 1 });
+	}
+}
+
+void StaticBoundingBoxTree::RayCast(const Ray& ray, RayCastResult::HitData& hitData, bool parallel, uint32_t& numNodesVisited) const
+{
+	IMZADI_ASSERT(this->built);
+
+	NodeHit rootHit;
+	if (this->nodeArray->size() == 0 || !this->CastAgainstNode(ray, 0, rootHit) || rootHit.alpha >= hitData.alpha)
+		return;
+
+	if (!parallel)
+	{
+		this->RayCastSubtree(ray, rootHit, hitData, numNodesVisited);
+		return;
+	}
+
+	// Casting against the subtrees one after the other is the same as casting against the whole tree.
+	std::vector<NodeHit> subtreeHitArray;
+	this->FindSubtreesHitBy(ray, rootHit, subtreeHitArray, numNodesVisited);
+
+	std::vector<uint32_t> subtreeArray;
+	for (const NodeHit& subtreeHit : subtreeHitArray)
+		subtreeArray.push_back(subtreeHit.nodeIndex);
+
+	// A ray usually hits something in the first few subtrees it goes through, and then skips the rest,
+	// so only a ray going through many subtrees is worth casting against all of them at the same time.
+	if (subtreeArray.size() < IMZADI_PARALLEL_RAY_MIN_SUBTREES || this->CountShapesInSubtrees(subtreeArray) < IMZADI_PARALLEL_QUERY_MIN_SHAPES)
+	{
+		for (const NodeHit& subtreeHit : subtreeHitArray)
+			this->RayCastSubtree(ray, subtreeHit, hitData, numNodesVisited);
+
+		return;
+	}
+
+	// A serial cast goes through the subtrees in the order they were found, nearest first, skipping anything
+	// beyond the nearest hit so far.  Here, each subtree is cast against at the same time, not knowing what the
+	// others will hit, and so without skipping as much.  Going through the hits in order then tells us what
+	// the serial cast would have found.  A subtree's hit stands if nothing before it was hit, as it then saw
+	// just what the serial cast would have.  If it's no nearer than an earlier hit, the serial cast could
+	// not have found anything nearer there either.  Otherwise, the subtree is cast against again, on its
+	// own, knowing the earlier hit, which is exactly what the serial cast would have done.
+	std::vector<RayCastResult::HitData> subtreeHitDataArray(subtreeHitArray.size(), hitData);
+	std::vector<uint32_t> subtreeNodesVisitedArray(subtreeHitArray.size(), 0);
+	std::vector<uint32_t> indexArray(subtreeHitArray.size());
+	std::iota(indexArray.begin(), indexArray.end(), 0);
+	std::for_each(std::execution::par, indexArray.begin(), indexArray.end(), [&](uint32_t i)
+	{
+		this->RayCastSubtree(ray, subtreeHitArray[i], subtreeHitDataArray[i], subtreeNodesVisitedArray[i]);
+	});
+
+	bool hitFound = false;
+	for (uint32_t i = 0; i < (uint32_t)subtreeHitArray.size(); i++)
+	{
+		numNodesVisited += subtreeNodesVisitedArray[i];
+
+		if (subtreeHitDataArray[i].alpha >= hitData.alpha)
+			continue;
+
+		if (!hitFound)
+			hitData = subtreeHitDataArray[i];
+		else
+			this->RayCastSubtree(ray, subtreeHitArray[i], hitData, numNodesVisited);
+
+		hitFound = true;
+	}
+}
+
+void StaticBoundingBoxTree::RayCastSubtree(const Ray& ray, const NodeHit& subtreeHit, RayCastResult::HitData& hitData, uint32_t& numNodesVisited) const
+{
+	std::vector<NodeHit, CollisionHeapAllocator<NodeHit>> nodeStack;
+	nodeStack.push_back(subtreeHit);
+
+	while (nodeStack.size() > 0)
+	{
+		NodeHit nodeHit = nodeStack.back();
+		nodeStack.pop_back();
+
+		// A nearer hit may have been found since this node was pushed.
+		if (nodeHit.alpha >= hitData.alpha)
+			continue;
+
+		const Node& node = (*this->nodeArray)[nodeHit.nodeIndex];
+		numNodesVisited++;
+
+		if (node.secondChildIndex == 0)
+		{
+			for (uint32_t i = node.firstShape; i < node.firstShape + node.numShapes; i++)
+				BroadPhase::RayCastShape(ray, (*this->shapeArray)[i], hitData);
+
+			continue;
+		}
+
+		NodeHit childHit[2];
+		bool childHitValid[2];
+		childHitValid[0] = this->CastAgainstNode(ray, nodeHit.nodeIndex + 1, childHit[0]) && childHit[0].alpha < hitData.alpha;
+		childHitValid[1] = this->CastAgainstNode(ray, node.secondChildIndex, childHit[1]) && childHit[1].alpha < hitData.alpha;
+
+		// Push the farther child first so that the nearer child is visited first.
+		int nearIndex = (childHitValid[0] && childHitValid[1] && childHit[1].alpha < childHit[0].alpha) ? 1 : 0;
+		int farIndex = 1 - nearIndex;
+		if (childHitValid[farIndex])
+			nodeStack.push_back(childHit[farIndex]);
+		if (childHitValid[nearIndex])
+			nodeStack.push_back(childHit[nearIndex]);
+	}
+}
+
+void StaticBoundingBoxTree::FindSubtreesHitBy(const Ray& ray, const NodeHit& rootHit, std::vector<NodeHit>& subtreeHitArray, uint32_t& numNodesVisited) const
+{
+	// This goes in the same order as the RayCastSubtree method, but stops at a fixed depth.  There
+	// are no shapes above that depth, except in leaves, which end the search, so nothing is ever
+	// hit, and nothing is ever skipped for being beyond a hit.
+	std::vector<std::pair<NodeHit, uint32_t>> nodeStack;
+	nodeStack.push_back(std::pair<NodeHit, uint32_t>(rootHit, 0));
+	while (nodeStack.size() > 0)
+	{
+		NodeHit nodeHit = nodeStack.back().first;
+		uint32_t depth = nodeStack.back().second;
+		nodeStack.pop_back();
+
+		const Node& node = (*this->nodeArray)[nodeHit.nodeIndex];
+		if (node.secondChildIndex == 0 || depth == IMZADI_PARALLEL_QUERY_SPLIT_DEPTH)
+		{
+			subtreeHitArray.push_back(nodeHit);
+			continue;
+		}
+
+		numNodesVisited++;
+
+		NodeHit childHit[2];
+		bool childHitValid[2];
+		childHitValid[0] = this->CastAgainstNode(ray, nodeHit.nodeIndex + 1, childHit[0]);
+		childHitValid[1] = this->CastAgainstNode(ray, node.secondChildIndex, childHit[1]);
+
+		int nearIndex = (childHitValid[0] && childHitValid[1] && childHit[1].alpha < childHit[0].alpha) ? 1 : 0;
+		int farIndex = 1 - nearIndex;
+		if (childHitValid[farIndex])
+			nodeStack.push_back(std::pair<NodeHit, uint32_t>(childHit[farIndex], depth + 1));
+		if (childHitValid[nearIndex])
+			nodeStack.push_back(std::pair<NodeHit, uint32_t>(childHit[nearIndex], depth + 1));
+	}
+}
+
+bool StaticBoundingBoxTree::CastAgainstNode(const Ray& ray, uint32_t nodeIndex, NodeHit& nodeHit) const
+{
+	const AxisAlignedBoundingBox& box = (*this->nodeArray)[nodeIndex].box;
+	nodeHit.nodeIndex = nodeIndex;
+	nodeHit.alpha = 0.0;
+	if (box.ContainsPoint(ray.origin))
+		return true;
+
+	return ray.CastAgainst(box, nodeHit.alpha);
+}
+
+uint32_t StaticBoundingBoxTree::CountShapesInSubtrees(const std::vector<uint32_t>& subtreeArray) const
+{
+	uint32_t numShapes = 0;
+	for (uint32_t nodeIndex : subtreeArray)
+		numShapes += (*this->nodeArray)[nodeIndex].numShapes;
+
+	return numShapes;
+}
+
+void StaticBoundingBoxTree::DebugRender(DebugRenderResult* renderResult) const
+{
+	for (const Node& node : *this->nodeArray)
+		renderResult->AddLinesForBox(node.box, Vector3(0.5, 0.5, 1.0));
+}
\ No newline at end of file
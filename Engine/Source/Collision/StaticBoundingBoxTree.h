@@ -0,0 +1,191 @@
+#pragma once
+
+#include "Defines.h"
+#include "Shape.h"
+#include "Result.h"
+#include "Math/AxisAlignedBoundingBox.h"
+#include <vector>
+
+namespace Imzadi
+{
+	class Ray;
+
+	/**
+	 * This is a read-only bounding-volume hierarchy for shapes that never move, such as
+	 * the geometry of a level.  It is not a broad-phase in its own right, but is owned by
+	 * the BroadPhase class, which searches it alongside whatever structure it keeps for
+	 * the shapes that do move.
+	 *
+	 * Rather than being updated one shape at a time, the tree is built from scratch, all at
+	 * once, the first time it's searched after its set of shapes has changed.  This lets it
+	 * be built top-down, each node's shapes being divided wherever the surface area heuristic
+	 * says is best, which makes for a much tighter tree than one can get incrementally.
+	 * Nodes are packed depth-first into one array, a node's first child being right after it,
+	 * and the shapes of each leaf are packed next to one another, so the tree is walked through
+	 * two small blocks of memory.
+	 */
+	class IMZADI_API StaticBoundingBoxTree
+	{
+	public:
+		StaticBoundingBoxTree();
+		virtual ~StaticBoundingBoxTree();
+
+		/**
+		 * Add the given shape to this tree.  The tree doesn't own the shape.
+		 */
+		void Add(Shape* shape);
+
+		/**
+		 * Take the given shape out of this tree.  It must have been added to this tree.
+		 */
+		void Remove(Shape* shape);
+
+		/**
+		 * Let the tree know that one of its shapes has changed, and so it needs to be rebuilt.
+		 */
+		void Invalidate();
+
+		/**
+		 * Take all shapes out of this tree.
+		 */
+		void Clear();
+
+		/**
+		 * Rebuild the tree if its set of shapes, or any of its shapes, has changed since it
+		 * was last built.  This must be done before the tree is searched, and must not be
+		 * done while it's being searched.
+		 */
+		void BuildIfNotAlreadyBuilt();
+
+		/**
+		 * Tell the caller if the tree reflects its present set of shapes.
+		 */
+		bool IsBuilt() const { return this->built; }
+
+		/**
+		 * Return the number of shapes in this tree.
+		 */
+		uint32_t GetNumShapes() const { return (uint32_t)this->shapeArray->size(); }
+
+		/**
+		 * Add to the given list every shape in this tree whose bounding box overlaps the given box.
+		 *
+		 * @param[in] box This is the box in question.
+		 * @param[out] overlappingShapeArray The overlapping shapes are added to the end of this list, always in the same order.
+		 * @param[in] parallel If true, and enough shapes are near the box, subtrees are searched at the same time on all cores.  The shapes found, and their order, are the same either way.
+		 * @param[in,out] numNodesVisited This is incremented for every node visited.
+		 */
+		void GatherShapesOverlapping(const AxisAlignedBoundingBox& box, std::vector<const Shape*>& overlappingShapeArray, bool parallel, uint32_t& numNodesVisited) const;
+
+		/**
+		 * Cast the given ray against the shapes of this tree, replacing the given hit with any closer one.
+		 *
+		 * @param[in] ray This is the ray with which to perform the ray-cast.
+		 * @param[in,out] hitData Nothing at or beyond this hit is considered.
+		 * @param[in] parallel If true, and enough shapes are along the ray, subtrees are cast against at the same time on all cores.  The hit found is the same either way.
+		 * @param[in,out] numNodesVisited This is incremented for every node visited.
+		 */
+		void RayCast(const Ray& ray, RayCastResult::HitData& hitData, bool parallel, uint32_t& numNodesVisited) const;
+
+		/**
+		 * Draw the box of every node in the tree.
+		 */
+		void DebugRender(DebugRenderResult* renderResult) const;
+
+	private:
+
+		/**
+		 * The first child of an internal node is always the next node in the array.
+		 */
+		struct Node
+		{
+			AxisAlignedBoundingBox box;				///< This is the smallest box containing the boxes of all shapes under this node.
+			uint32_t secondChildIndex;				///< This is the index of the second child, or zero for a leaf.
+			uint32_t firstShape;					///< This is the start of the run of the shape array holding all shapes under this node.
+			uint32_t numShapes;						///< This is the length of the run of the shape array holding all shapes under this node.
+		};
+
+		/**
+		 * This is where a ray enters the box of a node.
+		 */
+		struct NodeHit
+		{
+			uint32_t nodeIndex;
+			double alpha;							///< This is zero if the ray starts inside the box.
+		};
+
+		/**
+		 * This is what we need to know about each shape while building the tree.
+		 */
+		struct BuildEntry
+		{
+			Shape* shape;
+			AxisAlignedBoundingBox box;
+			double center[3];
+		};
+
+		/**
+		 * Make a node for the given run of build entries, and then, if it has too many
+		 * shapes to be a leaf, partition the run and make the node's children from the parts.
+		 * Children with enough shapes between them are built at the same time.
+		 *
+		 * @param[in,out] nodeArray The new node, followed by all nodes under it, is added to the end of this array.
+		 * @param[in] box This is the smallest box containing those of all the given entries.
+		 * @return The index of the new node is returned.
+		 */
+		static uint32_t BuildNode(std::vector<Node>& nodeArray, std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries, const AxisAlignedBoundingBox& box);
+
+		/**
+		 * Reorder the given run of build entries so that those going to the first child come first,
+		 * choosing the plane that minimizes the surface area heuristic over a set of evenly spaced
+		 * candidate planes along each axis.
+		 *
+		 * @param[out] firstBox This is given the smallest box containing those of all entries going to the first child.
+		 * @param[out] secondBox This is given the smallest box containing those of all entries going to the second child.
+		 * @return The number of entries going to the first child is returned.  It is never zero and never all of them.
+		 */
+		static uint32_t PartitionEntries(std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries, AxisAlignedBoundingBox& firstBox, AxisAlignedBoundingBox& secondBox);
+
+		/**
+		 * Calculate the smallest box containing those of all the given run of build entries.
+		 */
+		static void CalculateBox(const std::vector<BuildEntry>& buildEntryArray, uint32_t firstEntry, uint32_t numEntries, AxisAlignedBoundingBox& box);
+
+		/**
+		 * Add to the given list every shape under the given node whose bounding box overlaps the given box, which overlaps the node's.
+		 */
+		void GatherShapesInSubtree(uint32_t subtreeIndex, const AxisAlignedBoundingBox& box, std::vector<const Shape*>& overlappingShapeArray, uint32_t& numNodesVisited) const;
+
+		/**
+		 * Find the nodes IMZADI_PARALLEL_QUERY_SPLIT_DEPTH levels down, or any leaves above them, whose boxes
+		 * overlap the given box, in the order the GatherShapesInSubtree method would get to them from the root.
+		 */
+		void FindSubtreesOverlapping(const AxisAlignedBoundingBox& box, std::vector<uint32_t>& subtreeArray, uint32_t& numNodesVisited) const;
+
+		/**
+		 * Cast the given ray against the shapes under the given node, replacing the given hit with any closer one.
+		 * Subtrees are visited nearest first, and any starting beyond the nearest hit so far are skipped.
+		 */
+		void RayCastSubtree(const Ray& ray, const NodeHit& subtreeHit, RayCastResult::HitData& hitData, uint32_t& numNodesVisited) const;
+
+		/**
+		 * Find the nodes IMZADI_PARALLEL_QUERY_SPLIT_DEPTH levels down, or any leaves above them, whose boxes the
+		 * given ray enters, in the order the RayCastSubtree method would get to them from the root.
+		 */
+		void FindSubtreesHitBy(const Ray& ray, const NodeHit& rootHit, std::vector<NodeHit>& subtreeHitArray, uint32_t& numNodesVisited) const;
+
+		/**
+		 * Find out where, if anywhere, the given ray enters the box of the given node.
+		 */
+		bool CastAgainstNode(const Ray& ray, uint32_t nodeIndex, NodeHit& nodeHit) const;
+
+		/**
+		 * Return the total number of shapes under all the given nodes.
+		 */
+		uint32_t CountShapesInSubtrees(const std::vector<uint32_t>& subtreeArray) const;
+
+		std::vector<Node>* nodeArray;				///< This is empty if the tree has no shapes.  Otherwise, the root is at index zero.
+		std::vector<Shape*>* shapeArray;			///< These are all the shapes of the tree, in leaf order once the tree is built.
+		bool built;									///< This is false if the node array doesn't reflect the shape array.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+using namespace Imzadi;
+
+//--------------------------------- SweepAndPrune ---------------------------------
+
+SweepAndPrune::SweepAndPrune()
+{
+	this->entryArray = new std::vector<Entry>();
+	this->newEntryArray = new std::vector<Entry>();
+	this->sweepAxis = 0;
+	this->numForgottenEntries = 0;
+	this->sortNeeded = true;
+}
+
+/*virtual*/ SweepAndPrune::~SweepAndPrune()
+{
+	delete this->entryArray;
+	delete this->newEntryArray;
+}
+
+void SweepAndPrune::Update(Shape* shape)
+{
+	if (shape->sweepEntryIndex == IMZADI_INVALID_SHAPE_INDEX)
+	{
+		Entry entry;
+		entry.shape = shape;
+		entry.originalShapeID = shape->GetOriginalShapeID();
+		SetEntryBox(entry, shape);
+		this->newEntryArray->push_back(entry);
+		return;
+	}
+
+	Entry& entry = (*this->entryArray)[shape->sweepEntryIndex];
+	IMZADI_ASSERT(entry.shape == shape);
+	SetEntryBox(entry, shape);
+}
+
+void SweepAndPrune::Forget(Shape* shape)
+{
+	if (shape->sweepEntryIndex == IMZADI_INVALID_SHAPE_INDEX)
+		return;
+
+	Entry& entry = (*this->entryArray)[shape->sweepEntryIndex];
+	IMZADI_ASSERT(entry.shape == shape);
+	entry.shape = nullptr;
+	shape->sweepEntryIndex = IMZADI_INVALID_SHAPE_INDEX;
+	this->numForgottenEntries++;
+}
+
+uint64_t SweepAndPrune::Sort()
+{
+	// Entries forgotten since the last sort are dropped.  Removal doesn't disturb the order,
+	// so only the shapes of entries after the first one dropped need to be told where they now are.
+	if (this->numForgottenEntries > 0)
+	{
+		auto firstDropped = std::find_if(this->entryArray->begin(), this->entryArray->end(), [](const Entry& entry) { return entry.shape == nullptr; });
+		uint32_t firstEntry = uint32_t(firstDropped - this->entryArray->begin());
+		this->entryArray->erase(std::remove_if(firstDropped, this->entryArray->end(), [](const Entry& entry) { return entry.shape == nullptr; }), this->entryArray->end());
+		this->ReindexEntries(firstEntry);
+		this->numForgottenEntries = 0;
+	}
+
+	uint64_t numShifts = 0;
+	if (!this->sortNeeded && !this->InsertionSort(numShifts))
+		this->sortNeeded = true;
+
+	if (this->newEntryArray->size() > 0)
+	{
+		// New shapes could be anywhere, so rather than shift them into place one at a time,
+		// they're sorted among themselves and merged in all at once.
+		uint32_t firstNewEntry = (uint32_t)this->entryArray->size();
+		this->entryArray->insert(this->entryArray->end(), this->newEntryArray->begin(), this->newEntryArray->end());
+		this->newEntryArray->clear();
+
+		if (!this->sortNeeded)
+		{
+			uint32_t axis = this->sweepAxis;
+			auto lessThan = [axis](const Entry& entryA, const Entry& entryB) { return entryA.min[axis] < entryB.min[axis]; };
+			auto firstNew = this->entryArray->begin() + firstNewEntry;
+			std::sort(firstNew, this->entryArray->end(), lessThan);
+			auto firstMerged = std::upper_bound(this->entryArray->begin(), firstNew, *firstNew, lessThan);
+			std::inplace_merge(firstMerged, firstNew, this->entryArray->end(), lessThan);
+			this->ReindexEntries(uint32_t(firstMerged - this->entryArray->begin()));
+		}
+	}
+
+	if (this->sortNeeded)
+	{
+		this->FullSort();
+		this->sortNeeded = false;
+	}
+
+	return numShifts;
+}
+
+bool SweepAndPrune::InsertionSort(uint64_t& numShifts)
+{
+	numShifts = 0;
+	uint64_t maxShifts = uint64_t(IMZADI_SWEEP_MAX_SHIFTS_PER_SHAPE) * this->entryArray->size();
+	uint32_t axis = this->sweepAxis;
+	std::vector<Entry>& entryArray = *this->entryArray;
+
+	for (uint32_t i = 1; i < (uint32_t)entryArray.size(); i++)
+	{
+		if (entryArray[i - 1].min[axis] <= entryArray[i].min[axis])
+			continue;
+
+		Entry entry = entryArray[i];
+		uint32_t j = i;
+		do
+		{
+			entryArray[j] = entryArray[j - 1];
+			entryArray[j].shape->sweepEntryIndex = j;
+			j--;
+		} while (j > 0 && entryArray[j - 1].min[axis] > entry.min[axis]);
+
+		entryArray[j] = entry;
+		entry.shape->sweepEntryIndex = j;
+
+		numShifts += i - j;
+		if (numShifts > maxShifts)
+			return false;
+	}
+
+	return true;
+}
+
+void SweepAndPrune::FullSort()
+{
+	// Sweeping along the axis the shapes are most spread out along keeps down the number of
+	// pairs that overlap along it, but not along the others, which the sweep has to weed out.
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	double sumOfSquares[3] = { 0.0, 0.0, 0.0 };
+	for (const Entry& entry : *this->entryArray)
+	{
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			double center = (entry.min[axis] + entry.max[axis]) / 2.0;
+			sum[axis] += center;
+			sumOfSquares[axis] += center * center;
+		}
+	}
+
+	double numEntries = double(IMZADI_MAX(this->entryArray->size(), 1));
+	double largestVariance = -1.0;
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		double mean = sum[axis] / numEntries;
+		double variance = sumOfSquares[axis] / numEntries - mean * mean;
+		if (variance > largestVariance)
+		{
+			largestVariance = variance;
+			this->sweepAxis = axis;
+		}
+	}
+
+	uint32_t axis = this->sweepAxis;
+	std::sort(this->entryArray->begin(), this->entryArray->end(), [axis](const Entry& entryA, const Entry& entryB) { return entryA.min[axis] < entryB.min[axis]; });
+	this->ReindexEntries(0);
+}
+
+void SweepAndPrune::ReindexEntries(uint32_t firstEntry)
+{
+	for (uint32_t i = firstEntry; i < (uint32_t)this->entryArray->size(); i++)
+		(*this->entryArray)[i].shape->sweepEntryIndex = i;
+}
+
+void SweepAndPrune::ForAllOverlappingPairs(std::function<void(const Shape*, const Shape*)> callback) const
+{
+	uint32_t axis = this->sweepAxis;
+	uint32_t otherAxisA = (axis + 1) % 3;
+	uint32_t otherAxisB = (axis + 2) % 3;
+	const std::vector<Entry>& entryArray = *this->entryArray;
+
+	// Everything that could overlap an entry along the sweep axis comes after it, and before the first entry starting past its end.
+	for (uint32_t i = 0; i < (uint32_t)entryArray.size(); i++)
+	{
+		const Entry& entry = entryArray[i];
+		for (uint32_t j = i + 1; j < (uint32_t)entryArray.size() && entryArray[j].min[axis] <= entry.max[axis]; j++)
+		{
+			const Entry& otherEntry = entryArray[j];
+			if (otherEntry.min[otherAxisA] > entry.max[otherAxisA] || otherEntry.max[otherAxisA] < entry.min[otherAxisA] ||
+				otherEntry.min[otherAxisB] > entry.max[otherAxisB] || otherEntry.max[otherAxisB] < entry.min[otherAxisB])
+			{
+				continue;
+			}
+
+			if (otherEntry.originalShapeID != entry.originalShapeID)
+				callback(entry.shape, otherEntry.shape);
+		}
+	}
+}
+
+void SweepAndPrune::Clear()
+{
+	this->entryArray->clear();
+	this->newEntryArray->clear();
+	this->numForgottenEntries = 0;
+	this->sortNeeded = true;
+}
+
+/*static*/ void SweepAndPrune::SetEntryBox(Entry& entry, const Shape* shape)
+{
+	const AxisAlignedBoundingBox& box = shape->GetBoundingBox();
+	box.minCorner.GetComponents(entry.min[0], entry.min[1], entry.min[2]);
+	box.maxCorner.GetComponents(entry.max[0], entry.max[1], entry.max[2]);
+}
\ No newline at end of file
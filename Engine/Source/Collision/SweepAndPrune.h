@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Defines.h"
+#include "Shape.h"
+#include "Math/AxisAlignedBoundingBox.h"
+#include <vector>
+#include <functional>
+
+namespace Imzadi
+{
+	/**
+	 * This finds every overlapping pair of boxes among a set of shapes by sorting the boxes along
+	 * one axis and sweeping across them.  It is not a broad-phase in its own right, but is owned by
+	 * the BroadPhase class, which uses it to answer the AllPairsQuery class for the shapes that move.
+	 *
+	 * The sorted order is kept from one sweep to the next.  Shapes don't move much between frames,
+	 * so the order is nearly right already, and an insertion sort puts it right in time proportional
+	 * to how far the shapes moved, rather than to how many there are.  Should the shapes have been
+	 * shuffled too much for that, such as when a level is reset, the order is simply sorted again.
+	 *
+	 * The set of shapes is kept from one sweep to the next as well.  Only shapes that have come, moved
+	 * or gone since the last sweep are given, by calling the Update or Forget methods, before the Sort
+	 * method is called.  Entries keep pointers to their shapes, so a shape must be forgotten before
+	 * it is freed.
+	 */
+	class IMZADI_API SweepAndPrune
+	{
+	public:
+		SweepAndPrune();
+		virtual ~SweepAndPrune();
+
+		/**
+		 * Include the given shape in the next sweep, going by its bounding box as it is now.
+		 * This is called for shapes not yet in the sweep, as well as for those that have moved.
+		 */
+		void Update(Shape* shape);
+
+		/**
+		 * Leave the given shape out of the next sweep.  This must be called for shapes that no longer
+		 * belong in the sweep, including those about to be freed.  It does nothing for shapes not in it.
+		 */
+		void Forget(Shape* shape);
+
+		/**
+		 * Drop all shapes forgotten since the last sort, and put the rest in order.
+		 *
+		 * @return The number of places shapes were shifted by the insertion sort, if any, is returned.
+		 */
+		uint64_t Sort();
+
+		/**
+		 * Call the given function for every pair of shapes whose bounding boxes overlap.
+		 * Pieces of the same split shape are never paired.  See Shape::GetOriginalShapeID.
+		 *
+		 * @param[in] callback This is called once per overlapping pair.
+		 */
+		void ForAllOverlappingPairs(std::function<void(const Shape*, const Shape*)> callback) const;
+
+		/**
+		 * Forget all shapes.  Shapes are not looked at, so this may be called after they've been freed.
+		 */
+		void Clear();
+
+	private:
+
+		/**
+		 * This is a shape as it was when last given, with its box spread out so that it can be indexed by axis.
+		 */
+		struct Entry
+		{
+			Shape* shape;					///< This is null if the shape has been forgotten since the last sort.
+			ShapeID originalShapeID;		///< This is the ID of the shape the entry's shape was split from, if any.
+			double min[3];					///< This is the minimum corner of the shape's bounding box.
+			double max[3];					///< This is the maximum corner of the shape's bounding box.
+		};
+
+		/**
+		 * Copy the given shape's bounding box into the given entry.
+		 */
+		static void SetEntryBox(Entry& entry, const Shape* shape);
+
+		/**
+		 * Shift entries that moved along the sweep axis back into order.  If that takes more than
+		 * IMZADI_SWEEP_MAX_SHIFTS_PER_SHAPE shifts per entry, give up part way, leaving them out of order.
+		 *
+		 * @param[out] numShifts This is given the number of places entries were shifted.
+		 * @return True is returned if the entries were put in order; false, if we gave up.
+		 */
+		bool InsertionSort(uint64_t& numShifts);
+
+		/**
+		 * Sort the entries from scratch along whichever axis their boxes are most spread out along.
+		 */
+		void FullSort();
+
+		/**
+		 * Let each shape know where its entry is, starting with the given entry.
+		 */
+		void ReindexEntries(uint32_t firstEntry);
+
+		std::vector<Entry>* entryArray;				///< These are kept sorted by the minimum of their boxes along the sweep axis.
+		std::vector<Entry>* newEntryArray;			///< These are the entries of shapes given for the first time since the last sort.
+		uint32_t sweepAxis;							///< This is the axis, 0 for X, 1 for Y and 2 for Z, along which the entries are sorted.
+		uint32_t numForgottenEntries;				///< This is the number of entries whose shapes have been forgotten since the last sort.
+		bool sortNeeded;							///< This is true if the entries must be sorted from scratch.
+	};
+}
\ No newline at end of file
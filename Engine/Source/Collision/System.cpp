@@ -16,12 +16,16 @@ CollisionSystem::CollisionSystem()
 	delete this->thread;
 }
 
-bool CollisionSystem::Initialize(const AxisAlignedBoundingBox& collsionWorldExtents)
+bool CollisionSystem::Initialize(const AxisAlignedBoundingBox& collsionWorldExtents, uint32_t numWorkerThreads /*= 0*/, BroadPhase::Type broadPhaseType /*= BroadPhase::Type::BOUNDING_BOX_TREE*/, double gridCellSize /*= IMZADI_GRID_DEFAULT_CELL_SIZE*/)
 {
 	if (this->thread)
 		return false;
 
-	this->thread = new Thread(collsionWorldExtents);
+	// Leave some cores for the main thread and whatever else the application is doing.
+	if (numWorkerThreads == 0)
+		numWorkerThreads = IMZADI_CLAMP(std::thread::hardware_concurrency() / 2, 1, 8);
+
+	this->thread = new Thread(collsionWorldExtents, numWorkerThreads, broadPhaseType, gridCellSize);
 
 	if (!this->thread->Startup())
 	{
@@ -64,6 +68,19 @@ ShapeID CollisionSystem::AddShape(Shape* shape, uint32_t flags)
 	return shapeID;
 }
 
+bool CollisionSystem::AddShapes(const std::vector<Shape*>& shapeArray, uint32_t flags)
+{
+	if (!this->thread)
+		return false;
+
+	auto command = AddShapesCommand::Create();
+	command->GetShapeArray() = shapeArray;
+	command->SetFlags(flags);
+	this->thread->SendTask(command);
+
+	return true;
+}
+
 void CollisionSystem::RemoveShape(ShapeID shapeID)
 {
 	auto command = this->Create<RemoveShapeCommand>();
@@ -85,6 +102,21 @@ bool CollisionSystem::IssueCommand(Command* command)
 	return true;
 }
 
+bool CollisionSystem::IssueCommands(CommandBatch* batch)
+{
+	if (!this->thread)
+		return false;
+
+	if (batch->GetNumTasks() > IMZADI_RESULT_SLOT_CAPACITY)
+	{
+		Task::Free(batch);
+		return false;
+	}
+
+	this->thread->SendBatch(batch);
+	return true;
+}
+
 bool CollisionSystem::MakeQuery(Query* query, TaskID& taskID)
 {
 	if (!this->thread)
@@ -94,6 +126,21 @@ bool CollisionSystem::MakeQuery(Query* query, TaskID& taskID)
 	return true;
 }
 
+bool CollisionSystem::MakeQueries(QueryBatch* batch, TaskIDRange& taskIDRange)
+{
+	if (!this->thread)
+		return false;
+
+	if (batch->GetNumTasks() > IMZADI_RESULT_SLOT_CAPACITY)
+	{
+		Task::Free(batch);
+		return false;
+	}
+
+	taskIDRange = this->thread->SendBatch(batch);
+	return true;
+}
+
 Result* CollisionSystem::ObtainQueryResult(TaskID taskID)
 {
 	if (!this->thread)
@@ -102,6 +149,17 @@ Result* CollisionSystem::ObtainQueryResult(TaskID taskID)
 	return this->thread->ReceiveResult(taskID);
 }
 
+uint32_t CollisionSystem::ObtainQueryResults(const TaskIDRange& taskIDRange, std::vector<Result*>& resultArray)
+{
+	if (!this->thread)
+	{
+		resultArray.clear();
+		return 0;
+	}
+
+	return this->thread->ReceiveResults(taskIDRange, resultArray);
+}
+
 bool CollisionSystem::FlushAllTasks()
 {
 	if (!this->thread)
@@ -111,6 +169,33 @@ bool CollisionSystem::FlushAllTasks()
 	return true;
 }
 
+bool CollisionSystem::WaitForTask(TaskID taskID)
+{
+	if (!this->thread)
+		return false;
+
+	this->thread->WaitForTask(taskID);
+	return true;
+}
+
+bool CollisionSystem::WaitForTasks(const TaskIDRange& taskIDRange)
+{
+	if (!this->thread)
+		return false;
+
+	this->thread->WaitForTasks(taskIDRange);
+	return true;
+}
+
+bool CollisionSystem::WaitForTasks(const std::vector<TaskID>& taskIDArray)
+{
+	if (!this->thread)
+		return false;
+
+	this->thread->WaitForTasks(taskIDArray);
+	return true;
+}
+
 bool CollisionSystem::DumpToFile(const std::string& fileName)
 {
 	auto command = FileCommand::Create();
@@ -129,4 +214,18 @@ bool CollisionSystem::RestoreFromFile(const std::string& fileName)
 	this->IssueCommand(command);
 	this->FlushAllTasks();
 	return true;
+}
+
+void CollisionSystem::GetHeapStats(CollisionHeap::Stats& stats) const
+{
+	CollisionHeap::Get()->GetStats(stats);
+}
+
+bool CollisionSystem::GetCommandStats(CommandStats& stats) const
+{
+	if (!this->thread)
+		return false;
+
+	this->thread->GetCommandStats(stats);
+	return true;
 }
\ No newline at end of file
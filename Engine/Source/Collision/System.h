@@ -2,6 +2,8 @@
 
 #include "Defines.h"
 #include "Task.h"
+#include "CollisionHeap.h"
+#include "BroadPhase.h"
 #include "Shape.h"
 #include "Math/AxisAlignedBoundingBox.h"
 
@@ -13,9 +15,12 @@ namespace Imzadi
 {
 	class Shape;
 	class Command;
+	class CommandBatch;
 	class Query;
+	class QueryBatch;
 	class Result;
 	class Thread;
+	struct CommandStats;
 
 	/**
 	 * This is the main interface to the collision system.  An application will typically instantiate
@@ -42,9 +47,12 @@ namespace Imzadi
 		 * Initialize the collision system.  You must call this before using the system.
 		 * 
 		 * @param collisionWorldExtents This is an AABB defining the scope of the entire collision world/system.  All shapes that will ever be created must fit in this box.
+		 * @param numWorkerThreads This is the number of threads used to execute collision tasks.  Queries are spread across these threads.  One gives single-threaded behavior, and zero picks a number based on the hardware.
+		 * @param broadPhaseType This is how shapes are spatially sorted for the broad-phase of collision detection.  See the BroadPhase class.
+		 * @param gridCellSize If the broad-phase is a grid, this is the size of its cells, which should be about that of a typical moving shape.  A grid has no bounds, so the collision world box is then ignored.
 		 * @return True is returned on success; false, otherwise.
 		 */
-		bool Initialize(const AxisAlignedBoundingBox& collsionWorldExtents);
+		bool Initialize(const AxisAlignedBoundingBox& collsionWorldExtents, uint32_t numWorkerThreads = 0, BroadPhase::Type broadPhaseType = BroadPhase::Type::BOUNDING_BOX_TREE, double gridCellSize = IMZADI_GRID_DEFAULT_CELL_SIZE);
 
 		/**
 		 * Shutdown the collision system.  You should call this before your program exits.
@@ -59,11 +67,22 @@ namespace Imzadi
 		 * Shape class derivative.
 		 * 
 		 * @param shape This is a pointer to the Shape object derivative.  Ownership of the memory is taken by the system.
-		 * @param flags This is an OR-ing of the IMZADI_ADD_FLAG_* flags.
+		 * @param flags This is an OR-ing of the IMZADI_ADD_FLAG_* flags.  Pass IMZADI_ADD_FLAG_STATIC for shapes that will never move, such as the geometry of a level.  They're kept apart from the rest in a tighter, read-only tree.
 		 * @return A handle to the collision shape is returned.  Use it to reference the shape in any command or query.
 		 */
 		ShapeID AddShape(Shape* shape, uint32_t flags);
 
+		/**
+		 * Add many collision shapes to the collision system at once.  This does the same as calling AddShape on each
+		 * shape, but is much faster for large numbers of shapes, such as all those of a level, because the broad-phase
+		 * can then place them all in one pass.  Get the ID of each shape from the shape itself before calling this.
+		 * 
+		 * @param shapeArray These are the shapes to add.  Ownership of the memory of every shape is taken by the system.
+		 * @param flags This is an OR-ing of the IMZADI_ADD_FLAG_* flags, applied to every shape.  See the AddShape method.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool AddShapes(const std::vector<Shape*>& shapeArray, uint32_t flags);
+
 		/**
 		 * Remove the collision shape from the collision system having the given shape ID.  This does nothing if
 		 * the shape ID is invalid, except generate an error.
@@ -88,12 +107,23 @@ namespace Imzadi
 		 */
 		bool IssueCommand(Command* command);
 
+		/**
+		 * Send a whole batch of commands to the collision system in one go.  This is much cheaper
+		 * than issuing each command individually.  The commands are executed in the order they
+		 * were added to the batch.  A batch of more than IMZADI_RESULT_SLOT_CAPACITY commands is refused.
+		 * 
+		 * @param[in] batch This is a pointer to a CommandBatch object.  Ownership of the memory is taken by the system, even if the batch is refused.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool IssueCommands(CommandBatch* batch);
+
 		/**
 		 * Make a collision query against the system.  Call an API function to allocate the given query.  You should
 		 * never allocate it yourself.  Allocators are typically static methods of the desired Query command
 		 * class derivative, but you can also use the Create and Free method of the System class.
 		 * 
-		 * Note that queries are always processed in the same order that they are made.
+		 * Note that queries are always processed in the same order that they are made, relative to commands.
+		 * Queries made back-to-back, with no command in between them, may be processed in parallel.
 		 * 
 		 * @param[in] query This is a pointer to Query object derivative.  Ownership of the memory is taken by the system.
 		 * @param[out] taskID A handle to the query is returned.  Use it in a call to ObtainQueryResult.
@@ -101,24 +131,49 @@ namespace Imzadi
 		 */
 		bool MakeQuery(Query* query, TaskID& taskID);
 
+		/**
+		 * Make a whole batch of queries against the system in one go.  This is much cheaper
+		 * than making each query individually.  A batch of more than IMZADI_RESULT_SLOT_CAPACITY queries is refused.
+		 * 
+		 * @param[in] batch This is a pointer to a QueryBatch object.  Ownership of the memory is taken by the system, even if the batch is refused.
+		 * @param[out] taskIDRange The handles to the queries are returned here, in the order they were added to the batch.  Use them in a call to ObtainQueryResults.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool MakeQueries(QueryBatch* batch, TaskIDRange& taskIDRange);
+
 		/**
 		 * Get the result of a collision query, if it is available.  Rather than call this
 		 * function with the possibility that the result is not yet available, it probably makes
 		 * more sense to issue all needed queries, then at a later point, stall the system until
 		 * all queries are complete.  See the FlushAllTasks function.
 		 * 
+		 * A result that is never obtained is not leaked.  It is freed once IMZADI_RESULT_SLOT_CAPACITY
+		 * more tasks have been issued, after which its handle can no longer be used to obtain it.
+		 * No more than IMZADI_RESULT_SLOT_CAPACITY tasks are ever pending at once, deferred queries included.
+		 * Issuing a task beyond that blocks the caller, who helps the collision system execute queries,
+		 * until the oldest pending task is done.
+		 * 
 		 * @param[in] taskID This is a handle to the collision query that was made; what is returned by the MakeQuery function.
 		 * @return A Result object derivative is returned.  The caller takes ownership of the memory.  See the Free function.
 		 */
 		Result* ObtainQueryResult(TaskID taskID);
 
+		/**
+		 * Get the results of all the collision queries in the given range, if they are available.
+		 * 
+		 * @param[in] taskIDRange This is the range of handles returned by the MakeQueries function.
+		 * @param[out] resultArray This gets one Result object derivative per handle of the given range, or null if not available.  The caller takes ownership of the memory.
+		 * @return The number of results obtained is returned.
+		 */
+		uint32_t ObtainQueryResults(const TaskIDRange& taskIDRange, std::vector<Result*>& resultArray);
+
 		/**
 		 * Free the memory associated with the given object.  Note that no heap-allocated object
 		 * used by the collision system should ever be created or destroyed by the collision system user
 		 * using the standard new and delete operators.  Rather, they should be created or destroyed by
 		 * the collision system user using the Create or Free methods, respectively.  This is because the
-		 * user's heap and the collision system's heap may not be the same.  The collision system might
-		 * even impliment it's own high-performance heap to boost efficiency.
+		 * user's heap and the collision system's heap may not be the same.  In fact, commands, queries
+		 * and results are allocated from the collision system's own heap.  See the CollisionHeap class.
 		 */
 		template<typename T>
 		void Free(T* object)
@@ -140,12 +195,40 @@ namespace Imzadi
 		 * Stall until all collision tasks (queries or commands) are complete.  Once this function has returned,
 		 * all previously issued commands will have been executed, and every call to ObtainQueryResult with a
 		 * valid query handle will succeed.  In other words, no command or query is pending or in flight once
-		 * this call returns with success.
+		 * this call returns with success.  Rather than sit idle, the calling thread helps the collision
+		 * system execute queries while it waits.
 		 * 
 		 * @return True is returned on success; false, otherwise.
 		 */
 		bool FlushAllTasks();
 
+		/**
+		 * Stall until the given task (query or command) is complete, but not necessarily any other.
+		 * Unlike FlushAllTasks, this lets the collision system carry on with the rest of its work
+		 * while the caller goes ahead with the result.  Once this returns with success, a call to
+		 * ObtainQueryResult with the given handle will succeed if the task was a query.
+		 * 
+		 * @param[in] taskID This is the handle returned when the task was issued.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool WaitForTask(TaskID taskID);
+
+		/**
+		 * Stall until all tasks of the given range are complete.  See the WaitForTask function.
+		 * 
+		 * @param[in] taskIDRange This is the range of handles returned by the MakeQueries function.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool WaitForTasks(const TaskIDRange& taskIDRange);
+
+		/**
+		 * Stall until all of the given tasks are complete.  See the WaitForTask function.
+		 * 
+		 * @param[in] taskIDArray These are the handles returned when the tasks were issued.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool WaitForTasks(const std::vector<TaskID>& taskIDArray);
+
 		/**
 		 * Dump the current physics world (all the shapes) to the given file.  This is mainly used
 		 * for debugging purposes.
@@ -164,6 +247,24 @@ namespace Imzadi
 		 */
 		bool RestoreFromFile(const std::string& fileName);
 
+		/**
+		 * Get a snapshot of the counters kept by the heap from which commands, queries and results
+		 * are allocated.  If the number of system allocations doesn't change from one frame to the
+		 * next, then the collision system made no system heap allocations during that frame.
+		 * 
+		 * @param[out] stats The counters are returned here.
+		 */
+		void GetHeapStats(CollisionHeap::Stats& stats) const;
+
+		/**
+		 * Get a snapshot of the counters kept by the collision thread about the commands it has been sent.
+		 * For example, this tells how many object-to-world commands were made redundant by later ones.
+		 * 
+		 * @param[out] stats The counters are returned here.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool GetCommandStats(CommandStats& stats) const;
+
 	private:
 		Thread* thread;
 	};
@@ -1,8 +1,9 @@
 #include "Task.h"
+#include "CollisionHeap.h"
 
 using namespace Imzadi;
 
-TaskID Task::nextTaskID = 0;
+std::atomic<TaskID> Task::nextTaskID(0);
 
 Task::Task()
 {
@@ -13,7 +14,69 @@ Task::Task()
 {
 }
 
+/*virtual*/ bool Task::IsReadOnly() const
+{
+	return false;
+}
+
 /*static*/ void Task::Free(Task* task)
 {
 	delete task;
+}
+
+/*static*/ void* Task::operator new(size_t size)
+{
+	return CollisionHeap::Get()->Allocate(size);
+}
+
+/*static*/ void Task::operator delete(void* memory, size_t size)
+{
+	CollisionHeap::Get()->Deallocate(memory, size);
+}
+
+//------------------------------- TaskBatch -------------------------------
+
+TaskBatch::TaskBatch()
+{
+	this->taskArray = CollisionHeap::Get()->New<TaskArray>();
+}
+
+/*virtual*/ TaskBatch::~TaskBatch()
+{
+	for (Task* task : *this->taskArray)
+		Task::Free(task);
+
+	CollisionHeap::Get()->Delete(this->taskArray);
+}
+
+/*virtual*/ void TaskBatch::Execute(Thread* thread)
+{
+	for (Task* task : *this->taskArray)
+		task->Execute(thread);
+}
+
+/*virtual*/ bool TaskBatch::IsReadOnly() const
+{
+	for (const Task* task : *this->taskArray)
+		if (!task->IsReadOnly())
+			return false;
+
+	return true;
+}
+
+void TaskBatch::AddTask(Task* task)
+{
+	this->taskArray->push_back(task);
+}
+
+TaskIDRange TaskBatch::AssignTaskIDs()
+{
+	TaskIDRange taskIDRange;
+	taskIDRange.numTaskIDs = (uint32_t)this->taskArray->size();
+	taskIDRange.firstTaskID = nextTaskID.fetch_add(taskIDRange.numTaskIDs);
+
+	for (uint32_t i = 0; i < taskIDRange.numTaskIDs; i++)
+		(*this->taskArray)[i]->taskID = taskIDRange[i];
+
+	return taskIDRange;
 }
\ No newline at end of file
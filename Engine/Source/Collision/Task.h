@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Defines.h"
+#include "CollisionHeap.h"
 #include <stdint.h>
+#include <atomic>
+#include <vector>
 
 namespace Imzadi
 {
@@ -9,8 +12,29 @@ namespace Imzadi
 
 	class Thread;
 
+	/**
+	 * This is a contiguous range of task IDs, such as is handed out for the tasks of a batch.
+	 */
+	struct IMZADI_API TaskIDRange
+	{
+		TaskID firstTaskID;		///< This is the ID of the first task in the range.
+		uint32_t numTaskIDs;	///< This is the number of task IDs in the range.
+
+		/**
+		 * Return the i-th task ID of this range.  No bounds checking is done.
+		 */
+		TaskID operator[](uint32_t i) const { return this->firstTaskID + i; }
+
+		/**
+		 * Tell the caller if the given task ID falls within this range.
+		 */
+		bool Contains(TaskID taskID) const { return taskID - this->firstTaskID < this->numTaskIDs; }
+	};
+
 	class IMZADI_API Task
 	{
+		friend class TaskBatch;
+
 	public:
 		Task();
 		virtual ~Task();
@@ -23,6 +47,14 @@ namespace Imzadi
 		 */
 		virtual void Execute(Thread* thread) = 0;
 
+		/**
+		 * Tell the caller if this task leaves the collision world unchanged.
+		 * Read-only tasks may be executed in parallel with one another, while
+		 * all other tasks are executed one at a time in the order they were issued.
+		 * By default, a task is assumed to modify the collision world.
+		 */
+		virtual bool IsReadOnly() const;
+
 		/**
 		 * Get the unique identifier for this task.  These IDs are used as safe
 		 * handles the caller can use instead of pointer than can potentially
@@ -39,8 +71,75 @@ namespace Imzadi
 		 */
 		static void Free(Task* task);
 
+		/**
+		 * Tasks are allocated from the collision heap rather than the system heap.
+		 * See the CollisionHeap class.
+		 */
+		static void* operator new(size_t size);
+
+		/**
+		 * Give the memory of a task back to the collision heap.
+		 */
+		static void operator delete(void* memory, size_t size);
+
 	private:
 		TaskID taskID;
-		static TaskID nextTaskID;
+		static std::atomic<TaskID> nextTaskID;
+	};
+
+	/**
+	 * A batch is a group of tasks that are gathered up on the caller's side and then
+	 * handed over to the collision thread all in one go.  Sending a batch of many
+	 * tasks costs the same synchronization as sending a single task.  Once the batch
+	 * is received, the collision thread treats each of its tasks just as if they had
+	 * been sent one after another, in the order they were added to the batch.
+	 * 
+	 * When a batch is sent, its tasks are given a contiguous range of task IDs,
+	 * so the IDs the tasks may have had before the batch was sent are not valid.
+	 * 
+	 * Users should use the CommandBatch or QueryBatch derivatives of this class.
+	 */
+	class IMZADI_API TaskBatch : public Task
+	{
+		friend class Thread;
+
+	public:
+		TaskBatch();
+		virtual ~TaskBatch();
+
+		/**
+		 * The collision thread unpacks a batch before executing it, so this is not
+		 * normally called.  If it is, then all the tasks of the batch are executed in order.
+		 */
+		virtual void Execute(Thread* thread) override;
+
+		/**
+		 * A batch is read-only if all of its tasks are read-only.
+		 */
+		virtual bool IsReadOnly() const override;
+
+		/**
+		 * Return the number of tasks in this batch.
+		 */
+		uint32_t GetNumTasks() const { return (uint32_t)this->taskArray->size(); }
+
+	protected:
+
+		/**
+		 * Add the given task to the end of this batch.  The batch takes ownership of the memory.
+		 */
+		void AddTask(Task* task);
+
+	private:
+
+		/**
+		 * Give every task of this batch a new task ID from a contiguous range of such.
+		 * 
+		 * @return The range of task IDs assigned is returned, in the order the tasks were added.
+		 */
+		TaskIDRange AssignTaskIDs();
+
+		typedef std::vector<Task*, CollisionHeapAllocator<Task*>> TaskArray;
+		TaskArray* taskArray;
 	};
 }
\ No newline at end of file
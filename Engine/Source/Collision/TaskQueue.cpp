@@ -0,0 +1,106 @@
+#include "TaskQueue.h"
+#include "Task.h"
+#include <thread>
+
+using namespace Imzadi;
+
+TaskQueue::TaskQueue(uint32_t capacity)
+{
+	this->capacity = 2;
+	while (this->capacity < capacity)
+		this->capacity <<= 1;
+
+	this->mask = this->capacity - 1;
+	this->cellArray = new Cell[this->capacity];
+	for (uint32_t i = 0; i < this->capacity; i++)
+	{
+		this->cellArray[i].sequence.store(i, std::memory_order_relaxed);
+		this->cellArray[i].task = nullptr;
+	}
+
+	this->enqueuePosition.store(0, std::memory_order_relaxed);
+	this->dequeuePosition.store(0, std::memory_order_relaxed);
+}
+
+/*virtual*/ TaskQueue::~TaskQueue()
+{
+	delete[] this->cellArray;
+}
+
+void TaskQueue::Push(Task* task)
+{
+	while (!this->TryPush(task))
+		std::this_thread::yield();
+}
+
+bool TaskQueue::TryPush(Task* task)
+{
+	uint64_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		Cell* cell = &this->cellArray[position & this->mask];
+		uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+		int64_t difference = int64_t(sequence) - int64_t(position);
+
+		if (difference == 0)
+		{
+			// The cell is free.  Try to claim it.  On failure, the position is reloaded for us.
+			if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				cell->task = task;
+				cell->sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			// The cell still holds a task from one lap ago.  The queue is full.
+			return false;
+		}
+		else
+		{
+			// Another producer claimed this cell before us.  Try again further along.
+			position = this->enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool TaskQueue::TryPop(Task*& task)
+{
+	uint64_t position = this->dequeuePosition.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		Cell* cell = &this->cellArray[position & this->mask];
+		uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+		int64_t difference = int64_t(sequence) - int64_t(position + 1);
+
+		if (difference == 0)
+		{
+			if (this->dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				task = cell->task;
+				cell->task = nullptr;
+				cell->sequence.store(position + this->capacity, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			// Nothing has been published to this cell yet.  The queue is empty.
+			return false;
+		}
+		else
+		{
+			position = this->dequeuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+uint32_t TaskQueue::GetSize() const
+{
+	uint64_t enqueuePosition = this->enqueuePosition.load(std::memory_order_relaxed);
+	uint64_t dequeuePosition = this->dequeuePosition.load(std::memory_order_relaxed);
+	return (enqueuePosition > dequeuePosition) ? uint32_t(enqueuePosition - dequeuePosition) : 0;
+}
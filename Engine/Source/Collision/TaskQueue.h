@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Defines.h"
+#include <stdint.h>
+#include <atomic>
+
+namespace Imzadi
+{
+	class Task;
+
+	/**
+	 * This is a bounded, lock-free ring queue of tasks.  Any number of threads may push
+	 * tasks into the queue at the same time, while the collision thread pops them off.
+	 * All memory is allocated up-front, so no push or pop ever touches the heap.
+	 * 
+	 * Each cell of the ring carries a sequence number telling producers and consumers
+	 * whose turn it is to use that cell.  A producer claims a cell by advancing the
+	 * enqueue position with a CAS, writes its task, and then publishes it by bumping
+	 * the cell's sequence number.  A consumer does the mirror image of this.  This is
+	 * the well-known bounded queue design of Dmitry Vyukov.
+	 * 
+	 * The capacity of the queue is not a hard limit on the number of tasks in flight.
+	 * If the queue fills up, a push simply waits for the consumer to make room.
+	 */
+	class IMZADI_API TaskQueue
+	{
+	public:
+		/**
+		 * @param[in] capacity This is the number of cells in the ring.  It gets rounded up to a power of two.
+		 */
+		TaskQueue(uint32_t capacity);
+		virtual ~TaskQueue();
+
+		/**
+		 * Add the given task to the back of the queue.  This is safe to call from any thread.
+		 * If the queue is full, this yields until the consumer makes room.
+		 * 
+		 * @param[in] task This is the task to enqueue.
+		 */
+		void Push(Task* task);
+
+		/**
+		 * Try to add the given task to the back of the queue.
+		 * 
+		 * @param[in] task This is the task to enqueue.
+		 * @return False is returned if the queue is full; true, otherwise.
+		 */
+		bool TryPush(Task* task);
+
+		/**
+		 * Try to remove the task at the front of the queue.
+		 * 
+		 * @param[out] task This is assigned the task that was dequeued, if any.
+		 * @return False is returned if the queue is empty; true, otherwise.
+		 */
+		bool TryPop(Task*& task);
+
+		/**
+		 * Return the number of cells in the ring.
+		 */
+		uint32_t GetCapacity() const { return this->capacity; }
+
+		/**
+		 * Return a snapshot of how many tasks are in the queue.  This is only approximate
+		 * if other threads are pushing or popping at the same time.
+		 */
+		uint32_t GetSize() const;
+
+	private:
+
+		struct Cell
+		{
+			std::atomic<uint64_t> sequence;
+			Task* task;
+		};
+
+		Cell* cellArray;
+		uint32_t capacity;
+		uint64_t mask;
+
+		alignas(64) std::atomic<uint64_t> enqueuePosition;		///< Producers contend for this, so we keep it on its own cache line.
+		alignas(64) std::atomic<uint64_t> dequeuePosition;		///< Only the consumer touches this.
+	};
+}
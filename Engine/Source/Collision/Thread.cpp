@@ -6,29 +6,64 @@
 #include <format>
 #include <ostream>
 #include <istream>
+#include <chrono>
 
 using namespace Imzadi;
 
-Thread::Thread(const AxisAlignedBoundingBox& collisionWorldExtents) : boxTree(collisionWorldExtents)
+Thread::Thread(const AxisAlignedBoundingBox& collisionWorldExtents, uint32_t numWorkerThreads, BroadPhase::Type broadPhaseType, double gridCellSize)
 {
+	this->broadPhase = BroadPhase::Create(broadPhaseType, collisionWorldExtents, gridCellSize);
+	if (!this->broadPhase)
+		this->broadPhase = BroadPhase::Create(BroadPhase::Type::BOUNDING_BOX_TREE, collisionWorldExtents, gridCellSize);
+
 	this->thread = nullptr;
 	this->signaledToExit = false;
-	this->taskQueue = new std::list<Task*>();
-	this->taskQueueMutex = new std::mutex();
-	this->taskQueueSemaphore = new std::counting_semaphore<4096>(0);
-	this->resultMap = new std::unordered_map<TaskID, Result*>();
-	this->resultMapMutex = new std::mutex();
-	this->allTasksDoneCondVar = new std::condition_variable();
+	this->taskQueue = new TaskQueue(IMZADI_TASK_QUEUE_CAPACITY);
+	this->stagedTaskArray = new std::vector<Task*>();
+	this->stagedTaskArray->reserve(IMZADI_TASK_QUEUE_CAPACITY);
+	this->stagedTaskIndex = 0;
+	this->stagedMoveMap = CollisionHeap::Get()->New<StagedMoveMap>();
+	this->numObjectToWorldCommands = 0;
+	this->numObjectToWorldCommandsElided = 0;
+	this->deferredTaskArray = new std::vector<Task*>();
+	this->numPendingTasks = 0;
+	this->taskSignal = 0;
+	this->collisionThreadWaiting = false;
+	this->resultSlotArray = new ResultSlotArray(IMZADI_RESULT_SLOT_CAPACITY);
+	this->numWorkerThreads = IMZADI_MAX(numWorkerThreads, 1);
+	this->statistics = new CollisionStatistics();
+	this->broadPhase->SetStatistics(this->statistics);
+	this->workerThreadArray = new std::vector<std::thread*>();
+	this->parallelTaskArray = new std::vector<Task*>();
+	this->parallelTaskIndex = 0;
+	this->parallelTasksRemaining = 0;
+	this->parallelRunMutex = new std::mutex();
+	this->parallelRunStartCondVar = new std::condition_variable();
+	this->parallelRunDoneCondVar = new std::condition_variable();
+	this->parallelRunGeneration = 0;
+	this->numBusyWorkers = 0;
+	this->workersSignaledToExit = false;
+	this->assistCondVar = new std::condition_variable();
+	this->numAssistingThreads = 0;
+	this->assistConditionArray = new std::vector<const std::function<bool()>*>();
 }
 
 /*virtual*/ Thread::~Thread()
 {
 	delete this->taskQueue;
-	delete this->taskQueueMutex;
-	delete this->taskQueueSemaphore;
-	delete this->resultMap;
-	delete this->resultMapMutex;
-	delete this->allTasksDoneCondVar;
+	delete this->stagedTaskArray;
+	CollisionHeap::Get()->Delete(this->stagedMoveMap);
+	delete this->deferredTaskArray;
+	delete this->resultSlotArray;
+	delete this->broadPhase;
+	delete this->statistics;
+	delete this->workerThreadArray;
+	delete this->parallelTaskArray;
+	delete this->parallelRunMutex;
+	delete this->parallelRunStartCondVar;
+	delete this->parallelRunDoneCondVar;
+	delete this->assistCondVar;
+	delete this->assistConditionArray;
 }
 
 bool Thread::Startup()
@@ -39,6 +74,11 @@ bool Thread::Startup()
 	this->signaledToExit = false;
 	this->thread = new std::thread(&Thread::EntryFunc, this);
 
+	// The collision thread counts as one of the workers.
+	this->workersSignaledToExit = false;
+	for (uint32_t i = 1; i < this->numWorkerThreads; i++)
+		this->workerThreadArray->push_back(new std::thread(&Thread::WorkerEntryFunc, this));
+
 	return true;
 }
 
@@ -52,9 +92,29 @@ bool Thread::Shutdown()
 		this->thread = nullptr;
 	}
 
+	this->ShutdownWorkers();
+
 	return true;
 }
 
+void Thread::ShutdownWorkers()
+{
+	{
+		std::lock_guard<std::mutex> guard(*this->parallelRunMutex);
+		this->workersSignaledToExit = true;
+	}
+
+	this->parallelRunStartCondVar->notify_all();
+
+	for (std::thread* workerThread : *this->workerThreadArray)
+	{
+		workerThread->join();
+		delete workerThread;
+	}
+
+	this->workerThreadArray->clear();
+}
+
 /*static*/ void Thread::EntryFunc(Thread* thread)
 {
 	thread->Run();
@@ -62,41 +122,78 @@ bool Thread::Shutdown()
 
 void Thread::Run()
 {
+	std::vector<Task*> taskArray;
+
 	while (!this->signaledToExit)
 	{
 		// Don't eat up any CPU resources if there are no tasks queued.
-		// The semaphore count mirrors the size of the task queue.
-		this->taskQueueSemaphore->acquire();
+		// Deferred tasks are only gotten to once there's nothing else to do.
+		if (this->stagedTaskIndex == this->stagedTaskArray->size())
+		{
+			this->stagedTaskArray->clear();
+			this->stagedTaskIndex = 0;
+			this->stagedMoveMap->clear();
+			if (this->deferredTaskArray->size() > 0 && this->taskQueue->GetSize() == 0)
+				this->RestageDeferredTasks();
+			else
+				this->WaitForQueuedTasks();
+		}
+
+		this->StageQueuedTasks();
+
+		if (this->stagedTaskIndex == this->stagedTaskArray->size())
+			continue;
+
+		// Grab the next task.  If it's read-only, then also grab all read-only tasks
+		// immediately following it, because these can all be executed in parallel
+		// against the same state of the collision world.  Even without workers, this is
+		// worth doing if someone is waiting on us, because they'll lend a hand.
+		taskArray.clear();
+		Task* task = (*this->stagedTaskArray)[this->stagedTaskIndex++];
+		if (this->DeferIfOverdue(task))
+			continue;
 
-		// Grab the next task, but don't pull it off the queue just yet.
-		Task* task = nullptr;
-		if (this->taskQueue->size() > 0)
+		taskArray.push_back(task);
+		if ((this->numWorkerThreads > 1 || this->numAssistingThreads.load() > 0) && task->IsReadOnly())
 		{
-			std::lock_guard<std::mutex> guard(*this->taskQueueMutex);
-			if (this->taskQueue->size() > 0)
+			while (this->stagedTaskIndex < this->stagedTaskArray->size())
 			{
-				std::list<Task*>::iterator iter = this->taskQueue->begin();
-				task = *iter;
+				task = (*this->stagedTaskArray)[this->stagedTaskIndex];
+				if (!task->IsReadOnly())
+					break;
+
+				this->stagedTaskIndex++;
+				if (!this->DeferIfOverdue(task))
+					taskArray.push_back(task);
 			}
 		}
 
-		if (task)
+		// Static shapes are only sorted once something is about to look at them,
+		// so that adding a level's worth of them one at a time costs one build.
+		// Likewise, the moving shapes are only re-sorted, and the collision cache
+		// only trimmed, once queries are coming.
+		if (taskArray[0]->IsReadOnly())
 		{
-			// Process the task.
-			task->Execute(this);
-			Task::Free(task);
-			task = nullptr;
-		
-			// Once processed, we can remove it from the queue.  This way, our wait
-			// operation returns when all tasks are truely completed.
-			{
-				std::lock_guard<std::mutex> guard(*this->taskQueueMutex);
-				std::list<Task*>::iterator iter = this->taskQueue->begin();
-				this->taskQueue->erase(iter);
-				if (this->taskQueue->size() == 0)
-					this->allTasksDoneCondVar->notify_one();
-			}
+			this->broadPhase->BuildStaticTreeIfNotAlreadyBuilt();
+			this->broadPhase->RebuildIfDegraded();
+			this->broadPhase->TrimCollisionCache();
 		}
+
+		// A task run on its own would leave any other cores idle, so let it spread its work across them.
+		this->broadPhase->SetParallelQueries(taskArray.size() == 1 && this->numWorkerThreads > 1);
+
+		// Process the task(s).
+		if (taskArray.size() == 1)
+			this->ExecuteTask(taskArray[0]);
+		else
+			this->ExecuteInParallel(taskArray);
+
+		for (Task* task : taskArray)
+			Task::Free(task);
+
+		// Only now are the tasks considered complete.  This way, our wait
+		// operation returns when all tasks are truely completed.
+		this->RetireTasks((uint32_t)taskArray.size());
 	}
 
 	this->ClearTasks();
@@ -104,107 +201,499 @@ void Thread::Run()
 	this->ClearShapes();
 }
 
+void Thread::StageQueuedTasks()
+{
+	Task* task = nullptr;
+	while (this->taskQueue->TryPop(task))
+	{
+		// Batches are unpacked here so that their tasks are staged just as if they had been sent one by one.
+		auto batch = dynamic_cast<TaskBatch*>(task);
+		if (!batch)
+			this->StageTask(task);
+		else
+		{
+			for (Task* batchTask : *batch->taskArray)
+				this->StageTask(batchTask);
+
+			batch->taskArray->clear();
+			Task::Free(batch);
+		}
+	}
+}
+
+void Thread::StageTask(Task* task)
+{
+	auto query = dynamic_cast<Query*>(task);
+	if (!query)
+	{
+		auto objectToWorldCommand = dynamic_cast<ObjectToWorldCommand*>(task);
+		if (objectToWorldCommand)
+		{
+			if (this->CoalesceCommand(objectToWorldCommand))
+				return;
+		}
+		else
+		{
+			// Any other command that affects a shape keeps later moves of the shape from being folded into earlier ones.
+			auto shapeCommand = dynamic_cast<ShapeCommand*>(task);
+			if (shapeCommand)
+				this->stagedMoveMap->erase(shapeCommand->GetShapeID());
+			else
+				this->stagedMoveMap->clear();
+		}
+
+		this->stagedTaskArray->push_back(task);
+		return;
+	}
+
+	// The query might look at any shape, so no move staged before it can take on a move staged after it.
+	this->stagedMoveMap->clear();
+
+	if (query->GetPriority() != Query::Priority::HIGH)
+	{
+		this->stagedTaskArray->push_back(task);
+		return;
+	}
+
+	// Move the query up the line past everything it doesn't depend on.  It doesn't
+	// depend on other queries, but it shouldn't cut ahead of other high-priority ones.
+	uint32_t i = (uint32_t)this->stagedTaskArray->size();
+	while (i > this->stagedTaskIndex)
+	{
+		Task* otherTask = (*this->stagedTaskArray)[i - 1];
+
+		auto otherQuery = dynamic_cast<Query*>(otherTask);
+		if (otherQuery)
+		{
+			if (otherQuery->GetPriority() == Query::Priority::HIGH)
+				break;
+		}
+		else
+		{
+			auto command = dynamic_cast<Command*>(otherTask);
+			if (!command || query->DependsOn(command, this))
+				break;
+		}
+
+		i--;
+	}
+
+	this->stagedTaskArray->insert(this->stagedTaskArray->begin() + i, task);
+}
+
+bool Thread::CoalesceCommand(ObjectToWorldCommand* command)
+{
+	this->numObjectToWorldCommands.fetch_add(1, std::memory_order_relaxed);
+
+	uint32_t stagedIndex = (uint32_t)this->stagedTaskArray->size();
+	auto pair = this->stagedMoveMap->insert(std::pair<ShapeID, uint32_t>(command->GetShapeID(), stagedIndex));
+	if (pair.second)
+		return false;
+
+	// A move that has already been executed can't take on anything.  Ours takes its place.
+	uint32_t& pendingIndex = pair.first->second;
+	if (pendingIndex < this->stagedTaskIndex)
+	{
+		pendingIndex = stagedIndex;
+		return false;
+	}
+
+	auto pendingCommand = static_cast<ObjectToWorldCommand*>((*this->stagedTaskArray)[pendingIndex]);
+	pendingCommand->Absorb(command);
+
+	Task::Free(command);
+	this->RetireTasks(1);
+
+	this->numObjectToWorldCommandsElided.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool Thread::DeferIfOverdue(Task* task)
+{
+	auto query = dynamic_cast<Query*>(task);
+	if (!query || !query->IsOverdue())
+		return false;
+
+	// The query gets to go next time no matter what.
+	query->ClearDeadline();
+	this->deferredTaskArray->push_back(task);
+
+	// A flush shouldn't wait on the query now that it has been set aside.
+	this->RetireTasks(1);
+	return true;
+}
+
+void Thread::RestageDeferredTasks()
+{
+	this->numPendingTasks += (uint32_t)this->deferredTaskArray->size();
+
+	for (Task* task : *this->deferredTaskArray)
+		this->stagedTaskArray->push_back(task);
+
+	this->deferredTaskArray->clear();
+}
+
+void Thread::WaitForQueuedTasks()
+{
+	// Let senders know we may be going to sleep before we check the queue one last time.
+	// Any task pushed after we read the signal will change it, so the wait can't miss it.
+	this->collisionThreadWaiting = true;
+	uint32_t signal = this->taskSignal.load();
+	if (this->taskQueue->GetSize() == 0)
+		this->taskSignal.wait(signal);
+	this->collisionThreadWaiting = false;
+}
+
+void Thread::RetireTasks(uint32_t numTasks)
+{
+	if (numTasks == 0)
+		return;
+
+	this->numPendingTasks.fetch_sub(numTasks);
+
+	// Wake up the assisting threads, but only if what one of them is waiting on has come to pass.
+	// Waking them on every retirement would just have them fight us for the CPU.
+	if (this->numAssistingThreads.load() > 0)
+	{
+		std::lock_guard<std::mutex> guard(*this->parallelRunMutex);
+		for (const std::function<bool()>* isDone : *this->assistConditionArray)
+		{
+			if ((*isDone)())
+			{
+				this->assistCondVar->notify_all();
+				break;
+			}
+		}
+	}
+}
+
+/*static*/ void Thread::WorkerEntryFunc(Thread* thread)
+{
+	thread->WorkerRun();
+}
+
+void Thread::WorkerRun()
+{
+	uint64_t lastGeneration = 0;
+
+	while (true)
+	{
+		uint32_t numTasks = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(*this->parallelRunMutex);
+			this->parallelRunStartCondVar->wait(lock, [this, lastGeneration]() { return this->workersSignaledToExit || this->parallelRunGeneration != lastGeneration; });
+			if (this->workersSignaledToExit)
+				break;
+
+			lastGeneration = this->parallelRunGeneration;
+			numTasks = (uint32_t)this->parallelTaskArray->size();
+			this->numBusyWorkers++;
+		}
+
+		this->ExecuteParallelTasks(numTasks);
+
+		{
+			std::lock_guard<std::mutex> guard(*this->parallelRunMutex);
+			this->numBusyWorkers--;
+		}
+
+		this->parallelRunDoneCondVar->notify_one();
+	}
+}
+
+void Thread::ExecuteInParallel(const std::vector<Task*>& taskArray)
+{
+	// Post the run for the workers.  A worker that woke up too late for the previous run
+	// might still be looking at it, so we have to wait for it to leave first.
+	{
+		std::unique_lock<std::mutex> lock(*this->parallelRunMutex);
+		this->parallelRunDoneCondVar->wait(lock, [this]() { return this->numBusyWorkers == 0; });
+		*this->parallelTaskArray = taskArray;
+		this->parallelTaskIndex = 0;
+		this->parallelTasksRemaining = (uint32_t)taskArray.size();
+		this->parallelRunGeneration++;
+	}
+
+	this->parallelRunStartCondVar->notify_all();
+	this->assistCondVar->notify_all();
+
+	// Pitch in while the workers are doing the same.
+	this->ExecuteParallelTasks((uint32_t)taskArray.size());
+
+	// Don't return until every task is done and no worker is still looking at the run.
+	// The latter condition keeps late-waking workers from seeing the next run half-posted.
+	{
+		std::unique_lock<std::mutex> lock(*this->parallelRunMutex);
+		this->parallelRunDoneCondVar->wait(lock, [this]() { return this->parallelTasksRemaining == 0 && this->numBusyWorkers == 0; });
+		this->parallelTaskArray->clear();
+	}
+}
+
+void Thread::AssistUntil(const std::function<bool()>& isDone)
+{
+	if (isDone())
+		return;
+
+	// We announce ourselves before checking the condition again, and the collision thread retires
+	// tasks before looking for assistants, so one of us is sure to see the other.
+	this->numAssistingThreads++;
+
+	std::unique_lock<std::mutex> lock(*this->parallelRunMutex);
+	this->assistConditionArray->push_back(&isDone);
+	while (true)
+	{
+		this->assistCondVar->wait(lock, [this, &isDone]() { return isDone() || this->IsParallelRunOpen(); });
+		if (isDone())
+			break;
+
+		// Join the run just like a worker would.  The collision thread won't post another
+		// run, or return from this one, until we've left it.
+		uint32_t numTasks = (uint32_t)this->parallelTaskArray->size();
+		this->numBusyWorkers++;
+		lock.unlock();
+
+		this->ExecuteParallelTasks(numTasks);
+
+		lock.lock();
+		this->numBusyWorkers--;
+		this->parallelRunDoneCondVar->notify_one();
+	}
+
+	std::erase(*this->assistConditionArray, &isDone);
+	lock.unlock();
+	this->numAssistingThreads--;
+}
+
+bool Thread::IsParallelRunOpen() const
+{
+	return this->parallelTaskIndex.load() < (uint32_t)this->parallelTaskArray->size();
+}
+
+void Thread::ExecuteTask(Task* task)
+{
+	auto startTime = std::chrono::steady_clock::now();
+	task->Execute(this);
+	auto executionTime = std::chrono::steady_clock::now() - startTime;
+	this->statistics->RecordTaskExecution(task, std::chrono::duration_cast<std::chrono::nanoseconds>(executionTime).count());
+
+	// Anyone interested in this task can know it's done now, even though it hasn't been retired yet.
+	this->FinishTask(task);
+}
+
+void Thread::FinishTask(Task* task)
+{
+	this->resultSlotArray->Finish(task->GetTaskID());
+
+	auto objectToWorldCommand = dynamic_cast<ObjectToWorldCommand*>(task);
+	if (objectToWorldCommand)
+	{
+		const ObjectToWorldCommand::TaskIDArray* absorbedTaskIDArray = objectToWorldCommand->GetAbsorbedTaskIDArray();
+		if (absorbedTaskIDArray)
+			for (TaskID taskID : *absorbedTaskIDArray)
+				this->resultSlotArray->Finish(taskID);
+	}
+}
+
+void Thread::ExecuteParallelTasks(uint32_t numTasks)
+{
+	while (true)
+	{
+		uint32_t i = this->parallelTaskIndex.fetch_add(1);
+		if (i >= numTasks)
+			break;
+
+		Task* task = (*this->parallelTaskArray)[i];
+		this->ExecuteTask(task);
+
+		if (this->parallelTasksRemaining.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> guard(*this->parallelRunMutex);
+			this->parallelRunDoneCondVar->notify_one();
+		}
+	}
+}
+
 void Thread::ClearTasks()
 {
-	std::lock_guard<std::mutex> guard(*this->taskQueueMutex);
-	while (this->taskQueue->size() > 0)
+	uint32_t numTasks = 0;
+
+	for (uint32_t i = this->stagedTaskIndex; i < (uint32_t)this->stagedTaskArray->size(); i++)
 	{
-		std::list<Task*>::iterator iter = this->taskQueue->begin();
-		Task* task = *iter;
+		Task* task = (*this->stagedTaskArray)[i];
+		this->FinishTask(task);
 		Task::Free(task);
-		this->taskQueue->erase(iter);
+		numTasks++;
 	}
+
+	this->stagedTaskArray->clear();
+	this->stagedTaskIndex = 0;
+	this->stagedMoveMap->clear();
+
+	// These were already retired when they were deferred.
+	for (Task* task : *this->deferredTaskArray)
+	{
+		this->resultSlotArray->Finish(task->GetTaskID());
+		Task::Free(task);
+	}
+
+	this->deferredTaskArray->clear();
+
+	Task* task = nullptr;
+	while (this->taskQueue->TryPop(task))
+	{
+		auto batch = dynamic_cast<TaskBatch*>(task);
+		if (!batch)
+		{
+			this->resultSlotArray->Finish(task->GetTaskID());
+			numTasks++;
+		}
+		else
+		{
+			for (const Task* batchTask : *batch->taskArray)
+				this->resultSlotArray->Finish(batchTask->GetTaskID());
+			numTasks += batch->GetNumTasks();
+		}
+
+		Task::Free(task);
+	}
+
+	this->RetireTasks(numTasks);
+}
+
+void Thread::GetCommandStats(CommandStats& stats) const
+{
+	stats.numObjectToWorldCommands = this->numObjectToWorldCommands.load(std::memory_order_relaxed);
+	stats.numObjectToWorldCommandsElided = this->numObjectToWorldCommandsElided.load(std::memory_order_relaxed);
+}
+
+void Thread::TakeStatisticsSnapshot(CollisionStatistics::Snapshot& snapshot, bool reset)
+{
+	this->statistics->TakeSnapshot(snapshot);
+	snapshot.queueDepth = this->numPendingTasks.load(std::memory_order_relaxed);
+
+	if (reset)
+		this->statistics->Reset();
 }
 
 void Thread::ClearResults()
 {
-	std::lock_guard<std::mutex> guard(*this->resultMapMutex);
-	while (this->resultMap->size() > 0)
-	{
-		std::unordered_map<TaskID, Result*>::iterator iter = this->resultMap->begin();
-		Result* result = iter->second;
-		Result::Free(result);
-		this->resultMap->erase(iter);
-	}
+	this->resultSlotArray->Clear();
 }
 
 void Thread::ClearShapes()
 {
-	this->boxTree.Clear();
+	this->broadPhase->Clear();
 }
 
 void Thread::AddShape(Shape* shape, uint32_t flags)
 {
 	ShapeID shapeID = shape->GetShapeID();
 
-	if (!this->boxTree.Insert(shape, flags))
+	if (!this->broadPhase->Insert(shape, flags))
 		Shape::Free(shape);
 }
 
+void Thread::AddShapes(std::vector<Shape*>& shapeArray, uint32_t flags)
+{
+	this->broadPhase->InsertMany(shapeArray, flags);
+	this->statistics->RecordBulkInsertion(shapeArray.size());
+}
+
 void Thread::RemoveShape(ShapeID shapeID)
 {
-	this->boxTree.Remove(shapeID);
+	this->broadPhase->Remove(shapeID);
+}
+
+void Thread::SetCacheMemoryLimit(uint64_t memoryLimit)
+{
+	this->broadPhase->SetCacheMemoryLimit(memoryLimit);
 }
 
 Shape* Thread::FindShape(ShapeID shapeID)
 {
-	Shape* shape = this->boxTree.FindShape(shapeID);
+	Shape* shape = this->broadPhase->FindShape(shapeID);
 	IMZADI_ASSERT(!shape || shape->GetShapeID() == shapeID);
 	return shape;
 }
 
 TaskID Thread::SendTask(Task* task)
 {
+	// Note that the task may be executed and freed as soon as it's in the queue.
 	TaskID taskId = task->GetTaskID();
 
-	// Add the task to the queue.  Make the mutex scope-lock as tight as possible.
+	this->WaitForResultSlot(taskId);
+	this->resultSlotArray->Claim(taskId);
+	this->numPendingTasks++;
+	this->taskQueue->Push(task);
+
+	// Signal the collision thread that a task is available, but only wake it if it's asleep.
+	this->taskSignal++;
+	if (this->collisionThreadWaiting)
+		this->taskSignal.notify_one();
+
+	return taskId;
+}
+
+TaskIDRange Thread::SendBatch(TaskBatch* batch)
+{
+	TaskIDRange taskIDRange = batch->AssignTaskIDs();
+	if (taskIDRange.numTaskIDs == 0)
 	{
-		std::lock_guard<std::mutex> guard(*this->taskQueueMutex);
-		this->taskQueue->push_back(task);
+		Task::Free(batch);
+		return taskIDRange;
 	}
 
-	// Signal the collision thread that a task is available.
-	this->taskQueueSemaphore->release();
+	// Were the batch bigger than the ring, some of its tasks would wait on slots held by others of its tasks, which never run.
+	IMZADI_ASSERT(taskIDRange.numTaskIDs <= this->resultSlotArray->GetCapacity());
 
-	return taskId;
+	for (uint32_t i = 0; i < taskIDRange.numTaskIDs; i++)
+	{
+		this->WaitForResultSlot(taskIDRange[i]);
+		this->resultSlotArray->Claim(taskIDRange[i]);
+	}
+
+	this->numPendingTasks += taskIDRange.numTaskIDs;
+	this->taskQueue->Push(batch);
+
+	this->taskSignal++;
+	if (this->collisionThreadWaiting)
+		this->taskSignal.notify_one();
+
+	return taskIDRange;
 }
 
 Result* Thread::ReceiveResult(TaskID taskID)
 {
-	Result* result = nullptr;
+	return this->resultSlotArray->Collect(taskID);
+}
+
+uint32_t Thread::ReceiveResults(const TaskIDRange& taskIDRange, std::vector<Result*>& resultArray)
+{
+	uint32_t numResults = 0;
 
-	// Look-up the result, if it's ready.  Make the mutex scope-lock as tight as possible.
+	resultArray.resize(taskIDRange.numTaskIDs);
+
+	for (uint32_t i = 0; i < taskIDRange.numTaskIDs; i++)
 	{
-		std::lock_guard<std::mutex> guard(*this->resultMapMutex);
-		std::unordered_map<TaskID, Result*>::iterator iter = this->resultMap->find(taskID);
-		if (iter != this->resultMap->end())
-		{
-			result = iter->second;
-			this->resultMap->erase(iter);
-		}
+		resultArray[i] = this->resultSlotArray->Collect(taskIDRange[i]);
+		if (resultArray[i])
+			numResults++;
 	}
 
-	return result;
+	return numResults;
 }
 
 void Thread::StoreResult(Result* result, TaskID taskID)
 {
-	std::lock_guard<std::mutex> guard(*this->resultMapMutex);
-	std::unordered_map<TaskID, Result*>::iterator iter = this->resultMap->find(taskID);
-	if (iter == this->resultMap->end())
-		this->resultMap->insert(std::pair<TaskID, Result*>(taskID, result));
-	else
-	{
-		Result::Free(iter->second);
-		iter->second = result;
-	}
+	this->resultSlotArray->Store(taskID, result);
 }
 
 void Thread::DebugVisualize(DebugRenderResult* renderResult, uint32_t drawFlags)
 {
 	if ((drawFlags & IMZADI_DRAW_FLAG_SHAPES) != 0)
 	{
-		this->boxTree.ForAllShapes([renderResult, drawFlags](const Shape* shape) -> bool
+		this->broadPhase->ForAllShapes([renderResult, drawFlags](const Shape* shape) -> bool
 		{
 			shape->DebugRender(renderResult);
 			if ((drawFlags & IMZADI_DRAW_FLAG_SHAPE_BOXES) != 0)
@@ -214,21 +703,53 @@ void Thread::DebugVisualize(DebugRenderResult* renderResult, uint32_t drawFlags)
 	}
 
 	if ((drawFlags & IMZADI_DRAW_FLAG_AABB_TREE) != 0)
-		this->boxTree.DebugRender(renderResult);
+		this->broadPhase->DebugRender(renderResult);
 }
 
 void Thread::WaitForAllTasksToComplete()
 {
-	std::unique_lock<std::mutex> lock(*this->taskQueueMutex);
-	this->allTasksDoneCondVar->wait(lock, [=]() { return this->taskQueue->size() == 0; });
+	auto startTime = std::chrono::steady_clock::now();
+	this->AssistUntil([this]() { return this->numPendingTasks.load() == 0; });
+	auto waitTime = std::chrono::steady_clock::now() - startTime;
+	this->statistics->RecordFlush(std::chrono::duration_cast<std::chrono::nanoseconds>(waitTime).count());
+}
+
+void Thread::WaitForTask(TaskID taskID)
+{
+	auto startTime = std::chrono::steady_clock::now();
+	this->AssistUntil([this, taskID]() { return this->resultSlotArray->IsFinished(taskID); });
+	auto waitTime = std::chrono::steady_clock::now() - startTime;
+	this->statistics->RecordTaskWait(std::chrono::duration_cast<std::chrono::nanoseconds>(waitTime).count());
+}
+
+void Thread::WaitForResultSlot(TaskID taskID)
+{
+	// The slot is only still held if the ring has wrapped around onto a task that hasn't finished,
+	// such as a deferred query, so this is nearly always a quick look at the slot.
+	if (this->resultSlotArray->IsVacant(taskID))
+		return;
+
+	this->AssistUntil([this, taskID]() { return this->resultSlotArray->IsVacant(taskID); });
+}
+
+void Thread::WaitForTasks(const TaskIDRange& taskIDRange)
+{
+	for (uint32_t i = 0; i < taskIDRange.numTaskIDs; i++)
+		this->WaitForTask(taskIDRange[i]);
+}
+
+void Thread::WaitForTasks(const std::vector<TaskID>& taskIDArray)
+{
+	for (TaskID taskID : taskIDArray)
+		this->WaitForTask(taskID);
 }
 
 bool Thread::DumpShapes(std::ostream& stream) const
 {
-	uint32_t numShapes = this->boxTree.GetNumShapes();
+	uint32_t numShapes = this->broadPhase->GetNumShapes();
 	stream.write((char*)&numShapes, sizeof(uint32_t));
 
-	return this->boxTree.ForAllShapes([&stream](const Shape* shape) -> bool
+	return this->broadPhase->ForAllShapes([&stream](const Shape* shape) -> bool
 	{
 		uint32_t typeID = shape->GetShapeTypeID();
 		stream.write((char*)&typeID, sizeof(typeID));
@@ -245,19 +766,25 @@ bool Thread::RestoreShapes(std::istream& stream)
 	uint32_t numShapes = 0;
 	stream.read((char*)&numShapes, sizeof(numShapes));
 
-	for (uint32_t i = 0; i < numShapes; i++)
+	std::vector<Shape*> shapeArray;
+	bool restored = true;
+	for (uint32_t i = 0; i < numShapes && restored; i++)
 	{
 		uint32_t typeID = 0;
 		stream.read((char*)&typeID, sizeof(typeID));
 		Shape* shape = Shape::Create((Shape::TypeID)typeID);
 		if (!shape)
-			return false;
-		
-		if (!shape->Restore(stream))
-			return false;
-
-		this->AddShape(shape, 0);
+			restored = false;
+		else if (!shape->Restore(stream))
+		{
+			Shape::Free(shape);
+			restored = false;
+		}
+		else
+			shapeArray.push_back(shape);
 	}
 
-	return true;
+	// Whatever shapes were restored before any failure are still added, just as they were when added one at a time.
+	this->AddShapes(shapeArray, 0);
+	return restored;
 }
\ No newline at end of file
@@ -4,17 +4,24 @@
 #include "Task.h"
 #include "Shape.h"
 #include "Math/AxisAlignedBoundingBox.h"
-#include "BoundingBoxTree.h"
+#include "BroadPhase.h"
+#include "TaskQueue.h"
+#include "ResultSlotArray.h"
+#include "CollisionStatistics.h"
 #include <thread>
 #include <mutex>
-#include <list>
-#include <semaphore>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
 #include <unordered_map>
+#include <functional>
 
 namespace Imzadi
 {
 	class Task;
 	class Result;
+	class ObjectToWorldCommand;
+	struct CommandStats;
 	class DebugRenderResult;
 
 	/**
@@ -24,13 +31,30 @@ namespace Imzadi
 	 * pointer to this class, nor should they ever need one.  Note that some methods
 	 * of this class are meant to be called only from the main thread, or only from
 	 * the collision thread.
+	 * 
+	 * The collision thread may be assisted by a pool of worker threads.  Commands,
+	 * which change the collision world, are always executed one at a time by the
+	 * collision thread in the order they were issued.  Queries are executed in order
+	 * with respect to commands too, except for high-priority queries, which jump
+	 * ahead of commands they don't depend on, and late low-priority queries, which
+	 * are deferred (see the Query class).  Any run of consecutive queries,
+	 * however, sees a world that isn't changing, and so such a run is divided up among
+	 * the collision thread and its workers to be executed in parallel.  Any thread
+	 * blocked waiting on tasks also pitches in on such runs, so a collision thread
+	 * without workers still gets help from the main thread when it's waiting.
 	 */
 	class IMZADI_API Thread
 	{
 		friend class ExitThreadCommand;
 
 	public:
-		Thread(const AxisAlignedBoundingBox& collisionWorldExtents);
+		/**
+		 * @param[in] collisionWorldExtents This is the AABB defining the scope of the collision world.
+		 * @param[in] numWorkerThreads This is the total number of threads that will execute tasks, including the collision thread.  One gives single-threaded behavior.
+		 * @param[in] broadPhaseType This is the kind of broad-phase used to spatially sort all shapes in the collision world.
+		 * @param[in] gridCellSize This is the size of each cell of the broad-phase, if it's a grid.
+		 */
+		Thread(const AxisAlignedBoundingBox& collisionWorldExtents, uint32_t numWorkerThreads, BroadPhase::Type broadPhaseType, double gridCellSize);
 		virtual ~Thread();
 
 		/**
@@ -53,22 +77,48 @@ namespace Imzadi
 		 * by this thread.  The caller should consider their pointer invalid
 		 * once the call has returned.
 		 * 
+		 * If IMZADI_RESULT_SLOT_CAPACITY tasks are already unfinished, the result slot of the given
+		 * task is still held by one of them, so this blocks, helping out as the WaitForTask method
+		 * does, until that task finishes.
+		 * 
 		 * @param[in] task This is the task (command or query) to be performed by this thread.
 		 * @return A task ID is returned.  The caller can safely refer to this task in other API calls using this ID.
 		 */
 		TaskID SendTask(Task* task);
 
+		/**
+		 * Send all tasks of the given batch to this thread in one go from the main thread.
+		 * Ownership of the batch memory is taken by this thread.  This blocks just as the SendTask
+		 * method does.  The batch may hold no more than IMZADI_RESULT_SLOT_CAPACITY tasks.
+		 * 
+		 * @param[in] batch This is the batch of tasks to be performed by this thread.
+		 * @return The range of task IDs given to the batched tasks is returned, in the order they were added to the batch.
+		 */
+		TaskIDRange SendBatch(TaskBatch* batch);
+
 		/**
 		 * Retrieve the result of a previously made query, if it's ready, from the main thread.
 		 * After sending a bunch of queries, the user may wish to do some other work.  Once that
 		 * work is done, a call to FlushAllTasks can be made, at which point, any call to this
-		 * method should succeed with a valid task ID.
+		 * method should succeed with a valid task ID.  This is O(1) and takes no lock.
+		 * 
+		 * Results are held for only so long.  See the ResultSlotArray class.
 		 * 
 		 * @param[in] taskID This is the task ID of the query that was previously made.
 		 * @return A pointer to the query result, if any, is returned; null, otherwise.  The caller takes ownership of the memory and should free it when done.
 		 */
 		Result* ReceiveResult(TaskID taskID);
 
+		/**
+		 * Retrieve the results of all previously made queries in the given range, if they're ready.
+		 * This is the same as calling ReceiveResult for each task ID of the range.
+		 * 
+		 * @param[in] taskIDRange This is the range of task IDs returned when a batch was sent.
+		 * @param[out] resultArray This is populated with one result per task ID of the given range.  Null is given for any result not available.  The caller takes ownership of the memory.
+		 * @return The number of non-null results is returned.
+		 */
+		uint32_t ReceiveResults(const TaskIDRange& taskIDRange, std::vector<Result*>& resultArray);
+
 		/**
 		 * Store a newly calculated result for the query of the given taskID.
 		 * If a result is already stored for the given query, then it is replaced,
@@ -87,6 +137,14 @@ namespace Imzadi
 		 */
 		void AddShape(Shape* shape, uint32_t flags);
 
+		/**
+		 * Add all the given shapes to the collision world in one go.
+		 * 
+		 * @param[in] shapeArray These are the shapes to add.  Any null entries are ignored.
+		 * @param[in] flags These are an OR-ing of the IMZADI_ADD_FLAG_* flags.
+		 */
+		void AddShapes(std::vector<Shape*>& shapeArray, uint32_t flags);
+
 		/**
 		 * Remove the given shape from the collision world.
 		 * 
@@ -94,6 +152,13 @@ namespace Imzadi
 		 */
 		void RemoveShape(ShapeID shapeID);
 
+		/**
+		 * Set the most memory the collision cache should take up.
+		 * 
+		 * @param memoryLimit This is the limit in bytes.
+		 */
+		void SetCacheMemoryLimit(uint64_t memoryLimit);
+
 		/**
 		 * Search the bounding-box tree for the shape having the given shape ID.
 		 * 
@@ -118,14 +183,39 @@ namespace Imzadi
 		/**
 		 * Block until all pending tasks have been processed by this thread.
 		 * This is not a busy wait, so it should not significantly consume any
-		 * CPU resources.
+		 * CPU resources.  While waiting, the calling thread helps execute any
+		 * run of read-only tasks the collision thread has posted.
 		 */
 		void WaitForAllTasksToComplete();
 
 		/**
-		 * Return the AABB tree being used to spatially sort all shapes in the collision world.
+		 * Block until the given task has been processed by this thread.  Other tasks
+		 * may still be pending when this returns, including ones sent before it.
+		 * This is not a busy wait.  As with WaitForAllTasksToComplete, the calling
+		 * thread helps execute read-only tasks while it waits.
+		 * 
+		 * @param[in] taskID This is the ID of a task that was sent to this thread.
+		 */
+		void WaitForTask(TaskID taskID);
+
+		/**
+		 * Block until all tasks of the given range have been processed by this thread.
+		 * 
+		 * @param[in] taskIDRange This is the range of task IDs returned when a batch was sent.
 		 */
-		BoundingBoxTree& GetBoundingBoxTree() { return this->boxTree; }
+		void WaitForTasks(const TaskIDRange& taskIDRange);
+
+		/**
+		 * Block until all of the given tasks have been processed by this thread.
+		 * 
+		 * @param[in] taskIDArray These are the IDs of tasks that were sent to this thread.
+		 */
+		void WaitForTasks(const std::vector<TaskID>& taskIDArray);
+
+		/**
+		 * Return the broad-phase being used to spatially sort all shapes in the collision world.
+		 */
+		BroadPhase& GetBroadPhase() { return *this->broadPhase; }
 
 		/**
 		 * Write all shapes of the collision world to the given stream.
@@ -146,6 +236,24 @@ namespace Imzadi
 		 */
 		bool RestoreShapes(std::istream& stream);
 
+		/**
+		 * Get a snapshot of the counters we keep about the commands sent to us.
+		 */
+		void GetCommandStats(CommandStats& stats) const;
+
+		/**
+		 * Get a snapshot of our statistics, including the present depth of our queue.  See the StatisticsQuery class.
+		 * 
+		 * @param[out] snapshot This is where the counters are copied.
+		 * @param[in] reset If true, the counters are set back to zero once they're copied.
+		 */
+		void TakeStatisticsSnapshot(CollisionStatistics::Snapshot& snapshot, bool reset);
+
+		/**
+		 * Return the total number of threads used to execute tasks, including the collision thread.
+		 */
+		uint32_t GetNumWorkerThreads() const { return this->numWorkerThreads; }
+
 	private:
 
 		/**
@@ -161,25 +269,162 @@ namespace Imzadi
 		 */
 		void Run();
 
+		/**
+		 * This is the thread-entry function for the worker threads that assist the collision thread.
+		 * 
+		 * @param thread This is the thread object that owns the worker.
+		 */
+		static void WorkerEntryFunc(Thread* thread);
+
+		/**
+		 * This is the worker thread implimentation.  All we do is wait for a run of
+		 * read-only tasks to be posted, and then help execute them.
+		 */
+		void WorkerRun();
+
+		/**
+		 * Execute the given tasks, which must all be read-only, using every thread we have at our disposal.
+		 * This blocks until all the given tasks have been executed.  It is called only on the collision thread.
+		 * 
+		 * @param[in] taskArray These are the tasks to execute.  They are not freed here.
+		 */
+		void ExecuteInParallel(const std::vector<Task*>& taskArray);
+
+		/**
+		 * Grab and execute tasks of the currently posted parallel run until there are none left to grab.
+		 * 
+		 * @param[in] numTasks This is the number of tasks in the run as seen when the caller joined it.
+		 */
+		void ExecuteParallelTasks(uint32_t numTasks);
+
+		/**
+		 * Block the calling thread until the given condition is met.  In the meantime, the
+		 * calling thread joins any parallel run posted by the collision thread, just as a
+		 * worker thread would.  This way, time spent waiting on the collision thread is
+		 * spent doing some of its work.
+		 * 
+		 * @param[in] isDone This is the condition to wait on.  It must be safe to check from any thread.
+		 */
+		void AssistUntil(const std::function<bool()>& isDone);
+
+		/**
+		 * Block the calling thread, helping out as the AssistUntil method does, until the result
+		 * slot of the given task is no longer held by a task that has yet to finish.
+		 */
+		void WaitForResultSlot(TaskID taskID);
+
+		/**
+		 * Tell the caller if the current parallel run, if any, has tasks that have yet to be grabbed.
+		 * The parallel run mutex must be held by the caller.
+		 */
+		bool IsParallelRunOpen() const;
+
+		/**
+		 * Signal all worker threads to exit and wait for them to do so.
+		 */
+		void ShutdownWorkers();
+
 		/**
 		 * Wipe out all currently queued tasks without processing them.
 		 */
 		void ClearTasks();
 
+		/**
+		 * Move all tasks currently in the task queue over to our staging array,
+		 * which is where the collision thread works from.
+		 */
+		void StageQueuedTasks();
+
+		/**
+		 * Add the given task to our staging array.  Normally, it just goes at the end, but
+		 * a high-priority query is moved ahead of any tasks it doesn't need to wait for.
+		 * See the Query::SetPriority method.
+		 */
+		void StageTask(Task* task);
+
+		/**
+		 * If a move of the given command's shape is already staged, and no query has been
+		 * staged since, fold the given command into that move and retire the given command.
+		 * The given command is not marked finished until the move it was folded into executes,
+		 * so that anyone waiting on it doesn't see the shape where it was.
+		 * Either way, the given command's shape is remembered as having a staged move.
+		 * 
+		 * @return True is returned if the command was absorbed and freed; false, otherwise, in which case the caller should stage it.
+		 */
+		bool CoalesceCommand(ObjectToWorldCommand* command);
+
+		/**
+		 * If the given task is a query that has missed its deadline, set it aside in our deferred
+		 * task array, and retire it for now.  See the Query::SetDeadline method.
+		 * 
+		 * @return True is returned if the task was deferred; false, otherwise.
+		 */
+		bool DeferIfOverdue(Task* task);
+
+		/**
+		 * Move all deferred tasks into our staging array.  This is done once the collision thread has nothing else to do.
+		 */
+		void RestageDeferredTasks();
+
+		/**
+		 * Block the collision thread until something has been pushed into the task queue.
+		 * This is not a busy wait.
+		 */
+		void WaitForQueuedTasks();
+
+		/**
+		 * Account for the given number of tasks having been executed, waking up
+		 * anyone waiting on the completion of all tasks if need be.
+		 */
+		void RetireTasks(uint32_t numTasks);
+
+		/**
+		 * Execute the given task and then mark its result slot as finished.
+		 */
+		void ExecuteTask(Task* task);
+
+		/**
+		 * Mark the result slot of the given task as finished, along with those of any
+		 * commands that were folded into it.  See the CoalesceCommand method.
+		 */
+		void FinishTask(Task* task);
+
 		/**
 		 * Wipe out all currently stored results before they can be processed by the user.
 		 */
 		void ClearResults();
 
 	private:
-		BoundingBoxTree boxTree;
+		typedef std::unordered_map<ShapeID, uint32_t, std::hash<ShapeID>, std::equal_to<ShapeID>, CollisionHeapAllocator<std::pair<const ShapeID, uint32_t>>> StagedMoveMap;
+
+		BroadPhase* broadPhase;
 		bool signaledToExit;
 		std::thread* thread;
-		std::mutex* taskQueueMutex;
-		std::list<Task*>* taskQueue;		// TODO: May want to replace this with a lock-free queue at some point.
-		std::counting_semaphore<4096>* taskQueueSemaphore;
-		std::mutex* resultMapMutex;
-		std::unordered_map<TaskID, Result*>* resultMap;
-		std::condition_variable* allTasksDoneCondVar;
+		TaskQueue* taskQueue;								///< Tasks are sent to the collision thread through this queue.
+		std::vector<Task*>* stagedTaskArray;				///< These are tasks pulled off the queue that the collision thread has yet to execute.
+		uint32_t stagedTaskIndex;							///< This is the index of the next staged task to execute.
+		StagedMoveMap* stagedMoveMap;						///< This maps shapes to the staging index of a move that later moves of the shape can be folded into.
+		std::atomic<uint64_t> numObjectToWorldCommands;		///< This is the number of object-to-world commands staged or absorbed so far.
+		std::atomic<uint64_t> numObjectToWorldCommandsElided;	///< This is the number of object-to-world commands absorbed so far.
+		std::vector<Task*>* deferredTaskArray;				///< These are low-priority queries that missed their deadline.  They wait until the collision thread is otherwise idle.
+		std::atomic<uint32_t> numPendingTasks;				///< This is the number of tasks sent that have not yet been executed.
+		std::atomic<uint32_t> taskSignal;					///< This is bumped every time a task is sent.  The collision thread sleeps on it when it has nothing to do.
+		std::atomic<bool> collisionThreadWaiting;			///< This lets senders skip the wake-up call when the collision thread isn't sleeping.
+		ResultSlotArray* resultSlotArray;					///< Results are handed back to the caller through these, one slot per task.
+		uint32_t numWorkerThreads;
+		CollisionStatistics* statistics;					///< This is where we count what we do, so the user can see what's going on.
+		std::vector<std::thread*>* workerThreadArray;
+		std::vector<Task*>* parallelTaskArray;				///< These are the tasks of the current parallel run, if any.
+		std::atomic<uint32_t> parallelTaskIndex;			///< This is the index of the next task to be grabbed in the current parallel run.
+		std::atomic<uint32_t> parallelTasksRemaining;		///< This is the number of tasks in the current parallel run that have not yet finished.
+		std::mutex* parallelRunMutex;
+		std::condition_variable* parallelRunStartCondVar;
+		std::condition_variable* parallelRunDoneCondVar;
+		uint64_t parallelRunGeneration;						///< This is bumped each time a new parallel run is posted so that workers can tell it's new.
+		uint32_t numBusyWorkers;							///< This is the number of workers still inside the current parallel run.
+		std::condition_variable* assistCondVar;				///< Threads waiting on tasks sleep on this until there is a parallel run to join or their wait is over.
+		std::atomic<uint32_t> numAssistingThreads;			///< This is the number of threads currently waiting on tasks, and so available to help with them.
+		std::vector<const std::function<bool()>*>* assistConditionArray;	///< These are the conditions the assisting threads are waiting on.  The collision thread checks them as it retires tasks.
+		bool workersSignaledToExit;
 	};
 }
\ No newline at end of file
@@ -26,8 +26,51 @@
 #define IMZADI_ASSERT(condition)			assert(condition)
 
 #define IMZADI_ADD_FLAG_ALLOW_SPLIT			0x00000001
+#define IMZADI_ADD_FLAG_STATIC				0x00000002
 
 #define IMZADI_MIN_NODE_VOLUME				(50.0 * 50.0 * 50.0)
+#define IMZADI_INVALID_NODE_INDEX			0xFFFFFFFF
+#define IMZADI_INVALID_SHAPE_INDEX			0xFFFFFFFF
+#define IMZADI_TREE_MAX_EMPTY_NODE_RATIO		0.75
+#define IMZADI_TREE_MIN_NODES_TO_RECLAIM		1024
+#define IMZADI_TREE_DIAGNOSTICS_MAX_DEPTH	64
+
+#define IMZADI_STATIC_TREE_MAX_LEAF_SHAPES	4
+#define IMZADI_STATIC_TREE_NUM_BINS			12
+#define IMZADI_PARALLEL_BUILD_MIN_SHAPES	4096
+#define IMZADI_PARALLEL_QUERY_MIN_SHAPES	4096
+#define IMZADI_PARALLEL_QUERY_MIN_PAIRS		64
+#define IMZADI_PARALLEL_QUERY_SPLIT_DEPTH	5
+#define IMZADI_PARALLEL_RAY_MIN_SUBTREES	8
+
+#define IMZADI_FAT_BOX_MARGIN				0.25
+#define IMZADI_FAT_BOX_MOTION_FACTOR		4.0
+#define IMZADI_FAT_BOX_MAX_AREA_RATIO		4.0
+
+#define IMZADI_GRID_DEFAULT_CELL_SIZE		8.0
+#define IMZADI_GRID_MAX_CELLS_PER_SHAPE		64
+
+#define IMZADI_SWEEP_MAX_SHIFTS_PER_SHAPE	8
+
+#define IMZADI_CACHE_INITIAL_NUM_SLOTS		1024
+#define IMZADI_CACHE_DEFAULT_MEMORY_LIMIT	(32 * 1024 * 1024)
+#define IMZADI_CACHE_EVICTION_TARGET		0.75
+
+#define IMZADI_GJK_MAX_ITERATIONS			64
+#define IMZADI_GJK_TOLERANCE				1e-9
+#define IMZADI_EPA_MAX_ITERATIONS			64
+
+#define IMZADI_TASK_QUEUE_CAPACITY			8192
+#define IMZADI_RESULT_SLOT_CAPACITY			32768
+
+#define IMZADI_HEAP_BLOCK_GRANULARITY		16
+#define IMZADI_HEAP_MAX_SMALL_BLOCK_SIZE	512
+#define IMZADI_HEAP_MAX_BLOCK_SIZE			(64 * 1024)
+#define IMZADI_HEAP_SLAB_SIZE				(16 * 1024)
+
+#define IMZADI_STATS_NUM_HISTOGRAM_BUCKETS	16
+#define IMZADI_STATS_MAX_TASK_TYPES			32
+#define IMZADI_STATS_MAX_SHAPE_TYPES		8
 
 #define IMZADI_AXIS_FLAG_X					0x00000001
 #define IMZADI_AXIS_FLAG_Y					0x00000002
@@ -26,6 +26,8 @@ Hero::Hero()
 	this->boundsQueryTaskID = 0;
 	this->collisionQueryTaskID = 0;
 	this->groundQueryTaskID = 0;
+	this->queryTaskIDRange.firstTaskID = 0;
+	this->queryTaskIDRange.numTaskIDs = 0;
 	this->inContactWithGround = false;
 }
 
@@ -158,21 +160,32 @@ Hero::Hero()
 			command->objectToWorld = objectToWorld;
 			collisionSystem->IssueCommand(command);
 
+			// The character is what the player is looking at, so its queries shouldn't get stuck behind other work.
+			auto queryBatch = QueryBatch::Create();
+
 			auto boundsQuery = ShapeInBoundsQuery::Create();
 			boundsQuery->SetShapeID(this->collisionShapeID);
-			collisionSystem->MakeQuery(boundsQuery, this->boundsQueryTaskID);
+			boundsQuery->SetPriority(Query::Priority::HIGH);
+			queryBatch->Add(boundsQuery);
 
 			auto collisionQuery = CollisionQuery::Create();
 			collisionQuery->SetShapeID(this->collisionShapeID);
-			collisionSystem->MakeQuery(collisionQuery, this->collisionQueryTaskID);
+			collisionQuery->SetPriority(Query::Priority::HIGH);
+			queryBatch->Add(collisionQuery);
 
 			if (this->groundShapeID != 0)
 			{
 				auto objectToWorldQuery = ObjectToWorldQuery::Create();
 				objectToWorldQuery->SetShapeID(this->groundShapeID);
-				collisionSystem->MakeQuery(objectToWorldQuery, this->groundQueryTaskID);
+				objectToWorldQuery->SetPriority(Query::Priority::HIGH);
+				queryBatch->Add(objectToWorldQuery);
 			}
 
+			collisionSystem->MakeQueries(queryBatch, this->queryTaskIDRange);
+			this->boundsQueryTaskID = this->queryTaskIDRange[0];
+			this->collisionQueryTaskID = this->queryTaskIDRange[1];
+			this->groundQueryTaskID = (this->queryTaskIDRange.numTaskIDs > 2) ? this->queryTaskIDRange[2] : 0;
+
 			auto animatedMesh = dynamic_cast<AnimatedMeshInstance*>(this->renderMesh.Get());
 			if (animatedMesh)
 			{
@@ -201,6 +214,9 @@ Hero::Hero()
 		}
 		case TickPass::POST_TICK:
 		{
+			// Our queries are all we need from the collision system, so that's all we wait for.
+			collisionSystem->WaitForTasks(this->queryTaskIDRange);
+
 			if (this->boundsQueryTaskID)
 			{
 				Result* result = collisionSystem->ObtainQueryResult(this->boundsQueryTaskID);
@@ -41,5 +41,6 @@ namespace Imzadi
 		TaskID boundsQueryTaskID;
 		TaskID collisionQueryTaskID;
 		TaskID groundQueryTaskID;
+		TaskIDRange queryTaskIDRange;
 	};
 }
\ No newline at end of file
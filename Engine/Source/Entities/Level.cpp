@@ -95,8 +95,8 @@ Level::Level()
 
 	for(auto collisionShapeSet : collisionShapeSetArray)
 	{
-		for (Shape* shape : collisionShapeSet->GetCollisionShapeArray())
-			Game::Get()->GetCollisionSystem()->AddShape(shape, 0 /*IMZADI_ADD_FLAG_ALLOW_SPLIT*/);	// TODO: Figure out why splitting fails.
+		// Level geometry never moves, so it goes in the static tree, which fits it tightly enough that it needn't be split.
+		Game::Get()->GetCollisionSystem()->AddShapes(collisionShapeSet->GetCollisionShapeArray(), IMZADI_ADD_FLAG_STATIC);
 
 		collisionShapeSet->Clear(false);
 	}
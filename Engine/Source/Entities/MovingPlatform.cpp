@@ -110,14 +110,17 @@ MovingPlatform::MovingPlatform()
 
 	this->renderMesh->SetObjectToWorldTransform(objectToWorld);
 
+	auto commandBatch = CommandBatch::Create();
 	for (ShapeID shapeID : this->collisionShapeArray)
 	{
 		auto command = ObjectToWorldCommand::Create();
 		command->SetShapeID(shapeID);
 		command->objectToWorld = objectToWorld;
-		Game::Get()->GetCollisionSystem()->IssueCommand(command);
+		commandBatch->Add(command);
 	}
 
+	Game::Get()->GetCollisionSystem()->IssueCommands(commandBatch);
+
 	if (arrived)
 	{
 		switch (this->data->GetSplineMode())
@@ -470,10 +470,9 @@ bool Game::RecreateViews()
 	// Do work that runs in parallel with the collision system.  (e.g., animating skeletons and performing skinning.)
 	this->Tick(TickPass::MID_TICK);
 
-	// Stall waiting for the collision system to complete all queries and commands.
-	this->collisionSystem.FlushAllTasks();
-
 	// Collision queries can now be acquired and used in this pass.  (e.g., to solve constraints.)
+	// Rather than stall here for the collision system to complete everything, each entity
+	// waits on just the queries it needs, so the collision system can carry on with the rest.
 	this->Tick(TickPass::POST_TICK);
 
 	if (this->windowResized)
@@ -489,7 +488,7 @@ bool Game::RecreateViews()
 		query->SetDrawFlags(this->collisionSystemDebugDrawFlags);
 		TaskID collisionSystemDebugDrawTaskID = 0;
 		this->collisionSystem.MakeQuery(query, collisionSystemDebugDrawTaskID);
-		this->collisionSystem.FlushAllTasks();
+		this->collisionSystem.WaitForTask(collisionSystemDebugDrawTaskID);
 		Result* result = this->collisionSystem.ObtainQueryResult(collisionSystemDebugDrawTaskID);
 		if (result)
 		{
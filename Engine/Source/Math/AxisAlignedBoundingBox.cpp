@@ -84,6 +84,17 @@ bool AxisAlignedBoundingBox::Intersect(const AxisAlignedBoundingBox& aabbA, cons
 	return this->IsValid();
 }
 
+void AxisAlignedBoundingBox::Merge(const AxisAlignedBoundingBox& aabbA, const AxisAlignedBoundingBox& aabbB)
+{
+	this->minCorner.x = IMZADI_MIN(aabbA.minCorner.x, aabbB.minCorner.x);
+	this->minCorner.y = IMZADI_MIN(aabbA.minCorner.y, aabbB.minCorner.y);
+	this->minCorner.z = IMZADI_MIN(aabbA.minCorner.z, aabbB.minCorner.z);
+
+	this->maxCorner.x = IMZADI_MAX(aabbA.maxCorner.x, aabbB.maxCorner.x);
+	this->maxCorner.y = IMZADI_MAX(aabbA.maxCorner.y, aabbB.maxCorner.y);
+	this->maxCorner.z = IMZADI_MAX(aabbA.maxCorner.z, aabbB.maxCorner.z);
+}
+
 void AxisAlignedBoundingBox::Scale(double scale)
 {
 	this->Scale(scale, scale, scale);
@@ -129,14 +140,9 @@ void AxisAlignedBoundingBox::Expand(const std::vector<Vector3>& pointArray)
 
 void AxisAlignedBoundingBox::Expand(const AxisAlignedBoundingBox& box)
 {
-	this->Expand(Vector3(box.minCorner.x, box.minCorner.y, box.minCorner.z));
-	this->Expand(Vector3(box.maxCorner.x, box.minCorner.y, box.minCorner.z));
-	this->Expand(Vector3(box.minCorner.x, box.maxCorner.y, box.minCorner.z));
-	this->Expand(Vector3(box.maxCorner.x, box.maxCorner.y, box.minCorner.z));
-	this->Expand(Vector3(box.minCorner.x, box.minCorner.y, box.maxCorner.z));
-	this->Expand(Vector3(box.maxCorner.x, box.minCorner.y, box.maxCorner.z));
-	this->Expand(Vector3(box.minCorner.x, box.maxCorner.y, box.maxCorner.z));
-	this->Expand(Vector3(box.maxCorner.x, box.maxCorner.y, box.maxCorner.z));
+	// Every other corner of the box has its coordinates from among these two.
+	this->Expand(box.minCorner);
+	this->Expand(box.maxCorner);
 }
 
 void AxisAlignedBoundingBox::Split(AxisAlignedBoundingBox& aabbA, AxisAlignedBoundingBox& aabbB, Plane* divisionPlane /*= nullptr*/) const
@@ -196,44 +202,55 @@ void AxisAlignedBoundingBox::SetToBoundPointCloud(const std::vector<Vector3>& po
 }
 
 void AxisAlignedBoundingBox::GetSidePlanes(std::vector<Plane>& sidePlaneArray) const
+{
+	Plane sidePlaneBuffer[6];
+	uint32_t numSidePlanes = this->GetSidePlanes(sidePlaneBuffer);
+	for (uint32_t i = 0; i < numSidePlanes; i++)
+		sidePlaneArray.push_back(sidePlaneBuffer[i]);
+}
+
+uint32_t AxisAlignedBoundingBox::GetSidePlanes(Plane* sidePlaneArray) const
 {
 	double xSize = 0.0, ySize = 0.0, zSize = 0.0;
 	this->GetDimensions(xSize, ySize, zSize);
 
 	Plane plane;
+	uint32_t numSidePlanes = 0;
 
 	if (xSize > 0.0 && ySize > 0.0)
 	{
 		plane.unitNormal = Vector3(0.0, 0.0, -1.0);
 		plane.center.SetComponents(this->minCorner.x, this->minCorner.y, this->minCorner.z);
-		sidePlaneArray.push_back(plane);
+		sidePlaneArray[numSidePlanes++] = plane;
 
 		plane.unitNormal = Vector3(0.0, 0.0, 1.0);
 		plane.center.SetComponents(this->minCorner.x, this->minCorner.y, this->maxCorner.z);
-		sidePlaneArray.push_back(plane);
+		sidePlaneArray[numSidePlanes++] = plane;
 	}
 
 	if (xSize > 0.0 && zSize > 0.0)
 	{
 		plane.unitNormal = Vector3(0.0, -1.0, 0.0);
 		plane.center.SetComponents(this->minCorner.x, this->minCorner.y, this->minCorner.z);
-		sidePlaneArray.push_back(plane);
+		sidePlaneArray[numSidePlanes++] = plane;
 
 		plane.unitNormal = Vector3(0.0, 1.0, 0.0);
 		plane.center.SetComponents(this->minCorner.x, this->maxCorner.y, this->minCorner.z);
-		sidePlaneArray.push_back(plane);
+		sidePlaneArray[numSidePlanes++] = plane;
 	}
 
 	if (ySize > 0.0 && zSize > 0.0)
 	{
 		plane.unitNormal = Vector3(-1.0, 0.0, 0.0);
 		plane.center.SetComponents(this->minCorner.x, this->minCorner.y, this->minCorner.z);
-		sidePlaneArray.push_back(plane);
+		sidePlaneArray[numSidePlanes++] = plane;
 
 		plane.unitNormal = Vector3(1.0, 0.0, 0.0);
 		plane.center.SetComponents(this->maxCorner.x, this->minCorner.y, this->minCorner.z);
-		sidePlaneArray.push_back(plane);
+		sidePlaneArray[numSidePlanes++] = plane;
 	}
+
+	return numSidePlanes;
 }
 
 void AxisAlignedBoundingBox::GetVertices(std::vector<Vector3>& vertexArray) const
@@ -363,6 +380,13 @@ double AxisAlignedBoundingBox::GetVolume() const
 	return width * height * depth;
 }
 
+double AxisAlignedBoundingBox::GetSurfaceArea() const
+{
+	double width = 0.0, height = 0.0, depth = 0.0;
+	this->GetDimensions(width, height, depth);
+	return 2.0 * (width * height + height * depth + depth * width);
+}
+
 void AxisAlignedBoundingBox::GetSphere(Vector3& center, double& radius) const
 {
 	// TODO: Write this.
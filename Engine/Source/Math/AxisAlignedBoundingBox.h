@@ -81,6 +81,15 @@ namespace Imzadi
 		 */
 		bool Intersect(const AxisAlignedBoundingBox& aabbA, const AxisAlignedBoundingBox& aabbB);
 
+		/**
+		 * Set this AABB to be the smallest AABB containing both of the given AABBs.
+		 * This is a commutative operation.
+		 * 
+		 * @param[in] aabbA The first AABB taken in the merge operation.
+		 * @param[in] aabbB The second AABB taken in the merge operation.
+		 */
+		void Merge(const AxisAlignedBoundingBox& aabbA, const AxisAlignedBoundingBox& aabbB);
+
 		/**
 		 * Minimally expand this AABB so that it includes the given point.
 		 * 
@@ -158,6 +167,14 @@ namespace Imzadi
 		 */
 		void GetSidePlanes(std::vector<Plane>& sidePlaneArray) const;
 
+		/**
+		 * This is the same as the other GetSidePlanes method, but it doesn't touch the heap.
+		 * 
+		 * @param[out] sidePlaneArray This must point to room for at least 6 planes.  It is populated with the planes containing the sides of this box.
+		 * @return The number of planes written is returned.
+		 */
+		uint32_t GetSidePlanes(Plane* sidePlaneArray) const;
+
 		/**
 		 * Calculate and return the 8 vertices of this box.
 		 * 
@@ -177,6 +194,11 @@ namespace Imzadi
 		 */
 		double GetVolume() const;
 
+		/**
+		 * Return the total area of the six faces of this AABB.
+		 */
+		double GetSurfaceArea() const;
+
 		/**
 		 * Calculate and return the tightest sphere containing this AABB.
 		 * One application here is to check the returned sphere (once transformed
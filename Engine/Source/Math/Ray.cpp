@@ -76,12 +76,27 @@ bool Ray::CastAgainst(const Plane& plane, double& alpha) const
 
 bool Ray::CastAgainst(const AxisAlignedBoundingBox& box, double& alpha) const
 {
-	std::vector<double> alphaArray;
-	if (!this->CastAgainst(box, alphaArray))
-		return false;
+	// This gives the same answer as the other overload, but is called often enough
+	// during tree traversal that it's worth avoiding the heap here.
+	Plane sidePlaneArray[6];
+	uint32_t numSidePlanes = box.GetSidePlanes(sidePlaneArray);
 
-	alpha = alphaArray[0];
-	return true;
+	bool hitFound = false;
+	for (uint32_t i = 0; i < numSidePlanes; i++)
+	{
+		double sideAlpha = 0.0;
+		if (this->CastAgainst(sidePlaneArray[i], sideAlpha))
+		{
+			Vector3 hitPoint = this->CalculatePoint(sideAlpha);
+			if (box.ContainsPoint(hitPoint, 1e-5) && (!hitFound || sideAlpha < alpha))
+			{
+				alpha = sideAlpha;
+				hitFound = true;
+			}
+		}
+	}
+
+	return hitFound;
 }
 
 bool Ray::CastAgainst(const AxisAlignedBoundingBox& box, std::vector<double>& alphaArray) const
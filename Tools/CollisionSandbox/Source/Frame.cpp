@@ -203,8 +203,7 @@ void Frame::OnLoadShapes(wxCommandEvent& event)
 			wxMessageBox(wxString::Format("%d shapes loaded!", int(shapeArray.size())), "Shape Loading", wxICON_INFORMATION | wxOK, this);
 
 			CollisionSystem* system = wxGetApp().GetCollisionSystem();
-			for (auto shape : shapeArray)
-				system->AddShape(shape, IMZADI_ADD_FLAG_ALLOW_SPLIT);
+			system->AddShapes(shapeArray, IMZADI_ADD_FLAG_ALLOW_SPLIT);
 		}
 	}
 }
@@ -0,0 +1,170 @@
+#include "AllPairsTests.h"
+#include "Collision/System.h"
+#include "Collision/Query.h"
+#include "Collision/Command.h"
+#include "Collision/Result.h"
+#include "Collision/CollisionCache.h"
+#include "Collision/Shapes/Sphere.h"
+#include <set>
+#include <algorithm>
+
+using namespace Imzadi;
+
+AllPairsTest::AllPairsTest() : Test("AllPairs")
+{
+}
+
+/*virtual*/ AllPairsTest::~AllPairsTest()
+{
+}
+
+/*virtual*/ void AllPairsTest::Run()
+{
+	this->TestBroadPhase(BroadPhase::Type::BOUNDING_BOX_TREE, "bounding-box tree");
+	this->TestBroadPhase(BroadPhase::Type::DYNAMIC_BOUNDING_BOX_TREE, "dynamic bounding-box tree");
+	this->TestBroadPhase(BroadPhase::Type::SPATIAL_HASH_GRID, "spatial hash grid");
+}
+
+void AllPairsTest::TestBroadPhase(BroadPhase::Type broadPhaseType, const char* broadPhaseName)
+{
+	constexpr uint32_t numSpheres = 300;
+	constexpr uint32_t numStaticSpheres = 50;
+	constexpr uint32_t numRounds = 30;
+	constexpr uint32_t numReplacedPerRound = 10;
+
+	CollisionSystem collisionSystem;
+	if (!this->Check(collisionSystem.Initialize(MakeWorldBox(50.0), 1, broadPhaseType, 4.0), "Failed to initialize collision system."))
+		return;
+
+	struct Sphere
+	{
+		ShapeID shapeID;
+		Vector3 center;
+		double radius;
+		bool inWorld;
+
+		Vector3 GetPosition() const { return this->inWorld ? this->center : Vector3(this->center.x, 1000.0, this->center.z); }
+	};
+
+	std::vector<Sphere> sphereArray;
+
+	// The spatial hash grid has no bounds, so spheres sent out of the world are still in play there.
+	bool bounded = (broadPhaseType != BroadPhase::Type::SPATIAL_HASH_GRID);
+
+	auto addSphere = [this, &collisionSystem](uint32_t flags) -> Sphere
+	{
+		Sphere sphere;
+		sphere.center = this->RandomPoint(40.0, 40.0, 40.0);
+		sphere.radius = this->Random(1.0, 3.0);
+		sphere.inWorld = true;
+
+		// The sphere sits at the origin of its own space, so that moving it is just a matter of translation.
+		Transform objectToWorld;
+		objectToWorld.SetIdentity();
+		objectToWorld.translation = sphere.center;
+
+		auto shape = SphereShape::Create();
+		shape->SetRadius(sphere.radius);
+		shape->SetObjectToWorldTransform(objectToWorld);
+		sphere.shapeID = collisionSystem.AddShape(shape, flags);
+		return sphere;
+	};
+
+	for (uint32_t i = 0; i < numSpheres; i++)
+		sphereArray.push_back(addSphere(0));
+
+	// These are near enough to the others to overlap some of them, but should never turn up in a pair.
+	for (uint32_t i = 0; i < numStaticSpheres; i++)
+		addSphere(IMZADI_ADD_FLAG_STATIC);
+
+	uint32_t numMismatchedRounds = 0;
+	uint64_t numPairs = 0;
+
+	for (uint32_t round = 0; round < numRounds; round++)
+	{
+		// Every so often, nothing moves at all, and the last answer must still hold.
+		if (round % 7 != 6)
+		{
+			if (round % 5 == 4)
+			{
+				for (uint32_t i = 0; i < numReplacedPerRound; i++)
+				{
+					uint32_t j = (uint32_t)this->RandomInt(0, (int)sphereArray.size() - 1);
+					collisionSystem.RemoveShape(sphereArray[j].shapeID);
+					sphereArray[j] = sphereArray.back();
+					sphereArray.pop_back();
+				}
+
+				for (uint32_t i = 0; i < numReplacedPerRound; i++)
+					sphereArray.push_back(addSphere(0));
+			}
+
+			// Only some of the spheres move each round, so the rest are left as they were in the sweep.
+			// A few leave the collision world, to come back the next time they're moved.
+			for (Sphere& sphere : sphereArray)
+			{
+				if (this->Random(0.0, 1.0) > 0.3)
+					continue;
+
+				sphere.center += this->RandomPoint(2.0, 2.0, 2.0);
+				sphere.center.x = IMZADI_CLAMP(sphere.center.x, -40.0, 40.0);
+				sphere.center.y = IMZADI_CLAMP(sphere.center.y, -40.0, 40.0);
+				sphere.center.z = IMZADI_CLAMP(sphere.center.z, -40.0, 40.0);
+				sphere.inWorld = (this->Random(0.0, 1.0) > 0.05);
+
+				auto command = ObjectToWorldCommand::Create();
+				command->SetShapeID(sphere.shapeID);
+				command->objectToWorld.SetIdentity();
+				command->objectToWorld.translation = sphere.GetPosition();
+
+				collisionSystem.IssueCommand(command);
+			}
+		}
+
+		TaskID taskID = 0;
+		collisionSystem.MakeQuery(AllPairsQuery::Create(), taskID);
+		collisionSystem.FlushAllTasks();
+
+		std::set<std::pair<ShapeID, ShapeID>> foundPairSet;
+		Result* result = collisionSystem.ObtainQueryResult(taskID);
+		auto allPairsResult = dynamic_cast<AllPairsResult*>(result);
+		if (!this->Check(allPairsResult != nullptr, "All-pairs result missing."))
+			break;
+
+		for (const ShapePairCollisionStatus* status : allPairsResult->GetCollisionStatusArray())
+		{
+			ShapeID shapeIDA = status->GetShapeID(0);
+			ShapeID shapeIDB = status->GetShapeID(1);
+			foundPairSet.insert(std::pair<ShapeID, ShapeID>(IMZADI_MIN(shapeIDA, shapeIDB), IMZADI_MAX(shapeIDA, shapeIDB)));
+		}
+
+		collisionSystem.Free<Result>(result);
+
+		std::set<std::pair<ShapeID, ShapeID>> expectedPairSet;
+		for (uint32_t i = 0; i < (uint32_t)sphereArray.size(); i++)
+		{
+			const Sphere& sphere = sphereArray[i];
+			if (bounded && !sphere.inWorld)
+				continue;
+
+			for (uint32_t j = i + 1; j < (uint32_t)sphereArray.size(); j++)
+			{
+				const Sphere& otherSphere = sphereArray[j];
+				if ((otherSphere.inWorld || !bounded) && (sphere.GetPosition() - otherSphere.GetPosition()).Length() < sphere.radius + otherSphere.radius)
+					expectedPairSet.insert(std::pair<ShapeID, ShapeID>(IMZADI_MIN(sphere.shapeID, otherSphere.shapeID), IMZADI_MAX(sphere.shapeID, otherSphere.shapeID)));
+			}
+		}
+
+		numPairs += expectedPairSet.size();
+		if (foundPairSet != expectedPairSet)
+		{
+			numMismatchedRounds++;
+			this->Report("Round %d with the %s: found %d pair(s), but expected %d.", round, broadPhaseName, (int)foundPairSet.size(), (int)expectedPairSet.size());
+		}
+	}
+
+	collisionSystem.Shutdown();
+
+	this->Report("%d pairs found over %d rounds with the %s.", (int)numPairs, numRounds, broadPhaseName);
+	this->Check(numMismatchedRounds == 0, "%d round(s) with the %s found the wrong pairs.", numMismatchedRounds, broadPhaseName);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Test.h"
+#include "Collision/BroadPhase.h"
+
+/**
+ * An all-pairs query only brings up to date the shapes that have been inserted, moved or removed
+ * since the last one, so anything it misses would show up as a stale pair or a missing one.  Spheres
+ * are moved a few at a time, some out of the collision world and back, some removed and others added,
+ * alongside static spheres that must never be paired, and after every round the pairs found are
+ * checked against those worked out by hand.  This is done for every kind of broad-phase.
+ */
+class AllPairsTest : public Test
+{
+public:
+	AllPairsTest();
+	virtual ~AllPairsTest();
+
+	virtual void Run() override;
+
+private:
+	void TestBroadPhase(Imzadi::BroadPhase::Type broadPhaseType, const char* broadPhaseName);
+};
\ No newline at end of file
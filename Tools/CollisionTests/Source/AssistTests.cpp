@@ -0,0 +1,133 @@
+#include "AssistTests.h"
+#include "Collision/System.h"
+#include "Collision/Query.h"
+#include "Collision/Result.h"
+#include "Collision/CollisionCache.h"
+#include "Collision/Shapes/Sphere.h"
+#include <thread>
+#include <set>
+
+using namespace Imzadi;
+
+namespace
+{
+	/**
+	 * This is a collision query that tallies whether it ran on the flushing thread.
+	 * The first one stalls the collision thread long enough for the flush to begin,
+	 * so that the rest are sure to be gathered into a run the flushing thread can join.
+	 */
+	class ThreadNotingQuery : public CollisionQuery
+	{
+	public:
+		ThreadNotingQuery(std::thread::id flushingThreadID, std::atomic<uint32_t>* numRunOnFlushingThread, bool stall)
+		{
+			this->flushingThreadID = flushingThreadID;
+			this->numRunOnFlushingThread = numRunOnFlushingThread;
+			this->stall = stall;
+		}
+
+		virtual Result* ExecuteQuery(Thread* thread) override
+		{
+			if (this->stall)
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+			if (std::this_thread::get_id() == this->flushingThreadID)
+				(*this->numRunOnFlushingThread)++;
+
+			return CollisionQuery::ExecuteQuery(thread);
+		}
+
+	private:
+		std::thread::id flushingThreadID;
+		std::atomic<uint32_t>* numRunOnFlushingThread;
+		bool stall;
+	};
+}
+
+AssistDuringFlushTest::AssistDuringFlushTest() : Test("AssistDuringFlush")
+{
+}
+
+/*virtual*/ AssistDuringFlushTest::~AssistDuringFlushTest()
+{
+}
+
+/*virtual*/ void AssistDuringFlushTest::Run()
+{
+	constexpr uint32_t numSpheres = 400;
+	constexpr uint32_t numRounds = 10;
+	constexpr double radius = 3.0;
+
+	CollisionSystem collisionSystem;
+	if (!this->Check(collisionSystem.Initialize(MakeWorldBox(200.0), 1), "Failed to initialize collision system."))
+		return;
+
+	std::vector<Vector3> centerArray;
+	std::vector<ShapeID> shapeIDArray;
+	for (uint32_t i = 0; i < numSpheres; i++)
+	{
+		Vector3 center = this->RandomPoint(50.0, 10.0, 50.0);
+		auto sphere = SphereShape::Create();
+		sphere->SetCenter(center);
+		sphere->SetRadius(radius);
+		centerArray.push_back(center);
+		shapeIDArray.push_back(collisionSystem.AddShape(sphere, 0));
+	}
+
+	collisionSystem.FlushAllTasks();
+
+	std::atomic<uint32_t> numRunOnFlushingThread(0);
+	uint32_t numQueries = 0;
+	uint32_t numMissing = 0;
+	uint32_t numWrong = 0;
+
+	for (uint32_t round = 0; round < numRounds; round++)
+	{
+		QueryBatch* batch = QueryBatch::Create();
+		for (uint32_t i = 0; i < numSpheres; i++)
+		{
+			auto query = new ThreadNotingQuery(std::this_thread::get_id(), &numRunOnFlushingThread, i == 0);
+			query->SetShapeID(shapeIDArray[i]);
+			batch->Add(query);
+		}
+
+		TaskIDRange taskIDRange;
+		collisionSystem.MakeQueries(batch, taskIDRange);
+		collisionSystem.FlushAllTasks();
+
+		for (uint32_t i = 0; i < numSpheres; i++)
+		{
+			numQueries++;
+			Result* result = collisionSystem.ObtainQueryResult(taskIDRange[i]);
+			auto collisionResult = dynamic_cast<CollisionQueryResult*>(result);
+			if (!collisionResult)
+			{
+				numMissing++;
+				collisionSystem.Free<Result>(result);
+				continue;
+			}
+
+			std::set<ShapeID> foundSet;
+			for (const ShapePairCollisionStatus* status : collisionResult->GetCollisionStatusArray())
+				if (status->AreInCollision())
+					foundSet.insert(status->GetOtherShape(shapeIDArray[i]));
+
+			std::set<ShapeID> expectedSet;
+			for (uint32_t j = 0; j < numSpheres; j++)
+				if (j != i && (centerArray[i] - centerArray[j]).Length() < 2.0 * radius)
+					expectedSet.insert(shapeIDArray[j]);
+
+			if (foundSet != expectedSet)
+				numWrong++;
+
+			collisionSystem.Free<Result>(result);
+		}
+	}
+
+	collisionSystem.Shutdown();
+
+	this->Report("%d queries, %d run on the flushing thread.", numQueries, numRunOnFlushingThread.load());
+	this->Check(numMissing == 0, "%d result(s) missing after flush.", numMissing);
+	this->Check(numWrong == 0, "%d result(s) disagree with brute force.", numWrong);
+	this->Check(numRunOnFlushingThread.load() > 0, "The flushing thread did not help.");
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Test.h"
+
+/**
+ * A thread flushing the collision system should help execute the queries it is waiting on,
+ * and the results it gets should be no different for it.  A batch of collision queries
+ * among randomly placed spheres is flushed with a single collision thread, and each
+ * answer is checked against brute force.  Each query also notes the thread that ran it,
+ * so we can check that the flushing thread did some of them.
+ */
+class AssistDuringFlushTest : public Test
+{
+public:
+	AssistDuringFlushTest();
+	virtual ~AssistDuringFlushTest();
+
+	virtual void Run() override;
+};
\ No newline at end of file
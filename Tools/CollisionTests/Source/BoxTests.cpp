@@ -0,0 +1,191 @@
+#include "BoxTests.h"
+#include "Collision/ConvexCollision.h"
+#include "Collision/CollisionCalculator.h"
+#include "Collision/Shapes/Box.h"
+#include <math.h>
+#include <algorithm>
+
+using namespace Imzadi;
+
+//------------------------------------ BoxBoxTest ------------------------------------
+
+/*static*/ const char* BoxBoxTest::arrangementName[3] = { "rotated", "aligned", "sheared" };
+
+BoxBoxTest::BoxBoxTest() : Test("BoxBox")
+{
+}
+
+BoxBoxTest::BoxBoxTest(const char* name) : Test(name)
+{
+}
+
+/*virtual*/ BoxBoxTest::~BoxBoxTest()
+{
+}
+
+/*virtual*/ void BoxBoxTest::Run()
+{
+	constexpr uint32_t numPairs = 5000;
+
+	for (int arrangement = ROTATED; arrangement <= SHEARED; arrangement++)
+	{
+		uint32_t numCollisions = 0;
+		uint32_t numCollisionMismatches = 0;
+		uint32_t numDepthMismatches = 0;
+		uint32_t numUnresolved = 0;
+		uint32_t numOvershot = 0;
+
+		for (uint32_t i = 0; i < numPairs; i++)
+		{
+			BoxShape* boxA = nullptr;
+			BoxShape* boxB = nullptr;
+			this->MakeBoxPair(Arrangement(arrangement), boxA, boxB);
+
+			ShapePairCollisionStatus* status = CollisionCalculator<BoxShape, BoxShape>::Calculate(boxA, boxB);
+			ShapePairCollisionStatus* convexStatus = ConvexCollision::Calculate(boxA, boxB);
+
+			if (status->AreInCollision() != convexStatus->AreInCollision())
+				numCollisionMismatches++;
+			else if (status->AreInCollision())
+			{
+				numCollisions++;
+
+				// Where more than one axis is as shallow as any, the two may pick different ones, so only the depths must agree.
+				double depth = status->GetSeparationDeltaLength();
+				double convexDepth = convexStatus->GetSeparationDeltaLength();
+				if (::fabs(depth - convexDepth) > 1e-6 * IMZADI_MAX(1.0, convexDepth))
+					numDepthMismatches++;
+
+				// Whichever axis was picked, moving the first box along the delta, and a hair more, should just pull the boxes apart.
+				Vector3 delta = status->GetSeparationDelta(boxA->GetShapeID());
+				Transform objectToWorld = boxA->GetObjectToWorldTransform();
+
+				Transform movedObjectToWorld = objectToWorld;
+				movedObjectToWorld.translation += delta * 1.000001;
+				boxA->SetObjectToWorldTransform(movedObjectToWorld);
+				ShapePairCollisionStatus* movedStatus = ConvexCollision::Calculate(boxA, boxB);
+				if (movedStatus->AreInCollision())
+					numUnresolved++;
+
+				delete movedStatus;
+
+				movedObjectToWorld.translation = objectToWorld.translation + delta * 0.99;
+				boxA->SetObjectToWorldTransform(movedObjectToWorld);
+				movedStatus = ConvexCollision::Calculate(boxA, boxB);
+				if (!movedStatus->AreInCollision())
+					numOvershot++;
+
+				delete movedStatus;
+			}
+
+			delete status;
+			delete convexStatus;
+			Shape::Free(boxA);
+			Shape::Free(boxB);
+		}
+
+		const char* name = arrangementName[arrangement];
+		this->Report("%s: %d of %d pairs in collision.", name, numCollisions, numPairs);
+		this->Check(numCollisionMismatches == 0, "%s: %d pair(s) where the calculator and GJK disagree on collision.", name, numCollisionMismatches);
+		this->Check(numDepthMismatches == 0, "%s: %d pair(s) where the calculator and EPA disagree on depth.", name, numDepthMismatches);
+		this->Check(numUnresolved == 0, "%s: %d of %d separation deltas did not pull the boxes apart.", name, numUnresolved, numCollisions);
+		this->Check(numOvershot == 0, "%s: %d of %d separation deltas were longer than needed.", name, numOvershot, numCollisions);
+	}
+}
+
+void BoxBoxTest::MakeBoxPair(Arrangement arrangement, BoxShape*& boxA, BoxShape*& boxB)
+{
+	boxA = BoxShape::Create();
+	boxA->SetExtents(Vector3(this->Random(0.05, 1.5), this->Random(0.05, 1.5), this->Random(0.05, 1.5)));
+	boxA->SetObjectToWorldTransform(this->RandomTransform(arrangement == SHEARED));
+
+	boxB = BoxShape::Create();
+	boxB->SetExtents(Vector3(this->Random(0.05, 1.5), this->Random(0.05, 1.5), this->Random(0.05, 1.5)));
+	Transform objectToWorld = this->RandomTransform(arrangement == SHEARED);
+	if (arrangement == ALIGNED)
+		objectToWorld.matrix = boxA->GetObjectToWorldTransform().matrix;
+
+	boxB->SetObjectToWorldTransform(objectToWorld);
+}
+
+Transform BoxBoxTest::RandomTransform(bool shear)
+{
+	Vector3 unitAxis = this->RandomPoint(1.0, 1.0, 1.0).Normalized();
+	Transform transform(unitAxis, this->Random(0.0, 2.0 * M_PI), this->RandomPoint(1.5, 1.5, 1.5));
+
+	if (shear)
+	{
+		Matrix3x3 shearMatrix;
+		shearMatrix.SetIdentity();
+		shearMatrix.ele[0][0] = this->Random(0.5, 1.5);
+		shearMatrix.ele[0][1] = this->Random(-0.5, 0.5);
+		shearMatrix.ele[1][2] = this->Random(-0.5, 0.5);
+		transform.matrix = transform.matrix * shearMatrix;
+	}
+
+	return transform;
+}
+
+//------------------------------------ BoxBoxBenchmark ------------------------------------
+
+BoxBoxBenchmark::BoxBoxBenchmark() : BoxBoxTest("BoxBoxBenchmark")
+{
+}
+
+/*virtual*/ BoxBoxBenchmark::~BoxBoxBenchmark()
+{
+}
+
+/*virtual*/ bool BoxBoxBenchmark::IsBenchmark() const
+{
+	return true;
+}
+
+/*virtual*/ void BoxBoxBenchmark::Run()
+{
+	constexpr uint32_t numPairs = 20000;
+	constexpr uint32_t numPasses = 5;
+
+	for (int arrangement = ROTATED; arrangement <= SHEARED; arrangement++)
+	{
+		std::vector<BoxShape*> boxArrayA(numPairs), boxArrayB(numPairs);
+		for (uint32_t i = 0; i < numPairs; i++)
+			this->MakeBoxPair(Arrangement(arrangement), boxArrayA[i], boxArrayB[i]);
+
+		// The best of several passes is taken, so that the numbers are about the code, not whatever else the machine was doing.
+		double calculatorSeconds = 1e30;
+		double convexSeconds = 1e30;
+		uint32_t numCollisions = 0;
+		for (uint32_t pass = 0; pass < numPasses; pass++)
+		{
+			numCollisions = 0;
+			Stopwatch calculatorStopwatch;
+			for (uint32_t i = 0; i < numPairs; i++)
+			{
+				ShapePairCollisionStatus* status = CollisionCalculator<BoxShape, BoxShape>::Calculate(boxArrayA[i], boxArrayB[i]);
+				if (status->AreInCollision())
+					numCollisions++;
+
+				delete status;
+			}
+
+			calculatorSeconds = std::min(calculatorSeconds, calculatorStopwatch.GetElapsedSeconds());
+
+			Stopwatch convexStopwatch;
+			for (uint32_t i = 0; i < numPairs; i++)
+				delete ConvexCollision::Calculate(boxArrayA[i], boxArrayB[i]);
+
+			convexSeconds = std::min(convexSeconds, convexStopwatch.GetElapsedSeconds());
+		}
+
+		this->Report("%s (%d of %d pairs in collision): separating axes %.0f ns/pair, GJK and EPA %.0f ns/pair, %.1fx faster.",
+			arrangementName[arrangement], numCollisions, numPairs,
+			calculatorSeconds * 1e9 / double(numPairs), convexSeconds * 1e9 / double(numPairs), convexSeconds / calculatorSeconds);
+
+		for (uint32_t i = 0; i < numPairs; i++)
+		{
+			Shape::Free(boxArrayA[i]);
+			Shape::Free(boxArrayB[i]);
+		}
+	}
+}
\ No newline at end of file
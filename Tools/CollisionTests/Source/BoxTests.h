@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Test.h"
+#include "Math/Transform.h"
+
+namespace Imzadi
+{
+	class BoxShape;
+}
+
+/**
+ * Pairs of boxes have a calculator of their own, using the separating axis test, where they used to
+ * go through the GJK and EPA algorithms of the ConvexCollision class.  The two are run side by side
+ * on random pairs of boxes, including boxes lined up with one another and boxes sheared out of square,
+ * and must agree on whether the boxes collide and how deep.  The calculator's separation delta must
+ * also be just enough to pull the boxes apart.
+ */
+class BoxBoxTest : public Test
+{
+public:
+	BoxBoxTest();
+	virtual ~BoxBoxTest();
+
+	virtual void Run() override;
+
+protected:
+	BoxBoxTest(const char* name);
+
+	/**
+	 * These are the ways the pairs of boxes are made.
+	 */
+	enum Arrangement
+	{
+		ROTATED,			///< Each box is turned every which way.
+		ALIGNED,			///< Both boxes are turned the same way, so many of the axes tested are parallel.
+		SHEARED				///< Each box is turned and sheared, so it's a parallelepiped in world space.
+	};
+
+	/**
+	 * Make a pair of boxes, of random size, placed near one another in the given arrangement.
+	 */
+	void MakeBoxPair(Arrangement arrangement, Imzadi::BoxShape*& boxA, Imzadi::BoxShape*& boxB);
+
+	/**
+	 * Return a random rotation, followed by a shear if asked for, followed by a random translation near the origin.
+	 */
+	Imzadi::Transform RandomTransform(bool shear);
+
+	static const char* arrangementName[3];
+};
+
+/**
+ * Time the box-box calculator against the GJK and EPA algorithms it replaced, on the same random pairs of boxes.
+ */
+class BoxBoxBenchmark : public BoxBoxTest
+{
+public:
+	BoxBoxBenchmark();
+	virtual ~BoxBoxBenchmark();
+
+	virtual void Run() override;
+	virtual bool IsBenchmark() const override;
+};
\ No newline at end of file
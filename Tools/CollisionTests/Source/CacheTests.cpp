@@ -0,0 +1,200 @@
+#include "CacheTests.h"
+#include "Collision/System.h"
+#include "Collision/Query.h"
+#include "Collision/Command.h"
+#include "Collision/Result.h"
+#include "Collision/Shapes/Sphere.h"
+#include <math.h>
+
+using namespace Imzadi;
+
+CollisionCacheTest::CollisionCacheTest() : Test("CollisionCache")
+{
+}
+
+/*virtual*/ CollisionCacheTest::~CollisionCacheTest()
+{
+}
+
+/*virtual*/ void CollisionCacheTest::Run()
+{
+	constexpr double spacing = 1.5;
+	constexpr double queryGroupSpacing = 5.0;
+	constexpr uint32_t numRemoved = 20;
+
+	CollisionSystem collisionSystem;
+	if (!this->Check(collisionSystem.Initialize(MakeWorldBox(50.0), 1), "Failed to initialize collision system."))
+		return;
+
+	// A sheet of static unit spheres covers the floor of the world.  The moving spheres sit among them,
+	// offset from the grid so no boxes merely touch, and far enough apart to never overlap one another.
+	// So every pair a query looks up is one moving sphere and one static sphere, and is looked up once.
+	std::vector<Vector3> staticCenterArray;
+	for (double x = -45.0; x <= 45.0; x += spacing)
+	{
+		for (double z = -45.0; z <= 45.0; z += spacing)
+		{
+			auto sphere = SphereShape::Create();
+			sphere->SetCenter(Vector3(x, 0.0, z));
+			sphere->SetRadius(1.0);
+			collisionSystem.AddShape(sphere, IMZADI_ADD_FLAG_STATIC);
+			staticCenterArray.push_back(Vector3(x, 0.0, z));
+		}
+	}
+
+	// The first group is much bigger than the second, so that evicting part of it makes room for the second.
+	std::vector<ShapeID> groupArray[2];
+	std::vector<uint32_t> numPairsArray[2];
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		double minX = (i == 0) ? -40.0 : 20.0;
+		double maxX = (i == 0) ? -5.0 : 40.0;
+		double maxZ = (i == 0) ? 40.0 : -20.0;
+
+		for (double x = minX; x <= maxX; x += queryGroupSpacing)
+		{
+			for (double z = -40.0; z <= maxZ; z += queryGroupSpacing)
+			{
+				Vector3 center(x + 0.37, 0.0, z + 0.37);
+
+				auto sphere = SphereShape::Create();
+				sphere->SetCenter(center);
+				sphere->SetRadius(1.0);
+				groupArray[i].push_back(collisionSystem.AddShape(sphere, 0));
+
+				uint32_t numPairs = 0;
+				for (const Vector3& staticCenter : staticCenterArray)
+					if (::fabs(center.x - staticCenter.x) < 2.0 && ::fabs(center.z - staticCenter.z) < 2.0)
+						numPairs++;
+
+				numPairsArray[i].push_back(numPairs);
+			}
+		}
+	}
+
+	uint64_t numPairsA = 0;
+	for (uint32_t numPairs : numPairsArray[0])
+		numPairsA += numPairs;
+
+	uint64_t numPairsB = 0;
+	for (uint32_t numPairs : numPairsArray[1])
+		numPairsB += numPairs;
+
+	CollisionStatistics::Snapshot snapshot;
+	if (!this->TakeSnapshot(collisionSystem, snapshot) || !this->QueryShapes(collisionSystem, groupArray[0]) || !this->TakeSnapshot(collisionSystem, snapshot))
+		return;
+
+	this->Report("%d pairs in the first group, %d in the second.", (int)numPairsA, (int)numPairsB);
+	this->Check(snapshot.numCacheMisses == numPairsA && snapshot.numCacheHits == 0, "First look-ups of the first group: %d misses and %d hits, but expected %d misses.", (int)snapshot.numCacheMisses, (int)snapshot.numCacheHits, (int)numPairsA);
+	this->Check(snapshot.numCacheEntries == numPairsA, "Cache holds %d entries, but expected %d.", (int)snapshot.numCacheEntries, (int)numPairsA);
+
+	// Removing shapes should purge exactly the entries involving them, and leave the rest to be hit.
+	uint64_t numPurgedPairs = 0;
+	for (uint32_t i = 0; i < numRemoved; i++)
+	{
+		uint32_t j = (uint32_t)this->RandomInt(0, (int)groupArray[0].size() - 1);
+		collisionSystem.RemoveShape(groupArray[0][j]);
+		numPurgedPairs += numPairsArray[0][j];
+		numPairsA -= numPairsArray[0][j];
+		groupArray[0][j] = groupArray[0].back();
+		groupArray[0].pop_back();
+		numPairsArray[0][j] = numPairsArray[0].back();
+		numPairsArray[0].pop_back();
+	}
+
+	if (!this->TakeSnapshot(collisionSystem, snapshot))
+		return;
+
+	this->Check(snapshot.numCachePurges == numPurgedPairs, "Removing %d shapes purged %d entries, but expected %d.", numRemoved, (int)snapshot.numCachePurges, (int)numPurgedPairs);
+	this->Check(snapshot.numCacheEntries == numPairsA, "Cache holds %d entries after purging, but expected %d.", (int)snapshot.numCacheEntries, (int)numPairsA);
+
+	if (!this->QueryShapes(collisionSystem, groupArray[0]) || !this->TakeSnapshot(collisionSystem, snapshot))
+		return;
+
+	this->Check(snapshot.numCacheMisses == 0 && snapshot.numCacheHits == numPairsA, "Repeat look-ups after purging: %d misses and %d hits, but expected %d hits.", (int)snapshot.numCacheMisses, (int)snapshot.numCacheHits, (int)numPairsA);
+
+	// Now cap the cache at what it takes up already.  Adding the second group goes over the limit, and the
+	// first group, having gone unused the longest, should pay for it, while the second group, just used, is kept.
+	uint64_t memoryLimit = snapshot.cacheMemoryUsage;
+	auto command = SetCacheMemoryLimitCommand::Create();
+	command->SetMemoryLimit(memoryLimit);
+	collisionSystem.IssueCommand(command);
+
+	if (!this->QueryShapes(collisionSystem, groupArray[1]) || !this->TakeSnapshot(collisionSystem, snapshot))
+		return;
+
+	uint64_t numEvicted = snapshot.numCacheEvictions;
+	this->Report("Over the limit of %d bytes, %d entries were evicted, leaving %d bytes.", (int)memoryLimit, (int)numEvicted, (int)snapshot.cacheMemoryUsage);
+	this->Check(snapshot.numCacheMisses == numPairsB, "First look-ups of the second group: %d misses, but expected %d.", (int)snapshot.numCacheMisses, (int)numPairsB);
+	this->Check(numEvicted > 0 && numEvicted <= numPairsA, "Going over the limit evicted %d entries, but expected some, and no more than the first group's %d.", (int)numEvicted, (int)numPairsA);
+	this->Check(snapshot.cacheMemoryUsage <= memoryLimit, "Cache takes up %d bytes after eviction, over its limit of %d.", (int)snapshot.cacheMemoryUsage, (int)memoryLimit);
+	this->Check(snapshot.numCacheEntries == numPairsA + numPairsB - numEvicted, "Cache holds %d entries after eviction, but expected %d.", (int)snapshot.numCacheEntries, (int)(numPairsA + numPairsB - numEvicted));
+
+	if (!this->QueryShapes(collisionSystem, groupArray[1]) || !this->TakeSnapshot(collisionSystem, snapshot))
+		return;
+
+	this->Check(snapshot.numCacheMisses == 0, "Repeat look-ups of the second group missed %d times, so entries in use were evicted.", (int)snapshot.numCacheMisses);
+
+	if (!this->QueryShapes(collisionSystem, groupArray[0]) || !this->TakeSnapshot(collisionSystem, snapshot))
+		return;
+
+	this->Check(snapshot.numCacheMisses == numEvicted, "Repeat look-ups of the first group missed %d times, but expected one per evicted entry, %d.", (int)snapshot.numCacheMisses, (int)numEvicted);
+
+	// With no room at all, everything is evicted the moment it goes unused, but what was just used is kept, limit or no.
+	command = SetCacheMemoryLimitCommand::Create();
+	command->SetMemoryLimit(0);
+	collisionSystem.IssueCommand(command);
+
+	if (!this->QueryShapes(collisionSystem, groupArray[1]) || !this->TakeSnapshot(collisionSystem, snapshot))
+		return;
+
+	this->Check(snapshot.numCacheMisses == numPairsB, "Look-ups of the second group with no room missed %d times, but expected %d.", (int)snapshot.numCacheMisses, (int)numPairsB);
+	this->Check(snapshot.numCacheEntries == numPairsB, "Cache holds %d entries with no room, but expected the %d just used.", (int)snapshot.numCacheEntries, (int)numPairsB);
+
+	collisionSystem.Shutdown();
+}
+
+bool CollisionCacheTest::QueryShapes(CollisionSystem& collisionSystem, const std::vector<ShapeID>& shapeIDArray)
+{
+	QueryBatch* batch = QueryBatch::Create();
+	for (ShapeID shapeID : shapeIDArray)
+	{
+		auto query = CollisionQuery::Create();
+		query->SetShapeID(shapeID);
+		batch->Add(query);
+	}
+
+	TaskIDRange taskIDRange;
+	collisionSystem.MakeQueries(batch, taskIDRange);
+	collisionSystem.FlushAllTasks();
+
+	bool allResultsFound = true;
+	for (uint32_t i = 0; i < (uint32_t)shapeIDArray.size(); i++)
+	{
+		Result* result = collisionSystem.ObtainQueryResult(taskIDRange[i]);
+		if (!result)
+			allResultsFound = false;
+
+		collisionSystem.Free<Result>(result);
+	}
+
+	return this->Check(allResultsFound, "Some collision results were missing.");
+}
+
+bool CollisionCacheTest::TakeSnapshot(CollisionSystem& collisionSystem, CollisionStatistics::Snapshot& snapshot)
+{
+	auto query = StatisticsQuery::Create();
+	query->SetResetCounters(true);
+
+	TaskID taskID = 0;
+	collisionSystem.MakeQuery(query, taskID);
+	collisionSystem.WaitForTask(taskID);
+
+	Result* result = collisionSystem.ObtainQueryResult(taskID);
+	auto statisticsResult = dynamic_cast<StatisticsResult*>(result);
+	if (statisticsResult)
+		snapshot = statisticsResult->GetSnapshot();
+
+	collisionSystem.Free<Result>(result);
+	return this->Check(statisticsResult != nullptr, "Statistics result missing.");
+}
\ No newline at end of file
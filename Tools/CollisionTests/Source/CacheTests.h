@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Test.h"
+#include "Collision/Shape.h"
+#include "Collision/CollisionStatistics.h"
+
+namespace Imzadi
+{
+	class CollisionSystem;
+}
+
+/**
+ * The collision cache is trimmed between batches of queries.  Entries involving removed shapes
+ * should be purged, and, once the cache is over its memory limit, the entries that have gone unused
+ * the longest should be evicted, but never those in use.  Spheres are laid out so that every pair
+ * the queries look up is looked up exactly once, and the cache's statistics are checked against
+ * those pairs as shapes are removed, the limit is lowered, and the same queries are made again.
+ */
+class CollisionCacheTest : public Test
+{
+public:
+	CollisionCacheTest();
+	virtual ~CollisionCacheTest();
+
+	virtual void Run() override;
+
+private:
+
+	/**
+	 * Make a collision query for each of the given shapes, and wait for them all.
+	 */
+	bool QueryShapes(Imzadi::CollisionSystem& collisionSystem, const std::vector<Imzadi::ShapeID>& shapeIDArray);
+
+	/**
+	 * Take the statistics gathered since the last call, which also gets the cache trimmed.
+	 */
+	bool TakeSnapshot(Imzadi::CollisionSystem& collisionSystem, Imzadi::CollisionStatistics::Snapshot& snapshot);
+};
\ No newline at end of file
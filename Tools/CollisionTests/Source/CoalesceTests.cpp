@@ -0,0 +1,213 @@
+#include "CoalesceTests.h"
+#include "Gate.h"
+#include "Collision/System.h"
+#include "Collision/Query.h"
+#include "Collision/Command.h"
+#include "Collision/Result.h"
+#include "Collision/CollisionCache.h"
+#include "Collision/Shapes/Sphere.h"
+#include <thread>
+#include <set>
+
+using namespace Imzadi;
+
+MoveCoalescingTest::MoveCoalescingTest() : Test("MoveCoalescing")
+{
+}
+
+/*virtual*/ MoveCoalescingTest::~MoveCoalescingTest()
+{
+}
+
+/*virtual*/ void MoveCoalescingTest::Run()
+{
+	this->TestBurstOfMoves();
+	this->TestAbsorbedMoveCompletion();
+}
+
+void MoveCoalescingTest::TestBurstOfMoves()
+{
+	constexpr uint32_t numSpheres = 300;
+	constexpr uint32_t numMovesPerSphere = 4;
+	constexpr double radius = 3.0;
+
+	CollisionSystem collisionSystem;
+	if (!this->Check(collisionSystem.Initialize(MakeWorldBox(200.0), 1), "Failed to initialize collision system."))
+		return;
+
+	std::vector<ShapeID> shapeIDArray;
+	for (uint32_t i = 0; i < numSpheres; i++)
+	{
+		auto sphere = SphereShape::Create();
+		sphere->SetRadius(radius);
+		shapeIDArray.push_back(collisionSystem.AddShape(sphere, 0));
+	}
+
+	collisionSystem.FlushAllTasks();
+
+	CommandStats statsBefore;
+	collisionSystem.GetCommandStats(statsBefore);
+
+	Gate gate;
+	collisionSystem.IssueCommand(gate.MakeCommand());
+	gate.WaitUntilReached();
+
+	// Every sphere is moved several times, one batch per lap, while the collision thread is held up.
+	std::vector<Vector3> previousPositionArray(numSpheres);
+	std::vector<Vector3> positionArray(numSpheres);
+	for (uint32_t j = 0; j < numMovesPerSphere; j++)
+	{
+		CommandBatch* batch = CommandBatch::Create();
+		for (uint32_t i = 0; i < numSpheres; i++)
+		{
+			previousPositionArray[i] = positionArray[i];
+			positionArray[i] = this->RandomPoint(40.0, 8.0, 40.0);
+
+			auto command = ObjectToWorldCommand::Create();
+			command->SetShapeID(shapeIDArray[i]);
+			command->objectToWorld.SetIdentity();
+			command->objectToWorld.translation = positionArray[i];
+			batch->Add(command);
+		}
+
+		collisionSystem.IssueCommands(batch);
+	}
+
+	QueryBatch* queryBatch = QueryBatch::Create();
+	for (uint32_t i = 0; i < numSpheres; i++)
+	{
+		auto collisionQuery = CollisionQuery::Create();
+		collisionQuery->SetShapeID(shapeIDArray[i]);
+		queryBatch->Add(collisionQuery);
+
+		auto objectToWorldQuery = ObjectToWorldQuery::Create();
+		objectToWorldQuery->SetShapeID(shapeIDArray[i]);
+		queryBatch->Add(objectToWorldQuery);
+	}
+
+	TaskIDRange taskIDRange;
+	collisionSystem.MakeQueries(queryBatch, taskIDRange);
+
+	gate.Open();
+	collisionSystem.FlushAllTasks();
+
+	CommandStats statsAfter;
+	collisionSystem.GetCommandStats(statsAfter);
+
+	uint32_t numWrongCollisions = 0;
+	uint32_t numWrongTransforms = 0;
+	uint32_t numMissing = 0;
+
+	for (uint32_t i = 0; i < numSpheres; i++)
+	{
+		Result* result = collisionSystem.ObtainQueryResult(taskIDRange[2 * i]);
+		auto collisionResult = dynamic_cast<CollisionQueryResult*>(result);
+		if (!collisionResult)
+			numMissing++;
+		else
+		{
+			std::set<ShapeID> foundSet;
+			for (const ShapePairCollisionStatus* status : collisionResult->GetCollisionStatusArray())
+				if (status->AreInCollision())
+					foundSet.insert(status->GetOtherShape(shapeIDArray[i]));
+
+			std::set<ShapeID> expectedSet;
+			for (uint32_t j = 0; j < numSpheres; j++)
+				if (j != i && (positionArray[i] - positionArray[j]).Length() < 2.0 * radius)
+					expectedSet.insert(shapeIDArray[j]);
+
+			if (foundSet != expectedSet)
+				numWrongCollisions++;
+		}
+
+		collisionSystem.Free<Result>(result);
+
+		result = collisionSystem.ObtainQueryResult(taskIDRange[2 * i + 1]);
+		auto objectToWorldResult = dynamic_cast<ObjectToWorldResult*>(result);
+		if (!objectToWorldResult)
+			numMissing++;
+		else if ((objectToWorldResult->objectToWorld.translation - positionArray[i]).Length() > 1e-9 ||
+				(objectToWorldResult->previousObjectToWorld.translation - previousPositionArray[i]).Length() > 1e-9)
+			numWrongTransforms++;
+
+		collisionSystem.Free<Result>(result);
+	}
+
+	collisionSystem.Shutdown();
+
+	uint64_t numCommands = statsAfter.numObjectToWorldCommands - statsBefore.numObjectToWorldCommands;
+	uint64_t numElided = statsAfter.numObjectToWorldCommandsElided - statsBefore.numObjectToWorldCommandsElided;
+	this->Report("%d moves sent, %d elided.", uint32_t(numCommands), uint32_t(numElided));
+	this->Check(numElided == numSpheres * (numMovesPerSphere - 1), "Expected %d moves to be elided.", numSpheres * (numMovesPerSphere - 1));
+	this->Check(numMissing == 0, "%d result(s) missing.", numMissing);
+	this->Check(numWrongCollisions == 0, "%d collision result(s) disagree with brute force.", numWrongCollisions);
+	this->Check(numWrongTransforms == 0, "%d shape(s) not left where the last two moves put them.", numWrongTransforms);
+}
+
+void MoveCoalescingTest::TestAbsorbedMoveCompletion()
+{
+	CollisionSystem collisionSystem;
+	if (!this->Check(collisionSystem.Initialize(MakeWorldBox(200.0), 1), "Failed to initialize collision system."))
+		return;
+
+	auto sphere = SphereShape::Create();
+	sphere->SetRadius(1.0);
+	ShapeID shapeID = collisionSystem.AddShape(sphere, 0);
+	collisionSystem.FlushAllTasks();
+
+	// The first gate makes sure the second gate and both moves get staged together.
+	// The second gate then holds up the first move after the second has been folded into it.
+	Gate firstGate, secondGate;
+	collisionSystem.IssueCommand(firstGate.MakeCommand());
+	firstGate.WaitUntilReached();
+	collisionSystem.IssueCommand(secondGate.MakeCommand());
+
+	auto firstMove = ObjectToWorldCommand::Create();
+	firstMove->SetShapeID(shapeID);
+	firstMove->objectToWorld.SetIdentity();
+	firstMove->objectToWorld.translation = Vector3(10.0, 0.0, 0.0);
+	collisionSystem.IssueCommand(firstMove);
+
+	auto secondMove = ObjectToWorldCommand::Create();
+	secondMove->SetShapeID(shapeID);
+	secondMove->objectToWorld.SetIdentity();
+	secondMove->objectToWorld.translation = Vector3(20.0, 0.0, 0.0);
+	TaskID secondMoveTaskID = secondMove->GetTaskID();
+	collisionSystem.IssueCommand(secondMove);
+
+	firstGate.Open();
+	secondGate.WaitUntilReached();
+
+	std::atomic<bool> waitReturned(false);
+	std::thread waiter([&collisionSystem, &waitReturned, secondMoveTaskID]()
+	{
+		collisionSystem.WaitForTask(secondMoveTaskID);
+		waitReturned = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	bool returnedEarly = waitReturned.load();
+
+	CommandStats stats;
+	collisionSystem.GetCommandStats(stats);
+
+	secondGate.Open();
+	waiter.join();
+
+	auto query = ObjectToWorldQuery::Create();
+	query->SetShapeID(shapeID);
+	TaskID queryTaskID = 0;
+	collisionSystem.MakeQuery(query, queryTaskID);
+	collisionSystem.WaitForTask(queryTaskID);
+	Result* result = collisionSystem.ObtainQueryResult(queryTaskID);
+	auto objectToWorldResult = dynamic_cast<ObjectToWorldResult*>(result);
+	if (this->Check(objectToWorldResult != nullptr, "No object-to-world result."))
+		this->Check((objectToWorldResult->objectToWorld.translation - Vector3(20.0, 0.0, 0.0)).Length() < 1e-9, "Shape not where the second move put it.");
+
+	collisionSystem.Free<Result>(result);
+	collisionSystem.Shutdown();
+
+	this->Check(stats.numObjectToWorldCommandsElided == 1, "The second move was not folded into the first.");
+	this->Check(!returnedEarly, "Waiting on the folded move returned before the move it was folded into executed.");
+	this->Check(waitReturned.load(), "Waiting on the folded move never returned.");
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Test.h"
+
+/**
+ * When a shape is moved several times before the collision thread gets to it, only the last
+ * move should be applied, but nobody should be able to tell.  Bursts of moves are staged behind
+ * a gate, and then the shapes' transforms and collisions are checked against what they would
+ * be had every move been executed.  We also check that a move folded into an earlier one isn't
+ * reported done until that earlier move has executed.
+ */
+class MoveCoalescingTest : public Test
+{
+public:
+	MoveCoalescingTest();
+	virtual ~MoveCoalescingTest();
+
+	virtual void Run() override;
+
+private:
+	void TestBurstOfMoves();
+	void TestAbsorbedMoveCompletion();
+};
\ No newline at end of file
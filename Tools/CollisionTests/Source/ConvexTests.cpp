@@ -0,0 +1,325 @@
+#include "ConvexTests.h"
+#include "Collision/ConvexCollision.h"
+#include "Collision/CollisionCalculator.h"
+#include "Collision/CollisionCache.h"
+#include "Collision/Shapes/Sphere.h"
+#include "Collision/Shapes/Box.h"
+#include "Collision/Shapes/Capsule.h"
+#include "Collision/Shapes/Polygon.h"
+#include <math.h>
+
+using namespace Imzadi;
+
+/**
+ * Call the specialized calculator for the given types of shapes, so that they can all be put in one table.
+ */
+template<typename ShapeTypeA, typename ShapeTypeB>
+static ShapePairCollisionStatus* CalculateWithCalculator(const Shape* shapeA, const Shape* shapeB)
+{
+	return CollisionCalculator<ShapeTypeA, ShapeTypeB>::Calculate(static_cast<const ShapeTypeA*>(shapeA), static_cast<const ShapeTypeB*>(shapeB));
+}
+
+/*static*/ const char* ConvexCollisionTest::shapeKindName[NUM_SHAPE_KINDS] = { "sphere", "box", "capsule", "polygon" };
+
+ConvexCollisionTest::ConvexCollisionTest() : Test("ConvexCollision")
+{
+}
+
+/*virtual*/ ConvexCollisionTest::~ConvexCollisionTest()
+{
+}
+
+/*virtual*/ void ConvexCollisionTest::Run()
+{
+	this->TestAgainstCalculators();
+	this->TestAgainstGeometry();
+	this->TestSelfConsistency();
+}
+
+void ConvexCollisionTest::TestAgainstCalculators()
+{
+	constexpr uint32_t numPairs = 2000;
+
+	// Only calculators whose answers are exact are compared against.  Others, such as the one
+	// for a pair of capsules, cut corners of their own, and are checked against the geometry instead.
+	struct CalculatorCase
+	{
+		ShapeKind kindA;
+		ShapeKind kindB;
+		ShapePairCollisionStatus* (*calculate)(const Shape*, const Shape*);
+	};
+
+	static const CalculatorCase calculatorCaseArray[] =
+	{
+		{ SPHERE, SPHERE, &CalculateWithCalculator<SphereShape, SphereShape> },
+		{ SPHERE, CAPSULE, &CalculateWithCalculator<SphereShape, CapsuleShape> },
+		{ CAPSULE, SPHERE, &CalculateWithCalculator<CapsuleShape, SphereShape> },
+		{ SPHERE, POLYGON, &CalculateWithCalculator<SphereShape, PolygonShape> },
+		{ POLYGON, SPHERE, &CalculateWithCalculator<PolygonShape, SphereShape> }
+	};
+
+	for (const CalculatorCase& calculatorCase : calculatorCaseArray)
+	{
+		uint32_t numCollisionMismatches = 0;
+		uint32_t numDeltaMismatches = 0;
+		uint32_t numCollisions = 0;
+
+		for (uint32_t i = 0; i < numPairs; i++)
+		{
+			Shape* shapeA = this->MakeShape(calculatorCase.kindA);
+			Shape* shapeB = this->MakeShape(calculatorCase.kindB);
+
+			ShapePairCollisionStatus* convexStatus = ConvexCollision::Calculate(shapeA, shapeB);
+			ShapePairCollisionStatus* calculatorStatus = calculatorCase.calculate(shapeA, shapeB);
+
+			if (convexStatus->AreInCollision() != calculatorStatus->AreInCollision())
+				numCollisionMismatches++;
+			else if (convexStatus->AreInCollision())
+			{
+				numCollisions++;
+				if (!DeltasAgree(convexStatus->GetSeparationDelta(shapeA->GetShapeID()), calculatorStatus->GetSeparationDelta(shapeA->GetShapeID())))
+					numDeltaMismatches++;
+			}
+
+			delete convexStatus;
+			delete calculatorStatus;
+			Shape::Free(shapeA);
+			Shape::Free(shapeB);
+		}
+
+		const char* nameA = shapeKindName[calculatorCase.kindA];
+		const char* nameB = shapeKindName[calculatorCase.kindB];
+		this->Report("%s/%s: %d of %d pairs in collision.", nameA, nameB, numCollisions, numPairs);
+		this->Check(numCollisionMismatches == 0, "%s/%s: %d pair(s) where GJK and the calculator disagree on collision.", nameA, nameB, numCollisionMismatches);
+		this->Check(numDeltaMismatches == 0, "%s/%s: %d pair(s) where GJK and the calculator disagree on the separation delta.", nameA, nameB, numDeltaMismatches);
+	}
+}
+
+void ConvexCollisionTest::TestAgainstGeometry()
+{
+	constexpr uint32_t numPairs = 2000;
+	constexpr double touchingTolerance = 1e-6;
+
+	// A sphere and a box: take the sphere's center into the space of the box, where the nearest point of the box is found by clamping.
+	uint32_t numCollisionMismatches = 0;
+	uint32_t numDepthMismatches = 0;
+	for (uint32_t i = 0; i < numPairs; i++)
+	{
+		auto sphere = static_cast<SphereShape*>(this->MakeShape(SPHERE));
+		auto box = static_cast<BoxShape*>(this->MakeShape(BOX));
+
+		Vector3 center = box->GetObjectToWorldTransform().Inverted().TransformPoint(sphere->GetObjectToWorldTransform().TransformPoint(sphere->GetCenter()));
+		const Vector3& extents = box->GetExtents();
+		Vector3 nearestPoint(IMZADI_CLAMP(center.x, -extents.x, extents.x), IMZADI_CLAMP(center.y, -extents.y, extents.y), IMZADI_CLAMP(center.z, -extents.z, extents.z));
+		double distance = (center - nearestPoint).Length();
+
+		// Deep in the box, the sphere comes out through whichever face is nearest its center.
+		double depth = sphere->GetRadius() - distance;
+		if (distance == 0.0)
+			depth = sphere->GetRadius() + IMZADI_MIN(IMZADI_MIN(extents.x - ::fabs(center.x), extents.y - ::fabs(center.y)), extents.z - ::fabs(center.z));
+
+		for (int j = 0; j < 2; j++)
+		{
+			ShapePairCollisionStatus* status = (j == 0) ? ConvexCollision::Calculate(sphere, box) : ConvexCollision::Calculate(box, sphere);
+
+			if (::fabs(depth) > touchingTolerance)
+			{
+				if (status->AreInCollision() != (depth > 0.0))
+					numCollisionMismatches++;
+				else if (status->AreInCollision() && ::fabs(status->GetSeparationDeltaLength() - depth) > touchingTolerance)
+					numDepthMismatches++;
+			}
+
+			delete status;
+		}
+
+		Shape::Free(sphere);
+		Shape::Free(box);
+	}
+
+	this->Check(numCollisionMismatches == 0, "sphere/box: %d case(s) where GJK disagrees with the geometry on collision.", numCollisionMismatches);
+	this->Check(numDepthMismatches == 0, "sphere/box: %d case(s) where GJK disagrees with the geometry on depth.", numDepthMismatches);
+
+	// A pair of capsules: they're in collision if and only if their spines are closer than the sum of their radii.
+	numCollisionMismatches = 0;
+	numDepthMismatches = 0;
+	for (uint32_t i = 0; i < numPairs; i++)
+	{
+		auto capsuleA = static_cast<CapsuleShape*>(this->MakeShape(CAPSULE));
+		auto capsuleB = static_cast<CapsuleShape*>(this->MakeShape(CAPSULE));
+
+		LineSegment spineA = capsuleA->GetObjectToWorldTransform().TransformLineSegment(capsuleA->GetSpine());
+		LineSegment spineB = capsuleB->GetObjectToWorldTransform().TransformLineSegment(capsuleB->GetSpine());
+		double distance = SegmentDistance(spineA, spineB);
+		double depth = capsuleA->GetRadius() + capsuleB->GetRadius() - distance;
+
+		ShapePairCollisionStatus* status = ConvexCollision::Calculate(capsuleA, capsuleB);
+
+		// Where the spines cross, the depth depends on more than their distance, so only the collision is checked.
+		if (::fabs(depth) > touchingTolerance)
+		{
+			if (status->AreInCollision() != (depth > 0.0))
+				numCollisionMismatches++;
+			else if (status->AreInCollision() && distance > 1e-3 && ::fabs(status->GetSeparationDeltaLength() - depth) > touchingTolerance)
+				numDepthMismatches++;
+		}
+
+		delete status;
+		Shape::Free(capsuleA);
+		Shape::Free(capsuleB);
+	}
+
+	this->Check(numCollisionMismatches == 0, "capsule/capsule: %d case(s) where GJK disagrees with the geometry on collision.", numCollisionMismatches);
+	this->Check(numDepthMismatches == 0, "capsule/capsule: %d case(s) where GJK disagrees with the geometry on depth.", numDepthMismatches);
+}
+
+void ConvexCollisionTest::TestSelfConsistency()
+{
+	constexpr uint32_t numPairs = 1000;
+
+	for (int kindA = 0; kindA < NUM_SHAPE_KINDS; kindA++)
+	{
+		for (int kindB = 0; kindB < NUM_SHAPE_KINDS; kindB++)
+		{
+			uint32_t numCollisions = 0;
+			uint32_t numUnresolved = 0;
+			uint32_t numOvershot = 0;
+			uint32_t numAsymmetric = 0;
+
+			for (uint32_t i = 0; i < numPairs; i++)
+			{
+				Shape* shapeA = this->MakeShape(ShapeKind(kindA));
+				Shape* shapeB = this->MakeShape(ShapeKind(kindB));
+
+				ShapePairCollisionStatus* status = ConvexCollision::Calculate(shapeA, shapeB);
+				ShapePairCollisionStatus* reverseStatus = ConvexCollision::Calculate(shapeB, shapeA);
+
+				if (status->AreInCollision())
+				{
+					numCollisions++;
+					Vector3 delta = status->GetSeparationDelta(shapeA->GetShapeID());
+
+					if (!reverseStatus->AreInCollision() || !DeltasAgree(reverseStatus->GetSeparationDelta(shapeA->GetShapeID()), delta))
+						numAsymmetric++;
+
+					// Moving the first shape by the delta, and a hair more, should just pull the shapes apart.
+					MoveShape(shapeA, delta * 1.000001);
+					ShapePairCollisionStatus* movedStatus = ConvexCollision::Calculate(shapeA, shapeB);
+					if (movedStatus->AreInCollision())
+						numUnresolved++;
+
+					delete movedStatus;
+
+					// Moving it only most of the way should not.
+					MoveShape(shapeA, delta * -0.011);
+					movedStatus = ConvexCollision::Calculate(shapeA, shapeB);
+					if (!movedStatus->AreInCollision())
+						numOvershot++;
+
+					delete movedStatus;
+				}
+
+				delete status;
+				delete reverseStatus;
+				Shape::Free(shapeA);
+				Shape::Free(shapeB);
+			}
+
+			const char* nameA = shapeKindName[kindA];
+			const char* nameB = shapeKindName[kindB];
+			this->Check(numCollisions > 0, "%s/%s: no pair was in collision.", nameA, nameB);
+			this->Check(numUnresolved == 0, "%s/%s: %d of %d separation deltas did not pull the shapes apart.", nameA, nameB, numUnresolved, numCollisions);
+			this->Check(numOvershot == 0, "%s/%s: %d of %d separation deltas were longer than needed.", nameA, nameB, numOvershot, numCollisions);
+			this->Check(numAsymmetric == 0, "%s/%s: %d of %d pairs gave a different answer with the shapes swapped.", nameA, nameB, numAsymmetric, numCollisions);
+		}
+	}
+}
+
+Shape* ConvexCollisionTest::MakeShape(ShapeKind kind)
+{
+	switch (kind)
+	{
+		case SPHERE:
+		{
+			auto sphere = SphereShape::Create();
+			sphere->SetCenter(this->RandomPoint(0.5, 0.5, 0.5));
+			sphere->SetRadius(this->Random(0.3, 1.5));
+			sphere->SetObjectToWorldTransform(this->RandomTransform(1.5));
+			return sphere;
+		}
+		case BOX:
+		{
+			auto box = BoxShape::Create();
+			box->SetExtents(Vector3(this->Random(0.2, 1.5), this->Random(0.2, 1.5), this->Random(0.2, 1.5)));
+			box->SetObjectToWorldTransform(this->RandomTransform(1.5));
+			return box;
+		}
+		case CAPSULE:
+		{
+			auto capsule = CapsuleShape::Create();
+			capsule->SetVertex(0, this->RandomPoint(1.0, 1.0, 1.0));
+			capsule->SetVertex(1, this->RandomPoint(1.0, 1.0, 1.0));
+			capsule->SetRadius(this->Random(0.2, 1.0));
+			capsule->SetObjectToWorldTransform(this->RandomTransform(1.5));
+			return capsule;
+		}
+		default:
+		{
+			// A regular polygon, so that it's sure to be convex and planar.
+			auto polygon = PolygonShape::Create();
+			int numVertices = this->RandomInt(3, 7);
+			double radius = this->Random(0.5, 2.0);
+			for (int i = 0; i < numVertices; i++)
+			{
+				double angle = 2.0 * M_PI * double(i) / double(numVertices);
+				polygon->AddVertex(Vector3(radius * ::cos(angle), radius * ::sin(angle), 0.0));
+			}
+
+			polygon->SetObjectToWorldTransform(this->RandomTransform(1.5));
+			return polygon;
+		}
+	}
+}
+
+Transform ConvexCollisionTest::RandomTransform(double translationRange)
+{
+	Vector3 unitAxis = this->RandomPoint(1.0, 1.0, 1.0).Normalized();
+	double angle = this->Random(0.0, 2.0 * M_PI);
+	return Transform(unitAxis, angle, this->RandomPoint(translationRange, translationRange, translationRange));
+}
+
+/*static*/ double ConvexCollisionTest::SegmentDistance(const LineSegment& lineSegmentA, const LineSegment& lineSegmentB)
+{
+	// The distance to the second segment is convex along the first, so a ternary search finds its least.
+	auto distanceAt = [&lineSegmentA, &lineSegmentB](double lambda) -> double
+	{
+		Vector3 point = lineSegmentA.Lerp(lambda);
+		return (lineSegmentB.ClosestPointTo(point) - point).Length();
+	};
+
+	double minLambda = 0.0;
+	double maxLambda = 1.0;
+	for (int i = 0; i < 200; i++)
+	{
+		double lambdaA = minLambda + (maxLambda - minLambda) / 3.0;
+		double lambdaB = maxLambda - (maxLambda - minLambda) / 3.0;
+		if (distanceAt(lambdaA) < distanceAt(lambdaB))
+			maxLambda = lambdaB;
+		else
+			minLambda = lambdaA;
+	}
+
+	return distanceAt((minLambda + maxLambda) / 2.0);
+}
+
+/*static*/ void ConvexCollisionTest::MoveShape(Shape* shape, const Vector3& delta)
+{
+	Transform objectToWorld = shape->GetObjectToWorldTransform();
+	objectToWorld.translation += delta;
+	shape->SetObjectToWorldTransform(objectToWorld);
+}
+
+/*static*/ bool ConvexCollisionTest::DeltasAgree(const Vector3& deltaA, const Vector3& deltaB)
+{
+	return (deltaA - deltaB).Length() <= 1e-6 * IMZADI_MAX(1.0, deltaB.Length());
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Test.h"
+#include "Math/Vector3.h"
+#include "Math/Transform.h"
+#include "Math/LineSegment.h"
+
+namespace Imzadi
+{
+	class Shape;
+}
+
+/**
+ * The GJK and EPA algorithms of the ConvexCollision class answer for every pair of shape types
+ * without a calculator of its own, so they're checked here on random pairs of every type.  Where
+ * a specialized calculator is known to be exact, the two must agree.  Where the answer is easy to
+ * work out from the geometry directly, it must match that.  For all pairs, the separation delta
+ * must be just enough to pull the shapes apart, and the same either way around.
+ */
+class ConvexCollisionTest : public Test
+{
+public:
+	ConvexCollisionTest();
+	virtual ~ConvexCollisionTest();
+
+	virtual void Run() override;
+
+private:
+
+	/**
+	 * These are the kinds of random shapes we make.
+	 */
+	enum ShapeKind
+	{
+		SPHERE,
+		BOX,
+		CAPSULE,
+		POLYGON,
+		NUM_SHAPE_KINDS
+	};
+
+	void TestAgainstCalculators();
+	void TestAgainstGeometry();
+	void TestSelfConsistency();
+
+	/**
+	 * Make a shape of the given kind, of random size, placed with a random rigid transform near the origin.
+	 */
+	Imzadi::Shape* MakeShape(ShapeKind kind);
+
+	/**
+	 * Return a random rotation about a random axis, followed by a random translation within the given range.
+	 */
+	Imzadi::Transform RandomTransform(double translationRange);
+
+	/**
+	 * Return the shortest distance between the given line segments, found by searching along the first
+	 * for the point nearest the second, so that it owes nothing to the code under test.
+	 */
+	static double SegmentDistance(const Imzadi::LineSegment& lineSegmentA, const Imzadi::LineSegment& lineSegmentB);
+
+	/**
+	 * Translate the given shape by the given delta in world space.
+	 */
+	static void MoveShape(Imzadi::Shape* shape, const Imzadi::Vector3& delta);
+
+	/**
+	 * Tell the caller if the given separation deltas are the same, to within rounding error.
+	 */
+	static bool DeltasAgree(const Imzadi::Vector3& deltaA, const Imzadi::Vector3& deltaB);
+
+	static const char* shapeKindName[NUM_SHAPE_KINDS];
+};
\ No newline at end of file
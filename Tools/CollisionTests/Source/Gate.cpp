@@ -0,0 +1,49 @@
+#include "Gate.h"
+#include <thread>
+
+//------------------------------------ Gate ------------------------------------
+
+Gate::Gate()
+{
+	this->reached = false;
+	this->opened = false;
+}
+
+/*virtual*/ Gate::~Gate()
+{
+}
+
+Imzadi::Command* Gate::MakeCommand()
+{
+	return new GateCommand(this);
+}
+
+void Gate::WaitUntilReached()
+{
+	while (!this->reached.load())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void Gate::Open()
+{
+	this->opened = true;
+}
+
+//------------------------------------ Gate::GateCommand ------------------------------------
+
+Gate::GateCommand::GateCommand(Gate* gate)
+{
+	this->gate = gate;
+}
+
+/*virtual*/ Gate::GateCommand::~GateCommand()
+{
+}
+
+/*virtual*/ void Gate::GateCommand::Execute(Imzadi::Thread* thread)
+{
+	this->gate->reached = true;
+
+	while (!this->gate->opened.load())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
\ No newline at end of file
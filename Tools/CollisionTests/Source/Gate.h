@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Collision/Command.h"
+#include <atomic>
+
+/**
+ * A gate holds up the collision thread at a known point, so that a test can send it more
+ * tasks, knowing they will all be staged together once the gate is opened.  Issue the
+ * command made by the MakeCommand method, and the collision thread blocks when it
+ * executes that command until the Open method is called.
+ */
+class Gate
+{
+public:
+	Gate();
+	virtual ~Gate();
+
+	/**
+	 * Make a command that blocks the collision thread at this gate.
+	 * Ownership of the memory is passed to the caller, who should issue it.
+	 */
+	Imzadi::Command* MakeCommand();
+
+	/**
+	 * Block the calling thread until the collision thread has reached this gate.
+	 */
+	void WaitUntilReached();
+
+	/**
+	 * Let the collision thread through this gate.
+	 */
+	void Open();
+
+private:
+
+	/**
+	 * This is the command that waits at the gate.
+	 */
+	class GateCommand : public Imzadi::Command
+	{
+	public:
+		GateCommand(Gate* gate);
+		virtual ~GateCommand();
+
+		virtual void Execute(Imzadi::Thread* thread) override;
+
+	private:
+		Gate* gate;
+	};
+
+	std::atomic<bool> reached;
+	std::atomic<bool> opened;
+};
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "Test.h"
+#include "TaskQueueTests.h"
+#include "AssistTests.h"
+#include "PriorityTests.h"
+#include "CoalesceTests.h"
+#include "SplitTests.h"
+#include "AllPairsTests.h"
+#include "CacheTests.h"
+#include "ConvexTests.h"
+#include "BoxTests.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Run the collision system tests headless.
+ * 
+ * With no arguments, every test is run, but no benchmark.  Pass --bench to also run the
+ * benchmarks, or pass the names of particular tests or benchmarks to run only those.
+ * The exit code is the number of tests that failed, so that this can be run by ctest.
+ */
+int main(int argc, char** argv)
+{
+	std::vector<Test*> testArray;
+	testArray.push_back(new TaskQueueStressTest());
+	testArray.push_back(new TaskQueueBenchmark());
+	testArray.push_back(new AssistDuringFlushTest());
+	testArray.push_back(new HighPriorityQueryOrderTest());
+	testArray.push_back(new MoveCoalescingTest());
+	testArray.push_back(new PolygonSplitTest());
+	testArray.push_back(new AllPairsTest());
+	testArray.push_back(new CollisionCacheTest());
+	testArray.push_back(new ConvexCollisionTest());
+	testArray.push_back(new BoxBoxTest());
+	testArray.push_back(new BoxBoxBenchmark());
+
+	bool runBenchmarks = false;
+	std::vector<const char*> nameArray;
+	for (int i = 1; i < argc; i++)
+	{
+		if (::strcmp(argv[i], "--bench") == 0)
+			runBenchmarks = true;
+		else if (::strcmp(argv[i], "--list") == 0)
+		{
+			for (Test* test : testArray)
+				printf("%s%s\n", test->GetName(), test->IsBenchmark() ? " (benchmark)" : "");
+			return 0;
+		}
+		else
+			nameArray.push_back(argv[i]);
+	}
+
+	int numFailedTests = 0;
+	int numRunTests = 0;
+
+	for (Test* test : testArray)
+	{
+		bool run = false;
+		if (nameArray.size() > 0)
+		{
+			for (const char* name : nameArray)
+				if (::strcmp(name, test->GetName()) == 0)
+					run = true;
+		}
+		else
+			run = runBenchmarks || !test->IsBenchmark();
+
+		if (!run)
+			continue;
+
+		printf("%s...\n", test->GetName());
+		fflush(stdout);
+
+		Stopwatch stopwatch;
+		test->Run();
+		double seconds = stopwatch.GetElapsedSeconds();
+
+		numRunTests++;
+		if (test->GetNumFailures() == 0)
+			printf("    PASSED (%.3f seconds)\n", seconds);
+		else
+		{
+			printf("    FAILED %d check(s) (%.3f seconds)\n", test->GetNumFailures(), seconds);
+			numFailedTests++;
+		}
+
+		fflush(stdout);
+	}
+
+	for (Test* test : testArray)
+		delete test;
+
+	printf("%d of %d test(s) passed.\n", numRunTests - numFailedTests, numRunTests);
+	return numFailedTests;
+}
\ No newline at end of file
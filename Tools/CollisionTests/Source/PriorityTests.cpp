@@ -0,0 +1,146 @@
+#include "PriorityTests.h"
+#include "Gate.h"
+#include "Collision/System.h"
+#include "Collision/Query.h"
+#include "Collision/Command.h"
+#include "Collision/Result.h"
+#include "Collision/CollisionCache.h"
+#include "Collision/Shapes/Sphere.h"
+
+using namespace Imzadi;
+
+namespace
+{
+	/**
+	 * This is a move that notes when it was executed.
+	 */
+	class StampedMoveCommand : public ObjectToWorldCommand
+	{
+	public:
+		StampedMoveCommand(std::atomic<uint32_t>* clock)
+		{
+			this->clock = clock;
+			this->stamp = nullptr;
+		}
+
+		virtual void Execute(Thread* thread) override
+		{
+			ObjectToWorldCommand::Execute(thread);
+			*this->stamp = ++(*this->clock);
+		}
+
+		std::atomic<uint32_t>* clock;
+		uint32_t* stamp;
+	};
+
+	/**
+	 * This is a collision query that notes when it was executed.
+	 */
+	class StampedCollisionQuery : public CollisionQuery
+	{
+	public:
+		StampedCollisionQuery(std::atomic<uint32_t>* clock)
+		{
+			this->clock = clock;
+			this->stamp = nullptr;
+		}
+
+		virtual Result* ExecuteQuery(Thread* thread) override
+		{
+			*this->stamp = ++(*this->clock);
+			return CollisionQuery::ExecuteQuery(thread);
+		}
+
+		std::atomic<uint32_t>* clock;
+		uint32_t* stamp;
+	};
+}
+
+HighPriorityQueryOrderTest::HighPriorityQueryOrderTest() : Test("HighPriorityQueryOrder")
+{
+}
+
+/*virtual*/ HighPriorityQueryOrderTest::~HighPriorityQueryOrderTest()
+{
+}
+
+/*virtual*/ void HighPriorityQueryOrderTest::Run()
+{
+	bool queryHitMovedShape = false;
+
+	// The moving shape ends up overlapping the queried shape, so the query must wait for the move.
+	bool jumped = this->QueryJumpsMove(50.0, 0.5, queryHitMovedShape);
+	this->Check(!jumped, "Query jumped ahead of a move into contact with its shape.");
+	this->Check(queryHitMovedShape, "Query missed the shape moved into contact with it.");
+
+	// The moving shape starts out overlapping the queried shape, so the query must wait for the move.
+	jumped = this->QueryJumpsMove(0.5, 50.0, queryHitMovedShape);
+	this->Check(!jumped, "Query jumped ahead of a move out of contact with its shape.");
+	this->Check(!queryHitMovedShape, "Query saw a shape moved out of contact with it.");
+
+	// The moving shape is nowhere near the queried shape, so the query may go first.
+	jumped = this->QueryJumpsMove(50.0, 60.0, queryHitMovedShape);
+	this->Check(jumped, "Query did not jump ahead of a move that could not affect it.");
+	this->Check(!queryHitMovedShape, "Query saw a shape that was never near it.");
+}
+
+bool HighPriorityQueryOrderTest::QueryJumpsMove(double startX, double endX, bool& queryHitMovedShape)
+{
+	queryHitMovedShape = false;
+
+	CollisionSystem collisionSystem;
+	if (!this->Check(collisionSystem.Initialize(MakeWorldBox(200.0), 1), "Failed to initialize collision system."))
+		return false;
+
+	auto queriedSphere = SphereShape::Create();
+	queriedSphere->SetRadius(1.0);
+	ShapeID queriedShapeID = collisionSystem.AddShape(queriedSphere, 0);
+
+	auto movingSphere = SphereShape::Create();
+	movingSphere->SetRadius(1.0);
+	movingSphere->SetCenter(Vector3(startX, 0.0, 0.0));
+	ShapeID movingShapeID = collisionSystem.AddShape(movingSphere, 0);
+
+	collisionSystem.FlushAllTasks();
+
+	Gate gate;
+	std::atomic<uint32_t> clock(0);
+	uint32_t moveStamp = 0;
+	uint32_t queryStamp = 0;
+
+	collisionSystem.IssueCommand(gate.MakeCommand());
+
+	// The sphere's center is in object space, so the move is relative to where it started.
+	auto move = new StampedMoveCommand(&clock);
+	move->stamp = &moveStamp;
+	move->SetShapeID(movingShapeID);
+	move->objectToWorld.SetIdentity();
+	move->objectToWorld.translation = Vector3(endX - startX, 0.0, 0.0);
+	collisionSystem.IssueCommand(move);
+
+	auto query = new StampedCollisionQuery(&clock);
+	query->stamp = &queryStamp;
+	query->SetShapeID(queriedShapeID);
+	query->SetPriority(Query::Priority::HIGH);
+	TaskID queryTaskID = 0;
+	collisionSystem.MakeQuery(query, queryTaskID);
+
+	gate.Open();
+	collisionSystem.FlushAllTasks();
+
+	Result* result = collisionSystem.ObtainQueryResult(queryTaskID);
+	auto collisionResult = dynamic_cast<CollisionQueryResult*>(result);
+	if (this->Check(collisionResult != nullptr, "No collision query result."))
+	{
+		for (const ShapePairCollisionStatus* status : collisionResult->GetCollisionStatusArray())
+			if (status->AreInCollision() && status->GetOtherShape(queriedShapeID) == movingShapeID)
+				queryHitMovedShape = true;
+	}
+
+	collisionSystem.Free<Result>(result);
+	collisionSystem.Shutdown();
+
+	this->Check(moveStamp != 0 && queryStamp != 0, "Move or query never executed.");
+	this->Report("Move from x=%.1f to x=%.1f: query executed %s the move.", startX, endX, (queryStamp < moveStamp) ? "before" : "after");
+	return queryStamp < moveStamp;
+}
\ No newline at end of file
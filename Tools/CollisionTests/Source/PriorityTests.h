@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Test.h"
+
+/**
+ * A high-priority collision query may be moved ahead of commands it does not depend on,
+ * but never ahead of a move that brings another shape into contact with its shape.
+ * The collision thread is held up while a move and a query are sent, so that both are
+ * staged together, and then the order in which they execute is checked.
+ */
+class HighPriorityQueryOrderTest : public Test
+{
+public:
+	HighPriorityQueryOrderTest();
+	virtual ~HighPriorityQueryOrderTest();
+
+	virtual void Run() override;
+
+private:
+	/**
+	 * Stage a move of the given shape to the given position along with a high-priority
+	 * collision query on the other shape, and report the order in which they executed.
+	 * 
+	 * @return True is returned if the query executed before the move; false, otherwise.
+	 */
+	bool QueryJumpsMove(double startX, double endX, bool& queryHitMovedShape);
+};
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "SplitTests.h"
+#include "Collision/System.h"
+#include "Collision/Query.h"
+#include "Collision/Result.h"
+#include "Collision/CollisionCache.h"
+#include "Collision/Shapes/Sphere.h"
+#include "Collision/Shapes/Polygon.h"
+#include <algorithm>
+
+using namespace Imzadi;
+
+PolygonSplitTest::PolygonSplitTest() : Test("PolygonSplit")
+{
+}
+
+/*virtual*/ PolygonSplitTest::~PolygonSplitTest()
+{
+}
+
+/*virtual*/ void PolygonSplitTest::Run()
+{
+	constexpr uint32_t numQuads = 60;
+	constexpr uint32_t numSpheres = 400;
+	constexpr uint32_t numRays = 2000;
+
+	// Make big squares at random orientations, spread throughout the world, but not sticking out of it.
+	for (uint32_t i = 0; i < numQuads; i++)
+	{
+		Vector3 center = this->RandomPoint(20.0, 20.0, 20.0);
+		Vector3 axisA = this->RandomPoint(1.0, 1.0, 1.0).Normalized();
+		Vector3 axisB = this->RandomPoint(1.0, 1.0, 1.0).RejectedFrom(axisA).Normalized();
+		double halfSize = this->Random(5.0, 20.0);
+
+		Quad quad;
+		quad.vertex[0] = center + axisA * halfSize + axisB * halfSize;
+		quad.vertex[1] = center - axisA * halfSize + axisB * halfSize;
+		quad.vertex[2] = center - axisA * halfSize - axisB * halfSize;
+		quad.vertex[3] = center + axisA * halfSize - axisB * halfSize;
+		this->quadArray.push_back(quad);
+	}
+
+	for (uint32_t i = 0; i < numSpheres; i++)
+	{
+		this->sphereCenterArray.push_back(this->RandomPoint(45.0, 45.0, 45.0));
+		this->sphereRadiusArray.push_back(this->Random(1.0, 3.0));
+	}
+
+	for (uint32_t i = 0; i < numRays; i++)
+	{
+		Vector3 origin = this->RandomPoint(45.0, 45.0, 45.0);
+		Vector3 unitDirection = this->RandomPoint(1.0, 1.0, 1.0).Normalized();
+		this->rayArray.push_back(Ray(origin, unitDirection));
+	}
+
+	Answers unsplitAnswers, splitAnswers;
+	if (!this->BuildAndQuery(0, unsplitAnswers) || !this->BuildAndQuery(IMZADI_ADD_FLAG_ALLOW_SPLIT, splitAnswers))
+		return;
+
+	uint32_t numCollisionMismatches = 0;
+	uint32_t numCollisions = 0;
+	for (uint32_t i = 0; i < numSpheres; i++)
+	{
+		numCollisions += (uint32_t)unsplitAnswers.collisionArray[i].size();
+		if (unsplitAnswers.collisionArray[i] != splitAnswers.collisionArray[i])
+			numCollisionMismatches++;
+	}
+
+	uint32_t numRayMismatches = 0;
+	uint32_t numRayHits = 0;
+	for (uint32_t i = 0; i < numRays; i++)
+	{
+		if (unsplitAnswers.rayHitArray[i] >= 0)
+			numRayHits++;
+
+		if (unsplitAnswers.rayHitArray[i] != splitAnswers.rayHitArray[i])
+			numRayMismatches++;
+		else if (unsplitAnswers.rayHitArray[i] >= 0 && ::fabs(unsplitAnswers.rayAlphaArray[i] - splitAnswers.rayAlphaArray[i]) > 1e-6)
+			numRayMismatches++;
+	}
+
+	this->Report("%d collisions and %d ray hits without splitting.", numCollisions, numRayHits);
+	this->Report("Polygons in the tree: %d unsplit, %d split.", unsplitAnswers.numShapesInTree, splitAnswers.numShapesInTree);
+	this->Report("Polygons in the upper nodes of the tree: %d unsplit, %d split.", unsplitAnswers.numShapesInUpperNodes, splitAnswers.numShapesInUpperNodes);
+
+	this->Check(numCollisionMismatches == 0, "%d sphere(s) collide with different shapes once polygons are split.", numCollisionMismatches);
+	this->Check(numRayMismatches == 0, "%d ray(s) hit differently once polygons are split.", numRayMismatches);
+	this->Check(splitAnswers.numShapesInTree > unsplitAnswers.numShapesInTree, "No polygon was split.");
+	this->Check(splitAnswers.numShapesInUpperNodes * 4 <= unsplitAnswers.numShapesInUpperNodes, "Splitting did not thin out the upper nodes of the tree.");
+}
+
+bool PolygonSplitTest::BuildAndQuery(uint32_t addFlags, Answers& answers)
+{
+	// The top few levels of the tree are where every query has to look.
+	constexpr uint32_t numUpperLevels = 4;
+
+	CollisionSystem collisionSystem;
+	if (!this->Check(collisionSystem.Initialize(MakeWorldBox(50.0), 1, BroadPhase::Type::BOUNDING_BOX_TREE), "Failed to initialize collision system."))
+		return false;
+
+	std::map<ShapeID, int> shapeIndexMap;
+	std::vector<ShapeID> sphereIDArray;
+
+	for (const Quad& quad : this->quadArray)
+	{
+		auto polygon = PolygonShape::Create();
+		for (int i = 0; i < 4; i++)
+			polygon->AddVertex(quad.vertex[i]);
+
+		ShapeID shapeID = collisionSystem.AddShape(polygon, addFlags);
+		shapeIndexMap.insert(std::pair<ShapeID, int>(shapeID, (int)shapeIndexMap.size()));
+	}
+
+	// Look at the tree before the spheres go in, so that only the polygons are counted.
+	bool allResultsFound = true;
+	answers.numShapesInUpperNodes = 0;
+	answers.numShapesInTree = 0;
+	TaskID diagnosticsTaskID = 0;
+	collisionSystem.MakeQuery(TreeDiagnosticsQuery::Create(), diagnosticsTaskID);
+	collisionSystem.WaitForTask(diagnosticsTaskID);
+	Result* result = collisionSystem.ObtainQueryResult(diagnosticsTaskID);
+	auto diagnosticsResult = dynamic_cast<TreeDiagnosticsResult*>(result);
+	if (!diagnosticsResult)
+		allResultsFound = false;
+	else
+	{
+		const TreeDiagnosticsResult::Diagnostics& diagnostics = diagnosticsResult->GetDiagnostics();
+		for (uint32_t depth = 0; depth < numUpperLevels; depth++)
+			answers.numShapesInUpperNodes += diagnostics.numShapesAtDepth[depth];
+
+		answers.numShapesInTree = diagnostics.numShapesInLeafNodes + diagnostics.numShapesInInteriorNodes;
+	}
+
+	collisionSystem.Free<Result>(result);
+
+	for (uint32_t i = 0; i < (uint32_t)this->sphereCenterArray.size(); i++)
+	{
+		auto sphere = SphereShape::Create();
+		sphere->SetCenter(this->sphereCenterArray[i]);
+		sphere->SetRadius(this->sphereRadiusArray[i]);
+
+		ShapeID shapeID = collisionSystem.AddShape(sphere, 0);
+		shapeIndexMap.insert(std::pair<ShapeID, int>(shapeID, (int)shapeIndexMap.size()));
+		sphereIDArray.push_back(shapeID);
+	}
+
+	QueryBatch* batch = QueryBatch::Create();
+	for (ShapeID shapeID : sphereIDArray)
+	{
+		auto query = CollisionQuery::Create();
+		query->SetShapeID(shapeID);
+		batch->Add(query);
+	}
+
+	for (const Ray& ray : this->rayArray)
+	{
+		auto query = RayCastQuery::Create();
+		query->SetRay(ray);
+		batch->Add(query);
+	}
+
+	TaskIDRange taskIDRange;
+	collisionSystem.MakeQueries(batch, taskIDRange);
+	collisionSystem.FlushAllTasks();
+
+	uint32_t j = 0;
+	for (ShapeID shapeID : sphereIDArray)
+	{
+		std::vector<int> collisionArray;
+		result = collisionSystem.ObtainQueryResult(taskIDRange[j++]);
+		auto collisionResult = dynamic_cast<CollisionQueryResult*>(result);
+		if (!collisionResult)
+			allResultsFound = false;
+		else
+		{
+			for (const ShapePairCollisionStatus* status : collisionResult->GetCollisionStatusArray())
+			{
+				if (!status->AreInCollision())
+					continue;
+
+				auto iter = shapeIndexMap.find(status->GetOtherShape(shapeID));
+				collisionArray.push_back((iter != shapeIndexMap.end()) ? iter->second : -1);
+			}
+		}
+
+		std::sort(collisionArray.begin(), collisionArray.end());
+		answers.collisionArray.push_back(collisionArray);
+		collisionSystem.Free<Result>(result);
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)this->rayArray.size(); i++)
+	{
+		int hitIndex = -1;
+		double alpha = 0.0;
+		result = collisionSystem.ObtainQueryResult(taskIDRange[j++]);
+		if (!result)
+			allResultsFound = false;
+		else
+		{
+			const RayCastResult::HitData& hitData = static_cast<RayCastResult*>(result)->GetHitData();
+			if (hitData.shapeID != 0)
+			{
+				auto iter = shapeIndexMap.find(hitData.shapeID);
+				hitIndex = (iter != shapeIndexMap.end()) ? iter->second : -2;
+				alpha = hitData.alpha;
+			}
+		}
+
+		answers.rayHitArray.push_back(hitIndex);
+		answers.rayAlphaArray.push_back(alpha);
+		collisionSystem.Free<Result>(result);
+	}
+
+	collisionSystem.Shutdown();
+
+	return this->Check(allResultsFound, "Some results were missing.");
+}
\ No newline at end of file
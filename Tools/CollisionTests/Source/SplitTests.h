@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Test.h"
+#include "Math/Vector3.h"
+#include "Math/Ray.h"
+#include <map>
+
+/**
+ * Large polygons straddle the dividing planes near the root of the bounding-box tree, so
+ * every query that goes down the tree has to test them.  Letting the tree split them should
+ * push their pieces down to deeper nodes without changing any answer.  The same scene of
+ * big polygons and small spheres is built with and without splitting, and the collision
+ * queries and ray casts made against each are compared, along with how many shapes sit
+ * in the upper nodes of the tree.
+ */
+class PolygonSplitTest : public Test
+{
+public:
+	PolygonSplitTest();
+	virtual ~PolygonSplitTest();
+
+	virtual void Run() override;
+
+private:
+
+	/**
+	 * These are the answers given by one build of the scene.  Shapes are referred to
+	 * by the order in which they were added, since their IDs differ between builds.
+	 */
+	struct Answers
+	{
+		std::vector<std::vector<int>> collisionArray;		///< For each sphere, these are the shapes it was found to collide with, in order.
+		std::vector<int> rayHitArray;						///< For each ray, this is the shape it hit first, or -1 if none.
+		std::vector<double> rayAlphaArray;					///< For each ray, this is the distance to the hit, if any.
+		uint32_t numShapesInUpperNodes;						///< This is the number of shapes held in nodes of the top few levels of the tree.
+		uint32_t numShapesInTree;							///< This is the number of shapes (or pieces thereof) held anywhere in the tree.
+	};
+
+	/**
+	 * Build the scene, with or without polygon splitting, and gather its answers.
+	 */
+	bool BuildAndQuery(uint32_t addFlags, Answers& answers);
+
+	struct Quad
+	{
+		Imzadi::Vector3 vertex[4];
+	};
+
+	std::vector<Quad> quadArray;
+	std::vector<Imzadi::Vector3> sphereCenterArray;
+	std::vector<double> sphereRadiusArray;
+	std::vector<Imzadi::Ray> rayArray;
+};
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "TaskQueueTests.h"
+#include "Collision/TaskQueue.h"
+#include "Collision/Task.h"
+#include <thread>
+#include <list>
+#include <mutex>
+#include <semaphore>
+
+using namespace Imzadi;
+
+namespace
+{
+	/**
+	 * These tasks are never executed.  They just remember who pushed them and when.
+	 */
+	class MarkerTask : public Task
+	{
+	public:
+		MarkerTask()
+		{
+			this->producer = 0;
+			this->sequence = 0;
+		}
+
+		virtual void Execute(Thread* thread) override
+		{
+		}
+
+		uint32_t producer;
+		uint32_t sequence;
+	};
+
+	/**
+	 * This is how the collision thread queued tasks before the TaskQueue class.
+	 */
+	class LockingTaskQueue
+	{
+	public:
+		LockingTaskQueue() : semaphore(0)
+		{
+		}
+
+		void Push(Task* task)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->taskList.push_back(task);
+			}
+
+			this->semaphore.release();
+		}
+
+		Task* Pop()
+		{
+			this->semaphore.acquire();
+			std::lock_guard<std::mutex> lock(this->mutex);
+			Task* task = this->taskList.front();
+			this->taskList.pop_front();
+			return task;
+		}
+
+	private:
+		std::list<Task*> taskList;
+		std::mutex mutex;
+		std::counting_semaphore<> semaphore;
+	};
+
+	/**
+	 * Make the tasks for the given number of producers, each of which will push the given number of tasks.
+	 */
+	void MakeMarkerTasks(std::vector<MarkerTask>& taskArray, uint32_t numProducers, uint32_t numTasksPerProducer)
+	{
+		taskArray.resize(numProducers * numTasksPerProducer);
+		for (uint32_t i = 0; i < numProducers; i++)
+		{
+			for (uint32_t j = 0; j < numTasksPerProducer; j++)
+			{
+				MarkerTask& task = taskArray[i * numTasksPerProducer + j];
+				task.producer = i;
+				task.sequence = j;
+			}
+		}
+	}
+}
+
+//------------------------------------ TaskQueueStressTest ------------------------------------
+
+TaskQueueStressTest::TaskQueueStressTest() : Test("TaskQueueStress")
+{
+}
+
+/*virtual*/ TaskQueueStressTest::~TaskQueueStressTest()
+{
+}
+
+/*virtual*/ void TaskQueueStressTest::Run()
+{
+	constexpr uint32_t numProducers = 6;
+	constexpr uint32_t numTasksPerProducer = 200000;
+
+	std::vector<MarkerTask> taskArray;
+	MakeMarkerTasks(taskArray, numProducers, numTasksPerProducer);
+
+	// Keep the ring small so that the producers spend a good deal of time finding it full.
+	TaskQueue taskQueue(64);
+
+	std::vector<std::thread*> producerArray;
+	for (uint32_t i = 0; i < numProducers; i++)
+	{
+		producerArray.push_back(new std::thread([&taskArray, &taskQueue, i]()
+		{
+			for (uint32_t j = 0; j < numTasksPerProducer; j++)
+			{
+				Task* task = &taskArray[i * numTasksPerProducer + j];
+
+				// Exercise both ways of pushing.
+				if (j % 2 == 0)
+					taskQueue.Push(task);
+				else
+					while (!taskQueue.TryPush(task))
+						std::this_thread::yield();
+			}
+		}));
+	}
+
+	std::vector<uint32_t> nextSequenceArray(numProducers, 0);
+	uint32_t numOutOfOrder = 0;
+	uint32_t numPopped = 0;
+	while (numPopped < numProducers * numTasksPerProducer)
+	{
+		Task* task = nullptr;
+		if (!taskQueue.TryPop(task))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		auto markerTask = static_cast<MarkerTask*>(task);
+		if (markerTask->sequence != nextSequenceArray[markerTask->producer])
+			numOutOfOrder++;
+
+		nextSequenceArray[markerTask->producer] = markerTask->sequence + 1;
+		numPopped++;
+	}
+
+	for (std::thread* producer : producerArray)
+	{
+		producer->join();
+		delete producer;
+	}
+
+	Task* task = nullptr;
+	this->Check(!taskQueue.TryPop(task), "Queue should be empty once every task is popped.");
+	this->Check(taskQueue.GetSize() == 0, "Queue reports size %d when empty.", taskQueue.GetSize());
+	this->Check(numOutOfOrder == 0, "%d task(s) came out of order.", numOutOfOrder);
+
+	for (uint32_t i = 0; i < numProducers; i++)
+		this->Check(nextSequenceArray[i] == numTasksPerProducer, "Producer %d: last task popped was %d of %d.", i, nextSequenceArray[i], numTasksPerProducer);
+
+	this->Report("Popped %d tasks from %d producers through a ring of %d cells.", numPopped, numProducers, taskQueue.GetCapacity());
+}
+
+//------------------------------------ TaskQueueBenchmark ------------------------------------
+
+TaskQueueBenchmark::TaskQueueBenchmark() : Test("TaskQueueBenchmark")
+{
+}
+
+/*virtual*/ TaskQueueBenchmark::~TaskQueueBenchmark()
+{
+}
+
+/*virtual*/ bool TaskQueueBenchmark::IsBenchmark() const
+{
+	return true;
+}
+
+/*virtual*/ void TaskQueueBenchmark::Run()
+{
+	constexpr uint32_t numTasksPerProducer = 200000;
+
+	for (uint32_t numProducers = 1; numProducers <= 8; numProducers *= 2)
+	{
+		std::vector<MarkerTask> taskArray;
+		MakeMarkerTasks(taskArray, numProducers, numTasksPerProducer);
+		uint32_t numTasks = numProducers * numTasksPerProducer;
+
+		double taskQueueSeconds = 0.0;
+		{
+			TaskQueue taskQueue(8192);
+			Stopwatch stopwatch;
+
+			std::vector<std::thread*> producerArray;
+			for (uint32_t i = 0; i < numProducers; i++)
+			{
+				producerArray.push_back(new std::thread([&taskArray, &taskQueue, i]()
+				{
+					for (uint32_t j = 0; j < numTasksPerProducer; j++)
+						taskQueue.Push(&taskArray[i * numTasksPerProducer + j]);
+				}));
+			}
+
+			uint32_t numPopped = 0;
+			while (numPopped < numTasks)
+			{
+				Task* task = nullptr;
+				if (taskQueue.TryPop(task))
+					numPopped++;
+				else
+					std::this_thread::yield();
+			}
+
+			taskQueueSeconds = stopwatch.GetElapsedSeconds();
+
+			for (std::thread* producer : producerArray)
+			{
+				producer->join();
+				delete producer;
+			}
+		}
+
+		double lockingQueueSeconds = 0.0;
+		{
+			LockingTaskQueue lockingQueue;
+			Stopwatch stopwatch;
+
+			std::vector<std::thread*> producerArray;
+			for (uint32_t i = 0; i < numProducers; i++)
+			{
+				producerArray.push_back(new std::thread([&taskArray, &lockingQueue, i]()
+				{
+					for (uint32_t j = 0; j < numTasksPerProducer; j++)
+						lockingQueue.Push(&taskArray[i * numTasksPerProducer + j]);
+				}));
+			}
+
+			for (uint32_t i = 0; i < numTasks; i++)
+				lockingQueue.Pop();
+
+			lockingQueueSeconds = stopwatch.GetElapsedSeconds();
+
+			for (std::thread* producer : producerArray)
+			{
+				producer->join();
+				delete producer;
+			}
+		}
+
+		this->Report("%d producer(s), %d tasks: TaskQueue %.1f ns/task, list+mutex+semaphore %.1f ns/task (%.2fx)",
+			numProducers, numTasks,
+			taskQueueSeconds * 1e9 / double(numTasks),
+			lockingQueueSeconds * 1e9 / double(numTasks),
+			lockingQueueSeconds / taskQueueSeconds);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Test.h"
+
+/**
+ * Several producer threads push tasks into one TaskQueue while a single consumer pops them
+ * off, as the collision thread would.  Every task must come out exactly once, and the
+ * tasks of any one producer must come out in the order that producer pushed them.
+ */
+class TaskQueueStressTest : public Test
+{
+public:
+	TaskQueueStressTest();
+	virtual ~TaskQueueStressTest();
+
+	virtual void Run() override;
+};
+
+/**
+ * Time the same multi-producer workload through the TaskQueue and through the
+ * list, mutex and semaphore arrangement that the collision thread used to queue tasks with.
+ */
+class TaskQueueBenchmark : public Test
+{
+public:
+	TaskQueueBenchmark();
+	virtual ~TaskQueueBenchmark();
+
+	virtual void Run() override;
+	virtual bool IsBenchmark() const override;
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "Test.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+//------------------------------------ Test ------------------------------------
+
+Test::Test(const char* name)
+{
+	this->name = name;
+	this->numFailures = 0;
+	this->randomState = 0x2545F4914F6CDD1Dull;
+}
+
+/*virtual*/ Test::~Test()
+{
+}
+
+/*virtual*/ bool Test::IsBenchmark() const
+{
+	return false;
+}
+
+void Test::Report(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	printf("    ");
+	vprintf(format, args);
+	printf("\n");
+	va_end(args);
+}
+
+bool Test::Check(bool condition, const char* format, ...)
+{
+	if (!condition)
+	{
+		this->numFailures++;
+
+		va_list args;
+		va_start(args, format);
+		printf("    FAILED: ");
+		vprintf(format, args);
+		printf("\n");
+		va_end(args);
+	}
+
+	return condition;
+}
+
+double Test::Random(double min, double max)
+{
+	// This is xorshift64*.  It's good enough here and, unlike std::rand, gives the same sequence on every platform.
+	this->randomState ^= this->randomState >> 12;
+	this->randomState ^= this->randomState << 25;
+	this->randomState ^= this->randomState >> 27;
+	uint64_t bits = this->randomState * 0x2545F4914F6CDD1Dull;
+	double alpha = double(bits >> 11) / double(1ull << 53);
+	return min + alpha * (max - min);
+}
+
+int Test::RandomInt(int min, int max)
+{
+	int i = min + int(this->Random(0.0, double(max - min + 1)));
+	return (i > max) ? max : i;
+}
+
+Imzadi::Vector3 Test::RandomPoint(double halfX, double halfY, double halfZ)
+{
+	double x = this->Random(-halfX, halfX);
+	double y = this->Random(-halfY, halfY);
+	double z = this->Random(-halfZ, halfZ);
+	return Imzadi::Vector3(x, y, z);
+}
+
+/*static*/ Imzadi::AxisAlignedBoundingBox Test::MakeWorldBox(double halfSize)
+{
+	Imzadi::AxisAlignedBoundingBox worldBox;
+	worldBox.minCorner = Imzadi::Vector3(-halfSize, -halfSize, -halfSize);
+	worldBox.maxCorner = Imzadi::Vector3(halfSize, halfSize, halfSize);
+	return worldBox;
+}
+
+//------------------------------------ Stopwatch ------------------------------------
+
+Stopwatch::Stopwatch()
+{
+	this->startTime = std::chrono::steady_clock::now();
+}
+
+double Stopwatch::GetElapsedSeconds() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->startTime).count();
+}
\ No newline at end of file
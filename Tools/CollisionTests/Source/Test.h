@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <chrono>
+#include "Math/AxisAlignedBoundingBox.h"
+
+/**
+ * This is the base class of every test and benchmark run by the CollisionTests tool.
+ * Tests run headless against the collision system, print what they measured, and
+ * record a failure for every check that does not hold.  Benchmarks only print timings
+ * and are run only when asked for.
+ */
+class Test
+{
+public:
+	Test(const char* name);
+	virtual ~Test();
+
+	/**
+	 * Derivatives must impliment this method to perform the test.
+	 */
+	virtual void Run() = 0;
+
+	/**
+	 * Tell the caller if this is a benchmark rather than a correctness test.
+	 * Benchmarks take longer and are not run by default.
+	 */
+	virtual bool IsBenchmark() const;
+
+	/**
+	 * Get the name by which this test can be selected on the command-line.
+	 */
+	const char* GetName() const { return this->name.c_str(); }
+
+	/**
+	 * Get the number of checks that have failed so far.
+	 */
+	uint32_t GetNumFailures() const { return this->numFailures; }
+
+protected:
+
+	/**
+	 * Print the given printf-style message under this test's name.
+	 */
+	void Report(const char* format, ...);
+
+	/**
+	 * Record a failure, along with the given printf-style message, if the given condition is false.
+	 * 
+	 * @return The given condition is returned so that the caller can bail out early.
+	 */
+	bool Check(bool condition, const char* format, ...);
+
+	/**
+	 * Return a uniformly distributed random number in the range [min,max].
+	 * The sequence is seeded the same on every run so that failures can be reproduced.
+	 */
+	double Random(double min, double max);
+
+	/**
+	 * Return a uniformly distributed random integer in the range [min,max].
+	 */
+	int RandomInt(int min, int max);
+
+	/**
+	 * Return a random point in the box centered at the origin with the given half-extents.
+	 */
+	Imzadi::Vector3 RandomPoint(double halfX, double halfY, double halfZ);
+
+	/**
+	 * Return a cube centered at the origin with the given half-size, for use as the collision world box.
+	 */
+	static Imzadi::AxisAlignedBoundingBox MakeWorldBox(double halfSize);
+
+private:
+	std::string name;
+	uint32_t numFailures;
+	uint64_t randomState;
+};
+
+/**
+ * This is a stopwatch for the benchmarks.
+ */
+class Stopwatch
+{
+public:
+	Stopwatch();
+
+	/**
+	 * Return the number of seconds elapsed since construction.
+	 */
+	double GetElapsedSeconds() const;
+
+private:
+	std::chrono::steady_clock::time_point startTime;
+};
\ No newline at end of file